@@ -198,6 +198,7 @@ void print_usage() {
     printf("Usage: logvs logName iCOUNT sSLEEP t1 t2 t3...\n"
            "    logName     fon9     use fon9_LOG_INFO(test_values)\n"
            "                fon9fmt  use fon9_LOG_INFO(fon9::Fmt{}, test_values)\n"
+           "                fon9d    use fon9_LOG_INFO(test_values) with StartLogDeferred()\n"
          //"                fon9lf   lock-free test\n"
            "                spdlog\n"
            "                nanolog\n"
@@ -288,6 +289,15 @@ int main(int argc, char * argv[])
            };
         run_benchmark_threads(fon9BenchmarkFn, "fon9_LOG");
     }
+    else if(strcmp(argv[1], "fon9d") == 0) {
+        fon9::InitLogWriteToFile("/tmp/fon9d-latency.txt", fon9::TimeChecker::TimeScale::No, 0, 0);
+        fon9::StartLogDeferred();
+        auto fon9BenchmarkFn = [](int i, char const * const cstr) {
+           fon9_LOG_INFO("[" __FILE__ ":", __func__, ":" fon9_CTXTOCSTR(__LINE__) "] ", "Logging ", cstr, i, 0, 'K', fon9::Decimal<int64_t, 6>(-42.42), ", for more info.");
+           };
+        run_benchmark_threads(fon9BenchmarkFn, "fon9_LOG:deferred");
+        fon9::StopLogDeferred();
+    }
     else if(strcmp(argv[1], "fon9lf") == 0) {
         fon9::impl::MemBlockInit(fon9::kLogBlockNodeSize, 16, 1024); // mem usage: (lists) * (nodes) * 256(bytes)
         fon9::slistfd.Open("/tmp/fon9-slist.txt", fon9::FileMode::Append | fon9::FileMode::CreatePath);
@@ -4,6 +4,8 @@ rm -rf /tmp/*.log
 echo ======================================================================
 /usr/bin/time -v ./logvs fon9 $*
 echo ----------------------------------------------------------------------
+/usr/bin/time -v ./logvs fon9d $*
+echo ----------------------------------------------------------------------
 #/usr/bin/time -v ./logvs nanolog $*
 echo ----------------------------------------------------------------------
 /usr/bin/time -v ./logvs spdlog $*
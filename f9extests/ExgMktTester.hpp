@@ -9,6 +9,7 @@
 #include "fon9/TestTools.hpp"
 #include "fon9/RevPrint.hpp"
 #include "fon9/buffer/DcQueue.hpp"
+#include "fon9/PkReceiver.hpp"
 
 namespace f9extests {
 
@@ -37,13 +38,33 @@ public:
 
 /// 將 mdf 一次全部餵給 pkReceiver.
 /// 並顯示: 平均每筆封包處理時間. 封包數量、CheckSum錯誤次數, 錯誤的資料量.
+/// - 在餵給 pkReceiver 之前, 會先使用其他的 PkReceiver::ScanImpl 各餵一次,
+///   用來比較 CheckSum 及封包框架搜尋, 使用不同指令集的效率差異.
+/// - pkReceiver 使用此 CPU 可用的最快實作.
 template <class PkReceiverT>
 double ExgMktFeedAll(const MktDataFile& mdf, PkReceiverT& pkReceiver) {
+   using ScanImpl = fon9::PkReceiver::ScanImpl;
+   const ScanImpl bestImpl = fon9::PkReceiver::GetBestScanImpl();
+   for (ScanImpl impl : {ScanImpl::Scalar, ScanImpl::SSE2, ScanImpl::AVX2}) {
+      if (impl == bestImpl || !fon9::PkReceiver::SetScanImpl(impl))
+         continue;
+      std::unique_ptr<PkReceiverT> tmpReceiver{new PkReceiverT};
+      fon9::DcQueueFixedMem   dcq{mdf.Buffer_, mdf.Size_};
+      fon9::StopWatch         stopWatch;
+      tmpReceiver->FeedBuffer(dcq);
+      std::string msg = "Fetch packet|";
+      msg.append(fon9::PkReceiver::GetScanImplName(impl));
+      stopWatch.PrintResult(msg.c_str(), tmpReceiver->ReceivedCount_);
+   }
+   fon9::PkReceiver::SetScanImpl(bestImpl);
+
    fon9::DcQueueFixedMem   dcq{mdf.Buffer_, mdf.Size_};
    fon9::StopWatch         stopWatch;
    pkReceiver.FeedBuffer(dcq);
    const double tmFull = stopWatch.StopTimer();
-   stopWatch.PrintResult(tmFull, "Fetch packet", pkReceiver.ReceivedCount_);
+   std::string msg = "Fetch packet|";
+   msg.append(fon9::PkReceiver::GetScanImplName(bestImpl));
+   stopWatch.PrintResult(tmFull, msg.c_str(), pkReceiver.ReceivedCount_);
 
    std::cout << "ReceivedCount=" << pkReceiver.ReceivedCount_
       << "|ChkSumErrCount=" << pkReceiver.ChkSumErrCount_
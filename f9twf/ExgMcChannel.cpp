@@ -1,6 +1,7 @@
 ﻿// \file f9twf/ExgMcChannel.cpp
 // \author fonwinz@gmail.com
 #include "f9twf/ExgMcChannel.hpp"
+#include "f9twf/ExgMcPipeline.hpp"
 #include "f9twf/ExgMdPkReceiver.hpp"
 #include "f9twf/ExgMcFmtSS.hpp"
 #include "f9twf/ExgMrRecover.hpp"
@@ -22,12 +23,14 @@ void ExgMcChannel::StartupChannel(std::string logPath) {
    this->State_ = (IsEnumContainsAny(this->Style_, ExgMcChannelStyle::WaitBasic | ExgMcChannelStyle::WaitSnapshot)
                    ? ExgMcChannelState::Waiting : ExgMcChannelState::Running);
    this->CycleStartSeq_ = 0;
+   this->CycleStartPos_ = kInvalidPos;
    this->CycleBeforeLostCount_ = 0;
    this->Pk1stPos_ = 0;
    this->Pk1stSeq_ = 0;
    this->ReceivedCountInHb_ = 0;
    this->Clear();
    this->PkLog_.reset();
+   this->PkLogIdx_.Close();
    if (IsEnumContainsAny(this->Style_, ExgMcChannelStyle::PkLog | ExgMcChannelStyle::Reload)) {
       fon9::NumOutBuf nbuf;
       logPath.append(fon9::ToStrRev(nbuf.end(), this->ChannelId_, fon9::FmtDef{4, fon9::FmtFlag::IntPad0}),
@@ -44,6 +47,13 @@ void ExgMcChannel::StartupChannel(std::string logPath) {
          this->PkLog_.reset();
          fon9_LOG_FATAL(this->ChannelMgr_->Name_, ".StartupChannel|channelId=", this->ChannelId_, "|fn=", logPath, '|', res);
       }
+      else {
+         // 索引開啟失敗, 不影響 PkLog, 只是 ReloadDispatch() 需要從 Pk1stPos_ 開始讀取.
+         logPath.append(".idx");
+         res = this->PkLogIdx_.Open(logPath, this->Pk1stPos_);
+         if (res.IsError())
+            fon9_LOG_ERROR(this->ChannelMgr_->Name_, ".StartupChannel|channelId=", this->ChannelId_, "|fn=", logPath, '|', res);
+      }
    }
    if (this->IsSnapshot()) // 快照更新, 尚未收到 A:Refresh Begin 之前, 不記錄 PkLog.
       this->IsSkipPkLog_ = true;
@@ -73,7 +83,10 @@ void ExgMcChannel::SetupReload() {
       }
    };
    McReloader           reloader{*this};
-   fon9::File::SizeType fpos = 0;
+   // 輪播 channel 的每個循環都包含完整的資料(例: 基本資料),
+   // 所以只要從最後一個完整(沒有遺漏)循環的起點開始載入即可, 不用讀取整個 PkLog.
+   const fon9::TsAppendIndex::Entry* mark = this->PkLogIdx_.GetLastMark();
+   fon9::File::SizeType              fpos = (mark ? mark->Pos_ : 0);
    fon9::File::Result   res = fon9::FileReadAll(*this->PkLog_, fpos, reloader);
    if (res.IsError())
       fon9_LOG_FATAL(this->ChannelMgr_->Name_, ".SetupReload|channelId=", this->ChannelId_, "|pos=", fpos, '|', res);
@@ -106,6 +119,12 @@ void ExgMcChannel::ReloadDispatch(SeqT fromSeq) {
    };
    McReloader           reloader{*this, fromSeq};
    fon9::File::SizeType fpos = this->Pk1stPos_;
+   if (fromSeq != 0) {
+      // 透過索引直接跳到 fromSeq 附近, 不用讀取 [Pk1stPos_..fromSeq) 的封包.
+      const fon9::File::PosType idxpos = this->PkLogIdx_.FindPosBySeq(fromSeq);
+      if (fpos < idxpos)
+         fpos = idxpos;
+   }
    fon9::File::Result   res = fon9::FileReadAll(*this->PkLog_, fpos, reloader);
    if (res.IsError())
       fon9_LOG_FATAL(this->ChannelMgr_->Name_, ".ReloadDispatch|channelId=", this->ChannelId_, "|pos=", fpos, '|', res);
@@ -314,6 +333,12 @@ ExgMcChannelState ExgMcChannel::OnPkHb(const ExgMcHead& pk, unsigned pksz) {
                       ? ExgMcChannelState::CanBeClosed : ExgMcChannelState::Cycled);
       this->ChannelMgr_->ChannelCycled(*this);
    }
+   if (IsEnumContains(this->Style_, ExgMcChannelStyle::Reload)
+       && this->CycleStartSeq_
+       && this->CycleStartPos_ != kInvalidPos
+       && !this->IsSkipPkLog_
+       && this->LostCount_ - this->CycleBeforeLostCount_ == 0)
+      this->PkLogIdx_.AddMark(this->CycleStartSeq_, fon9::UtcNow(), this->CycleStartPos_);
    this->OnCycleStart(seq + 1);
    return this->State_;
 }
@@ -331,10 +356,13 @@ ExgMcChannelState ExgMcChannel::OnPkSeqReset(const ExgMcHead& pk, unsigned pksz)
 
    const SeqT seq = pk.GetChannelSeq();
    this->PkLogAppend(&pk, pksz, seq);
+   // 必須等 Pipeline 處理完之前的訊息, 才能處理 SeqReset.
+   // 此時不可鎖定 PkPendings_, 因為 receive stage 可能在 PkPendings_ 鎖定狀態下等候 ring 的空間.
+   if (this->Pipeline_)
+      this->Pipeline_->WaitChannelEmpty(this->PipelineIndex_);
 
    auto pks = this->PkPendings_.Lock();
-   pks->clear();
-   this->NextSeq_ = 0;
+   this->ResetSeqLocked(pks);
    if (!this->IsSetupReloading_) {
       // SeqReset 需要自行觸發 DispatchMcMessage(裡面會觸發 NotifyConsumers).
       ExgMcMessage e(pk, pksz, *this, seq);
@@ -351,7 +379,7 @@ ExgMcChannelState ExgMcChannel::OnPkSeqReset(const ExgMcHead& pk, unsigned pksz)
    return this->State_;
 }
 // 收到完整封包後, 會執行到此, 尚未確定是否重複或有遺漏.
-ExgMcChannelState ExgMcChannel::OnPkReceived(const ExgMcHead& pk, unsigned pksz) {
+ExgMcChannelState ExgMcChannel::OnPkReceived(const ExgMcHead& pk, unsigned pksz, unsigned lineIndex) {
    assert(pk.GetChannelId() == this->ChannelId_);
    ++this->ReceivedCountInHb_;
    // ----- 處理特殊訊息: Hb, SeqReset...
@@ -382,7 +410,7 @@ ExgMcChannelState ExgMcChannel::OnPkReceived(const ExgMcHead& pk, unsigned pksz)
    // ----- 不允許任意順序 or 有其他 Style, 則應透過 [序號連續] 機制處理.
    if ((this->Style_ - ExgMcChannelStyle::AnySeq) != ExgMcChannelStyle{}
        || this->Style_ == ExgMcChannelStyle{})
-      this->FeedPacket(&pk, pksz, seq);
+      this->FeedPacketFrom(lineIndex, &pk, pksz, seq);
    return this->State_;
 }
 // -----
@@ -400,8 +428,12 @@ void ExgMcChannel::PkContOnReceived(const void* pk, unsigned pksz, SeqT seq) {
             return;
       }
       if (fon9_LIKELY(this->State_ != ExgMcChannelState::Waiting)) {
-         ExgMcMessage e(*static_cast<const ExgMcHead*>(pk), pksz, *this, seq);
-         this->DispatchMcMessage(e);
+         if (this->Pipeline_)
+            this->Pipeline_->Push(this->PipelineIndex_, *static_cast<const ExgMcHead*>(pk), pksz);
+         else {
+            ExgMcMessage e(*static_cast<const ExgMcHead*>(pk), pksz, *this, seq);
+            this->DispatchMcMessage(e);
+         }
       }
    }
    this->LastInfoTime_ = static_cast<const ExgMcHead*>(pk)->InformationTime_.ToDayTime();
@@ -411,10 +443,9 @@ void ExgMcChannel::DispatchMcMessage(ExgMcMessage& e) {
    assert(this->PkPendings_.IsLocked());
    assert(e.Pk_.GetChannelId() == this->ChannelId_);
    this->ChannelMgr_->DispatchMcMessage(e);
-   this->NotifyConsumersLocked(e);
+   this->NotifyConsumers(e);
 }
-void ExgMcChannel::NotifyConsumersLocked(ExgMcMessage& e) {
-   assert(this->PkPendings_.IsLocked());
+void ExgMcChannel::NotifyConsumers(ExgMcMessage& e) {
    if (this->IsSetupReloading_)
       return;
    struct Combiner {
@@ -423,7 +454,7 @@ void ExgMcChannel::NotifyConsumersLocked(ExgMcMessage& e) {
          return true;
       }
    } combiner;
-   this->UnsafeConsumers_.Combine(combiner, e);
+   this->Consumers_.Combine(combiner, e);
 }
 bool ExgMcChannel::OnPkContSnapshot(const ExgMcHead& pk) {
    assert(this->IsSnapshot());
@@ -542,11 +573,37 @@ ExgMcChannelMgr::ExgMcChannelMgr(ExgMdSymbsSP symbs, fon9::StrView sysName, fon9
    // 快照更新.
    this->Channels_[13].Ctor(this, 13, ExgMcChannelStyle::Snapshot);
    this->Channels_[14].Ctor(this, 14, ExgMcChannelStyle::Snapshot);
+   for (ExgMcChannel& channel : this->Channels_)
+      channel.SetArbiterArgs(&this->ArbiterArgs_);
 }
 ExgMcChannelMgr::~ExgMcChannelMgr() {
 }
+void ExgMcChannelMgr::StartPipeline(const ExgMcPipelineArgs& args) {
+   assert(!this->Pipeline_);
+   if (this->Pipeline_)
+      return;
+   this->Pipeline_.reset(new ExgMcPipeline{args});
+   for (ExgMcChannel& channel : this->Channels_) {
+      if (channel.IsRealtime()) {
+         channel.PipelineIndex_ = static_cast<uint16_t>(this->Pipeline_->AddChannel(channel));
+         channel.Pipeline_ = this->Pipeline_.get();
+      }
+   }
+   this->Pipeline_->Start();
+   fon9_LOG_INFO(this->Name_, ".StartPipeline"
+                 "|DecodeCpu=", args.DecodeCpu_,
+                 "|PublishCpu=", args.PublishCpu_,
+                 "|PublishThread=", args.IsPublishThread_ ? 'Y' : 'N',
+                 "|RingSize=", args.RingSize_,
+                 "|Wait=", fon9::HowWaitToStr(args.HowWait_),
+                 "|SpinCount=", args.AdaptiveWait_.SpinCount_,
+                 "|YieldCount=", args.AdaptiveWait_.YieldCount_);
+}
 void ExgMcChannelMgr::StartupChannelMgr(std::string logPath) {
    fon9_LOG_INFO(this->Name_, ".StartupChannelMgr|path=", logPath);
+   // 重新啟動前, 必須先等 Pipeline 處理完之前的訊息.
+   if (this->Pipeline_)
+      this->Pipeline_->WaitAllEmpty();
    for (ExgMcChannel& channel : this->Channels_)
       channel.StartupChannel(logPath);
    for (ExgMcChannel& channel : this->Channels_)
@@ -560,6 +617,8 @@ void ExgMcChannelMgr::ChannelCycled(ExgMcChannel& src) {
          if (c.GetChannelId() % 2 == iMkt)
             c.OnBasicInfoCycled();
       }
+      // 基本資料輪播完畢, 商品清單已穩定, 重建 ProdId 索引, 加快之後的行情解析.
+      this->Symbs_->RebuildProdIdIndex();
       ExgMcChannel& ss = GetSnapshotChannel(src);
       if (ss.GetChannelState() == ExgMcChannelState::CanBeClosed)
          this->OnSnapshotDone(ss, ss.CycleStartSeq_);
@@ -14,6 +14,8 @@
 namespace f9twf {
 
 class f9twf_API ExgMcChannel;
+class f9twf_API ExgMcPipeline;
+struct ExgMcPipelineArgs;
 
 class ExgMrRecoverSession;
 using ExgMrRecoverSessionSP = fon9::intrusive_ptr<ExgMrRecoverSession>;
@@ -122,7 +124,9 @@ class f9twf_API ExgMcChannel : private fon9::PkContFeeder {
 
    /// 封包消費者, 例: McToMiConv.
    /// 在通知 Consumer 之前, 應先進行 DispatchMcMessage();
-   fon9::UnsafeSubject<ExgMcMessageConsumer*> UnsafeConsumers_{8};
+   /// 使用自己的 mutex 保護(而非 PkPendings_), 因為使用 ExgMcPipeline 時, 會在 Publish thread 通知 Consumers,
+   /// 此時 receive stage 可能正在 PkPendings_ 鎖定狀態下, 等候 ring 的空間.
+   fon9::Subject<ExgMcMessageConsumer*> Consumers_{8};
 
    using RecoversImpl = std::deque<ExgMrRecoverSessionSP>;
    using Recovers = fon9::MustLock<RecoversImpl>;
@@ -131,6 +135,9 @@ class f9twf_API ExgMcChannel : private fon9::PkContFeeder {
    /// 記錄收到的封包.
    /// - 如果是輪播 channel, 則在系統備妥後, 會載入 PkLog_ 用來更新 Symbols 及其他系統狀態.
    fon9::AsyncFileAppenderSP  PkLog_;
+   /// PkLog_ 的稀疏索引(seq, time => 檔案位置), 檔名為 PkLog 檔名 + ".idx";
+   /// 讓 ReloadDispatch(fromSeq) 可以直接從 fromSeq 附近開始讀取, 不用讀取整個 PkLog.
+   fon9::TsAppendIndex        PkLogIdx_;
    /// 記錄 [PkLog 開啟後] 收到的 [第一筆封包] 的檔案位置.
    fon9::File::SizeType Pk1stPos_;
    /// 記錄 [PkLog 開啟後] 收到的 [第一筆封包] 的序號.
@@ -139,6 +146,8 @@ class f9twf_API ExgMcChannel : private fon9::PkContFeeder {
    fon9::DayTime        LastInfoTime_;
 
    ExgMcChannelMgr*  ChannelMgr_{};
+   /// 若有設定, 則確定連續後的封包, 交給 Pipeline_ 的 Decode thread 處理.
+   ExgMcPipeline*    Pipeline_{};
    ExgMrChannelId_t  ChannelId_{};
    ExgMcChannelStyle Style_{};
    ExgMcChannelState State_{ExgMcChannelState::Running};
@@ -147,14 +156,21 @@ class f9twf_API ExgMcChannel : private fon9::PkContFeeder {
    /// - 在 [快照更新尚未收到 A:Refresh Begin] 之前.
    bool  IsSkipPkLog_{false};
    bool  IsSetupReloading_{false};
-   char  Padding___[2];
+   /// 在 Pipeline_ 裡面的索引.
+   uint16_t PipelineIndex_{0};
    /// 使用 CycleStartSeq_ & CycleBeforeLostCount_ 判斷: 兩個 Hb 之間是否有遺漏.
    /// 如果沒有遺漏, 則視為收了一次完整的輪播, 此時可能會進入 ExgMcChannelState::CanBeClosed 狀態.
    SeqT  CycleStartSeq_{0};
    SeqT  CycleBeforeLostCount_{0};
+   /// 輪播循環起點在 PkLog 的位置, 若為 kInvalidPos 表示起點沒有寫入 PkLog(例: SetupReload 期間).
+   /// 在完整(沒有遺漏)的循環結束時, 記錄到 PkLogIdx_ 的標記, 讓 SetupReload() 可從最後一個完整循環開始載入.
+   static constexpr fon9::File::PosType kInvalidPos = static_cast<fon9::File::PosType>(-1);
+   fon9::File::PosType  CycleStartPos_{kInvalidPos};
    void OnCycleStart(SeqT seq) {
       this->CycleStartSeq_ = seq;
       this->CycleBeforeLostCount_ = this->LostCount_;
+      this->CycleStartPos_ = ((this->IsSkipPkLog_ || !this->PkLogIdx_.IsOpened())
+                              ? kInvalidPos : this->PkLogIdx_.GetNextPos());
    }
 
    // 2 次 Hb 之間, 若沒有任何訊息, 則可能發生斷線.
@@ -163,14 +179,13 @@ class f9twf_API ExgMcChannel : private fon9::PkContFeeder {
    fon9::DataMemberEmitOnTimer<&ExgMcChannel::EmitHbTimer> HbTimer_;
 
    void DispatchMcMessage(ExgMcMessage& e);
-   void NotifyConsumersLocked(ExgMcMessage& e);
    void PkContOnReceived(const void* pk, unsigned pksz, SeqT seq) override;
    void PkContOnTimer(PkPendings::Locker&& pks) override;
    void PkLogAppend(const void* pk, unsigned pksz, SeqT seq) {
       if (!this->IsSkipPkLog_ && this->PkLog_) {
          if (this->Pk1stSeq_ == 0)
             this->Pk1stSeq_ = seq;
-         fon9::TsAppend(*this->PkLog_, fon9::UtcNow(), pk, static_cast<uint16_t>(pksz));
+         fon9::TsAppend(*this->PkLog_, this->PkLogIdx_, fon9::UtcNow(), pk, static_cast<uint16_t>(pksz), seq);
          static_assert(kExgMdMaxPacketSize < 0xfff0, "ExgMdHeadVerLen::BodyLength_ cannot use uint16_t.");
       }
    }
@@ -229,32 +244,29 @@ public:
    ExgMcChannelState GetChannelState() const {
       return this->State_;
    }
-   ExgMcChannelState OnPkReceived(const ExgMcHead& pk, unsigned pksz);
+   /// lineIndex = 收到封包的線路(ExgMcChannelMgr::GetArbiterArgs().RegLine() 的傳回值),
+   /// 用於 A/B 線路仲裁, 若為 kMaxLineCount 則不仲裁.
+   ExgMcChannelState OnPkReceived(const ExgMcHead& pk, unsigned pksz,
+                                  unsigned lineIndex = fon9::PkContArbiterArgs::kMaxLineCount);
+   using base::GetLineStat;
 
    bool IsNeedsNotifyConsumer() const {
-      return (!this->IsSetupReloading_ && !this->UnsafeConsumers_.IsEmpty());
+      return (!this->IsSetupReloading_ && !this->Consumers_.IsEmpty());
    }
    /// - 在 this->ChannelMgr_->DispatchMcMessage(e); 之後, 將收到的封包轉發給訂閱者(例: McToMiConv).
    /// - 可對於部分手動建立的訊息(例: 收到 I084._O_ 轉成 I083), 透過此處轉發給訂閱者.
-   void NotifyConsumers(ExgMcMessage& e) {
-      auto locker = this->PkPendings_.Lock();
-      this->NotifyConsumersLocked(e);
-   }
+   void NotifyConsumers(ExgMcMessage& e);
    void SubscribeConsumer(fon9::SubConn* conn, ExgMcMessageConsumer& h) {
-      auto locker = this->PkPendings_.Lock();
-      this->UnsafeConsumers_.Subscribe(conn, &h);
+      this->Consumers_.Subscribe(conn, &h);
    }
    void SubscribeConsumer(ExgMcMessageConsumer& h) {
-      auto locker = this->PkPendings_.Lock();
-      this->UnsafeConsumers_.Subscribe(&h);
+      this->Consumers_.Subscribe(&h);
    }
    void UnsubscribeConsumer(fon9::SubConn* h) {
-      auto locker = this->PkPendings_.Lock();
-      this->UnsafeConsumers_.Unsubscribe(h);
+      this->Consumers_.Unsubscribe(h);
    }
    void UnsubscribeConsumer(ExgMcMessageConsumer& h) {
-      auto locker = this->PkPendings_.Lock();
-      this->UnsafeConsumers_.UnsubscribeAll(&h);
+      this->Consumers_.UnsubscribeAll(&h);
    }
 
    void AddRecover(ExgMrRecoverSessionSP);
@@ -285,6 +297,13 @@ public:
    /// 在系統啟動時, 換日時... 會重新啟動 ChannelMgr;
    void StartupChannelMgr(std::string logPath);
 
+   /// 啟用多核心處理管線, 即時行情 channel(1,2) 在確定連續後, 交給 Decode thread 解析.
+   /// - 必須在 StartupChannelMgr() 之前(尚未開始接收行情前)呼叫, 且只能呼叫一次.
+   /// - 預設不啟用: 在 io thread 直接解析.
+   /// - 一般透過 ExgMcGroup::SetPipelineConfig() 設定, 在 ExgMcGroup::StartupMcGroup() 時啟動.
+   /// - 詳細說明請參考 ExgMcPipeline.
+   void StartPipeline(const ExgMcPipelineArgs& args);
+
    enum {
       kChannelCount = 20
    };
@@ -313,12 +332,20 @@ public:
       if (auto fnParser = this->McDispatcher_.Get(e.Pk_))
          fnParser(e);
    }
-   ExgMcChannelState OnPkReceived(const ExgMcHead& pk, unsigned pksz) {
+   ExgMcChannelState OnPkReceived(const ExgMcHead& pk, unsigned pksz,
+                                  unsigned lineIndex = fon9::PkContArbiterArgs::kMaxLineCount) {
       if (auto* channel = this->GetChannel(pk.GetChannelId()))
-         return channel->OnPkReceived(pk, pksz);
+         return channel->OnPkReceived(pk, pksz, lineIndex);
       return ExgMcChannelState::Running;
    }
 
+   /// 全部 channels 共用的 A/B 線路仲裁設定:
+   /// - 每個 ExgMcReceiver 可指定所屬線路(例: "Line=A"), 同一條線路的全部 channels 使用相同的 lineIndex.
+   /// - 沒有指定線路的 ExgMcReceiver, 不仲裁, 與原本相同.
+   fon9::PkContArbiterArgs& GetArbiterArgs() {
+      return this->ArbiterArgs_;
+   }
+
    /// channel 已收完一次輪播, 檢查是否允許進入下一階段, 例:
    /// - 基本資料.
    /// - 快照更新 A:Refresh Begin .. Z:Refresh Complete;
@@ -329,7 +356,11 @@ public:
 private:
    using McDispatcher = ExgMdMessageDispatcher<FnMcMessageParser>;
    McDispatcher   McDispatcher_;
+   /// 必須在 Channels_ 之前: Channels_ 解構時仍會用到.
+   fon9::PkContArbiterArgs ArbiterArgs_;
    ExgMcChannel   Channels_[kChannelCount];
+   /// 必須在 Channels_ 之後: 解構時先結束 Pipeline_(會處理完 ring 裡面的封包), 再解構 Channels_.
+   std::unique_ptr<ExgMcPipeline>   Pipeline_;
 };
 
 } // namespaces
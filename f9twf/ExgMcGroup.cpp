@@ -48,8 +48,39 @@ ExgMcGroup::ExgMcGroup(ExgMcSystem* mdsys, std::string name, f9fmkt_TradingSessi
 }
 ExgMcGroup::~ExgMcGroup() {
 }
+std::string ExgMcGroup::SetPipelineConfig(fon9::StrView cfg) {
+   if (fon9::StrTrim(&cfg).empty()) {
+      this->PipelineArgs_.reset();
+      return std::string{};
+   }
+   std::unique_ptr<ExgMcPipelineArgs> args{new ExgMcPipelineArgs};
+   fon9::RevBufferList rbuf{128};
+   if (!fon9::ParseConfig(*args, cfg, rbuf))
+      return fon9::BufferTo<std::string>(rbuf.MoveOut());
+   this->PipelineArgs_ = std::move(args);
+   return std::string{};
+}
+std::string ExgMcGroup::SetMcGroupConfig(fon9::StrView cfg) {
+   fon9::StrView tag, value;
+   while (fon9::SbrFetchTagValue(cfg, tag, value)) {
+      if (tag == "Pipeline") {
+         fon9::StrView inside = fon9::SbrTrimHeadFetchInside(value);
+         std::string   errmsg = this->SetPipelineConfig(inside.IsNull() ? value : inside);
+         if (!errmsg.empty())
+            return "Pipeline:" + errmsg;
+      }
+      else
+         return fon9::RevPrintTo<std::string>("Unknown tag=", tag);
+   }
+   return std::string{};
+}
 void ExgMcGroup::StartupMcGroup(ExgMcSystem& mdsys, std::string logPath) {
    (void)mdsys;
+   // Pipeline 必須在開始接收行情前啟動, 且只能啟動一次.
+   if (this->PipelineArgs_) {
+      this->ChannelMgr_->StartPipeline(*this->PipelineArgs_);
+      this->PipelineArgs_.reset();
+   }
    // logPath = "logs/yyyymmdd/TwfMd_MdDay_"
    logPath += this->ChannelMgr_->Name_ + "_";
    // 在設定 Channel 時, PkLog 的檔名為 sysLogPath + "NNNN.tsbin"; 其中 NNNN = ChannelId;
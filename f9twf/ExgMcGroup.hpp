@@ -3,6 +3,7 @@
 #ifndef __f9twf_ExgMcGroup_hpp__
 #define __f9twf_ExgMcGroup_hpp__
 #include "f9twf/ExgMcChannel.hpp"
+#include "f9twf/ExgMcPipeline.hpp"
 #include "fon9/framework/IoManagerTree.hpp"
 #include "fon9/fmkt/MdSystem.hpp"
 
@@ -10,6 +11,7 @@ namespace f9twf {
 
 /// Sapling 應該包含:
 /// - Symbs (建構時自動加入)
+/// - SymbsArc: 換日時, 由「前一日」的 rti 轉出的歸檔查詢(使用 rti 且 SetRtiConfig("Archive=Y") 時才有).
 /// - FpSession: McReceiver, MrRecover, MiSender...
 /// - 根據設定加入 McGroup.
 class f9twf_API ExgMcSystem : public fon9::fmkt::MdSystem {
@@ -39,12 +41,26 @@ using ExgMcSystemSP = fon9::intrusive_ptr<ExgMcSystem>;
 class f9twf_API ExgMcGroup : public fon9::seed::NamedMaTree {
    fon9_NON_COPY_NON_MOVE(ExgMcGroup);
    using base = fon9::seed::NamedMaTree;
+   /// 有設定 Pipeline, 在第一次 StartupMcGroup() 時啟動, 之後就不再需要.
+   std::unique_ptr<ExgMcPipelineArgs>  PipelineArgs_;
 public:
    const ExgMcChannelMgrSP ChannelMgr_;
 
    ExgMcGroup(ExgMcSystem* mdsys, std::string name, f9fmkt_TradingSessionId tsesId);
    ~ExgMcGroup();
 
+   /// 設定 McGroup 使用多核心處理管線, cfg 格式請參考 ExgMcPipelineArgs, 例:
+   /// "DecodeCpu=2|Wait=Adaptive|PublishThread=N";
+   /// - 必須在第一次 StartupMcGroup() 之前設定(建立 McGroup 時, 由 McGroup 的設定取得).
+   /// - cfg.empty() 則不使用 Pipeline, 在 io thread 直接解析.
+   /// - 傳回錯誤訊息, retval.empty() 表示成功.
+   std::string SetPipelineConfig(fon9::StrView cfg);
+   /// 建立 McGroup 的 plugin, 將 McGroup 的設定字串交給這裡處理.
+   /// - cfg = "Pipeline={DecodeCpu=2|Wait=Adaptive}"
+   /// - Pipeline: 括號內的設定, 請參考 SetPipelineConfig(); 沒設定則不使用 Pipeline.
+   /// - 傳回錯誤訊息, retval.empty() 表示成功.
+   std::string SetMcGroupConfig(fon9::StrView cfg);
+
    /// 啟動(or 換日清檔), 從 ExgMcSystem::StartupMcSystem() 呼叫到此.
    /// 此時 logPath = "logs/yyyymmdd/";
    void StartupMcGroup(ExgMcSystem& mdsys, std::string logPath);
@@ -0,0 +1,192 @@
+﻿// \file f9twf/ExgMcPipeline.cpp
+// \author fonwinz@gmail.com
+#include "f9twf/ExgMcPipeline.hpp"
+#include "f9twf/ExgMcChannel.hpp"
+#include "fon9/StrTo.hpp"
+#include "fon9/ThreadTools.hpp"
+#include "fon9/Log.hpp"
+
+namespace f9twf {
+
+fon9::ConfigParser::Result ExgMcPipelineArgs::OnTagValue(fon9::StrView tag, fon9::StrView& value) {
+   if (tag == "DecodeCpu")
+      this->DecodeCpu_ = fon9::StrTo(value, -1);
+   else if (tag == "PublishCpu")
+      this->PublishCpu_ = fon9::StrTo(value, -1);
+   else if (tag == "RingSize")
+      this->RingSize_ = fon9::StrTo(value, this->RingSize_);
+   else if (tag == "Wait") {
+      if ((this->HowWait_ = fon9::StrToHowWait(value)) == fon9::HowWait::Unknown) {
+         this->HowWait_ = fon9::HowWait::Block;
+         return fon9::ConfigParser::Result::EInvalidValue;
+      }
+   }
+   else if (tag == "SpinCount")
+      this->AdaptiveWait_.SpinCount_ = fon9::StrTo(value, this->AdaptiveWait_.SpinCount_);
+   else if (tag == "YieldCount")
+      this->AdaptiveWait_.YieldCount_ = fon9::StrTo(value, this->AdaptiveWait_.YieldCount_);
+   else if (tag == "PublishThread")
+      this->IsPublishThread_ = (toupper(value.Get1st()) == 'Y');
+   else
+      return fon9::ConfigParser::Result::EUnknownTag;
+   return fon9::ConfigParser::Result::Success;
+}
+//--------------------------------------------------------------------------//
+template <class IsReady>
+void ExgMcPipeline::StageWaiter::Wait(const ExgMcPipelineArgs& args, IsReady isReady) {
+   switch (args.HowWait_) {
+   case fon9::HowWait::Busy:
+      return;
+   case fon9::HowWait::Yield:
+      std::this_thread::yield();
+      return;
+   case fon9::HowWait::Adaptive:
+      // 先 spin, 再 yield, 都沒有封包才進入 block 等候.
+      for (fon9::AdaptiveWaitCounter counter; counter.OnIdle(args.AdaptiveWait_);) {
+         if (isReady())
+            return;
+      }
+      break;
+   default:
+   case fon9::HowWait::Unknown:
+   case fon9::HowWait::Block:
+      break;
+   }
+   std::unique_lock<std::mutex> lk{this->Mutex_};
+   this->IsSleeping_.store(true, std::memory_order_relaxed);
+   // 設定 IsSleeping_ 之後, 必須再檢查一次, 避免在設定之前, producer 已放入封包, 但沒有通知.
+   std::atomic_thread_fence(std::memory_order_seq_cst);
+   while (!isReady())
+      this->Cond_.wait(lk);
+   this->IsSleeping_.store(false, std::memory_order_relaxed);
+}
+//--------------------------------------------------------------------------//
+ExgMcPipeline::ExgMcPipeline(const ExgMcPipelineArgs& args) : Args_(args) {
+}
+ExgMcPipeline::~ExgMcPipeline() {
+   // 先結束 Decode thread(處理完剩餘封包), 再結束 Publish thread.
+   this->IsDecodeRunning_ = false;
+   this->DecodeWaiter_.Notify();
+   fon9::JoinThread(this->DecodeThread_);
+   this->IsPublishRunning_ = false;
+   this->PublishWaiter_.Notify();
+   fon9::JoinThread(this->PublishThread_);
+}
+unsigned ExgMcPipeline::AddChannel(ExgMcChannel& channel) {
+   assert(!this->IsDecodeRunning_);
+   this->Channels_.emplace_back(new ChannelRing{channel, this->Args_.RingSize_});
+   return static_cast<unsigned>(this->Channels_.size() - 1);
+}
+void ExgMcPipeline::Start() {
+   assert(!this->IsDecodeRunning_);
+   this->IsDecodeRunning_ = true;
+   this->DecodeThread_ = std::thread(&ExgMcPipeline::DecodeThreadRun, this);
+   if (this->Args_.IsPublishThread_) {
+      this->IsPublishRunning_ = true;
+      this->PublishThread_ = std::thread(&ExgMcPipeline::PublishThreadRun, this);
+   }
+}
+//--------------------------------------------------------------------------//
+void ExgMcPipeline::Push(unsigned channelIndex, const ExgMcHead& pk, unsigned pksz) {
+   assert(channelIndex < this->Channels_.size());
+   PkRing&                 ring = this->Channels_[channelIndex]->Ring_;
+   const PkRing::PkSizeT   recsz = static_cast<PkRing::PkSizeT>(sizeof(ExgMdSymb*) + pksz);
+   void*                   rec;
+   while ((rec = ring.Alloc(recsz)) == nullptr) {
+      // ring 已滿: 等候 decode/publish 處理.
+      // 此時不可通知 Consumers 或等候 PkPendings_, 否則可能死結.
+      this->DecodeWaiter_.Notify();
+      std::this_thread::yield();
+   }
+   // rec = [ExgMdSymb* 由 decode stage 填入] + [封包內容].
+   *static_cast<ExgMdSymb**>(rec) = nullptr;
+   memcpy(static_cast<char*>(rec) + sizeof(ExgMdSymb*), &pk, pksz);
+   ring.Commit();
+   this->DecodeWaiter_.Notify();
+}
+void ExgMcPipeline::WaitChannelEmpty(unsigned channelIndex) {
+   assert(channelIndex < this->Channels_.size());
+   const PkRing& ring = this->Channels_[channelIndex]->Ring_;
+   while (!ring.IsEmpty())
+      std::this_thread::yield();
+}
+void ExgMcPipeline::WaitAllEmpty() {
+   for (unsigned L = 0; L < this->Channels_.size(); ++L)
+      this->WaitChannelEmpty(L);
+}
+//--------------------------------------------------------------------------//
+bool ExgMcPipeline::IsAnyStageReady(unsigned stage) const {
+   for (const ChannelRingSP& ch : this->Channels_) {
+      if (!ch->Ring_.IsStageEmpty(stage))
+         return true;
+   }
+   return false;
+}
+bool ExgMcPipeline::RunStage(unsigned stage) {
+   // 每個 channel 每次最多處理 kBatchCount 個封包, 避免其中一個 channel 佔用太久.
+   constexpr unsigned kBatchCount = 64;
+   const bool isPublishInDecode = (stage == kStageDecode && !this->Args_.IsPublishThread_);
+   bool       hasPk = false;
+   for (const ChannelRingSP& ch : this->Channels_) {
+      PkRing&        ring = ch->Ring_;
+      PkRing::PkSizeT recsz;
+      for (unsigned count = 0; count < kBatchCount; ++count) {
+         char* rec = static_cast<char*>(ring.Peek(stage, recsz));
+         if (rec == nullptr)
+            break;
+         const ExgMcHead& pk = *reinterpret_cast<const ExgMcHead*>(rec + sizeof(ExgMdSymb*));
+         ExgMcMessage     e(pk, static_cast<unsigned>(recsz - sizeof(ExgMdSymb*)), ch->Channel_, pk.GetChannelSeq());
+         if (stage == kStageDecode) {
+            ch->Channel_.GetChannelMgr()->DispatchMcMessage(e);
+            *reinterpret_cast<ExgMdSymb**>(rec) = e.Symb_;
+            if (isPublishInDecode)
+               ch->Channel_.NotifyConsumers(e);
+         }
+         else {
+            e.Symb_ = *reinterpret_cast<ExgMdSymb**>(rec);
+            ch->Channel_.NotifyConsumers(e);
+         }
+         ring.Consume(stage);
+         if (isPublishInDecode)
+            ring.Consume(kStagePublish);
+         hasPk = true;
+      }
+   }
+   return hasPk;
+}
+void ExgMcPipeline::DecodeThreadRun() {
+   fon9::Result3 cpuAffinityResult = fon9::SetCpuAffinity(this->Args_.DecodeCpu_);
+   fon9_LOG_ThrRun("ExgMcPipeline.Decode.ThrRun|Cpu=", this->Args_.DecodeCpu_, ':', cpuAffinityResult,
+                   "|Wait=", fon9::HowWaitToStr(this->Args_.HowWait_));
+   for (;;) {
+      if (this->RunStage(kStageDecode)) {
+         this->PublishWaiter_.Notify();
+         continue;
+      }
+      if (!this->IsDecodeRunning_.load(std::memory_order_relaxed))
+         break;
+      this->DecodeWaiter_.Wait(this->Args_, [this]() {
+         return !this->IsDecodeRunning_.load(std::memory_order_relaxed)
+             || this->IsAnyStageReady(kStageDecode);
+      });
+   }
+   fon9_LOG_ThrRun("ExgMcPipeline.Decode.ThrRun.End");
+}
+void ExgMcPipeline::PublishThreadRun() {
+   fon9::Result3 cpuAffinityResult = fon9::SetCpuAffinity(this->Args_.PublishCpu_);
+   fon9_LOG_ThrRun("ExgMcPipeline.Publish.ThrRun|Cpu=", this->Args_.PublishCpu_, ':', cpuAffinityResult,
+                   "|Wait=", fon9::HowWaitToStr(this->Args_.HowWait_));
+   for (;;) {
+      if (this->RunStage(kStagePublish))
+         continue;
+      if (!this->IsPublishRunning_.load(std::memory_order_relaxed))
+         break;
+      this->PublishWaiter_.Wait(this->Args_, [this]() {
+         return !this->IsPublishRunning_.load(std::memory_order_relaxed)
+             || this->IsAnyStageReady(kStagePublish);
+      });
+   }
+   fon9_LOG_ThrRun("ExgMcPipeline.Publish.ThrRun.End");
+}
+
+} // namespaces
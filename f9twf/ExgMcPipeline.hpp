@@ -0,0 +1,138 @@
+﻿// \file f9twf/ExgMcPipeline.hpp
+// \author fonwinz@gmail.com
+#ifndef __f9twf_ExgMcPipeline_hpp__
+#define __f9twf_ExgMcPipeline_hpp__
+#include "f9twf/Config.h"
+#include "fon9/SpscRing.hpp"
+#include "fon9/ConfigParser.hpp"
+#include "fon9/Tools.hpp"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+
+namespace f9twf {
+
+class f9twf_API ExgMcChannel;
+struct ExgMcHead;
+
+/// ExgMcPipeline 的設定.
+/// args: "DecodeCpu=n|PublishCpu=n|RingSize=n|Wait=Block|SpinCount=n|YieldCount=n|PublishThread=N"
+struct f9twf_API ExgMcPipelineArgs {
+   /// Decode thread 綁定的 cpu, -1 表示不綁定.
+   int         DecodeCpu_{-1};
+   /// Publish thread 綁定的 cpu, -1 表示不綁定.
+   int         PublishCpu_{-1};
+   /// 每個 channel 的 ring 大小(bytes).
+   uint32_t    RingSize_{4 * 1024 * 1024};
+   /// Decode thread, Publish thread 沒有封包時, 如何等候?
+   fon9::HowWait  HowWait_{fon9::HowWait::Block};
+   /// HowWait_ == HowWait::Adaptive 時使用.
+   fon9::AdaptiveWaitArgs  AdaptiveWait_;
+   /// 是否使用獨立的 Publish thread 通知 Consumers(例: McToMiConv)?
+   /// - 預設為 N: 在 Decode thread 解析完畢後, 立即通知 Consumers.
+   ///   因為 Consumer 可能需要取得與訊息一致的商品狀態(例: McToMiConv 將 I081 轉成 I080 需要完整委託簿),
+   ///   若使用 Publish thread, 則通知時商品可能已被之後的訊息異動.
+   /// - 只有在 Consumers 不會用到商品狀態時(例: McChannelTunnel 僅轉發封包), 才可設定 PublishThread=Y.
+   bool        IsPublishThread_{false};
+   char        Padding____[3];
+
+   /// tag           | value
+   /// --------------|------------------------------
+   /// DecodeCpu     | cpu id
+   /// PublishCpu    | cpu id
+   /// RingSize      | bytes, 會調整成 2 的冪次.
+   /// Wait          | "Block" or "Busy" or "Yield" or "Adaptive"
+   /// SpinCount     | Wait=Adaptive 時, 沒有封包時先 spin 的次數.
+   /// YieldCount    | Wait=Adaptive 時, spin 之後再 yield 的次數, 之後才進入 block 等候.
+   /// PublishThread | "Y" or "N"
+   fon9::ConfigParser::Result OnTagValue(fon9::StrView tag, fon9::StrView& value);
+};
+
+fon9_WARN_DISABLE_PADDING;
+/// 台灣期交所逐筆行情: 多核心的 channel 處理管線.
+/// - Receive stage(原本的 io thread): 接收、確保連續(PkContFeeder)、PkLog;
+///   確定連續後, 將封包複製到該 channel 的 ring.
+/// - Decode stage(Decode thread): 依序取出封包, 執行 ExgMcChannelMgr::DispatchMcMessage();
+///   解析、更新商品、透過 MdRtStream 發行及儲存, 都在此 thread 處理.
+///   - MdRtStream 的訂閱者必須在商品鎖定狀態下通知, 才能與「訂閱時取得的商品快照」保持一致,
+///     所以無法移到下一個 stage.
+///   - MdRtStream 的儲存: rti 的寫入位置是「回補」與「即時通知」的分界點, 也必須與通知在同一次鎖定內完成;
+///     在此 thread 只是放入 InnApf 的緩衝, 實際寫檔已由 InnApf 的 thread 負責.
+/// - Publish stage(Publish thread): 通知 channel 的 Consumers(例: McToMiConv, McChannelTunnel).
+/// - 每個 channel 有自己的 ring, 且只有 1 個 Decode thread, 所以同一個 channel 的訊息順序不變,
+///   同一個商品只會出現在一個 channel, 所以商品的異動順序也不變.
+/// - 目前僅用於即時行情 channel(1,2):
+///   其他 channel 的處理, 與 channel 狀態(快照、基本資料輪播...)有關, 仍維持在 io thread 處理.
+/// - 當 ring 滿了, receive stage 會等候(背壓), 不會遺失封包.
+class f9twf_API ExgMcPipeline {
+   fon9_NON_COPY_NON_MOVE(ExgMcPipeline);
+public:
+   using PkRing = fon9::SpscPkRing<2>;
+   enum : unsigned {
+      kStageDecode = 1,
+      kStagePublish = 2,
+   };
+
+   ExgMcPipeline(const ExgMcPipelineArgs& args);
+   /// 會等候 ring 裡面的封包處理完畢.
+   ~ExgMcPipeline();
+
+   const ExgMcPipelineArgs Args_;
+
+   /// 加入一個需要使用 pipeline 的 channel, 必須在 Start() 之前呼叫.
+   /// 傳回在 pipeline 裡面的索引, 用於 Push(); WaitChannelEmpty();
+   unsigned AddChannel(ExgMcChannel& channel);
+   /// 啟動 Decode thread 及 Publish thread.
+   void Start();
+
+   /// 由 receive stage 呼叫, 必須確保同一個 channelIndex 不會同時呼叫.
+   /// 若 ring 已滿, 則會等候 ring 有足夠空間.
+   void Push(unsigned channelIndex, const ExgMcHead& pk, unsigned pksz);
+   /// 等候 channel 的 ring 裡面的封包處理完畢.
+   /// 例: 收到 I002.SeqReset, 必須先等之前的訊息處理完畢.
+   void WaitChannelEmpty(unsigned channelIndex);
+   /// 等候全部 channel 的 ring 裡面的封包處理完畢.
+   void WaitAllEmpty();
+
+private:
+   /// 當 thread 沒有封包處理時, 依照 Args_.HowWait_, Args_.AdaptiveWait_ 等候.
+   struct StageWaiter {
+      std::atomic<bool>       IsSleeping_{false};
+      std::mutex              Mutex_;
+      std::condition_variable Cond_;
+      void Notify() {
+         std::atomic_thread_fence(std::memory_order_seq_cst);
+         if (this->IsSleeping_.load(std::memory_order_relaxed)) {
+            std::unique_lock<std::mutex> lk{this->Mutex_};
+            this->Cond_.notify_one();
+         }
+      }
+      template <class IsReady>
+      void Wait(const ExgMcPipelineArgs& args, IsReady isReady);
+   };
+   struct ChannelRing {
+      fon9_NON_COPY_NON_MOVE(ChannelRing);
+      ExgMcChannel&  Channel_;
+      PkRing         Ring_;
+      ChannelRing(ExgMcChannel& channel, size_t ringSize) : Channel_(channel), Ring_{ringSize} {
+      }
+   };
+   using ChannelRingSP = std::unique_ptr<ChannelRing>;
+   std::vector<ChannelRingSP> Channels_;
+   StageWaiter                DecodeWaiter_;
+   StageWaiter                PublishWaiter_;
+   std::atomic<bool>          IsDecodeRunning_{false};
+   std::atomic<bool>          IsPublishRunning_{false};
+   std::thread                DecodeThread_;
+   std::thread                PublishThread_;
+
+   bool IsAnyStageReady(unsigned stage) const;
+   bool RunStage(unsigned stage);
+   void DecodeThreadRun();
+   void PublishThreadRun();
+};
+fon9_WARN_POP;
+
+} // namespaces
+#endif//__f9twf_ExgMcPipeline_hpp__
@@ -0,0 +1,197 @@
+﻿// \file f9twf/ExgMcPipeline_UT.cpp
+//
+// 測試 ExgMcGroup 設定 Pipeline 之後, 即時行情 channel(1,2) 透過 ExgMcPipeline 處理:
+// - 解析(parser)在 Decode thread 執行, 且每個 channel 的序號連續、內容正確.
+// - Consumers 的通知順序與解析順序相同, 且在通知時, 該訊息已解析完畢.
+//
+// \author fonwinz@gmail.com
+#include "f9twf/ExgMcGroup.hpp"
+#include "fon9/TestTools.hpp"
+#include "fon9/PackBcd.hpp"
+#include <thread>
+
+//--------------------------------------------------------------------------//
+static const char    kLogPath[] = "ExgMcPipeline_UT_";
+static const uint8_t kTestVer = 1;
+
+struct ChannelStat {
+   std::atomic<uint64_t>   ParsedCount_{0};
+   uint64_t                ConsumedCount_{0};
+   std::thread::id         ParserThreadId_;
+   std::thread::id         ConsumerThreadId_;
+   /// 錯誤訊息: 序號不連續、內容不正確...
+   std::string             ErrMsg_;
+};
+static ChannelStat   gChannelStat[3];
+
+/// Body_ = seq * 1000 + channelId;
+struct TestPk {
+   f9twf::ExgMcHead  Head_;
+   fon9::PackBcd<16> Body_;
+   f9twf::ExgMdTail  Tail_;
+};
+static_assert(sizeof(TestPk) == sizeof(f9twf::ExgMcNoBody) + sizeof(fon9::PackBcd<16>), "TestPk 沒有 pack?");
+
+static bool CheckPkBody(const f9twf::ExgMcMessage& e) {
+   const auto& pk = reinterpret_cast<const TestPk&>(e.Pk_);
+   return e.PkSize_ == sizeof(pk)
+      && fon9::PackBcdTo<uint64_t>(pk.Body_) == e.SeqNo_ * 1000 + e.Channel_.GetChannelId();
+}
+static void TestParser(f9twf::ExgMcMessage& e) {
+   ChannelStat& st = gChannelStat[e.Channel_.GetChannelId()];
+   st.ParserThreadId_ = std::this_thread::get_id();
+   if (e.SeqNo_ != st.ParsedCount_ + 1 && st.ErrMsg_.empty())
+      st.ErrMsg_ = "Parser.SeqNo=" + std::to_string(e.SeqNo_);
+   if (!CheckPkBody(e) && st.ErrMsg_.empty())
+      st.ErrMsg_ = "Parser.Body|SeqNo=" + std::to_string(e.SeqNo_);
+   st.ParsedCount_.store(e.SeqNo_, std::memory_order_release);
+}
+struct TestConsumer : public f9twf::ExgMcMessageConsumer {
+   fon9_NON_COPY_NON_MOVE(TestConsumer);
+   TestConsumer() = default;
+   void OnExgMcMessage(const f9twf::ExgMcMessage& e) override {
+      ChannelStat& st = gChannelStat[e.Channel_.GetChannelId()];
+      st.ConsumerThreadId_ = std::this_thread::get_id();
+      if (e.SeqNo_ != st.ConsumedCount_ + 1 && st.ErrMsg_.empty())
+         st.ErrMsg_ = "Consumer.SeqNo=" + std::to_string(e.SeqNo_);
+      if (!CheckPkBody(e) && st.ErrMsg_.empty())
+         st.ErrMsg_ = "Consumer.Body|SeqNo=" + std::to_string(e.SeqNo_);
+      // 通知 Consumer 時, 此訊息必定已解析完畢.
+      if (st.ParsedCount_.load(std::memory_order_acquire) < e.SeqNo_ && st.ErrMsg_.empty())
+         st.ErrMsg_ = "Consumer.BeforeParsed|SeqNo=" + std::to_string(e.SeqNo_);
+      st.ConsumedCount_ = e.SeqNo_;
+   }
+};
+
+static void MakeTestPk(TestPk& pk, f9twf::ExgMrChannelId_t channelId, uint64_t seq) {
+   memset(&pk, 0, sizeof(pk));
+   pk.Head_.Esc_ = '\x1b';
+   pk.Head_.TransmissionCode_ = (channelId == 1 ? '2' : '5');
+   pk.Head_.MessageKind_ = 'A';
+   fon9::ToPackBcd(pk.Head_.ChannelId_, channelId);
+   fon9::ToPackBcd(pk.Head_.ChannelSeq_, seq);
+   fon9::ToPackBcd(pk.Head_.VersionNo_, kTestVer);
+   fon9::ToPackBcd(pk.Head_.BodyLength_, static_cast<unsigned>(sizeof(pk.Body_)));
+   fon9::ToPackBcd(pk.Body_, seq * 1000 + channelId);
+   pk.Tail_.CrLf_[0] = '\x0d';
+   pk.Tail_.CrLf_[1] = '\x0a';
+}
+static void RemoveTestLogs(const std::string& logPath) {
+   for (unsigned L = 0; L < f9twf::ExgMcChannelMgr::kChannelCount; ++L) {
+      char fname[16];
+      sprintf(fname, "%04u.tsbin", L);
+      std::string fn = logPath + fname;
+      remove(fn.c_str());
+      fn.append(".idx");
+      remove(fn.c_str());
+   }
+}
+
+//--------------------------------------------------------------------------//
+void TestPipeline(const char* cfg, bool isPublishThread, uint64_t pkCount) {
+   std::cout << "[TEST ] Pipeline=" << cfg << "|pkCount=" << pkCount;
+   for (ChannelStat& st : gChannelStat) {
+      st.ParsedCount_ = 0;
+      st.ConsumedCount_ = 0;
+      st.ParserThreadId_ = st.ConsumerThreadId_ = std::thread::id{};
+      st.ErrMsg_.clear();
+   }
+   fon9::seed::MaTreeSP root{new fon9::seed::MaTree{"Root"}};
+   f9twf::ExgMcSystemSP mdsys{new f9twf::ExgMcSystem(root, "TwfMd", false, false)};
+   f9twf::ExgMcGroupSP  mcGroup{new f9twf::ExgMcGroup(mdsys.get(), "MdDay", f9fmkt_TradingSessionId_Normal)};
+   const std::string    logPath = kLogPath + mcGroup->ChannelMgr_->Name_ + "_";
+   RemoveTestLogs(logPath);
+
+   const std::string mcGroupCfg = std::string{"Pipeline={"} + cfg + "}";
+   std::string errmsg = mcGroup->SetMcGroupConfig(&mcGroupCfg);
+   if (!errmsg.empty()) {
+      std::cout << "|err=SetMcGroupConfig:" << errmsg << "\r[ERROR]" << std::endl;
+      abort();
+   }
+   f9twf::ExgMcChannelMgr& mgr = *mcGroup->ChannelMgr_;
+   mgr.RegMcMessageParser('2', 'A', kTestVer, &TestParser);
+   mgr.RegMcMessageParser('5', 'A', kTestVer, &TestParser);
+   TestConsumer consumer;
+   mgr.GetChannel(1)->SubscribeConsumer(consumer);
+   mgr.GetChannel(2)->SubscribeConsumer(consumer);
+   mcGroup->StartupMcGroup(*mdsys, kLogPath);
+   // 快照更新完畢後, 即時行情 channel 才會開始解析.
+   mgr.OnSnapshotDone(*mgr.GetChannel(13), 0);
+   mgr.OnSnapshotDone(*mgr.GetChannel(14), 0);
+
+   TestPk pk;
+   for (uint64_t seq = 1; seq <= pkCount; ++seq) {
+      MakeTestPk(pk, 1, seq);
+      mgr.OnPkReceived(pk.Head_, sizeof(pk));
+      MakeTestPk(pk, 2, seq);
+      mgr.OnPkReceived(pk.Head_, sizeof(pk));
+   }
+   // 解構 McGroup 時, 會等 Pipeline 處理完 ring 裡面的封包(包含通知 consumer).
+   mcGroup.reset();
+   mdsys.reset();
+   RemoveTestLogs(logPath);
+
+   const std::thread::id mainThreadId = std::this_thread::get_id();
+   for (f9twf::ExgMrChannelId_t channelId = 1; channelId <= 2; ++channelId) {
+      ChannelStat& st = gChannelStat[channelId];
+      std::cout << "|ch" << channelId << "=" << st.ParsedCount_ << "/" << st.ConsumedCount_;
+      if (st.ErrMsg_.empty()) {
+         if (st.ParsedCount_ != pkCount)
+            st.ErrMsg_ = "ParsedCount";
+         else if (st.ConsumedCount_ != pkCount)
+            st.ErrMsg_ = "ConsumedCount";
+         else if (st.ParserThreadId_ == mainThreadId)
+            st.ErrMsg_ = "Parser not in Decode thread";
+         else if ((st.ConsumerThreadId_ == st.ParserThreadId_) == isPublishThread)
+            st.ErrMsg_ = (isPublishThread ? "Consumer not in Publish thread" : "Consumer not in Decode thread");
+      }
+      if (!st.ErrMsg_.empty()) {
+         std::cout << "|err=" << st.ErrMsg_ << "\r[ERROR]" << std::endl;
+         abort();
+      }
+   }
+   std::cout << "\r[OK   ]" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+   (void)argc; (void)argv;
+   fon9::AutoPrintTestInfo utinfo{"f9twf ExgMcPipeline"};
+
+   std::cout << "[TEST ] ExgMcPipelineArgs default";
+   f9twf::ExgMcPipelineArgs args;
+   if (args.IsPublishThread_) {
+      std::cout << "|err=PublishThread default must be N\r[ERROR]" << std::endl;
+      abort();
+   }
+   std::cout << "\r[OK   ]" << std::endl;
+
+   std::cout << "[TEST ] ExgMcPipelineArgs Adaptive";
+   fon9::RevBufferList rbuf{128};
+   if (!fon9::ParseConfig(args, "Wait=Adaptive|SpinCount=100|YieldCount=10", rbuf)
+       || args.HowWait_ != fon9::HowWait::Adaptive
+       || args.AdaptiveWait_.SpinCount_ != 100
+       || args.AdaptiveWait_.YieldCount_ != 10) {
+      std::cout << "|err=SpinCount or YieldCount\r[ERROR]" << std::endl;
+      abort();
+   }
+   std::cout << "\r[OK   ]" << std::endl;
+   {
+      std::cout << "[TEST ] SetPipelineConfig(bad)";
+      fon9::seed::MaTreeSP root{new fon9::seed::MaTree{"Root"}};
+      f9twf::ExgMcSystemSP mdsys{new f9twf::ExgMcSystem(root, "TwfMd", false, false)};
+      f9twf::ExgMcGroupSP  mcGroup{new f9twf::ExgMcGroup(mdsys.get(), "MdDay", f9fmkt_TradingSessionId_Normal)};
+      if (mcGroup->SetPipelineConfig("Wait=Unknown").empty()
+          || mcGroup->SetMcGroupConfig("Pipeline={Wait=Unknown}").empty()
+          || mcGroup->SetMcGroupConfig("Unknown=Y").empty()) {
+         std::cout << "|err=Must fail\r[ERROR]" << std::endl;
+         abort();
+      }
+      std::cout << "\r[OK   ]" << std::endl;
+   }
+   utinfo.PrintSplitter();
+   TestPipeline("Wait=Block", false, 1000);
+   TestPipeline("Wait=Adaptive|RingSize=4096", false, 100000);
+   TestPipeline("Wait=Adaptive|SpinCount=100|YieldCount=10|RingSize=4096", false, 100000);
+   TestPipeline("Wait=Block|PublishThread=Y|RingSize=4096", true, 100000);
+   TestPipeline("Wait=Yield|PublishThread=Y", true, 100000);
+}
@@ -11,12 +11,29 @@ std::string ExgMcReceiver::SessionCommand(fon9::io::Device& dev, fon9::StrView c
    (void)dev;
    cmdln = StrFetchTrim(cmdln, &isspace);
    if (cmdln == "info") {
-      return RevPrintTo<std::string>(
+      RevBufferList  rbuf{128};
+      PkContLineStat stat;
+      auto*          channel = (this->ChannelId_ ? this->ChannelMgr_->GetChannel(this->ChannelId_) : nullptr);
+      if (channel && channel->GetLineStat(this->LineIndex_, stat)) {
+         RevPrint(rbuf,
+                  "|line=", this->ChannelMgr_->GetArbiterArgs().GetLineName(this->LineIndex_),
+                  "|lineRecv=", stat.RecvCount_,
+                  "|win=", stat.WinCount_,
+                  "|lose=", stat.LoseCount_,
+                  "|gap=", stat.GapCount_, '/', stat.GapPkCount_,
+                  "|lagAvgUs=", stat.LagAvgUs_,
+                  "|lagMaxUs=", stat.LagMaxUs_,
+                  "|degraded=", stat.IsDegraded_ ? 'Y' : 'N');
+      }
+      RevPrint(rbuf,
          UtcNow(),
          "|channelId=", this->ChannelId_,
          "|pkCount=", this->ReceivedCount_,
          "|chkSumErr=", this->ChkSumErrCount_,
-         "|dropped=", this->DroppedBytes_);
+         "|dropped=", this->DroppedBytes_,
+         "|contiguous=", this->ContiguousCount_,
+         "|stitched=", this->StitchedCount_);
+      return BufferTo<std::string>(rbuf.MoveOut());
    }
    return "unknown ExgMcReceiver command";
 }
@@ -42,7 +59,7 @@ io::RecvBufferSize ExgMcReceiver::OnDevice_Recv(io::Device& dev, DcQueueList& rx
    return io::RecvBufferSize::Default;
 }
 bool ExgMcReceiver::OnPkReceived(const void* pkptr, unsigned pksz) {
-   if (this->ChannelMgr_->OnPkReceived(*static_cast<const ExgMcHead*>(pkptr), pksz) == ExgMcChannelState::CanBeClosed)
+   if (this->ChannelMgr_->OnPkReceived(*static_cast<const ExgMcHead*>(pkptr), pksz, this->LineIndex_) == ExgMcChannelState::CanBeClosed)
       this->Device_->AsyncClose("Channel can be closed.");
    return true;
 }
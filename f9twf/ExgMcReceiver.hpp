@@ -21,12 +21,17 @@ class ExgMcReceiver : public fon9::io::Session, private ExgMcPkReceiver {
 public:
    const ExgMcChannelMgrSP ChannelMgr_;
    const ExgMrChannelId_t  ChannelId_;
-   char                    Padding___[6];
+   /// 此 Receiver 所屬的線路, 用於 A/B 線路仲裁, 請參考 ExgMcChannelMgr::GetArbiterArgs();
+   /// fon9::PkContArbiterArgs::kMaxLineCount 表示不仲裁.
+   const uint8_t           LineIndex_;
+   char                    Padding___[5];
 
    /// 如果有指定 channelId, 則在 OnDevice_BeforeOpen() 會檢查是否需要開啟 Receiver.
-   ExgMcReceiver(ExgMcChannelMgrSP channelMgr, ExgMrChannelId_t channelId)
+   ExgMcReceiver(ExgMcChannelMgrSP channelMgr, ExgMrChannelId_t channelId,
+                 unsigned lineIndex = fon9::PkContArbiterArgs::kMaxLineCount)
       : ChannelMgr_{std::move(channelMgr)}
-      , ChannelId_{channelId} {
+      , ChannelId_{channelId}
+      , LineIndex_{static_cast<uint8_t>(lineIndex)} {
    }
    ~ExgMcReceiver();
 
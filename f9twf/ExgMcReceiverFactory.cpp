@@ -12,6 +12,8 @@ io::SessionSP ExgMcReceiverFactory::CreateSession(IoManager& ioMgr, const IoConf
       StrView           tag, value, args = ToStrView(cfg.SessionArgs_);
       ExgMrChannelId_t  channelId = 0;
       TimeInterval      waitInterval{TimeInterval::Null()};
+      unsigned          lineIndex = PkContArbiterArgs::kMaxLineCount;
+      PkContArbiterArgs& arbArgs = mgr->McGroup_->ChannelMgr_->GetArbiterArgs();
       while (fon9::StrFetchTagValue(args, tag, value)) {
          if (tag == "ChannelId") {
             channelId = StrTo(value, channelId);
@@ -22,11 +24,33 @@ io::SessionSP ExgMcReceiverFactory::CreateSession(IoManager& ioMgr, const IoConf
          }
          else if (tag == "WaitInterval")
             waitInterval = StrTo(value, waitInterval);
+         // A/B 線路仲裁: "Line=A|LinePrimary=Y|LineHold=0.0005|LineDegrade=0.001"
+         // LineHold, LineDegrade 為全部線路共用的設定.
+         else if (tag == "Line") {
+            if ((lineIndex = arbArgs.RegLine(value)) >= PkContArbiterArgs::kMaxLineCount) {
+               errReason = "f9twf.ExgMcReceiverFactory.CreateSession: Too many Line.";
+               return nullptr;
+            }
+         }
+         else if (tag == "LinePrimary") {
+            if (fon9::toupper(value.Get1st()) == 'Y') {
+               if (lineIndex >= PkContArbiterArgs::kMaxLineCount) {
+                  errReason = "f9twf.ExgMcReceiverFactory.CreateSession: LinePrimary must after Line.";
+                  return nullptr;
+               }
+               arbArgs.PrimaryLine_ = static_cast<uint8_t>(lineIndex);
+               arbArgs.Policy_ = PkContArbiterArgs::Policy::PreferPrimary;
+            }
+         }
+         else if (tag == "LineHold")
+            arbArgs.HoldTimeout_ = StrTo(value, arbArgs.HoldTimeout_);
+         else if (tag == "LineDegrade")
+            arbArgs.DegradeLag_ = StrTo(value, arbArgs.DegradeLag_);
       }
       if (auto ch = mgr->McGroup_->ChannelMgr_->GetChannel(channelId)) {
          if (!waitInterval.IsNull())
             ch->SetWaitInterval(waitInterval);
-         return new ExgMcReceiver(mgr->McGroup_->ChannelMgr_, channelId);
+         return new ExgMcReceiver(mgr->McGroup_->ChannelMgr_, channelId, lineIndex);
       }
       errReason = "f9twf.ExgMcReceiverFactory.CreateSession: Unknown ChannelId.";
       return nullptr;
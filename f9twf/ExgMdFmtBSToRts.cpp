@@ -11,8 +11,8 @@ using namespace fon9;
 using namespace fon9::fmkt;
 
 f9twf_API void I081BSParserToRts(ExgMcMessage& e) {
-   auto&       pk = *static_cast<const ExgMcI081*>(&e.Pk_);
-   ExgMdLocker lk{e, pk.ProdId_};
+   auto&           pk = *static_cast<const ExgMcI081*>(&e.Pk_);
+   ExgMdSymbLocker lk{e, pk.ProdId_};
    if (!e.Channel_.GetChannelMgr()->CheckSymbTradingSessionId(*e.Symb_))
       return;
    // ExgMdToUpdateBS(e.Pk_.InformationTime_.ToDayTime(), PackBcdTo<unsigned>(pk.NoMdEntries_), pk.MdEntry_, *e.Symb_);
@@ -121,8 +121,8 @@ f9twf_API void I081BSParserToRts(ExgMcMessage& e) {
 }
 //--------------------------------------------------------------------------//
 f9twf_API void I083BSParserToRts(ExgMcMessage& e) {
-   auto&       pk = *static_cast<const ExgMcI083*>(&e.Pk_);
-   ExgMdLocker lk{e, pk.ProdId_};
+   auto&           pk = *static_cast<const ExgMcI083*>(&e.Pk_);
+   ExgMdSymbLocker lk{e, pk.ProdId_};
    if (!e.Channel_.GetChannelMgr()->CheckSymbTradingSessionId(*e.Symb_))
       return;
    ExgMdToSnapshotBS(e.Pk_.InformationTime_.ToDayTime(), PackBcdTo<unsigned>(pk.NoMdEntries_), pk.MdEntry_,
@@ -11,8 +11,8 @@ namespace f9fmkt = fon9::fmkt;
 static void I071ClosingToRts(ExgMcMessage& e, const ExgMdClosing071& pk) {
    f9fmkt::SymbFuoClosing_Data closing;
 
-   ExgMdLocker lk{e, pk.ProdId_};
-   auto&       symb = *e.Symb_;
+   ExgMdSymbLocker lk{e, pk.ProdId_};
+   auto&           symb = *e.Symb_;
    ExgMdPriceTo(closing.PriSettlement_, pk.PriSettlement_, symb.PriceOrigDiv_);
    if (closing.PriSettlement_.IsZero())
       closing.PriSettlement_.AssignNull();
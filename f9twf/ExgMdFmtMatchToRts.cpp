@@ -47,9 +47,9 @@ struct RtsMdMatchParser {
 };
 
 f9twf_API void I024MatchParserToRts(ExgMcMessage& e) {
-   auto&       pk = *static_cast<const ExgMcI024*>(&e.Pk_);
-   ExgMdLocker lk{e, pk.ProdId_};
-   auto&       symb = *e.Symb_;
+   auto&           pk = *static_cast<const ExgMcI024*>(&e.Pk_);
+   ExgMdSymbLocker lk{e, pk.ProdId_};
+   auto&           symb = *e.Symb_;
    // 由於解析成交明細時, 會同時檢查 High/Low, 並設定 High/Low 的時間,
    // 所以必須在解析成交明細前, 先取出成交時間.
    const auto  bfDealTime = symb.Deal_.Data_.DealTime_;
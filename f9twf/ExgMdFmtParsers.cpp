@@ -97,8 +97,8 @@ f9twf_API void I011ContractParser(ExgMcMessage& e) {
 }
 //--------------------------------------------------------------------------//
 f9twf_API void I081BSParser(ExgMcMessage& e) {
-   auto&       pk = *static_cast<const ExgMcI081*>(&e.Pk_);
-   ExgMdLocker lk{e, pk.ProdId_};
+   auto&           pk = *static_cast<const ExgMcI081*>(&e.Pk_);
+   ExgMdSymbLocker lk{e, pk.ProdId_};
    if (e.Channel_.GetChannelMgr()->CheckSymbTradingSessionId(*e.Symb_)) {
       ExgMdToUpdateBS(e.Pk_.InformationTime_.ToDayTime(),
                       fon9::PackBcdTo<unsigned>(pk.NoMdEntries_),
@@ -108,8 +108,8 @@ f9twf_API void I081BSParser(ExgMcMessage& e) {
    }
 }
 f9twf_API void I083BSParser(ExgMcMessage& e) {
-   auto&       pk = *static_cast<const ExgMcI083*>(&e.Pk_);
-   ExgMdLocker lk{e, pk.ProdId_};
+   auto&           pk = *static_cast<const ExgMcI083*>(&e.Pk_);
+   ExgMdSymbLocker lk{e, pk.ProdId_};
    if (e.Channel_.GetChannelMgr()->CheckSymbTradingSessionId(*e.Symb_)) {
       ExgMdToSnapshotBS(e.Pk_.InformationTime_.ToDayTime(),
                         fon9::PackBcdTo<unsigned>(pk.NoMdEntries_),
@@ -30,6 +30,59 @@ struct ExgMdLocker {
    }
 };
 
+/// 解析「只異動單一商品」的訊息(例: 成交、委託簿、收盤、詢價)時使用.
+/// - 若商品已存在, 且商品的盤別與 ChannelMgr 相同: 僅鎖定商品所在的分區,
+///   讓不同分區的商品可以在不同的 thread 同時處理.
+/// - 否則(新商品、需要換盤 SessionClear...): 改成鎖定整棵樹, 然後使用 FetchSymb() 取得商品.
+///   因為這些情況可能會異動 SymbMap 或 Contract 的共用資料.
+struct ExgMdSymbLocker {
+   fon9_NON_COPY_NON_MOVE(ExgMdSymbLocker);
+   ExgMdSymbs&             Symbs_;
+   ExgMdSymbs::ShardLocker ShardLocker_;
+   ExgMdSymbs::Locker      SymbsLocker_;
+
+   ExgMdSymbLocker(ExgMcMessage& e, fon9::StrView symbId)
+      : Symbs_(*e.Channel_.GetChannelMgr()->Symbs_) {
+      this->LockSymb(e, symbId);
+   }
+   /// 優先使用 ExgMdSymbs::GetProdIdIndex() 尋找商品, 不用建立 StrView 及計算字串 hash;
+   /// 若沒有索引, 或商品不在索引裡面, 則使用字串尋找.
+   ExgMdSymbLocker(ExgMcMessage& e, const ExgMdProdId20& prodId)
+      : Symbs_(*e.Channel_.GetChannelMgr()->Symbs_) {
+      if (const ExgMdProdIdIndex* idx = this->Symbs_.GetProdIdIndex()) {
+         if (const ExgMdProdIdIndex::Entry* ent = idx->Find(prodId)) {
+            this->ShardLocker_ = this->Symbs_.LockShardIndex(ent->ShardIndex_);
+            // 取得分區鎖之後, 索引仍有效, 才能使用 ent->Symb_;
+            if (fon9_LIKELY(this->Symbs_.GetProdIdIndex() == idx
+                            && ent->Symb_->TradingSessionId_ == e.Channel_.GetChannelMgr()->TradingSessionId_)) {
+               e.Symb_ = static_cast<ExgMdSymb*>(ent->Symb_);
+               return;
+            }
+            this->ShardLocker_.unlock();
+         }
+      }
+      this->LockSymb(e, fon9::StrView_eos_or_all(prodId.Chars_, ' '));
+   }
+
+   template <class ProdId>
+   ExgMdSymbLocker(ExgMcMessage& e, const ProdId& prodId)
+      : ExgMdSymbLocker{e, fon9::StrView_eos_or_all(prodId.Chars_, ' ')} {
+   }
+
+private:
+   void LockSymb(ExgMcMessage& e, fon9::StrView symbId) {
+      this->ShardLocker_ = this->Symbs_.LockShard(symbId);
+      auto* symb = static_cast<ExgMdSymb*>(this->Symbs_.FindSymb(this->ShardLocker_, symbId));
+      if (fon9_LIKELY(symb && symb->TradingSessionId_ == e.Channel_.GetChannelMgr()->TradingSessionId_)) {
+         e.Symb_ = symb;
+         return;
+      }
+      this->ShardLocker_.unlock();
+      this->SymbsLocker_ = this->Symbs_.SymbMap_.Lock();
+      e.Symb_ = static_cast<ExgMdSymb*>(this->Symbs_.FetchSymb(this->SymbsLocker_, symbId).get());
+   }
+};
+
 f9twf_API void I010BasicInfoParser_V7(ExgMcMessage& e);
 f9twf_API bool I010BasicInfoLockedParser_V7(ExgMcMessage& e, const ExgMdLocker&);
 f9twf_API bool I010BasicInfoLockedParser_V8(ExgMcMessage& e, const ExgMdLocker&);
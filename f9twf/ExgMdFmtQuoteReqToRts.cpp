@@ -14,8 +14,8 @@ f9twf_API void I100QuoteReqParserToRts(ExgMcMessage& e) {
    quoteReq.DisclosureTime_ = pk.DisclosureTime_.ToDayTime();
    quoteReq.DurationSeconds_ = fon9::PackBcdTo<uint16_t>(pk.DurationSeconds_);
 
-   ExgMdLocker lk{e, pk.ProdId_};
-   auto&       symb = *e.Symb_;
+   ExgMdSymbLocker lk{e, pk.ProdId_};
+   auto&           symb = *e.Symb_;
    if (symb.QuoteReq_.Data_ == quoteReq)
       return;
    symb.QuoteReq_.Data_ = quoteReq;
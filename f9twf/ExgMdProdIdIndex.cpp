@@ -0,0 +1,63 @@
+﻿// \file f9twf/ExgMdProdIdIndex.cpp
+// \author fonwinz@gmail.com
+#include "f9twf/ExgMdProdIdIndex.hpp"
+
+namespace f9twf {
+
+ExgMdProdIdIndex::~ExgMdProdIdIndex() {
+}
+/// 使用 seed 將 ents 填入 table, 返回最長的探查次數.
+static unsigned FillProdIdTable(std::vector<ExgMdProdIdIndex::Entry>& table, size_t mask, uint64_t seed,
+                                const std::vector<ExgMdProdIdIndex::Entry>& ents) {
+   table.assign(mask + 1, ExgMdProdIdIndex::Entry{});
+   unsigned maxProbe = 0;
+   for (const auto& ent : ents) {
+      size_t   idx = ExgMdProdIdIndex::Hash(ent.ProdId_, seed) & mask;
+      unsigned probe = 1;
+      while (table[idx].Symb_) {
+         idx = (idx + 1) & mask;
+         ++probe;
+      }
+      table[idx] = ent;
+      if (maxProbe < probe)
+         maxProbe = probe;
+   }
+   return maxProbe;
+}
+void ExgMdProdIdIndex::Build(const fon9::fmkt::SymbTree& tree, const fon9::fmkt::SymbTree::SymbMapImpl& symbs) {
+   std::vector<Entry> ents;
+   ents.reserve(symbs.size());
+   this->Symbs_.clear();
+   this->Symbs_.reserve(symbs.size());
+   for (const auto& v : symbs) {
+      fon9::fmkt::Symb& symb = fon9::fmkt::GetSymbValue(v);
+      const fon9::StrView symbid = fon9::ToStrView(symb.SymbId_);
+      if (symbid.empty() || symbid.size() > sizeof(ExgMdProdId20))
+         continue;
+      ents.emplace_back();
+      Entry& ent = ents.back();
+      memset(ent.ProdId_.Chars_, ' ', sizeof(ent.ProdId_.Chars_));
+      memcpy(ent.ProdId_.Chars_, symbid.begin(), symbid.size());
+      ent.ShardIndex_ = tree.GetShardIndex(symbid);
+      ent.Symb_ = &symb;
+      this->Symbs_.emplace_back(&symb);
+   }
+   this->Size_ = ents.size();
+   // 使用率 <= 50%, 讓找不到的商品也能快速結束探查.
+   size_t capacity = 16;
+   while (capacity < ents.size() * 2)
+      capacity <<= 1;
+   this->Mask_ = capacity - 1;
+   this->MaxProbe_ = FillProdIdTable(this->Table_, this->Mask_, this->Seed_ = 0, ents);
+   std::vector<Entry> table;
+   for (uint64_t seed = 1; seed < kMaxSeedTry && this->MaxProbe_ > 1; ++seed) {
+      const unsigned maxProbe = FillProdIdTable(table, this->Mask_, seed * 0x9e3779b97f4a7c15u, ents);
+      if (maxProbe < this->MaxProbe_) {
+         this->Table_.swap(table);
+         this->MaxProbe_ = maxProbe;
+         this->Seed_ = seed * 0x9e3779b97f4a7c15u;
+      }
+   }
+}
+
+} // namespaces
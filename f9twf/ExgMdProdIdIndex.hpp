@@ -0,0 +1,97 @@
+﻿// \file f9twf/ExgMdProdIdIndex.hpp
+// \author fonwinz@gmail.com
+#ifndef __f9twf_ExgMdProdIdIndex_hpp__
+#define __f9twf_ExgMdProdIdIndex_hpp__
+#include "f9twf/ExgMdFmt.hpp"
+#include "fon9/fmkt/SymbTree.hpp"
+#include <vector>
+
+namespace f9twf {
+
+fon9_WARN_DISABLE_PADDING;
+/// 使用期交所行情封包的 ExgMdProdId20(20 bytes, 尾端補空白) 直接找到商品.
+/// - 不用建立 StrView, 也不用計算字串 hash, 只需要比對固定長度的 key.
+/// - 使用 open addressing(linear probing) 的表格.
+/// - 建立後就不再異動, 所以可以在多個 thread 同時查找.
+/// - 建立時會嘗試多個 hash seed, 選用「最長探查次數」最少的 seed;
+///   若每個商品都在第一個探查位置, 則為 perfect hash.
+class f9twf_API ExgMdProdIdIndex {
+   fon9_NON_COPY_NON_MOVE(ExgMdProdIdIndex);
+public:
+   struct Entry {
+      ExgMdProdId20     ProdId_;
+      /// 商品所在的分區, 可直接使用 SymbTree::LockShardIndex(ShardIndex_) 鎖定.
+      uint32_t          ShardIndex_;
+      /// 鎖定 ShardIndex_ 之後, 確定索引仍有效, 才能使用 Symb_;
+      /// 索引失效後, 會釋放保留的商品(ReleaseSymbs()), 此時 Symb_ 可能已經無效.
+      fon9::fmkt::Symb* Symb_;
+   };
+   enum : unsigned {
+      /// 建立索引時, 最多嘗試的 hash seed 數量.
+      kMaxSeedTry = 16,
+   };
+
+   ExgMdProdIdIndex() = default;
+   ~ExgMdProdIdIndex();
+
+   /// 建立索引, 呼叫前 symbs 必須在鎖定狀態.
+   /// 商品代號長度超過 ExgMdProdId20 的商品, 不會加入索引.
+   void Build(const fon9::fmkt::SymbTree& tree, const fon9::fmkt::SymbTree::SymbMapImpl& symbs);
+
+   /// \retval nullptr 商品不在索引裡面.
+   const Entry* Find(const ExgMdProdId20& prodId) const {
+      size_t idx = this->Hash(prodId, this->Seed_) & this->Mask_;
+      for (unsigned L = 0; L < this->MaxProbe_; ++L) {
+         const Entry& ent = this->Table_[idx];
+         if (ent.Symb_ == nullptr)
+            break;
+         if (memcmp(ent.ProdId_.Chars_, prodId.Chars_, sizeof(prodId.Chars_)) == 0)
+            return &ent;
+         idx = (idx + 1) & this->Mask_;
+      }
+      return nullptr;
+   }
+
+   /// 索引失效後呼叫: 釋放保留的商品, 但保留表格, 讓仍在 Find() 的 thread 可以安全讀取.
+   void ReleaseSymbs() {
+      std::vector<fon9::fmkt::SymbSP>{}.swap(this->Symbs_);
+   }
+
+   /// 索引的商品數量.
+   size_t size() const {
+      return this->Size_;
+   }
+   size_t GetCapacity() const {
+      return this->Table_.size();
+   }
+   /// 最長的探查次數, 1 表示: perfect hash.
+   unsigned GetMaxProbe() const {
+      return this->MaxProbe_;
+   }
+
+   static size_t Hash(const ExgMdProdId20& prodId, uint64_t seed) {
+      static_assert(sizeof(prodId.Chars_) == 8 + 8 + 4, "ExgMdProdId20 size error.");
+      uint64_t a, b;
+      uint32_t c;
+      memcpy(&a, prodId.Chars_, 8);
+      memcpy(&b, prodId.Chars_ + 8, 8);
+      memcpy(&c, prodId.Chars_ + 16, 4);
+      uint64_t h = (a ^ seed) * 0x9e3779b97f4a7c15u;
+      h = (h ^ (h >> 32) ^ b) * 0xc2b2ae3d27d4eb4fu;
+      h = (h ^ (h >> 29) ^ c) * 0x165667b19e3779f9u;
+      return static_cast<size_t>(h ^ (h >> 32));
+   }
+
+private:
+   std::vector<Entry>               Table_;
+   /// 保留商品的參考計數, 確保 Entry::Symb_ 在索引存續期間有效.
+   std::vector<fon9::fmkt::SymbSP>  Symbs_;
+   size_t   Size_{0};
+   uint64_t Seed_{0};
+   size_t   Mask_{0};
+   unsigned MaxProbe_{0};
+};
+fon9_WARN_POP;
+
+} // namespaces
+#endif//__f9twf_ExgMdProdIdIndex_hpp__
@@ -5,6 +5,7 @@
 #include "f9twf/ExgMdFmtBS.hpp"
 #include "fon9/seed/FieldMaker.hpp"
 #include "fon9/fmkt/SymbTabNames.h"
+#include "fon9/Log.hpp"
 
 namespace f9twf {
 
@@ -65,6 +66,7 @@ ExgMdSymb::~ExgMdSymb() {
 }
 void ExgMdSymb::OnBeforeRemove(fon9::fmkt::SymbTree& owner, unsigned tdayYYYYMMDD) {
    (void)tdayYYYYMMDD;
+   static_cast<ExgMdSymbs*>(&owner)->ClearProdIdIndex();
    this->MdRtStream_.BeforeRemove(owner, *this);
    this->Contract_.OnSymbRemove(*this);
 }
@@ -123,14 +125,46 @@ void ExgMdSymb::OnOpenSeqReset(fon9::fmkt::SymbTree& owner) {
 ExgMdSymbs::ExgMdSymbs(std::string rtiPathFmt, bool isAddMarketSeq)
    : base(ExgMdSymb::MakeLayout(isAddMarketSeq), std::move(rtiPathFmt),
           isAddMarketSeq ? fon9::fmkt::MdSymbsCtrlFlag::HasMarketDataSeq : fon9::fmkt::MdSymbsCtrlFlag{}) {
+   this->SetShardCount(kDefaultShardCount);
 }
 fon9::fmkt::SymbSP ExgMdSymbs::MakeSymb(const fon9::StrView& symbid) {
    assert(this->SymbMap_.IsLocked());
    return new ExgMdSymb(symbid, *this);
 }
 void ExgMdSymbs::OnAfterLoadFrom(Locker&& symbsLk) {
-   (void)symbsLk;
    this->Contracts_.OnSymbsReload();
+   this->RebuildProdIdIndex(symbsLk);
+}
+void ExgMdSymbs::OnBeforePodOpRemove(fon9::fmkt::Symb& symb, const Locker& symbs) {
+   (void)symb; (void)symbs;
+   this->ClearProdIdIndex();
+}
+void ExgMdSymbs::OnParentSeedClear() {
+   {
+      auto symbs = this->SymbMap_.Lock();
+      this->ClearProdIdIndex();
+   }
+   base::OnParentSeedClear();
+}
+void ExgMdSymbs::RebuildProdIdIndex(const Locker& symbs) {
+   assert(symbs.owns_lock());
+   std::unique_ptr<ExgMdProdIdIndex> idx{new ExgMdProdIdIndex};
+   idx->Build(*this, *symbs);
+   fon9_LOG_INFO("ExgMdSymbs.RebuildProdIdIndex"
+                 "|count=", idx->size(),
+                 "|capacity=", idx->GetCapacity(),
+                 "|maxProbe=", idx->GetMaxProbe());
+   this->ResetProdIdIndex(idx.get());
+   this->ProdIdIndexList_.push_back(std::move(idx));
+}
+void ExgMdSymbs::ResetProdIdIndex(const ExgMdProdIdIndex* idx) {
+   assert(this->SymbMap_.IsLocked());
+   const ExgMdProdIdIndex* const prev = this->ProdIdIndex_.exchange(idx, std::memory_order_acq_rel);
+   // SymbMap_ locked = 全部的分區都已鎖定, 此時沒有任何 thread 正在使用 prev 的 Entry::Symb_;
+   // 解除鎖定後, 取得分區鎖的 thread 都會看到新的索引, 不會再使用 prev 的 Entry::Symb_;
+   // 所以可以立即釋放 prev 保留的商品, 只保留表格給「尚未取得分區鎖」的 thread 讀取.
+   if (prev && !this->ProdIdIndexList_.empty() && this->ProdIdIndexList_.back().get() == prev)
+      this->ProdIdIndexList_.back()->ReleaseSymbs();
 }
 void ExgMdSymbs::OnTreeOp(fon9::seed::FnTreeOp fnCallback) {
    MdTreeOp op{*this};
@@ -3,6 +3,7 @@
 #ifndef __f9twf_ExgMdSymbs_hpp__
 #define __f9twf_ExgMdSymbs_hpp__
 #include "f9twf/ExgMdContracts.hpp"
+#include "f9twf/ExgMdProdIdIndex.hpp"
 #include "f9twf/TwfSymbRef.hpp"
 #include "fon9/fmkt/SymbTwf.hpp"
 #include "fon9/fmkt/MdSymbs.hpp"
@@ -12,6 +13,7 @@
 #include "fon9/fmkt/SymbBreakSt.hpp"
 #include "fon9/fmkt/SymbFuoClosing.hpp"
 #include "fon9/fmkt/SymbDynBand.hpp"
+#include <atomic>
 #include "fon9/fmkt/SymbQuoteReq.hpp"
 #include "fon9/fmkt/MdRtStream.hpp"
 
@@ -84,9 +86,26 @@ class f9twf_API ExgMdSymbs : public fon9::fmkt::MdSymbsT<ExgMdSymb> {
    using base = fon9::fmkt::MdSymbsT<ExgMdSymb>;
    ExgMdContracts Contracts_;
 
+   /// 目前有效的 ProdId 索引, nullptr 表示沒有索引(或已失效).
+   std::atomic<const ExgMdProdIdIndex*>            ProdIdIndex_{nullptr};
+   /// 包含已失效的索引: 因為其他 thread 可能仍在讀取(尚未取得分區鎖),
+   /// 所以失效索引的表格不能立即釋放, 在 ExgMdSymbs 解構時才釋放.
+   /// - 但失效時會立即釋放索引保留的商品(ExgMdProdIdIndex::ReleaseSymbs()),
+   ///   避免已移除的商品(及其 MdRtStream...), 因為仍被舊索引參考而無法釋放.
+   /// - 索引只在商品載入、基本資料輪播完畢時重建, 所以數量不多, 且僅剩表格, 佔用空間不大.
+   std::vector<std::unique_ptr<ExgMdProdIdIndex>>  ProdIdIndexList_;
+   /// 必須在 SymbMap_ locked 狀態下呼叫: 設定新的索引, 並釋放舊索引保留的商品.
+   void ResetProdIdIndex(const ExgMdProdIdIndex* idx);
+
    void OnAfterLoadFrom(Locker&& symbsLk) override;
+   void OnBeforePodOpRemove(fon9::fmkt::Symb& symb, const Locker& symbs) override;
 
 public:
+   /// 預設的分區數量, 讓期貨、選擇權...的行情可以在不同的 thread 同時處理.
+   /// 解析行情時, 使用 ExgMdSymbLocker 鎖定商品所在的分區.
+   enum : unsigned {
+      kDefaultShardCount = 16,
+   };
    ExgMdSymbs(std::string rtiPathFmt, bool isAddMarketSeq);
 
    fon9::fmkt::SymbSP MakeSymb(const fon9::StrView& symbid) override;
@@ -107,12 +126,31 @@ public:
       return this->Contracts_;
    }
 
+   /// 使用現有的全部商品, 重建 ProdId 索引.
+   /// - 商品清單穩定後(例: LoadFrom() 之後、基本資料輪播完畢)呼叫.
+   /// - 新增的商品不會加入索引, 此時解析行情仍可使用字串尋找, 不影響正確性.
+   void RebuildProdIdIndex(const Locker& symbs);
+   void RebuildProdIdIndex() {
+      this->RebuildProdIdIndex(this->SymbMap_.Lock());
+   }
+   /// 移除商品前, 必須在 SymbMap_ locked 狀態下, 先讓索引失效.
+   void ClearProdIdIndex() {
+      assert(this->SymbMap_.IsLocked());
+      this->ResetProdIdIndex(nullptr);
+   }
+   /// 讀取 ProdId 索引時不用鎖定, 但使用 Entry::Symb_ 之前:
+   /// 必須先鎖定 Entry::ShardIndex_, 然後確定 GetProdIdIndex() 仍是同一個索引.
+   const ExgMdProdIdIndex* GetProdIdIndex() const {
+      return this->ProdIdIndex_.load(std::memory_order_acquire);
+   }
+
    struct MdTreeOp : public MdSymbsOp {
       fon9_NON_COPY_NON_MOVE(MdTreeOp);
       using MdSymbsOp::MdSymbsOp;
       void Get(fon9::StrView strKeyText, fon9::seed::FnPodOp fnCallback) override;
    };
    void OnTreeOp(fon9::seed::FnTreeOp fnCallback) override;
+   void OnParentSeedClear() override;
 };
 using ExgMdSymbsSP = fon9::intrusive_ptr<ExgMdSymbs>;
 //--------------------------------------------------------------------------//
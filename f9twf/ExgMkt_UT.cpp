@@ -10,6 +10,7 @@
 #include "f9twf/ExgMdFmtHL.hpp"
 #include "f9twf/ExgMcFmtSS.hpp"
 #include "f9twf/ExgMdSymbs.hpp"
+#include "f9twf/ExgMdProdIdIndex.hpp"
 #include "f9extests/ExgMktTester.hpp"
 
 //--------------------------------------------------------------------------//
@@ -80,6 +81,8 @@ struct RtParser : public TwfPkReceiver, public fon9::fmkt::SymbTree {
    size_t      ParsedCount_{};
    size_t      TotalQtyLostCount_{};
    size_t      UnknownValue_{};
+   /// 若有提供, 則優先使用 ProdId 索引尋找商品.
+   const f9twf::ExgMdProdIdIndex* ProdIdIndex_{};
 
    RtParser() : baseTree{fon9::seed::LayoutSP{}} {
       // 逐筆: 成交價量:I024;
@@ -112,6 +115,13 @@ struct RtParser : public TwfPkReceiver, public fon9::fmkt::SymbTree {
    fon9::fmkt::SymbSP MakeSymb(const fon9::StrView& symbid) override {
       return new f9extests::SymbIn{symbid};
    }
+   f9extests::SymbIn& FetchSymbIn(const SymbMap::Locker& symbs, const f9twf::ExgMdProdId20& prodId) {
+      if (this->ProdIdIndex_) {
+         if (const f9twf::ExgMdProdIdIndex::Entry* ent = this->ProdIdIndex_->Find(prodId))
+            return *static_cast<f9extests::SymbIn*>(ent->Symb_);
+      }
+      return *static_cast<f9extests::SymbIn*>(this->FetchSymb(symbs, fon9::StrView_eos_or_all(prodId.Chars_, ' ')).get());
+   }
    size_t GetParsedCount() const {
       return this->ParsedCount_;
    }
@@ -149,14 +159,14 @@ struct RtParser : public TwfPkReceiver, public fon9::fmkt::SymbTree {
    // isCalc = true = 試撮價格訊息.
    template <class Pk>
    static uintptr_t AssignMatch(RtParser& dst, const Pk& pk, bool isCalc) {
-      return AssignMatch(dst, fon9::StrView_eos_or_all(pk.ProdId_.Chars_, ' '), pk, pk, isCalc)
+      return AssignMatch(dst, pk.ProdId_, pk, pk, isCalc)
              - reinterpret_cast<uintptr_t>(&pk);
    }
-   static uintptr_t AssignMatch(RtParser& dst, const fon9::StrView& symbid,
+   static uintptr_t AssignMatch(RtParser& dst, const f9twf::ExgMdProdId20& prodId,
                                 const f9twf::ExgMdMatchHead& mat, const f9twf::ExgMdHead0& hdr,
                                 bool isCalc) {
       SymbMap::Locker      symbs{dst.SymbMap_};
-      f9extests::SymbIn&   symb = *static_cast<f9extests::SymbIn*>(dst.FetchSymb(symbs, symbid).get());
+      f9extests::SymbIn&   symb = dst.FetchSymbIn(symbs, prodId);
       symb.Deal_.Data_.InfoTime_ = hdr.InformationTime_.ToDayTime();
       symb.Deal_.Data_.DealTime_ = mat.MatchTime_.ToDayTime();
       mat.FirstMatchPrice_.AssignTo(symb.Deal_.Data_.Deal_.Pri_, symb.PriceOrigDiv_);
@@ -185,9 +195,8 @@ struct RtParser : public TwfPkReceiver, public fon9::fmkt::SymbTree {
       MiBSParser(*static_cast<const f9twf::ExgMiI082*>(&pk), pksz, dst);
    }
    static void MiBSParser(const f9twf::ExgMiI080& pk, unsigned pksz, RtParser& dst) {
-      fon9::StrView        symbid = fon9::StrView_eos_or_all(pk.ProdId_.Chars_, ' ');
       SymbMap::Locker      symbs{dst.SymbMap_};
-      f9extests::SymbIn&   symb = *static_cast<f9extests::SymbIn*>(dst.FetchSymb(symbs, symbid).get());
+      f9extests::SymbIn&   symb = dst.FetchSymbIn(symbs, pk.ProdId_);
       static_assert(fon9::fmkt::SymbBSData::kBSCount == sizeof(pk.BuyOrderBook_)/sizeof(pk.BuyOrderBook_[0]),
                     "fon9::fmkt::SymbBS::kBSCount must equal to numofele(pk.BuyOrderBook_)");
       AssignBS(symb.BS_.Data_.Buys_, pk.BuyOrderBook_, symb.PriceOrigDiv_);
@@ -216,9 +225,8 @@ struct RtParser : public TwfPkReceiver, public fon9::fmkt::SymbTree {
    }
    //-----------------------------------------------------------------------//
    static void McI081BSParser(const f9twf::ExgMcHead& pk, unsigned pksz, RtParser& rthis) {
-      fon9::StrView      symbid = fon9::StrView_eos_or_all(static_cast<const f9twf::ExgMcI081*>(&pk)->ProdId_.Chars_, ' ');
       SymbMap::Locker    symbs{rthis.SymbMap_};
-      f9extests::SymbIn& symb = *static_cast<f9extests::SymbIn*>(rthis.FetchSymb(symbs, symbid).get());
+      f9extests::SymbIn& symb = rthis.FetchSymbIn(symbs, static_cast<const f9twf::ExgMcI081*>(&pk)->ProdId_);
       unsigned mdCount = fon9::PackBcdTo<unsigned>(static_cast<const f9twf::ExgMcI081*>(&pk)->NoMdEntries_);
       auto*    mdEntry = static_cast<const f9twf::ExgMcI081*>(&pk)->MdEntry_;
       f9twf::ExgMdToUpdateBS(pk.InformationTime_.ToDayTime(), mdCount, mdEntry, symb,
@@ -228,9 +236,8 @@ struct RtParser : public TwfPkReceiver, public fon9::fmkt::SymbTree {
          fon9_CheckTestResult("McI081BSParser.pksz", false);
    }
    static void McI083BSParser(const f9twf::ExgMcHead& pk, unsigned pksz, RtParser& rthis) {
-      fon9::StrView      symbid = fon9::StrView_eos_or_all(static_cast<const f9twf::ExgMcI083*>(&pk)->ProdId_.Chars_, ' ');
       SymbMap::Locker    symbs{rthis.SymbMap_};
-      f9extests::SymbIn& symb = *static_cast<f9extests::SymbIn*>(rthis.FetchSymb(symbs, symbid).get());
+      f9extests::SymbIn& symb = rthis.FetchSymbIn(symbs, static_cast<const f9twf::ExgMcI083*>(&pk)->ProdId_);
       symb.BS_.Data_.Clear();
       const void* entryEnd = f9twf::ExgMdToSnapshotBS(pk.InformationTime_.ToDayTime(),
          fon9::PackBcdTo<unsigned>(static_cast<const f9twf::ExgMcI083*>(&pk)->NoMdEntries_),
@@ -317,6 +324,76 @@ struct RtParser : public TwfPkReceiver, public fon9::fmkt::SymbTree {
    }
 };
 
+//--------------------------------------------------------------------------//
+/// 比較使用 StrView(unordered_map) 及 ExgMdProdIdIndex 尋找商品的效率.
+void TestProdIdIndex(const f9extests::MktDataFile& mdf, double tmFull) {
+   std::unique_ptr<RtParser> parserSP{new RtParser};
+   RtParser&                 parser = *parserSP;
+   fon9::StopWatch           stopWatch;
+   {  // 先解析一次, 建立全部的商品.
+      fon9::DcQueueFixedMem dcq{mdf.Buffer_, mdf.Size_};
+      parser.FeedBuffer(dcq);
+   }
+   f9twf::ExgMdProdIdIndex          idx;
+   std::vector<f9twf::ExgMdProdId20> prodIds;
+   {
+      auto symbs = parser.SymbMap_.Lock();
+      stopWatch.ResetTimer();
+      idx.Build(parser, *symbs);
+      stopWatch.PrintResultNoEOL("ProdIdIndex.Build", symbs->size())
+         << "|capacity=" << idx.GetCapacity()
+         << "|maxProbe=" << idx.GetMaxProbe() << std::endl;
+      for (auto& v : *symbs) {
+         const fon9::StrView symbid = fon9::ToStrView(fon9::fmkt::GetSymbValue(v).SymbId_);
+         if (symbid.size() > sizeof(f9twf::ExgMdProdId20))
+            continue;
+         prodIds.emplace_back();
+         memset(prodIds.back().Chars_, ' ', sizeof(prodIds.back().Chars_));
+         memcpy(prodIds.back().Chars_, symbid.begin(), symbid.size());
+      }
+   }
+   if (prodIds.empty())
+      return;
+   // 單純比較尋找商品.
+   const unsigned kFindTimes = 100;
+   const size_t   findCount = prodIds.size() * kFindTimes;
+   size_t         found = 0;
+   {
+      auto symbs = parser.SymbMap_.Lock();
+      auto iend = symbs->end();
+      stopWatch.ResetTimer();
+      for (unsigned L = 0; L < kFindTimes; ++L) {
+         for (const auto& prodId : prodIds) {
+            if (symbs->find(fon9::StrView_eos_or_all(prodId.Chars_, ' ')) != iend)
+               ++found;
+         }
+      }
+      stopWatch.PrintResultNoEOL("Find|StrView      ", findCount) << "|found=" << found << std::endl;
+   }
+   found = 0;
+   stopWatch.ResetTimer();
+   for (unsigned L = 0; L < kFindTimes; ++L) {
+      for (const auto& prodId : prodIds) {
+         if (idx.Find(prodId))
+            ++found;
+      }
+   }
+   stopWatch.PrintResultNoEOL("Find|ProdIdIndex  ", findCount) << "|found=" << found << std::endl;
+   fon9_CheckTestResult("ProdIdIndex.Find", found == findCount);
+   // 比較完整的解析.
+   const f9twf::ExgMdProdIdIndex* const idxList[] = {nullptr, &idx};
+   for (const f9twf::ExgMdProdIdIndex* pidx : idxList) {
+      parser.ClearStatus();
+      parser.ParsedCount_ = 0;
+      parser.ProdIdIndex_ = pidx;
+      fon9::DcQueueFixedMem dcq{mdf.Buffer_, mdf.Size_};
+      stopWatch.ResetTimer();
+      parser.FeedBuffer(dcq);
+      const double tmParsed = stopWatch.StopTimer();
+      stopWatch.PrintResult(tmParsed - tmFull, pidx ? "Parse|ProdIdIndex " : "Parse|StrView     ", parser.GetParsedCount());
+   }
+}
+
 int main(int argc, char* argv[]) {
    fon9::AutoPrintTestInfo utinfo{"f9twf ExgMkt"};
 
@@ -417,8 +494,11 @@ int main(int argc, char* argv[]) {
       }
    }
    if (argc >= 5) {
-      if (f9extests::CheckExgMktFeederStep(pkReceiver, mdf, argv[4]) == 0)
+      if (f9extests::CheckExgMktFeederStep(pkReceiver, mdf, argv[4]) == 0) {
          f9extests::ExgMktTestParser<RtParser>("Parse Match+BS", mdf, argc - 4, argv + 4, tmFull,
                                                fon9::FmtDef{7,8});
+         utinfo.PrintSplitter();
+         TestProdIdIndex(mdf, tmFull);
+      }
    }
 }
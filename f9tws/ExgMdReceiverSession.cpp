@@ -18,7 +18,9 @@ std::string ExgMdReceiverSession::SessionCommand(io::Device& dev, StrView cmdln)
          UtcNow(),
          "|pkCount=", this->ReceivedCount_,
          "|chkSumErr=", this->ChkSumErrCount_,
-         "|dropped=", this->DroppedBytes_);
+         "|dropped=", this->DroppedBytes_,
+         "|contiguous=", this->ContiguousCount_,
+         "|stitched=", this->StitchedCount_);
    }
    return "unknown ExgMdReceiverSession command";
 }
@@ -52,6 +52,8 @@ public:
 /// TwsMdSys
 ///   ├─ Symbs      商品資料表.
 ///   ├─ Indices    指數資料表.
+///   ├─ SymbsArc, SymbsOddArc, IndicesArc
+///   │             換日時, 由「前一日」的 rti 轉出的歸檔查詢(使用 rti 且 SetRtiConfig("Archive=Y") 時才有).
 ///   └─ ExgMdIoMgr 資訊來源: ExgMdIoMgr 負責管理資料的連續性,
 ///                 所以「主、備」必須設定在同一個 ExgMdIoMgr.
 ///
@@ -13,6 +13,8 @@ constexpr uint32_t   kHeartBtInt = 10;
 
 fon9::ConfigParser::Result ExgTradingLineFixArgs::OnTagValue(fon9::StrView tag, fon9::StrView& value) {
    fon9::ConfigParser::Result r = this->FcArgs_.OnTagValue(tag, value);
+   if (r == fon9::ConfigParser::Result::EUnknownTag)
+      r = this->RecArgs_.OnTagValue(tag, value);
    if (r == fon9::ConfigParser::Result::EUnknownTag)
       return base::OnTagValue(tag, value);
    return r;
@@ -45,9 +47,10 @@ f9tws_API std::string MakeExgTradingLineFixSender(const ExgTradingLineFixArgs& a
    fileName.push_back('_');
    fixSender->CompIDs_.Sender_.CompID_.AppendTo(fileName); // ('T' or 'O') + BrkId + SocketId
    fileName.append(".log");
-   auto res = fixSender->GetFixRecorder().Initialize(fileName);
+   auto res = fixSender->GetFixRecorder().Initialize(fileName, args.RecArgs_.IsUseSeqIndex_);
    if (res.IsError())
       return fon9::RevPrintTo<std::string>("MakeExgTradingLineFixSender|fn=", fileName, '|', res);
+   fixSender->GetFixRecorder().SetWritePolicy(args.RecArgs_);
    out = std::move(fixSender);
    return std::string{};
 }
@@ -19,16 +19,21 @@ class f9tws_API ExgTradingLineFixArgs : public ExgLineArgs {
    using base = ExgLineArgs;
 public:
    fon9::FlowCounterArgs   FcArgs_;
+   /// FIX 記錄檔的寫檔策略.
+   f9fix::FixRecorderArgs  RecArgs_;
    void Clear() {
       base::Clear();
       this->FcArgs_.Clear();
+      this->RecArgs_.Clear();
    }
    fon9::ConfigParser::Result OnTagValue(fon9::StrView tag, fon9::StrView& value);
 };
 /// - 不改變 args.Market_ 您必須自行處理.
-/// - cfg = "BrkId=|SocketId=|Pass=|Fc=筆數/ms";
-/// - 除了 "Fc=" 每個欄位都必須提供.
+/// - cfg = "BrkId=|SocketId=|Pass=|Fc=筆數/ms|FixLogFlush=|FixLogSync=|FixSeqIndex=";
+/// - 除了 "Fc=", "FixLogFlush=", "FixLogSync=", "FixSeqIndex=" 每個欄位都必須提供.
 /// - 若省略 "Fc=" 則表示 FcCount_=0; 若省略 "/ms" 則用設為 1000; 
+/// - FixLogFlush, FixLogSync: FIX 記錄檔的寫檔策略, 參考 f9fix::FixRecorderArgs, 預設為立即寫檔, 不 Sync.
+/// - FixSeqIndex=Y: 使用 FIX 記錄檔的序號索引檔(記錄檔名 + ".idx"), 加快啟動及回補, 預設為 N.
 /// - retval.empty() 成功, retval = 失敗訊息.
 f9tws_API std::string ExgTradingLineFixArgsParser(ExgTradingLineFixArgs& args, fon9::StrView cfg);
 
@@ -1,41 +1,291 @@
 ﻿// \file fon9/DefaultThreadPool.cpp
 // \author fonwinz@gmail.com
+#define _CRT_SECURE_NO_WARNINGS  // Windows: getenv()
 #include "fon9/DefaultThreadPool.hpp"
 #include "fon9/sys/OnWindowsMainExit.hpp"
 #include "fon9/CyclicBarrier.hpp"
+#include "fon9/ThreadTools.hpp"
+#include "fon9/Tools.hpp"
+#include "fon9/StrTo.hpp"
+#include "fon9/Log.hpp"
+fon9_BEFORE_INCLUDE_STD;
+#include <deque>
+fon9_AFTER_INCLUDE_STD;
 
 namespace fon9 {
 
-struct DefaultThreadTaskHandler {
-   using MessageType = DefaultThreadTask;
-   DefaultThreadTaskHandler(DefaultThreadPool&) {
-      if (gWaitLogSystemReady)
-         gWaitLogSystemReady();
-   }
-   void OnMessage(DefaultThreadTask& task) {
-      task();
+ConfigParser::Result DefaultThreadPoolArgs::OnTagValue(StrView tag, StrView& value) {
+   const char* pvalbeg = value.begin();
+   if (tag == "ThreadCount") {
+      if ((this->ThreadCount_ = StrTo(value, 0u)) <= 0) {
+         this->ThreadCount_ = 1;
+         value.SetBegin(pvalbeg);
+         return ConfigParser::Result::EValueTooSmall;
+      }
    }
-   void OnThreadEnd(const std::string& threadName) {
-      (void)threadName;
+   else if (tag == "Cpus") {
+      this->CpuAffinity_.clear();
+      while (!value.empty()) {
+         StrView v1 = StrFetchTrim(value, ',');
+         if (v1.empty())
+            continue;
+         const char* pend;
+         int n = StrTo(v1, -1, &pend);
+         if (n < 0 || pend != v1.end()) {
+            value.SetBegin(n < 0 ? v1.begin() : pend);
+            return ConfigParser::Result::EInvalidValue;
+         }
+         this->CpuAffinity_.push_back(static_cast<uint32_t>(n));
+      }
    }
+   else
+      return ConfigParser::Result::EUnknownTag;
+   return ConfigParser::Result::Success;
+}
+
+//--------------------------------------------------------------------------//
+
+fon9_WARN_DISABLE_PADDING;
+struct DefaultThreadPool::Worker {
+   using Waiter = WaitPolicy_CV;
+   using Locker = Waiter::Locker;
+   Waiter::Mutex                 Mutex_;
+   Waiter                        Waiter_;
+   std::deque<DefaultThreadTask> Tasks_;
+   /// 在 Mutex_ 保護下設定: 正在等候工作, 加入工作時必須喚醒.
+   bool                          IsWaiting_{false};
+   std::thread                   Thread_;
 };
+fon9_WARN_POP;
+
+/// 目前 thread 所屬的 pool 及 worker, 用來判斷: 加入工作時, 是否在 pool 的 thread 裡面.
+static thread_local DefaultThreadPool* TlsCurrPool_;
+static thread_local void*              TlsCurrWorker_;
+
+static inline unsigned BitScanForwardU64(uint64_t v) {
+#ifdef _MSC_VER
+   unsigned long res;
+   _BitScanForward64(&res, v);
+   return static_cast<unsigned>(res);
+#else
+   return static_cast<unsigned>(__builtin_ctzll(v));
+#endif
+}
+
+DefaultThreadPool::DefaultThreadPool() {
+}
+DefaultThreadPool::~DefaultThreadPool() {
+   this->WaitForEndNow();
+}
+
+void DefaultThreadPool::StartThread(const DefaultThreadPoolArgs& args, StrView thrName) {
+   assert(this->State_ == ThreadState::Idle && !this->Workers_);
+   this->ThreadCount_ = (args.ThreadCount_ <= 0 ? 1u : args.ThreadCount_);
+   this->Workers_.reset(new Worker[this->ThreadCount_]);
+   this->State_.store(ThreadState::ExecutingOrWaiting, std::memory_order_release);
+   for (uint32_t L = 0; L < this->ThreadCount_; ++L) {
+      this->Workers_[L].Thread_ = std::thread(&DefaultThreadPool::ThrRun, this, L, args.GetCpuAffinity(L),
+                                              RevPrintTo<std::string>(thrName, "|indexInPool=", L + 1));
+   }
+}
+
+void DefaultThreadPool::ThrRun(uint32_t index, int cpuAffinity, std::string thrName) {
+   SetCurrentThreadName(thrName.c_str());
+   if (gWaitLogSystemReady)
+      gWaitLogSystemReady();
+   Result3 cpuAffinityResult = SetCpuAffinity(cpuAffinity);
+   fon9_LOG_ThrRun("DefaultThreadPool.ThrRun|name=", thrName, "|Cpu=", cpuAffinity, ':', cpuAffinityResult);
+
+   Worker&           worker = this->Workers_[index];
+   const uint64_t    idleBit = (index < 64 ? (uint64_t{1} << index) : 0u);
+   DefaultThreadTask task;
+   TlsCurrPool_ = this;
+   TlsCurrWorker_ = &worker;
+   for (;;) {
+      if (fon9_UNLIKELY(this->State_.load(std::memory_order_relaxed) >= ThreadState::EndNow))
+         break;
+      if (this->PopTask(worker, task) || this->StealTask(index, task)) {
+         task();
+         task = nullptr;
+         continue;
+      }
+      {
+         Worker::Locker lk{worker.Mutex_};
+         if (!worker.Tasks_.empty())
+            continue;
+         // 自己沒有工作, 也沒有從其他 thread 取得工作: 若正在結束, 則結束 thread, 否則進入等候.
+         if (this->State_.load(std::memory_order_relaxed) >= ThreadState::EndAfterWorkDone)
+            break;
+         worker.IsWaiting_ = true;
+      }
+      this->IdleBits_.fetch_or(idleBit);
+      // 設定等候狀態後, 必須再檢查一次其他 thread 的佇列:
+      // 避免在上次檢查之後, 有工作加入「忙碌中的 thread」, 但加入者尚未看到 idleBit, 因此沒有喚醒 this.
+      if (this->StealTask(index, task)) {
+         this->IdleBits_.fetch_and(~idleBit);
+         {
+            Worker::Locker lk{worker.Mutex_};
+            worker.IsWaiting_ = false;
+         }
+         task();
+         task = nullptr;
+         continue;
+      }
+      Worker::Locker lk{worker.Mutex_};
+      while (worker.IsWaiting_)
+         worker.Waiter_.Wait(lk);
+      lk.unlock();
+      this->IdleBits_.fetch_and(~idleBit);
+   }
+   TlsCurrPool_ = nullptr;
+   TlsCurrWorker_ = nullptr;
+   fon9_LOG_ThrRun("DefaultThreadPool.ThrRun.End|name=", thrName);
+}
+bool DefaultThreadPool::PopTask(Worker& worker, DefaultThreadTask& task) {
+   Worker::Locker lk{worker.Mutex_};
+   if (worker.Tasks_.empty())
+      return false;
+   task = std::move(worker.Tasks_.front());
+   worker.Tasks_.pop_front();
+   return true;
+}
+bool DefaultThreadPool::StealTask(uint32_t index, DefaultThreadTask& task) {
+   for (uint32_t L = 1; L < this->ThreadCount_; ++L) {
+      // 這裡不可使用 try_lock, 否則可能遺漏 victim 的工作, 造成 victim 忙碌(或阻塞)時, 工作無法被取走.
+      Worker&        victim = this->Workers_[(index + L) % this->ThreadCount_];
+      Worker::Locker lk{victim.Mutex_};
+      if (victim.Tasks_.empty())
+         continue;
+      task = std::move(victim.Tasks_.front());
+      victim.Tasks_.pop_front();
+      return true;
+   }
+   return false;
+}
+void DefaultThreadPool::WakeupIdle(uint64_t idleBits) {
+   while (idleBits) {
+      const unsigned idx = BitScanForwardU64(idleBits);
+      idleBits &= ~(uint64_t{1} << idx);
+      Worker&        worker = this->Workers_[idx];
+      Worker::Locker lk{worker.Mutex_};
+      if (worker.IsWaiting_) {
+         worker.IsWaiting_ = false;
+         this->IdleBits_.fetch_and(~(uint64_t{1} << idx));
+         worker.Waiter_.NotifyOne(lk);
+         return;
+      }
+   }
+}
+
+ThreadState DefaultThreadPool::AddTask(DefaultThreadTask&& task) {
+   const ThreadState st = this->State_.load(std::memory_order_acquire);
+   if (fon9_UNLIKELY(st != ThreadState::ExecutingOrWaiting)) // 尚未啟動(沒有 Workers_) 也無法加入工作.
+      return (st == ThreadState::Idle ? ThreadState::Terminated : st);
+   uint64_t idleBits;
+   Worker*  worker;
+   if (TlsCurrPool_ == this)
+      worker = static_cast<Worker*>(TlsCurrWorker_);
+   else if ((idleBits = this->IdleBits_.load(std::memory_order_relaxed)) != 0)
+      worker = &this->Workers_[BitScanForwardU64(idleBits)];
+   else
+      worker = &this->Workers_[this->NextWorker_.fetch_add(1, std::memory_order_relaxed) % this->ThreadCount_];
+   {
+      Worker::Locker lk{worker->Mutex_};
+      worker->Tasks_.push_back(std::move(task));
+      if (worker->IsWaiting_) {
+         worker->IsWaiting_ = false;
+         // 立即清除 idleBit, 讓接下來加入的工作可以交給其他等候中的 thread.
+         const size_t idx = static_cast<size_t>(worker - this->Workers_.get());
+         if (idx < 64)
+            this->IdleBits_.fetch_and(~(uint64_t{1} << idx));
+         worker->Waiter_.NotifyOne(lk);
+         return st;
+      }
+   }
+   // worker 忙碌中, 若有等候中的 thread, 則喚醒一個來取走工作.
+   if ((idleBits = this->IdleBits_.load()) != 0)
+      this->WakeupIdle(idleBits);
+   return st;
+}
+
+void DefaultThreadPool::NotifyForEnd(ThreadState st) {
+   ThreadState cur = this->State_.load(std::memory_order_relaxed);
+   do {
+      if (cur >= st)
+         return;
+   } while (!this->State_.compare_exchange_weak(cur, st, std::memory_order_acq_rel));
+   for (uint32_t L = 0; L < this->ThreadCount_; ++L) {
+      Worker&        worker = this->Workers_[L];
+      Worker::Locker lk{worker.Mutex_};
+      worker.IsWaiting_ = false;
+      worker.Waiter_.NotifyOne(lk);
+   }
+}
+void DefaultThreadPool::WaitThreadJoin() {
+   for (uint32_t L = 0; L < this->ThreadCount_; ++L)
+      JoinThread(this->Workers_[L].Thread_);
+   this->State_.store(ThreadState::Terminated, std::memory_order_release);
+}
+void DefaultThreadPool::WaitForEndNow() {
+   this->NotifyForEnd(ThreadState::EndNow);
+   this->WaitThreadJoin();
+}
+void DefaultThreadPool::WaitForEndAfterWorkDone() {
+   this->NotifyForEnd(ThreadState::EndAfterWorkDone);
+   this->WaitThreadJoin();
+}
+size_t DefaultThreadPool::RunRemainTasks() {
+   size_t            count = 0;
+   DefaultThreadTask task;
+   for (uint32_t L = 0; L < this->ThreadCount_; ++L) {
+      while (this->PopTask(this->Workers_[L], task)) {
+         task();
+         ++count;
+      }
+   }
+   return count;
+}
+
+//--------------------------------------------------------------------------//
+
+static std::mutex             DefaultThreadPoolArgsMutex_;
+static DefaultThreadPoolArgs* DefaultThreadPoolArgs_;
+static bool                   IsDefaultThreadPoolStarted_;
+
+fon9_API bool SetDefaultThreadPoolArgs(const DefaultThreadPoolArgs& args) {
+   std::lock_guard<std::mutex> lk{DefaultThreadPoolArgsMutex_};
+   if (IsDefaultThreadPoolStarted_)
+      return false;
+   if (DefaultThreadPoolArgs_)
+      *DefaultThreadPoolArgs_ = args;
+   else
+      DefaultThreadPoolArgs_ = new DefaultThreadPoolArgs(args);
+   return true;
+}
 
 fon9_API DefaultThreadPool& GetDefaultThreadPool() {
    struct DefaultThreadPoolImpl : public DefaultThreadPool, sys::OnWindowsMainExitHandle {
       fon9_NON_COPY_NON_MOVE(DefaultThreadPoolImpl);
       DefaultThreadPoolImpl() {
-         // TODO: 從 getenv()、argv 取得參數?
-         // 目前有用到的地方:
-         //  - log file(FileAppender)
-         //  - DN resolve(io/SocketAddressDN.cpp)
-         //  - Device 執行 OpQueue_
-         //  - InnDbf
-         //  - ...
-         // 這裡的 threadCount 應該考慮以上不同工作種類的數量, 與 CPU 核心數無關.
-         // 因為以上的工作都是: 低 CPU 用量, 且 IO blocking.
-         uint32_t threadCount = 4;
-
-         this->StartThread(threadCount, "fon9.DefaultThreadPool");
+         DefaultThreadPoolArgs args;
+         {
+            std::lock_guard<std::mutex> lk{DefaultThreadPoolArgsMutex_};
+            IsDefaultThreadPoolStarted_ = true;
+            if (DefaultThreadPoolArgs_) {
+               args = *DefaultThreadPoolArgs_;
+               delete DefaultThreadPoolArgs_;
+               DefaultThreadPoolArgs_ = nullptr;
+            }
+            else if (const char* envArgs = getenv("fon9_DefaultThreadPool")) {
+               // 此時可能正在啟動 log system (例: FileAppender 第一次呼叫 GetDefaultThreadPool()),
+               // 所以不能使用 fon9_LOG_*() 記錄錯誤.
+               RevBufferList rbuf{128};
+               if (!ParseConfig(args, StrView_cstr(envArgs), rbuf))
+                  fprintf(stderr, "DefaultThreadPool: env=%s|err=%s\n", envArgs,
+                          BufferTo<std::string>(rbuf.MoveOut()).c_str());
+            }
+         }
+         this->StartThread(args, "fon9.DefaultThreadPool");
       }
       void OnWindowsMainExit_Notify() {
          this->NotifyForEndNow();
@@ -65,8 +315,7 @@ fon9_API void WaitDefaultThreadPoolQuit(DefaultThreadPool& thrPool, unsigned wai
    thrPool.WaitForEndAfterWorkDone();
 
    // 把剩餘工作做完, 避免 memory leak.
-   DefaultThreadTaskHandler handler(thrPool);
-   thrPool.WaitForEndNow(handler);
+   thrPool.RunRemainTasks();
 }
 
 } // namespaces
@@ -2,9 +2,14 @@
 /// \author fonwinz@gmail.com
 #ifndef __fon9_DefaultThreadPool_hpp__
 #define __fon9_DefaultThreadPool_hpp__
-#include "fon9/MessageQueue.hpp"
+#include "fon9/ThreadController.hpp"
+#include "fon9/ConfigParser.hpp"
+#include "fon9/TimeInterval.hpp"
 fon9_BEFORE_INCLUDE_STD;
 #include <functional>
+#include <memory>
+#include <vector>
+#include <atomic>
 fon9_AFTER_INCLUDE_STD;
 
 namespace fon9 {
@@ -12,15 +17,110 @@ namespace fon9 {
 /// \ingroup Thrs
 /// 在 GetDefaultThreadPool() 裡面執行的單一作業。
 using DefaultThreadTask = std::function<void()>;
-struct DefaultThreadTaskHandler;
-using DefaultThreadPool = MessageQueue<DefaultThreadTaskHandler, DefaultThreadTask>;
+
+/// \ingroup Thrs
+/// DefaultThreadPool 的啟動參數.
+/// args: "ThreadCount=n|Cpus=List"
+struct fon9_API DefaultThreadPoolArgs {
+   /// 若有設定 CpuAffinity, 則每個 thread 依照 index 綁定一個 cpu, 例如:
+   /// ThreadCount_=3; CpuAffinity=0,1; 則 Thr0=Cpu0; Thr1=Cpu1; Thr2=Cpu0;
+   using CpuAffinity = std::vector<uint32_t>;
+   CpuAffinity CpuAffinity_;
+   /// 目前有用到的地方: log file(FileAppender), DN resolve, Device 執行 OpQueue_, InnDbf...
+   /// 都是: 低 CPU 用量, 且 IO blocking, 所以 ThreadCount 與 CPU 核心數無關.
+   uint32_t    ThreadCount_{4};
+
+   int GetCpuAffinity(size_t threadPoolIndex) const {
+      if (CpuAffinity_.empty())
+         return -1;
+      return static_cast<int>(CpuAffinity_[threadPoolIndex % CpuAffinity_.size()]);
+   }
+
+   /// 用 tag, value 設定參數.
+   /// tag         | value
+   /// ------------|------------------------------
+   /// ThreadCount | > 0
+   /// Cpus        | c0, c1, c2 ... 根據 thread pool index 依序選擇 c0 或 c1 或 c2...
+   ConfigParser::Result OnTagValue(StrView tag, StrView& value);
+};
+
+fon9_WARN_DISABLE_PADDING;
+/// \ingroup Thrs
+/// fon9 預設的 thread pool, 使用 work stealing:
+/// - 每個 thread 擁有自己的工作佇列(及 mutex, condition_variable), 不再共用同一個 mutex.
+/// - 加入工作時:
+///   - 若在 pool 的 thread 裡面, 則放到自己的佇列.
+///   - 否則優先交給等候中的 thread, 若沒有等候中的 thread, 則輪流分派.
+///   - 只有在目的 thread 正在等候時, 才需要喚醒; 若目的 thread 忙碌中, 則喚醒一個等候中的 thread 來取走工作.
+/// - thread 自己的佇列沒有工作時, 會從其他 thread 的佇列取出工作(steal), 都沒有工作才進入等候.
+/// - 每個 thread 的工作依照加入順序執行, 但不同 thread 之間的執行順序不保證.
+class fon9_API DefaultThreadPool {
+   fon9_NON_COPY_NON_MOVE(DefaultThreadPool);
+   struct Worker;
+   std::unique_ptr<Worker[]>  Workers_;
+   uint32_t                   ThreadCount_{0};
+   std::atomic<uint32_t>      NextWorker_{0};
+   /// bit(n) = Workers_[n] 正在等候工作. 只記錄前 64 個 thread, 超過的 thread 只能透過輪流分派取得工作.
+   std::atomic<uint64_t>      IdleBits_{0};
+   std::atomic<ThreadState>   State_{ThreadState::Idle};
+
+   void ThrRun(uint32_t index, int cpuAffinity, std::string thrName);
+   bool PopTask(Worker& worker, DefaultThreadTask& task);
+   bool StealTask(uint32_t index, DefaultThreadTask& task);
+   void WakeupIdle(uint64_t idleBits);
+   void NotifyForEnd(ThreadState st);
+   void WaitThreadJoin();
+
+public:
+   DefaultThreadPool();
+   /// 若有剩餘未執行的工作，將會被拋棄。
+   ~DefaultThreadPool();
+
+   void StartThread(const DefaultThreadPoolArgs& args, StrView thrName);
+   size_t GetThreadCount() const {
+      return this->ThreadCount_;
+   }
+   ThreadState GetThreadState() const {
+      return this->State_.load(std::memory_order_acquire);
+   }
+
+   /// 傳回 <= ThreadState::ExecutingOrWaiting 表示有加入 thread pool.
+   /// 必須在 StartThread() 之後才能加入工作.
+   ThreadState AddTask(DefaultThreadTask&& task);
+   template <class... ArgsT>
+   ThreadState EmplaceMessage(ArgsT&&... args) {
+      return this->AddTask(DefaultThreadTask(std::forward<ArgsT>(args)...));
+   }
+
+   /// 通知結束，若有剩餘未執行的工作，可透過 RunRemainTasks() 處理。
+   void NotifyForEndNow() {
+      this->NotifyForEnd(ThreadState::EndNow);
+   }
+   /// 通知結束, 並在 thread 結束後返回, 但不處理剩餘工作.
+   void WaitForEndNow();
+   /// 等候 thread 處理完工作後, 結束 thread.
+   void WaitForEndAfterWorkDone();
+   /// 在 thread 結束後, 於呼叫端的 thread 執行剩餘的工作.
+   /// \return 執行的工作數量.
+   size_t RunRemainTasks();
+};
+fon9_WARN_POP;
 
 /// \ingroup Thrs
 /// 取得 fon9 提供的一個 thread pool.
 /// * 一般用於不急迫, 但比較花時間的簡單工作, 例如: 寫檔、domain name 查找...
 /// * 程式結束時, 剩餘的工作會被拋棄!
+/// * 第一次呼叫時啟動, 啟動參數:
+///   * SetDefaultThreadPoolArgs() 設定的參數.
+///   * 若沒有呼叫 SetDefaultThreadPoolArgs(), 則使用環境變數 "fon9_DefaultThreadPool", 例: "ThreadCount=4|Cpus=2,3"
+///   * 都沒有設定, 則使用 DefaultThreadPoolArgs 的預設值.
 fon9_API DefaultThreadPool& GetDefaultThreadPool();
 
+/// \ingroup Thrs
+/// 設定 GetDefaultThreadPool() 的啟動參數, 必須在第一次呼叫 GetDefaultThreadPool() 之前設定才有效.
+/// \retval false GetDefaultThreadPool() 已啟動, 設定無效.
+fon9_API bool SetDefaultThreadPoolArgs(const DefaultThreadPoolArgs& args);
+
 /// \ingroup Thrs
 /// 等候 thread pool 將所有的工作完成之後結束 thread pool.
 /// 結束 thread pool 之後, 不會再處理後續加入的工作!!
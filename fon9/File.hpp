@@ -192,6 +192,10 @@ public:
    Fdr::fdr_t ReleaseFD() {
       return this->Fdr_.ReleaseFD();
    }
+   /// 取得 fd, 例: 用於 memory map; 仍由 File 擁有, 不可關閉.
+   Fdr::fdr_t GetFD() const {
+      return this->Fdr_.GetFD();
+   }
 };
 fon9_WARN_POP;
 
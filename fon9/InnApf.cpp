@@ -3,7 +3,6 @@
 #include "fon9/InnApf.hpp"
 #include "fon9/BitvArchive.hpp"
 #include "fon9/Log.hpp"
-#include "fon9/DefaultThreadPool.hpp"
 
 namespace fon9 {
 
@@ -49,28 +48,92 @@ void InnApf::Stream::UpdateChanged(InnStream& exHeader) {
       exHeader.Write(this->OffsetExHeader_, DcQueueList{rbuf.MoveOut()});
    }
 }
-void InnApf::UpdateChanged() {
+/// BeginBatch() 之後, 若有異常(例: UpdateChanged() 寫檔失敗), 也必須結束 batch,
+/// 否則之後其他執行緒的寫入, 都會暫存在 batch 裡面, 且可能在其他執行緒拋出 CommitBatch 的異常.
+struct InnFileBatchScope {
+   fon9_NON_COPY_NON_MOVE(InnFileBatchScope);
+   InnFileP* InnFile_;
+   InnFileBatchScope(InnFileP* innFile) : InnFile_{innFile} {
+      if (innFile)
+         innFile->BeginBatch();
+   }
+   ~InnFileBatchScope() {
+      if (this->InnFile_) {
+         // 只有在異常時才會來到此處, 此時應保留原本的異常, 所以忽略 CommitBatch() 的異常.
+         try {
+            this->InnFile_->CommitBatch(false);
+         }
+         catch (...) {
+         }
+      }
+   }
+   void Commit() {
+      if (InnFileP* innFile = this->InnFile_) {
+         this->InnFile_ = nullptr;
+         innFile->CommitBatch(false);
+      }
+   }
+};
+void InnApf::FlushChanged() {
    StreamList  changedStreams{std::move(KeyMap::Locker{this->KeyMap_}->ChangedStreams_)};
-   for (Stream* stream : changedStreams)
-      stream->UpdateChanged(this->ExHeader_);
-}
-void InnApf::EmitOnUpdateTimer(TimerEntry* timer, TimeStamp now) {
-   (void)now;
-   InnApf& rthis = ContainerOf(*static_cast<decltype(InnApf::UpdateTimer_)*>(timer), &InnApf::UpdateTimer_);
-   if(KeyMap::Locker{rthis.KeyMap_}->ChangedStreams_.empty()) {
-      rthis.StartUpdateTimer();
+   if (changedStreams.empty())
       return;
+   // 每 kMaxStreamsPerBatch 個 streams 合併一次寫入,
+   // 避免在全部 streams 更新期間 batch 都處在 active 狀態, 使得其他執行緒的 Read() 都要等 batch lock.
+   enum { kMaxStreamsPerBatch = 64 };
+   for (auto ibeg = changedStreams.begin(); ibeg != changedStreams.end();) {
+      const auto iend = (changedStreams.end() - ibeg > kMaxStreamsPerBatch
+                         ? ibeg + kMaxStreamsPerBatch : changedStreams.end());
+      InnFileBatchScope batch{this->IsWriteBatch_ ? &this->InnFile_ : nullptr};
+      for (; ibeg != iend; ++ibeg)
+         (*ibeg)->UpdateChanged(this->ExHeader_);
+      batch.Commit();
    }
-   // 正要解構, 但 ~InnApf() 尚未呼叫到 this->UpdateTimer_.DisposeAndWait();
-   // 此時, 不用執行底下的 pthis->UpdateChanged(); 交給 ~InnApf() 處理即可.
-   if (intrusive_ptr_add_ref(&rthis) == 0)
-      return;
-   // 為了避免佔用 timer thread 的時間, 所以切到 DefaultThreadPool 處理.
-   InnApfSP pthis{&rthis, false}; // false: 不用再 add_ref().
-   GetDefaultThreadPool().EmplaceMessage([pthis]() {
-      pthis->UpdateChanged();
-      pthis->StartUpdateTimer();
-   });
+   bool isSync = false;
+   if (this->SyncInterval_.GetOrigValue() > 0) {
+      const TimeStamp      now = UtcNow();
+      WriterController::Locker writer{this->Writer_};
+      if (now - writer->LastSyncTime_ >= this->SyncInterval_) {
+         writer->LastSyncTime_ = now;
+         isSync = true;
+      }
+   }
+   if (isSync)
+      this->InnFile_.Sync();
+}
+InnApf::~InnApf() {
+   this->Writer_.WaitForEndNow();
+   JoinThread(this->WriterThread_);
+   try {
+      this->FlushChanged();
+   }
+   catch (std::exception& e) {
+      fon9_LOG_ERROR("InnApf.Close|fileName=", this->InnFile_.GetOpenName(), "|err=", e.what());
+   }
+}
+void InnApf::StartWriter(const OpenArgs& args) {
+   this->FlushInterval_ = (args.FlushInterval_.GetOrigValue() > 0 ? args.FlushInterval_ : TimeInterval_Second(1));
+   this->SyncInterval_ = args.SyncInterval_;
+   this->IsWriteBatch_ = args.IsWriteBatch_;
+   WriterController::Locker{this->Writer_}->LastSyncTime_ = UtcNow();
+   this->Writer_.OnBeforeThreadStart(1);
+   this->WriterThread_ = std::thread(&InnApf::WriterThrRun, this);
+}
+void InnApf::WriterThrRun() {
+   SetCurrentThreadName("InnApf.Writer");
+   WriterController::Locker writer{this->Writer_};
+   while (this->Writer_.GetState(writer) == ThreadState::ExecutingOrWaiting) {
+      this->Writer_.WaitFor(writer, this->FlushInterval_.ToDuration());
+      writer.unlock();
+      try {
+         this->FlushChanged();
+      }
+      catch (std::exception& e) {
+         fon9_LOG_ERROR("InnApf.Flush|fileName=", this->InnFile_.GetOpenName(), "|err=", e.what());
+      }
+      writer.lock();
+   }
+   this->Writer_.OnBeforeThreadEnd(writer);
 }
 //--------------------------------------------------------------------------//
 InnApfSP InnApf::Make(OpenArgs& args, const InnStream::OpenArgs& streamOpenArgs, OpenResult& res) {
@@ -92,7 +155,7 @@ InnApfSP InnApf::Make(OpenArgs& args, const InnStream::OpenArgs& streamOpenArgs,
          }
          res = OpenResult{KeyMap::Locker{retval->KeyMap_}->size()};
       }
-      retval->StartUpdateTimer();
+      retval->StartWriter(args);
       return retval;
    }
    catch (std::exception& e) {
@@ -219,6 +282,14 @@ void InnApf::Stream::OnFirstRoomPosChanged(const Locker& impl, RoomPos newFirstR
    this->IsNeedsChangedUpdate_ = true;
    this->CurrInfo_.FirstRoomPos_.Value_ = newFirstRoomPos;
 }
+std::vector<InnApf::SKeyT> InnApf::GetStreamKeys() const {
+   KeyMap::ConstLocker     map{this->KeyMap_};
+   std::vector<SKeyT>      keys;
+   keys.reserve(map->size());
+   for (const auto& i : *map)
+      keys.push_back(i.first);
+   return keys;
+}
 InnApf::Stream* InnApf::KeyMapImpl::AddStream(StreamRec&& rec, SPosT ofsExHeader) {
    StreamSP stream{new Stream{this->Owner(), std::move(rec), ofsExHeader}};
    auto     ins = this->emplace(stream->Key(), stream);
@@ -6,8 +6,11 @@
 #include "fon9/intrusive_ref_counter.hpp"
 #include "fon9/BitvFixedInt.hpp"
 #include "fon9/buffer/DcQueueList.hpp"
-#include "fon9/Timer.hpp"
+#include "fon9/ThreadController.hpp"
+#include "fon9/ThreadTools.hpp"
+#include "fon9/TimeStamp.hpp"
 #include <unordered_map>
+#include <vector>
 
 namespace fon9 {
 
@@ -30,6 +33,9 @@ fon9_WARN_DISABLE_PADDING;
 ///      srw.AppendNoBuffer();
 ///   \endcode
 /// - 使用 InnFile 實作.
+/// - 每個 InnApf 有一個寫入執行緒(group commit writer):
+///   每隔 OpenArgs::FlushInterval_ 將全部 streams 的 AppendBuffered() 資料及 ExHeader 的異動,
+///   分段(每段最多 64 個 streams)合併(InnFile::BeginBatch(), CommitBatch())後寫入檔案.
 /// - InnFile.FileExHeader: 儲存 key 及其相關的索引.
 ///   - RoomPos  NextExHeaderRoomPos;
 ///   - uint8_t  ApfVer;
@@ -108,6 +114,12 @@ public: // 雖然為 public, 但一般不會直接使用到, 只是為了在 Inn
       SizeT Read(SPosT pos, void* buf, SizeT bufsz) {
          return base::Read(pos, buf, bufsz);
       }
+      const byte* Peek(SPosT pos, SizeT& size) {
+         SizeType    sz = size;
+         const byte* retval = base::Peek(pos, sz);
+         size = static_cast<SizeT>(sz);
+         return retval;
+      }
       SizeT Write(SPosT pos, const void* buf, SizeT bufsz) {
          auto retval = base::Write(pos, buf, bufsz);
          this->CheckCurrInfoChanged();
@@ -136,16 +148,33 @@ public:
       : StreamOpenArgs_{streamOpenArgs} {
    }
 
-   ~InnApf() {
-      this->UpdateTimer_.DisposeAndWait();
-      this->UpdateChanged();
-   }
-   using OpenArgs = InnFile::OpenArgs;
+   ~InnApf();
+
+   struct OpenArgs : public InnFile::OpenArgs {
+      using base = InnFile::OpenArgs;
+      using base::base;
+      /// 寫入執行緒每隔多久, 將 AppendBuffered() 的資料寫入檔案; <= 0 則使用 1 秒.
+      TimeInterval   FlushInterval_{TimeInterval_Second(1)};
+      /// 寫入後, 若距離上次 fsync 已超過此時間, 則呼叫 fsync;
+      /// - 0 表示不呼叫 fsync, 由 OS 決定何時寫入磁碟.
+      /// - 若要每次寫入後都 fsync, 可設為 <= FlushInterval_;
+      TimeInterval   SyncInterval_{};
+      /// 是否將一次 flush 的全部寫入合併, 依照檔案位置順序寫入.
+      /// 若為 false, 則每個 stream 各自直接寫入.
+      bool           IsWriteBatch_{true};
+   };
    using OpenResult = InnFile::OpenResult;
    /// - 若傳回 nullptr, 則透過 res 取得錯誤原因.
    /// - ores.GetResult() == key 的數量.
    static InnApfSP Make(OpenArgs& args, const InnStream::OpenArgs& streamOpenArgs, OpenResult& res);
 
+   /// 寫入檔案的統計, 請參考 InnFile::GetWriteStats();
+   InnFile::WriteStats GetWriteStats() const {
+      return this->InnFile_.GetWriteStats();
+   }
+   /// 取得目前全部 stream 的 key, 沒有特定順序.
+   std::vector<SKeyT> GetStreamKeys() const;
+
    class fon9_API StreamRW {
       fon9_NON_COPYABLE(StreamRW);
       StreamSP Stream_;
@@ -183,6 +212,11 @@ public:
          assert(this->IsReady());
          return this->Stream_->Read(pos, buf, bufsz);
       }
+      /// 直接取得從 pos 開始的資料, 不用複製, 請參考 InnStream::Peek();
+      const byte* Peek(SPosT pos, SizeT& size) {
+         assert(this->IsReady());
+         return this->Stream_->Peek(pos, size);
+      }
       /// 從指定位置寫入.
       /// \return 寫入的資料量, 必定 == bufsz; 
       SizeT Write(SPosT pos, const void* buf, SizeT bufsz) {
@@ -213,13 +247,16 @@ public:
 private:
    const char* ReadExHeader();
    void OnNewInnFile();
-   void UpdateChanged();
+   /// 在寫入執行緒, 將異動的 streams 寫入檔案.
+   void FlushChanged();
 
    using StreamList = std::deque<Stream*>;
    class KeyMapImpl : protected std::unordered_map<SKeyT, StreamSP> {
       using base = std::unordered_map<SKeyT, StreamSP>;
    public:
       using base::size;
+      using base::begin;
+      using base::end;
 
       /// 當 Stream 有異動, 需要寫入 ExHeader 時, 依照加入的順序存放於此.
       StreamList  ChangedStreams_;
@@ -242,11 +279,18 @@ private:
    RoomPos     FreeRoomPos1st_; 
    InnStream   ExHeader_;
 
-   void StartUpdateTimer() {
-      this->UpdateTimer_.RunAfter(TimeInterval_Second(1));
-   }
-   static void EmitOnUpdateTimer(TimerEntry* timer, TimeStamp now);
-   DataMemberEmitOnTimer<&InnApf::EmitOnUpdateTimer> UpdateTimer_;
+   struct WriterImpl {
+      /// 上次 fsync 的時間.
+      TimeStamp   LastSyncTime_;
+   };
+   using WriterController = ThreadController<WriterImpl, WaitPolicy_CV>;
+   WriterController  Writer_;
+   std::thread       WriterThread_;
+   TimeInterval      FlushInterval_{TimeInterval_Second(1)};
+   TimeInterval      SyncInterval_{};
+   bool              IsWriteBatch_{false};
+   void StartWriter(const OpenArgs& args);
+   void WriterThrRun();
 };
 fon9_WARN_POP;
 
@@ -273,6 +273,201 @@ void InnApf_Benchmark(const double   kTestSpan) {
    std::cout << fon9::AutoTimeUnit{stopWatch.StopTimer()} << "\r[OK   ]" << std::endl;
 }
 //--------------------------------------------------------------------------//
+static std::atomic<unsigned> RecoverSum_{0};
+// 模擬回補: 類似 MdRtRecover, 每次最多讀取 4K, 依序讀完每個 stream.
+// - mapExtentSize == 0: 使用 Read(); 否則優先使用 Peek();
+static uint64_t RecoverAllStreams(fon9::InnApf& apf, size_t keyCount, bool isPeek) {
+   char              rdbuf[4 * 1024];
+   uint64_t          totsz = 0;
+   unsigned          sum = 0;
+   fon9::NumOutBuf   nbuf;
+   for (size_t L = 0; L < keyCount; ++L) {
+      fon9::StrView           keystr{fon9::ToStrRev(nbuf.end(), L), nbuf.end()};
+      fon9::InnApf::StreamRW  aprw;
+      CheckOpenResult(aprw.Open(apf, keystr, fon9::FileMode::Read), OpenResult{0});
+      fon9::InnApf::SPosT pos = 0;
+      for (;;) {
+         size_t rdsz = sizeof(rdbuf);
+         const fon9::byte* pk = (isPeek ? aprw.Peek(pos, rdsz) : nullptr);
+         if (pk == nullptr) {
+            rdsz = aprw.Read(pos, rdbuf, sizeof(rdbuf));
+            pk = reinterpret_cast<const fon9::byte*>(rdbuf);
+         }
+         if (rdsz <= 0)
+            break;
+         for (size_t idx = 0; idx < rdsz; ++idx) // 模擬使用資料.
+            sum += pk[idx];
+         pos += rdsz;
+      }
+      totsz += pos;
+   }
+   RecoverSum_ += sum;
+   return totsz;
+}
+void InnApf_RecoverBenchmark() {
+   const size_t   kKeyCount = 1000;
+   const size_t   kRecordSize = 128;
+   const size_t   kRecordCount = 2000; // 每個 key 的筆數.
+   const unsigned kThreadCount = 4;
+   std::cout << "RecoverBenchmark: "
+      << "|KeyCount=" << kKeyCount
+      << "|RecordSize=" << kRecordSize
+      << "|RecordCount=" << kRecordCount
+      << std::endl;
+   fon9::InnStream::OpenArgs  streamArgs{fon9::InnRoomType{}};
+   // 與 MdRtStreamInnMgr 相同的 room size 設定.
+   streamArgs.ExpectedRoomSize_[0] = 1024 * 2;
+   streamArgs.ExpectedRoomSize_[1] = 1024 * 4;
+   streamArgs.ExpectedRoomSize_[2] = 1024 * 8;
+   streamArgs.ExpectedRoomSize_[3] = 1024 * 16;
+   fon9::InnApf::OpenResult   ores;
+   remove(kInnApfFileName);
+   {  // 建立測試檔: 交錯寫入各個 key, 類似盤中即時資料的儲存.
+      std::cout << "[TEST ] Build:";
+      fon9::StopWatch         stopWatch;
+      fon9::InnApf::OpenArgs  innArgs{kInnApfFileName, 64};
+      fon9::InnApfSP          apf = fon9::InnApf::Make(innArgs, streamArgs, ores);
+      CheckOpenResult(ores, OpenResult{0});
+      std::vector<fon9::InnApf::StreamRW> aprws(kKeyCount);
+      fon9::NumOutBuf nbuf;
+      for (size_t L = 0; L < kKeyCount; ++L) {
+         fon9::StrView keystr{fon9::ToStrRev(nbuf.end(), L), nbuf.end()};
+         CheckOpenResult(aprws[L].Open(*apf, keystr, fon9::FileMode::CreatePath | fon9::FileMode::Append), OpenResult{0});
+      }
+      char rec[kRecordSize];
+      for (size_t LRec = 0; LRec < kRecordCount; ++LRec) {
+         for (size_t LKey = 0; LKey < kKeyCount; ++LKey) {
+            memset(rec, static_cast<char>(LRec + LKey), sizeof(rec));
+            aprws[LKey].AppendNoBuffer(rec, sizeof(rec));
+         }
+      }
+      aprws.clear();
+      while (apf->use_count() != 1)
+         std::this_thread::yield();
+      apf.reset();
+      std::cout << fon9::AutoTimeUnit{stopWatch.StopTimer()} << "\r[OK   ]" << std::endl;
+   }
+   const uint64_t kTotalSize = kKeyCount * kRecordSize * kRecordCount;
+   for (fon9::File::SizeType mapExtentSize : {fon9::File::SizeType{0}, fon9::File::SizeType{64 * 1024 * 1024}}) {
+      fon9::InnApf::OpenArgs innArgs{kInnApfFileName, 64};
+      innArgs.MapExtentSize_ = mapExtentSize;
+      fon9::InnApfSP apf = fon9::InnApf::Make(innArgs, streamArgs, ores);
+      CheckOpenResult(ores, OpenResult{kKeyCount});
+      const bool isPeek = (mapExtentSize != 0);
+      for (unsigned thrCount : {1u, kThreadCount}) {
+         std::cout << "[TEST ] Recover|" << (isPeek ? "Peek(mmap)" : "Read") << "|threads=" << thrCount << ':';
+         fon9::StopWatch          stopWatch;
+         std::vector<std::thread> thrs;
+         std::atomic<uint64_t>    totsz{0};
+         for (unsigned L = 0; L < thrCount; ++L) {
+            thrs.emplace_back([&apf, &totsz, kKeyCount, isPeek]() {
+               totsz += RecoverAllStreams(*apf, kKeyCount, isPeek);
+            });
+         }
+         for (auto& thr : thrs)
+            thr.join();
+         const double span = stopWatch.StopTimer();
+         if (totsz != kTotalSize * thrCount) {
+            std::cout << "|totsz=" << totsz << "|expected=" << kTotalSize * thrCount << "\r[ERROR]" << std::endl;
+            abort();
+         }
+         std::cout << fon9::AutoTimeUnit{span}
+            << "|" << (static_cast<double>(totsz) / span / 1024 / 1024) << " MB/s"
+            << "\r[OK   ]" << std::endl;
+      }
+      while (apf->use_count() != 1)
+         std::this_thread::yield();
+   }
+}
+//--------------------------------------------------------------------------//
+// 模擬開盤時, 大量商品各自 AppendBuffered() 少量資料, 由寫入執行緒定時寫入檔案.
+// - 比較 IsWriteBatch_ 的差異: 每次 write 的平均資料量, AppendBuffered() 的延遲.
+void InnApf_GroupCommitBenchmark(bool isWriteBatch) {
+   const size_t   kKeyCount = 20000;
+   const size_t   kRecordSize = 64;
+   const size_t   kRoundCount = 50;
+   std::cout << "GroupCommitBenchmark: "
+      << "|KeyCount=" << kKeyCount
+      << "|RecordSize=" << kRecordSize
+      << "|RoundCount=" << kRoundCount
+      << "|IsWriteBatch=" << isWriteBatch
+      << std::endl;
+   fon9::InnStream::OpenArgs  streamArgs{fon9::InnRoomType{}};
+   streamArgs.ExpectedRoomSize_[0] = 1024 * 2;
+   streamArgs.ExpectedRoomSize_[1] = 1024 * 4;
+   fon9::InnApf::OpenArgs     innArgs{kInnApfFileName, 64};
+   innArgs.FlushInterval_ = fon9::TimeInterval_Millisecond(50);
+   innArgs.IsWriteBatch_ = isWriteBatch;
+   fon9::InnApf::OpenResult   ores;
+   remove(kInnApfFileName);
+   fon9::InnApfSP apf = fon9::InnApf::Make(innArgs, streamArgs, ores);
+   CheckOpenResult(ores, OpenResult{0});
+
+   std::vector<fon9::InnApf::StreamRW> aprws(kKeyCount);
+   fon9::NumOutBuf nbuf;
+   for (size_t L = 0; L < kKeyCount; ++L) {
+      fon9::StrView keystr{fon9::ToStrRev(nbuf.end(), L), nbuf.end()};
+      CheckOpenResult(aprws[L].Open(*apf, keystr, fon9::FileMode::CreatePath), OpenResult{0});
+   }
+   // 等候建立 keys 的 ExHeader 寫入完畢, 不列入統計.
+   std::this_thread::sleep_for(std::chrono::milliseconds{200});
+   const auto statsBeg = apf->GetWriteStats();
+
+   std::cout << "[TEST ] AppendBuffered:";
+   std::vector<uint32_t> lats; // 每次 AppendBuffered() 的延遲(ns);
+   lats.reserve(kKeyCount * kRoundCount);
+   char rec[kRecordSize];
+   fon9::StopWatch stopWatch;
+   for (size_t LRound = 0; LRound < kRoundCount; ++LRound) {
+      memset(rec, static_cast<char>(LRound), sizeof(rec));
+      for (auto& aprw : aprws) {
+         const auto tmBeg = std::chrono::steady_clock::now();
+         aprw.AppendBuffered(rec, sizeof(rec));
+         lats.push_back(static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - tmBeg).count()));
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds{10});
+   }
+   const double span = stopWatch.StopTimer();
+   std::sort(lats.begin(), lats.end());
+   std::cout << fon9::AutoTimeUnit{span}
+      << "|p50=" << lats[lats.size() / 2] << "ns"
+      << "|p99=" << lats[lats.size() * 99 / 100] << "ns"
+      << "|max=" << lats.back() << "ns"
+      << "\r[OK   ]" << std::endl;
+
+   // 等候寫入執行緒將剩餘的資料寫入.
+   std::this_thread::sleep_for(std::chrono::milliseconds{200});
+   const auto statsEnd = apf->GetWriteStats();
+   const uint64_t bytes = statsEnd.Bytes_ - statsBeg.Bytes_;
+   const uint64_t calls = statsEnd.Calls_ - statsBeg.Calls_;
+   std::cout << "[TEST ] WriteStats:"
+      << "|bytes=" << bytes
+      << "|calls=" << calls
+      << "|bytes/call=" << (calls ? bytes / calls : 0)
+      << "\r[OK   ]" << std::endl;
+
+   std::cout << "[TEST ] Reopen & Check:";
+   aprws.clear();
+   while (apf->use_count() != 1)
+      std::this_thread::yield();
+   apf.reset();
+   apf = fon9::InnApf::Make(innArgs, streamArgs, ores);
+   CheckOpenResult(ores, OpenResult{kKeyCount});
+   for (size_t L = 0; L < kKeyCount; ++L) {
+      fon9::StrView           keystr{fon9::ToStrRev(nbuf.end(), L), nbuf.end()};
+      fon9::InnApf::StreamRW  aprw;
+      CheckOpenResult(aprw.Open(*apf, keystr, fon9::FileMode::Read), OpenResult{0});
+      if (aprw.Size() != kRecordSize * kRoundCount) {
+         std::cout << "|key=" << L << "|size=" << aprw.Size() << "\r[ERROR]" << std::endl;
+         abort();
+      }
+   }
+   std::cout << "\r[OK   ]" << std::endl;
+   while (apf->use_count() != 1)
+      std::this_thread::yield();
+}
+//--------------------------------------------------------------------------//
 int main() {
 #if defined(_MSC_VER) && defined(_DEBUG)
    _CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
@@ -289,5 +484,11 @@ int main() {
       utinfo.PrintSplitter();
       InnApf_Benchmark(L);
    }
+   utinfo.PrintSplitter();
+   InnApf_RecoverBenchmark();
+   utinfo.PrintSplitter();
+   InnApf_GroupCommitBenchmark(false);
+   utinfo.PrintSplitter();
+   InnApf_GroupCommitBenchmark(true);
    remove(kInnApfFileName);
 }
@@ -3,6 +3,14 @@
 #include "fon9/InnFile.hpp"
 #include "fon9/Endian.hpp"
 #include "fon9/buffer/FwdBufferList.hpp"
+#include <atomic>
+#include <mutex>
+#include <map>
+#ifdef fon9_POSIX
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 namespace fon9 {
 
@@ -20,9 +28,219 @@ static_assert(cast_to_underlying(kOffset_DataBegin) == cast_to_underlying(InnFil
 
 //--------------------------------------------------------------------------//
 
-InnFile::InnFile() {
+/// 將檔案依照 ExtentSize_ 切成多個區塊, 用到時才 mmap(PROT_READ, MAP_SHARED).
+/// - 已 map 的區塊在 Close() 之前不會移動, 所以讀取者不用鎖定.
+/// - 可以 map 超過檔案尾端的範圍, 但只能存取 FileSize_ 之內的資料, 否則會有 SIGBUS.
+struct InnFile::MapImpl {
+   fon9_NON_COPY_NON_MOVE(MapImpl);
+   enum : size_t {
+      kMaxExtentCount = 1024 * 4,
+   };
+   const Fdr::fdr_t     Fd_;
+   const File::SizeType ExtentSize_;
+   /// 已預先配置磁碟空間的大小.
+   File::SizeType       AllocatedSize_{0};
+   std::mutex           Mutex_;
+   std::atomic<byte*>   Extents_[kMaxExtentCount];
+
+   MapImpl(Fdr::fdr_t fd, File::SizeType extentSize) : Fd_{fd}, ExtentSize_{extentSize} {
+      for (auto& ext : this->Extents_)
+         ext.store(nullptr, std::memory_order_relaxed);
+   }
+   ~MapImpl() {
+   #ifdef fon9_POSIX
+      for (auto& ext : this->Extents_) {
+         if (byte* ptr = ext.load(std::memory_order_relaxed))
+            munmap(ptr, this->ExtentSize_);
+      }
+   #endif
+   }
+   static File::SizeType AdjustExtentSize(File::SizeType extentSize) {
+   #ifdef fon9_POSIX
+      const File::SizeType pgsz = static_cast<File::SizeType>(sysconf(_SC_PAGESIZE));
+      return ((extentSize + pgsz - 1) / pgsz) * pgsz;
+   #else
+      (void)extentSize;
+      return 0;
+   #endif
+   }
+   byte* GetExtent(size_t idx) {
+      if (idx >= kMaxExtentCount)
+         return nullptr;
+      if (byte* ptr = this->Extents_[idx].load(std::memory_order_acquire))
+         return ptr;
+   #ifdef fon9_POSIX
+      std::lock_guard<std::mutex> lk{this->Mutex_};
+      if (byte* ptr = this->Extents_[idx].load(std::memory_order_relaxed))
+         return ptr;
+      void* ptr = mmap(nullptr, this->ExtentSize_, PROT_READ, MAP_SHARED, this->Fd_,
+                       static_cast<off_t>(this->ExtentSize_ * idx));
+      if (ptr == MAP_FAILED)
+         return nullptr;
+      this->Extents_[idx].store(static_cast<byte*>(ptr), std::memory_order_release);
+      return static_cast<byte*>(ptr);
+   #else
+      return nullptr;
+   #endif
+   }
+   /// [pos, pos + size) 必須在同一個 extent 之內, 否則傳回 nullptr.
+   const byte* GetAddr(File::PosType pos, File::SizeType size) {
+      const size_t idx = static_cast<size_t>(pos / this->ExtentSize_);
+      const File::PosType ofs = pos % this->ExtentSize_;
+      if (ofs + size > this->ExtentSize_)
+         return nullptr;
+      if (const byte* ptr = this->GetExtent(idx))
+         return ptr + ofs;
+      return nullptr;
+   }
+   /// 檔案即將增加到 newFileSize, 以 extent 為單位預先配置磁碟空間, 減少檔案系統的破碎.
+   void OnFileSizeIncreasing(File::SizeType newFileSize) {
+   #ifdef __linux__
+      if (newFileSize <= this->AllocatedSize_)
+         return;
+      const File::SizeType newAllocated = ((newFileSize + this->ExtentSize_ - 1) / this->ExtentSize_) * this->ExtentSize_;
+      // 失敗也沒關係, 之後的 SetFileSize() 仍會配置需要的空間.
+      if (fallocate(this->Fd_, FALLOC_FL_KEEP_SIZE, static_cast<off_t>(this->AllocatedSize_),
+                    static_cast<off_t>(newAllocated - this->AllocatedSize_)) == 0)
+         this->AllocatedSize_ = newAllocated;
+   #else
+      (void)newFileSize;
+   #endif
+   }
+};
+
+/// BeginBatch() 之後, CommitBatch() 之前的寫入, 暫存於此.
+/// - Pendings_ 的每個區塊互不重疊, 且依照位置排序.
+struct InnFile::WriteBatch {
+   fon9_NON_COPY_NON_MOVE(WriteBatch);
+   WriteBatch() = default;
+
+   enum : File::SizeType {
+      /// 在 DiskFileSize_ 之後的部分, 是檔案新增的空間, 尚未寫入的內容必定為 0;
+      /// 若兩個區塊之間的間隔都在這部分, 且間隔 <= kMaxGapSize, 則用 0 填補間隔, 合併成一個區塊.
+      /// 間隔只用來吸收 room header 之類的小空隙: 新分配的 room 通常尚未寫滿,
+      /// 若用 0 填補整個未寫入的 room, 寫入量會大幅增加, 但減少的 syscall 次數很有限.
+      kMaxGapSize = 64,
+      /// 暫存的資料量超過此值, 就先寫入檔案(但仍在 batch 狀態),
+      /// 避免暫存區塊無限制成長, 也讓合併區塊時的複製成本有上限.
+      kMaxPendingBytes = 1024 * 1024,
+   };
+   using Pendings = std::map<RoomPosT, std::string>;
+
+   std::mutex              Mutex_;
+   std::atomic<bool>       IsActive_{false};
+   Pendings                Pendings_;
+   /// Pendings_ 的資料量.
+   size_t                  PendingBytes_{0};
+   /// 每次將 Pendings_ 寫入檔案後 ++FlushId_;
+   /// 讓 ReadAt() 可以在 unlock 狀態下讀檔, 之後再確認讀檔期間 Pendings_ 是否有寫入檔案.
+   uint64_t                FlushId_{0};
+   /// 已寫入檔案的大小.
+   File::SizeType          DiskFileSize_{0};
+   std::atomic<uint64_t>   StatBytes_{0};
+   std::atomic<uint64_t>   StatCalls_{0};
+
+   void AddStat(size_t bytes) {
+      this->StatBytes_.fetch_add(bytes, std::memory_order_relaxed);
+      this->StatCalls_.fetch_add(1, std::memory_order_relaxed);
+   }
+   /// 結束於 endPos 的區塊, 是否可以與開始於 begPos 的區塊合併?
+   bool CanMerge(File::PosType endPos, File::PosType begPos) const {
+      return begPos <= endPos
+         || (endPos >= this->DiskFileSize_ && begPos - endPos <= kMaxGapSize);
+   }
+   void Put(File::PosType pos, const void* buf, size_t size) {
+      if (size <= 0)
+         return;
+      const File::PosType end = pos + size;
+      auto ibeg = this->Pendings_.upper_bound(pos);
+      if (ibeg != this->Pendings_.begin()) {
+         auto iprev = std::prev(ibeg);
+         if (this->CanMerge(iprev->first + iprev->second.size(), pos))
+            ibeg = iprev;
+      }
+      auto iend = ibeg;
+      while (iend != this->Pendings_.end() && this->CanMerge(end, iend->first))
+         ++iend;
+      if (ibeg == iend) {
+         this->Pendings_.emplace_hint(ibeg, pos, std::string(static_cast<const char*>(buf), size));
+         this->PendingBytes_ += size;
+         return;
+      }
+      auto           ilast = std::prev(iend);
+      File::PosType  mend = ilast->first + ilast->second.size();
+      if (mend < end)
+         mend = end;
+      if (ibeg->first <= pos) {
+         // 最常見的情況: 在既有區塊之中覆寫, 或在尾端附加:
+         // 直接延伸 ibeg(std::string 的容量會倍增), 再把後續被合併的區塊搬入, 每個區塊只會被搬移一次.
+         std::string&  dat = ibeg->second;
+         this->PendingBytes_ -= dat.size();
+         dat.resize(static_cast<size_t>(mend - ibeg->first));
+         for (auto i = std::next(ibeg); i != iend; ++i) {
+            this->PendingBytes_ -= i->second.size();
+            memcpy(&dat[static_cast<size_t>(i->first - ibeg->first)], i->second.data(), i->second.size());
+         }
+         memcpy(&dat[static_cast<size_t>(pos - ibeg->first)], buf, size);
+         this->PendingBytes_ += dat.size();
+         this->Pendings_.erase(std::next(ibeg), iend);
+         return;
+      }
+      // 寫入位置在第一個被合併的區塊之前, 必須建立新區塊;
+      // 因為有 kMaxPendingBytes 的限制, 所以複製的成本有上限.
+      std::string dat(static_cast<size_t>(mend - pos), '\0');
+      for (auto i = ibeg; i != iend; ++i) {
+         this->PendingBytes_ -= i->second.size();
+         memcpy(&dat[static_cast<size_t>(i->first - pos)], i->second.data(), i->second.size());
+      }
+      memcpy(&dat[0], buf, size);
+      this->PendingBytes_ += dat.size();
+      this->Pendings_.erase(ibeg, iend);
+      this->Pendings_.emplace(pos, std::move(dat));
+   }
+   /// 將 Pendings_ 在 [pos, pos + size) 的資料, 複製到 buf 相對應的位置.
+   /// \retval true  有複製資料.
+   /// \retval false [pos, pos + size) 沒有尚未寫入的資料.
+   bool Overlay(File::PosType pos, byte* buf, size_t size) const {
+      const File::PosType end = pos + size;
+      auto i = this->Pendings_.upper_bound(pos);
+      if (i != this->Pendings_.begin())
+         --i;
+      bool retval = false;
+      for (; i != this->Pendings_.end() && i->first < end; ++i) {
+         const File::PosType ibeg = (i->first > pos ? i->first : pos);
+         const File::PosType iend = (i->first + i->second.size() < end ? i->first + i->second.size() : end);
+         if (ibeg < iend) {
+            if (buf == nullptr)
+               return true;
+            memcpy(buf + (ibeg - pos), i->second.data() + (ibeg - i->first), static_cast<size_t>(iend - ibeg));
+            retval = true;
+         }
+      }
+      return retval;
+   }
+};
+
+InnFile::InnFile() : Batch_{new WriteBatch} {
 }
 InnFile::~InnFile() {
+   this->Close();
+}
+void InnFile::Close() {
+   if (this->Storage_.IsOpened()) {
+      // 關檔前, 必須將暫存的資料寫入; 此時無法告知呼叫者錯誤, 所以忽略.
+      try {
+         this->CommitBatch(false);
+      }
+      catch (...) {
+      }
+   }
+   {
+      std::lock_guard<std::mutex> lk{this->Batch_->Mutex_};
+      this->DiscardBatch(*this->Batch_);
+   }
+   this->Map_.reset();
+   this->Storage_.Close();
 }
 
 InnFile::OpenResult InnFile::Open(OpenArgs& args) {
@@ -54,7 +272,8 @@ InnFile::OpenResult InnFile::Open(OpenArgs& args) {
          return res;
       }
       this->Storage_ = std::move(fd);
-      this->FileSize_ = this->HeaderSize_;
+      this->StoreFileSize(this->HeaderSize_);
+      this->OpenMap(args);
       return OpenResult{0};
    }
    if (res.GetResult() != sizeof(header))
@@ -79,10 +298,76 @@ InnFile::OpenResult InnFile::Open(OpenArgs& args) {
       return InnFile::OpenResult{std::errc::bad_message};
    args.BlockSize_ = this->BlockSize_;
    this->Storage_ = std::move(fd);
-   this->FileSize_ = res.GetResult();
+   this->StoreFileSize(res.GetResult());
+   this->OpenMap(args);
    return OpenResult{(res.GetResult() - this->HeaderSize_) / this->BlockSize_};
 }
 
+void InnFile::OpenMap(const OpenArgs& args) {
+   this->Map_.reset();
+   if (args.MapExtentSize_ <= 0)
+      return;
+   if (const File::SizeType extentSize = MapImpl::AdjustExtentSize(args.MapExtentSize_)) {
+      this->Map_.reset(new MapImpl{this->Storage_.GetFD(), extentSize});
+      this->Map_->AllocatedSize_ = this->LoadFileSize();
+   }
+}
+File::Result InnFile::ReadAt(RoomPosT pos, void* buf, SizeT size) {
+   WriteBatch& batch = *this->Batch_;
+   if (fon9_LIKELY(!batch.IsActive_.load(std::memory_order_acquire)))
+      return this->ReadFromFile(pos, buf, size, this->LoadFileSize());
+   std::unique_lock<std::mutex> lk{batch.Mutex_};
+   for (;;) {
+      if (!batch.IsActive_.load(std::memory_order_relaxed)) {
+         lk.unlock();
+         return this->ReadFromFile(pos, buf, size, this->LoadFileSize());
+      }
+      // 在 DiskFileSize_ 之後的部分, 尚未寫入檔案: 內容為 0, 或在 Pendings_ 裡面.
+      // 讀檔時不用 lock, 避免其他 thread 的讀寫被擋住;
+      // 讀檔後若 FlushId_ 沒變, 表示讀檔期間 Pendings_ 沒有寫入檔案, 此時再用 Pendings_ 覆蓋即可.
+      const File::SizeType diskFileSize = batch.DiskFileSize_;
+      const uint64_t       flushId = batch.FlushId_;
+      SizeT                dsz = 0;
+      if (pos < diskFileSize) {
+         dsz = (pos + size <= diskFileSize ? size : static_cast<SizeT>(diskFileSize - pos));
+         lk.unlock();
+         File::Result res = this->ReadFromFile(pos, buf, dsz, diskFileSize);
+         if (!res)
+            return res;
+         lk.lock();
+         if (flushId != batch.FlushId_)
+            continue;
+      }
+      memset(static_cast<byte*>(buf) + dsz, 0, size - dsz);
+      batch.Overlay(pos, static_cast<byte*>(buf), size);
+      return File::Result{size};
+   }
+}
+File::Result InnFile::ReadFromFile(RoomPosT pos, void* buf, SizeT size, File::SizeType fileSize) {
+   // 超過 fileSize 的部分, 不能從 map 取得(會有 SIGBUS), 交給 Storage_.Read() 處理.
+   if (this->Map_ && pos + size <= fileSize) {
+      if (const byte* ptr = this->Map_->GetAddr(pos, size)) {
+         memcpy(buf, ptr, size);
+         return File::Result{size};
+      }
+   }
+   return this->Storage_.Read(pos, buf, size);
+}
+File::Result InnFile::WriteAt(RoomPosT pos, const void* buf, size_t size) {
+   WriteBatch& batch = *this->Batch_;
+   if (fon9_UNLIKELY(batch.IsActive_.load(std::memory_order_acquire))) {
+      std::lock_guard<std::mutex> lk{batch.Mutex_};
+      if (batch.IsActive_.load(std::memory_order_relaxed)) {
+         batch.Put(pos, buf, size);
+         if (batch.PendingBytes_ >= WriteBatch::kMaxPendingBytes)
+            this->WritePendings(batch);
+         return File::Result{size};
+      }
+   }
+   batch.AddStat(size);
+   return this->Storage_.Write(pos, buf, size);
+}
+
 //--------------------------------------------------------------------------//
 
 static void CheckIoSize(const File::Result& res, File::SizeType sz, const char* exResError, const char* exSizeError) {
@@ -111,7 +396,7 @@ InnFile::RoomKey InnFile::MakeRoomKey(RoomPosT roomPos, void* exRoomHeader, Size
    if (roomPos == 0)
       roomPos = this->HeaderSize_;
    this->CheckRoomPos(roomPos, "InnFile.MakeRoomKey: not opened.", "InnFile.MakeRoomKey: bad roomPos.");
-   if (roomPos >= this->FileSize_) { // 已到尾端(EOF).
+   if (roomPos >= this->LoadFileSize()) { // 已到尾端(EOF).
       RoomKey::Info info;
       ZeroStruct(info);
       return RoomKey{info};
@@ -120,7 +405,7 @@ InnFile::RoomKey InnFile::MakeRoomKey(RoomPosT roomPos, void* exRoomHeader, Size
    SizeT  sz = kRoomHeaderSize + exRoomHeaderSize;
    if (sz > sizeof(roomHeader))
       sz = kRoomHeaderSize;
-   auto res = this->Storage_.Read(roomPos, roomHeader, sz);
+   auto res = this->ReadAt(roomPos, roomHeader, sz);
    CheckIoSize(res, sz,
                "InnFile.MakeRoomKey: read RoomHeader error.",
                "InnFile.MakeRoomKey: read RoomHeader error size.");
@@ -133,12 +418,12 @@ InnFile::RoomKey InnFile::MakeRoomKey(RoomPosT roomPos, void* exRoomHeader, Size
    //if (info.DataSize_ < exRoomHeaderSize)
    //   Raise<InnFileError>(std::errc::bad_message, "InnFile.MakeRoomKey: DataSize < exRoomHeaderSize.");
    if (info.DataSize_ > info.RoomSize_ || info.RoomSize_ <= 0
-       || info.RoomPos_ + info.RoomSize_ + kRoomHeaderSize > this->FileSize_)
+       || info.RoomPos_ + info.RoomSize_ + kRoomHeaderSize > this->LoadFileSize())
       Raise<InnFileError>(std::errc::bad_message, "InnFile.MakeRoomKey: bad RoomHeader.");
 
    if (sz == kRoomHeaderSize) {
       if (exRoomHeaderSize) {
-         res = this->Storage_.Read(roomPos + sz, exRoomHeader, exRoomHeaderSize);
+         res = this->ReadAt(roomPos + sz, exRoomHeader, exRoomHeaderSize);
          CheckIoSize(res, exRoomHeaderSize,
                      "InnFile.MakeRoomKey: read room ExHeader error.",
                      "InnFile.MakeRoomKey: read room ExHeader error size.");
@@ -160,7 +445,7 @@ InnFile::RoomKey InnFile::MakeNewRoom(InnRoomType roomType, SizeT size) {
       Raise<InnFileError>(std::errc::bad_file_descriptor, "InnFile.MakeNewRoom: not opened.");
 
    RoomKey::Info info;
-   info.RoomPos_ = this->FileSize_;
+   info.RoomPos_ = this->LoadFileSize();
    SizeT blockCount = static_cast<SizeT>(static_cast<size_t>(size) + kRoomHeaderSize + this->BlockSize_ - 1) / this->BlockSize_;
    info.CurrentRoomType_ = info.PendingRoomType_ = roomType;
    info.DataSize_ = 0;
@@ -171,16 +456,34 @@ InnFile::RoomKey InnFile::MakeNewRoom(InnRoomType roomType, SizeT size) {
    PutBigEndian(roomHeader + kOffset_RoomType, info.CurrentRoomType_);
    PutBigEndian(roomHeader + kOffset_DataSize, info.DataSize_);
 
-   auto res = this->Storage_.SetFileSize(this->FileSize_ = info.RoomPos_ + blockCount * this->BlockSize_);
+   if (this->Map_)
+      this->Map_->OnFileSizeIncreasing(info.RoomPos_ + blockCount * this->BlockSize_);
+   WriteBatch& batch = *this->Batch_;
+   if (batch.IsActive_.load(std::memory_order_acquire)) {
+      std::lock_guard<std::mutex> lk{batch.Mutex_};
+      if (batch.IsActive_.load(std::memory_order_relaxed)) {
+         // 新增的 rooms 在檔案尾端連續排列, 在 CommitBatch() 時一次調整檔案大小及寫入.
+         this->StoreFileSize(info.RoomPos_ + blockCount * this->BlockSize_);
+         batch.Put(info.RoomPos_, roomHeader, kRoomHeaderSize);
+         if (batch.PendingBytes_ >= WriteBatch::kMaxPendingBytes)
+            this->WritePendings(batch);
+         return RoomKey{info};
+      }
+   }
+   batch.AddStat(0);
+   auto res = this->Storage_.SetFileSize(info.RoomPos_ + blockCount * this->BlockSize_);
    const char* exWhat;
    if (!res) {
       exWhat = "InnFile.MakeNewRoom: build room error.";
 __RETURN_RESTORE_FILE:
-      this->Storage_.SetFileSize(this->FileSize_ = info.RoomPos_);
+      this->StoreFileSize(info.RoomPos_);
+      this->Storage_.SetFileSize(info.RoomPos_);
       Raise<InnFileError>(res.GetError(), exWhat);
    }
+   // SetFileSize() 成功後, 才能讓其他執行緒看到新的 FileSize_.
+   this->StoreFileSize(info.RoomPos_ + blockCount * this->BlockSize_);
 
-   res = this->Storage_.Write(info.RoomPos_, roomHeader, kRoomHeaderSize);
+   res = this->WriteAt(info.RoomPos_, roomHeader, kRoomHeaderSize);
    if (!res) {
       exWhat = "InnFile.MakeNewRoom: write RoomHeader error.";
       goto __RETURN_RESTORE_FILE;
@@ -197,7 +500,7 @@ void InnFile::UpdateRoomHeader(RoomKey::Info& info, SizeT newsz, const char* exR
    if (info.CurrentRoomType_ == info.PendingRoomType_) {
       if (info.DataSize_ != newsz) {
          PutBigEndian(&newsz, info.DataSize_ = newsz);
-         CheckIoSize(this->Storage_.Write(info.RoomPos_ + kOffset_DataSize, &newsz, sizeof(newsz)),
+         CheckIoSize(this->WriteAt(info.RoomPos_ + kOffset_DataSize, &newsz, sizeof(newsz)),
                      sizeof(newsz), exResError, exSizeError);
       }
    }
@@ -212,7 +515,7 @@ void InnFile::UpdateRoomHeader(RoomKey::Info& info, SizeT newsz, const char* exR
          wrsz = sizeof(roomHeader);
          PutBigEndian(roomHeader + sizeof(info.CurrentRoomType_), info.DataSize_ = newsz);
       }
-      CheckIoSize(this->Storage_.Write(info.RoomPos_ + kOffset_RoomType, roomHeader, wrsz),
+      CheckIoSize(this->WriteAt(info.RoomPos_ + kOffset_RoomType, roomHeader, wrsz),
                   wrsz, exResError, exSizeError);
    }
 }
@@ -250,12 +553,12 @@ void InnFile::Reduce(RoomKey& roomKey, SizeT newDataSize, const void* exRoomHead
          wrsz += exRoomHeaderSize;
          exRoomHeaderSize = 0;
       }
-      CheckIoSize(this->Storage_.Write(roomKey.Info_.RoomPos_ + kOffset_RoomType, roomHeader, wrsz), wrsz,
+      CheckIoSize(this->WriteAt(roomKey.Info_.RoomPos_ + kOffset_RoomType, roomHeader, wrsz), wrsz,
                   "InnFile.Reduce: update RoomHeader2 error.",
                   "InnFile.Reduce: update RoomHeader2 error size.");
    }
    if (exRoomHeaderSize > 0) {
-      CheckIoSize(this->Storage_.Write(roomKey.Info_.RoomPos_ + kRoomHeaderSize, exRoomHeader, exRoomHeaderSize),
+      CheckIoSize(this->WriteAt(roomKey.Info_.RoomPos_ + kRoomHeaderSize, exRoomHeader, exRoomHeaderSize),
                   exRoomHeaderSize,
                   "InnFile.Reduce: update room ExHeader error.",
                   "InnFile.Reduce: update room ExHeader error size.");
@@ -273,8 +576,8 @@ InnFile::RoomPosT InnFile::CheckReadArgs(const RoomKey& roomKey, SizeT offset, S
    return roomKey.Info_.RoomPos_ + kRoomHeaderSize + offset;
 }
 
-static InnFile::SizeT ReadToNode(File& fd, FwdBufferNode* back, InnFile::RoomPosT pos, InnFile::SizeT size) {
-   CheckIoSize(fd.Read(pos, back->GetDataEnd(), size), size,
+InnFile::SizeT InnFile::ReadToNode(FwdBufferNode* back, RoomPosT pos, SizeT size) {
+   CheckIoSize(this->ReadAt(pos, back->GetDataEnd(), size), size,
                "InnFile.Read: read error.",
                "InnFile.Read: read error size.");
    back->SetDataEnd(back->GetDataEnd() + size);
@@ -288,18 +591,18 @@ InnFile::SizeT InnFile::Read(const RoomKey& roomKey, SizeT offset, SizeT size, B
    File::Result res;
    if (FwdBufferNode* back = FwdBufferNode::CastFrom(buf.back())) {
       if (back->GetRemainSize() >= size)
-         return ReadToNode(this->Storage_, back, pos, size);
+         return this->ReadToNode(back, pos, size);
    }
    FwdBufferNode* back = FwdBufferNode::Alloc(size);
    BufferList     tempbuf; // for auto free back.
    tempbuf.push_back(back);
-   ReadToNode(this->Storage_, back, pos, size);
+   this->ReadToNode(back, pos, size);
    buf.push_back(tempbuf.ReleaseList());
    return size;
 }
 InnFile::SizeT InnFile::Read(const RoomKey& roomKey, SizeT offset, void* buf, SizeT size) {
    if (RoomPosT pos = this->CheckReadArgs(roomKey, offset, size)) {
-      CheckIoSize(this->Storage_.Read(pos, buf, size), size,
+      CheckIoSize(this->ReadAt(pos, buf, size), size,
                   "InnFile.Read: read error.",
                   "InnFile.Read: read error size.");
       return size;
@@ -311,15 +614,34 @@ InnFile::SizeT InnFile::ReadAll(const RoomKey& roomKey, void* buf, SizeT bufsz)
       return this->Read(roomKey, 0, roomKey.GetDataSize(), buf);
    Raise<InnFileError>(std::errc::invalid_argument, "InnFile.ReadAll: buffer too small.");
 }
+const byte* InnFile::Peek(const RoomKey& roomKey, SizeT offset, SizeT& size) {
+   if (!this->Map_) {
+      size = 0;
+      return nullptr;
+   }
+   if (RoomPosT pos = this->CheckReadArgs(roomKey, offset, size)) {
+      WriteBatch& batch = *this->Batch_;
+      if (fon9_LIKELY(!batch.IsActive_.load(std::memory_order_acquire))) {
+         if (pos + size <= this->LoadFileSize())
+            return this->Map_->GetAddr(pos, size);
+         return nullptr;
+      }
+      // 尚未寫入檔案的資料, 無法從 map 取得.
+      std::lock_guard<std::mutex> lk{batch.Mutex_};
+      if (pos + size <= batch.DiskFileSize_ && !batch.Overlay(pos, nullptr, size))
+         return this->Map_->GetAddr(pos, size);
+   }
+   return nullptr;
+}
 
 //--------------------------------------------------------------------------//
 
-static void WriteRoom(File& fd, File::PosType pos, size_t wrsz, DcQueue& buf, const char* exResError, const char* exSizeError) {
+void InnFile::WriteRoom(RoomPosT pos, size_t wrsz, DcQueue& buf, const char* exResError, const char* exSizeError) {
    for (;;) {
       auto blk = buf.PeekCurrBlock();
       if (blk.second > wrsz)
          blk.second = wrsz;
-      CheckIoSize(fd.Write(pos, blk.first, blk.second), blk.second, exResError, exSizeError);
+      CheckIoSize(this->WriteAt(pos, blk.first, blk.second), blk.second, exResError, exSizeError);
       buf.PopConsumed(blk.second);
       if ((wrsz -= blk.second) <= 0)
          break;
@@ -336,7 +658,7 @@ InnFile::SizeT InnFile::Rewrite(RoomKey& roomKey, DcQueue& buf) {
    this->UpdateRoomHeader(roomKey.Info_, static_cast<SizeT>(bufsz),
                           "InnFile.Rewrite: update RoomHeader error.",
                           "InnFile.Rewrite: update RoomHeader error size.");
-   WriteRoom(this->Storage_, pos + kRoomHeaderSize, bufsz, buf,
+   this->WriteRoom(pos + kRoomHeaderSize, bufsz, buf,
              "InnFile.Rewrite: write error.",
              "InnFile.Rewrite: write error size.");
    return roomKey.Info_.DataSize_;
@@ -354,7 +676,7 @@ InnFile::SizeT InnFile::Write(RoomKey& roomKey, const SizeT offset, const SizeT
       return 0;
    if (size > buf.CalcSize())
       Raise<InnFileError>(std::errc::invalid_argument, "InnFile.Write: request size > buffer size.");
-   WriteRoom(this->Storage_, pos + kRoomHeaderSize + offset, size, buf,
+   this->WriteRoom(pos + kRoomHeaderSize + offset, size, buf,
              "InnFile.Write: write error.",
              "InnFile.Write: write error size.");
    SizeT newsz = offset + size;
@@ -366,4 +688,89 @@ InnFile::SizeT InnFile::Write(RoomKey& roomKey, const SizeT offset, const SizeT
    return size;
 }
 
+//--------------------------------------------------------------------------//
+
+void InnFile::BeginBatch() {
+   WriteBatch& batch = *this->Batch_;
+   std::lock_guard<std::mutex> lk{batch.Mutex_};
+   if (batch.IsActive_.load(std::memory_order_relaxed))
+      return;
+   batch.DiskFileSize_ = this->LoadFileSize();
+   batch.IsActive_.store(true, std::memory_order_release);
+}
+void InnFile::DiscardBatch(WriteBatch& batch) {
+   if (batch.IsActive_.load(std::memory_order_relaxed)
+       && batch.DiskFileSize_ < this->LoadFileSize()
+       && this->Storage_.IsOpened()) {
+      // batch 期間新增的 rooms 尚未配置檔案空間, 必須補上, 否則透過 map 讀取時會 SIGBUS;
+      // 此時已在處理錯誤, 所以忽略 SetFileSize() 的結果.
+      this->Storage_.SetFileSize(this->LoadFileSize());
+   }
+   batch.Pendings_.clear();
+   batch.PendingBytes_ = 0;
+   ++batch.FlushId_; // 讓 ReadAt() 重新檢查 batch 狀態.
+   batch.IsActive_.store(false, std::memory_order_release);
+}
+void InnFile::WritePendings(WriteBatch& batch) {
+   try {
+      this->WritePendingsImpl(batch);
+   }
+   catch (...) {
+      this->DiscardBatch(batch);
+      throw;
+   }
+}
+void InnFile::WritePendingsImpl(WriteBatch& batch) {
+   if (batch.DiskFileSize_ < this->LoadFileSize()) {
+      // 若最後一個區塊與新的檔案尾端很接近, 則補 0 到檔案尾端, 由寫入時延伸檔案, 可省下一次 SetFileSize();
+      auto ilast = batch.Pendings_.rbegin();
+      if (ilast != batch.Pendings_.rend() && batch.CanMerge(ilast->first + ilast->second.size(), this->LoadFileSize())) {
+         batch.PendingBytes_ -= ilast->second.size();
+         ilast->second.resize(static_cast<size_t>(this->LoadFileSize() - ilast->first));
+         batch.PendingBytes_ += ilast->second.size();
+      }
+      else {
+         batch.AddStat(0);
+         auto res = this->Storage_.SetFileSize(this->LoadFileSize());
+         if (!res)
+            Raise<InnFileError>(res.GetError(), "InnFile.CommitBatch: SetFileSize error.");
+         batch.DiskFileSize_ = this->LoadFileSize();
+      }
+   }
+   ++batch.FlushId_;
+   while (!batch.Pendings_.empty()) {
+      auto ibeg = batch.Pendings_.begin();
+      const std::string& dat = ibeg->second;
+      batch.AddStat(dat.size());
+      CheckIoSize(this->Storage_.Write(ibeg->first, dat.data(), dat.size()), dat.size(),
+                  "InnFile.CommitBatch: write error.",
+                  "InnFile.CommitBatch: write error size.");
+      // 寫入超過檔案尾端, 檔案會自動延伸, 中間的間隔內容為 0;
+      if (batch.DiskFileSize_ < ibeg->first + dat.size())
+         batch.DiskFileSize_ = ibeg->first + dat.size();
+      batch.PendingBytes_ -= dat.size();
+      batch.Pendings_.erase(ibeg);
+   }
+   assert(batch.DiskFileSize_ == this->LoadFileSize());
+   assert(batch.PendingBytes_ == 0);
+}
+void InnFile::CommitBatch(bool isSync) {
+   WriteBatch& batch = *this->Batch_;
+   std::lock_guard<std::mutex> lk{batch.Mutex_};
+   if (!batch.IsActive_.load(std::memory_order_relaxed))
+      return;
+   this->WritePendings(batch);
+   batch.IsActive_.store(false, std::memory_order_release);
+   if (isSync) {
+      batch.AddStat(0);
+      this->Storage_.Sync();
+   }
+}
+InnFile::WriteStats InnFile::GetWriteStats() const {
+   WriteStats retval;
+   retval.Bytes_ = this->Batch_->StatBytes_.load(std::memory_order_relaxed);
+   retval.Calls_ = this->Batch_->StatCalls_.load(std::memory_order_relaxed);
+   return retval;
+}
+
 } // namespaces
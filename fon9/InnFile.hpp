@@ -6,9 +6,13 @@
 #include "fon9/buffer/BufferList.hpp"
 #include "fon9/buffer/DcQueue.hpp"
 #include "fon9/Exception.hpp"
+#include <memory>
+#include <atomic>
 
 namespace fon9 {
 
+class FwdBufferNode;
+
 /// \ingroup Inn
 /// InnFile 不解釋 InnRoomType 的值, 由使用者自行解釋.
 using InnRoomType = byte;
@@ -47,7 +51,7 @@ fon9_WARN_POP;
 /// 檔案空間, 採用類似 memory alloc 的管理方式, 分配空間 & 釋放空間.
 /// - InnFile 不理會分配出去的空間如何使用, InnFile 僅提供最基本的功能.
 ///   - 所有操作都 **不是** thread safe.
-///   - 所有操作都 **立即** 操作檔案.
+///   - 所有操作都 **立即** 操作檔案; 除非在 BeginBatch() 之後, 此時寫入會暫存到 CommitBatch();
 /// - 除了 Open() 使用 OpenResult 傳回結果, 其餘操作若有錯誤, 則拋出異常.
 /// - 檔案格式:
 ///   - 所有的數字格式使用 big endian
@@ -104,6 +108,14 @@ public:
       std::string FileName_;
       SizeT       BlockSize_;
       FileMode    OpenMode_;
+      /// 使用 memory map 讀取資料, 每個 map 區塊(extent)的大小, 0 表示不使用.
+      /// - 僅支援 POSIX, 其他系統此設定無效.
+      /// - 會調整成 page size 的倍數.
+      /// - 寫入仍使用 File::Write(): 若磁碟空間不足, 才能用異常告知呼叫者, 而不是 SIGBUS.
+      ///   在 Linux 會使用 fallocate(FALLOC_FL_KEEP_SIZE) 以 extent 為單位預先配置磁碟空間,
+      ///   檔案大小(及格式)不變.
+      /// - 多個讀取者(例: 同時有多個回補要求) 共用同一份 page cache, 不需各自 read().
+      File::SizeType MapExtentSize_{0};
 
       OpenArgs(std::string fileName, SizeT blockSize = 64, FileMode openMode = kDefaultFileMode())
          : FileName_{std::move(fileName)}
@@ -119,8 +131,11 @@ public:
    /// \retval errc::bad_message 檔案格式有誤.
    OpenResult Open(OpenArgs& args);
 
-   void Close() {
-      this->Storage_.Close();
+   void Close();
+
+   /// 是否有使用 memory map, 請參考 OpenArgs::MapExtentSize_;
+   bool IsMapped() const {
+      return this->Map_.get() != nullptr;
    }
 
    //--------------------------------------------------------------------------//
@@ -286,6 +301,13 @@ public:
    }
    SizeT ReadAll(const RoomKey& roomKey, void* buf, SizeT bufsz);
 
+   /// 直接取得 room 儲存的內容, 不用 syscall, 也不用複製.
+   /// - 必須使用 memory map(OpenArgs::MapExtentSize_), 且要求的範圍在同一個 map 區塊內.
+   /// - 返回前 size 會調整成實際可取得的資料量(不超過 room DataSize).
+   /// - 傳回 nullptr 表示無法直接取得, 此時應使用 Read();
+   /// - 傳回的位置在 Close() 之前有效, 內容可能會被之後的 Write() 改變.
+   const byte* Peek(const RoomKey& roomKey, SizeT offset, SizeT& size);
+
    /// 將 「buf全部」 覆寫入 room, 成功後返回寫入 room 的資料量 = roomKey.GetDataSize() = buf.CalcSize();
    /// 若 room 的空間不足, 則 room 內容不變, 直接拋出 InnRoomSizeError 異常.
    SizeT Rewrite(RoomKey& roomKey, DcQueue& buf);
@@ -321,6 +343,32 @@ public:
 
    //--------------------------------------------------------------------------//
 
+   /// 開始合併寫入(group commit).
+   /// - 在 CommitBatch() 之前, 所有的寫入(包含 MakeNewRoom())都先暫存在記憶體,
+   ///   相鄰(或在檔案新增部分且間隔很小)的寫入, 會合併成一個連續區塊.
+   /// - 暫存的資料量超過 1M bytes 時, 會先寫入檔案.
+   /// - 此期間的 Read(), Peek() 可以正確取得尚未寫入檔案的資料.
+   /// - 若已在 BeginBatch() 狀態, 則不做任何事.
+   void BeginBatch();
+   /// 依照位置順序, 將 BeginBatch() 之後暫存的資料寫入檔案, 每個連續區塊只需一次 write.
+   /// - 檔案大小若有增加, 則會先調整檔案大小, 再寫入資料.
+   /// - isSync == true: 寫入後呼叫 Sync();
+   /// - 不論成功或失敗, 返回時都已結束 batch 狀態, 之後的寫入會直接寫入檔案.
+   /// - 若寫入失敗, 則拋出 InnFileError 異常, 尚未寫入的資料會被丟棄(如同直接寫入失敗).
+   /// - 若沒有在 BeginBatch() 狀態, 則不做任何事(也不會 Sync()).
+   void CommitBatch(bool isSync);
+
+   /// 寫入檔案的統計, 可用來評估每次 write 的平均資料量.
+   struct WriteStats {
+      /// 寫入檔案的資料量.
+      uint64_t Bytes_;
+      /// write, SetFileSize, Sync 的次數.
+      uint64_t Calls_;
+   };
+   WriteStats GetWriteStats() const;
+
+   //--------------------------------------------------------------------------//
+
 private:
    SizeT CalcRoomSize(SizeT blockCount) const {
       return blockCount ? static_cast<SizeT>(this->BlockSize_ * blockCount - kRoomHeaderSize) : 0;
@@ -333,11 +381,40 @@ private:
    void UpdateRoomHeader(RoomKey::Info& info, SizeT newsz, const char* exResError, const char* exSizeError);
    RoomPosT CheckReadArgs(const RoomKey& roomKey, SizeT offset, SizeT& size);
    void ClearRoom(RoomKey& roomKey, SizeT requiredSize);
+   void OpenMap(const OpenArgs& args);
+   /// 若在 BeginBatch() 狀態, 則會包含尚未寫入檔案的資料.
+   File::Result ReadAt(RoomPosT pos, void* buf, SizeT size);
+   /// 若有 memory map, 且 [pos, pos + size) 在 fileSize 之內, 則從 map 讀取, 否則使用 Storage_.Read();
+   File::Result ReadFromFile(RoomPosT pos, void* buf, SizeT size, File::SizeType fileSize);
+   SizeT ReadToNode(FwdBufferNode* back, RoomPosT pos, SizeT size);
+   /// 若在 BeginBatch() 狀態, 則先暫存, 否則直接寫入 Storage_;
+   File::Result WriteAt(RoomPosT pos, const void* buf, size_t size);
+   void WriteRoom(RoomPosT pos, size_t wrsz, DcQueue& buf, const char* exResError, const char* exSizeError);
+   struct WriteBatch;
+   /// 將 batch 暫存的資料寫入檔案, 必須在 batch.Mutex_ lock 狀態下呼叫.
+   /// 若寫入失敗, 則在拋出異常前呼叫 DiscardBatch(batch);
+   void WritePendings(WriteBatch& batch);
+   void WritePendingsImpl(WriteBatch& batch);
+   /// 丟棄尚未寫入的資料, 並結束 batch 狀態, 必須在 batch.Mutex_ lock 狀態下呼叫.
+   void DiscardBatch(WriteBatch& batch);
 
    File  Storage_;
    SizeT BlockSize_{0};
    SizeT HeaderSize_;
-   File::SizeType FileSize_;
+   /// MakeNewRoom() 會在其他執行緒 ReadAt()/Peek() 時增加 FileSize_;
+   /// 必須在 Storage_.SetFileSize() 成功之後才更新(release), 讀取時使用 acquire,
+   /// 避免讀取端透過 map 存取尚未配置的範圍(SIGBUS).
+   std::atomic<File::SizeType> FileSize_{0};
+   File::SizeType LoadFileSize() const {
+      return this->FileSize_.load(std::memory_order_acquire);
+   }
+   void StoreFileSize(File::SizeType sz) {
+      this->FileSize_.store(sz, std::memory_order_release);
+   }
+
+   struct MapImpl;
+   std::unique_ptr<MapImpl>   Map_;
+   std::unique_ptr<WriteBatch> Batch_;
 };
 
 } // namespaces
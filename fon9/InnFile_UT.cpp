@@ -168,15 +168,30 @@ void CheckRooms(fon9::InnFile& inn, bool useBufferList) {
          std::cout << "[ERROR] InnFile.Read|room#=" << L << "|ctx err at=" << (pne - membuf) << std::endl;
          abort();
       }
+      if (inn.IsMapped()) {
+         // 使用 memory map: 除了跨越 map 區塊的 room, 都應可直接取得.
+         fon9::InnFile::SizeT pksz = static_cast<fon9::InnFile::SizeT>(L + 1);
+         if (const fon9::byte* pk = inn.Peek(rkey, 0, pksz)) {
+            if (pksz != L || std::find_if(pk, pk + L, [L](fon9::byte b) { return b != static_cast<fon9::byte>(L); }) != pk + L) {
+               std::cout << "[ERROR] InnFile.Peek|room#=" << L << "|pksz=" << pksz << std::endl;
+               abort();
+            }
+         }
+      }
       rkey = inn.MakeNextRoomKey(rkey, nullptr, 0);
    }
 }
 
-void TestInnFunc() {
+// isBatch: 在 BeginBatch() 狀態下測試寫入及讀取, 最後才 CommitBatch();
+void TestInnFunc(fon9::File::SizeType mapExtentSize, bool isBatch) {
+   std::cout << "MapExtentSize=" << mapExtentSize << "|isBatch=" << isBatch << std::endl;
    remove(kInnFileName);
    fon9::InnFile::OpenArgs args{kInnFileName, kBlockSize};
    fon9::InnFile           inn;
+   args.MapExtentSize_ = mapExtentSize;
    TestInnOpen(inn, args, fon9::InnFile::OpenResult{0});
+   if (isBatch)
+      inn.BeginBatch();
 
    std::cout << "[TEST ] InnFile.Rewrite...";
    for (size_t L = 0; L < sizeof(membuf); ++L) {
@@ -245,6 +260,10 @@ void TestInnFunc() {
       }
       rkey = inn.MakeNextRoomKey(rkey, nullptr, 0);
    }
+   if (isBatch) // 之後檢查 CommitBatch() 寫入檔案的結果.
+      inn.CommitBatch(false);
+   const auto stats = inn.GetWriteStats();
+   std::cout << "|WriteStats:bytes=" << stats.Bytes_ << "|calls=" << stats.Calls_;
    // 檢查 Reduce() 的結果.
    size_t exRoomHeader;
    rkey = inn.MakeRoomKey(0, &exRoomHeader, sizeof(exRoomHeader));
@@ -274,6 +293,15 @@ int main() {
 #endif
    fon9::AutoPrintTestInfo utinfo("InnFile");
    TestInnOpen();
-   TestInnFunc();
+   TestInnFunc(0, false);
+   utinfo.PrintSplitter();
+   // 使用很小的 map 區塊, 測試跨越 map 區塊的 room.
+   TestInnFunc(1, false);
+   utinfo.PrintSplitter();
+   TestInnFunc(1024 * 1024, false);
+   utinfo.PrintSplitter();
+   TestInnFunc(0, true);
+   utinfo.PrintSplitter();
+   TestInnFunc(1, true);
    remove(kInnFileName);
 }
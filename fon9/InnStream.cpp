@@ -166,6 +166,33 @@ struct InnStream::IoHandlerRd : public IoHandler {
 InnStream::SizeType InnStream::Read(PosType pos, void* buf, SizeType bufsz) {
    return IoHandlerRd{}.Work(this->Lock(), pos, buf, bufsz);
 }
+const byte* InnStream::Peek(PosType pos, SizeType& size) {
+   Locker      impl{this->Lock()};
+   InnFileP*   ownerInnFile = impl->OwnerInnFile();
+   InnRoomSize ofsBlock;
+   size_t      idx;
+   if (ownerInnFile == nullptr || !ownerInnFile->IsMapped()
+       || (idx = InnStream::SeekWithFlush(impl, pos, ofsBlock)) == 0) {
+      size = 0;
+      return nullptr;
+   }
+   Block* curr = &impl->BlockList_[--idx];
+   if (ofsBlock >= curr->GetPayloadSize()) {
+      // pos 在此 block 的尾端, 則應從下一個 block 的開頭取得.
+      if (++idx >= impl->BlockList_.size()) {
+         size = 0;
+         return nullptr;
+      }
+      curr = &impl->BlockList_[idx];
+      ofsBlock = 0;
+   }
+   InnRoomSize pksz = curr->GetPayloadSize() - ofsBlock;
+   if (size < pksz)
+      pksz = static_cast<InnRoomSize>(size);
+   const byte* retval = ownerInnFile->Peek(curr->RoomKey_, static_cast<InnRoomSize>(ofsBlock + sizeof(RoomHeader)), pksz);
+   size = (retval ? pksz : 0);
+   return retval;
+}
 //--------------------------------------------------------------------------//
 struct InnStream::IoHandlerWr : public IoHandler {
    SizeType Write(const Locker& impl, PosType pos, const void* buf, SizeType bufsz) {
@@ -9,7 +9,7 @@
 
 namespace fon9 {
 
-/// 針對 MakeNewRoom(); 進行 thread safe 保護.
+/// 針對 MakeNewRoom(), BeginBatch(), CommitBatch(); 進行 thread safe 保護.
 class fon9_API InnFileP : protected InnFile {
    fon9_NON_COPYABLE(InnFileP);
    using base = InnFile;
@@ -22,11 +22,24 @@ public:
    using base::Write;
    using base::Read;
    using base::MakeRoomKey;
+   using base::Peek;
+   using base::IsMapped;
+   using base::GetWriteStats;
+   using base::GetOpenName;
+   using base::Sync;
 
    RoomKey MakeNewRoom(InnRoomType roomType, SizeT size) {
       Locker locker{this->Mutex_};
       return base::MakeNewRoom(roomType, size);
    }
+   void BeginBatch() {
+      Locker locker{this->Mutex_};
+      base::BeginBatch();
+   }
+   void CommitBatch(bool isSync) {
+      Locker locker{this->Mutex_};
+      base::CommitBatch(isSync);
+   }
 };
 
 /// 使用 InnFile Room 機制的 Stream.
@@ -75,6 +88,10 @@ public:
    }
 
    SizeType Read(PosType pos, void* buf, SizeType bufsz);
+   /// 直接取得從 pos 開始的資料, 不用複製, 請參考 InnFile::Peek();
+   /// - 只會取得 pos 所在 room 的資料, 所以返回時 size 可能會縮減.
+   /// - 傳回 nullptr 表示無法直接取得(例: 沒有使用 memory map), 此時應使用 Read();
+   const byte* Peek(PosType pos, SizeType& size);
    SizeType Write(PosType pos, const void* buf, SizeType bufsz);
    SizeType Write(PosType pos, DcQueue&& buf) {
       return this->WriteDcQueue(this->Lock(), pos, std::move(buf));
@@ -4,6 +4,14 @@
 #include "fon9/ThreadId.hpp"
 #include "fon9/buffer/DcQueueList.hpp"
 #include "fon9/buffer/BufferNodeWaiter.hpp"
+#include "fon9/SpscRing.hpp"
+
+fon9_BEFORE_INCLUDE_STD
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+fon9_AFTER_INCLUDE_STD
 
 namespace fon9 {
 
@@ -56,21 +64,369 @@ fon9_API void UnsetLogWriter(FnLogWriter fnLogWriter) {
    }
 }
 
+//--------------------------------------------------------------------------//
+
+enum class LogDeferredKind : uint8_t {
+   /// 延遲格式化: 由 FnFormat_ 從參數產生 log 內容.
+   Format,
+   /// LogWrite(LogLevel, RevBufferList&&); 已格式化的內容, 尚未加上 log header.
+   RevBuffer,
+   /// LogWrite(const LogArgs&, BufferList&&); 直接交給 FnLogWriter.
+   Raw,
+   /// WaitLogFlush(); 在此之前的 log 都已交給 FnLogWriter.
+   Flush,
+};
+fon9_WARN_DISABLE_PADDING;
+struct LogDeferredHead {
+   TimeStamp            UtcTime_;
+   FnLogDeferredFormat  FnFormat_;
+   LogLevel             Level_;
+   LogDeferredKind      Kind_;
+};
+fon9_WARN_POP;
+enum : size_t {
+   /// 參數從 head 之後的 8 bytes 對齊位置開始存放.
+   kLogDeferredHeadSize = (sizeof(LogDeferredHead) + 7) & ~static_cast<size_t>(7),
+};
+
+fon9_WARN_DISABLE_PADDING;
+/// 每個 thread 一個 ring, 由該 thread 放入, 由背景 thread 取出.
+class LogDeferredRing : public SpscPkRing<1> {
+   fon9_NON_COPY_NON_MOVE(LogDeferredRing);
+   using base = SpscPkRing<1>;
+public:
+   const ThreadId    ThreadId_;
+   /// 在 thread 結束時設定, 之後該 thread 不會再使用此 ring;
+   /// 背景 thread 確定 ring 已清空後, 就可以刪除此 ring.
+   std::atomic<bool> IsThreadEnded_{false};
+   /// 由 GetLogDeferredRing() 設定, 在 CommitEntry() 或 AllocEntry() 失敗時清除;
+   /// 背景 thread 結束前, 必須等候全部 ring 的 IsProducing_ 都已清除, 且 ring 都已清空.
+   std::atomic<bool> IsProducing_{false};
+
+   LogDeferredRing(size_t capacity) : base{capacity}, ThreadId_(ThisThread_) {
+   }
+   /// 分配一筆 log 的空間, 並填妥 head, 傳回參數的存放位置.
+   /// - 若空間不足, 則喚醒背景 thread 並等候.
+   /// - 若 argsz 太大, 或等候時延遲格式化被關閉, 則清除 IsProducing_ 並傳回 nullptr.
+   byte* AllocEntry(LogLevel level, LogDeferredKind kind, FnLogDeferredFormat fnFormat, size_t argsz, TimeStamp utctm);
+   void CommitEntry() {
+      this->Commit();
+      this->IsProducing_.store(false, std::memory_order_release);
+   }
+};
+fon9_WARN_POP;
+
+struct LogDeferredMgr {
+   fon9_NON_COPY_NON_MOVE(LogDeferredMgr);
+   LogDeferredMgr() = default;
+   ~LogDeferredMgr();
+
+   /// 保護 Rings_, IsRunning_, Args_.
+   std::mutex                    Mutex_;
+   std::condition_variable       Cond_;
+   std::vector<LogDeferredRing*> Rings_;
+   bool                          IsRunning_{false};
+   LogDeferredArgs               Args_;
+   /// Rings_ 有異動時設定, 背景 thread 據此重新取得 Rings_ 的複本.
+   std::atomic<bool>             IsRingsChanged_{false};
+   std::thread                   Thread_;
+
+   void Run();
+   /// 從 rings 取出時間最早的一筆 log 並輸出, 若全部 ring 都是空的, 則傳回 false.
+   static bool WriteNext(const std::vector<LogDeferredRing*>& rings);
+   /// 刪除已結束且已清空的 ring, 必須在 lock 狀態下呼叫.
+   void RemoveEndedRings();
+   /// 全部 ring 都沒有正在放入的 log, 且都已清空, 必須在 lock 狀態下呼叫.
+   bool IsAllRingsIdle() const;
+};
+static std::atomic<bool>   IsLogDeferred_{false};
+static LogDeferredMgr*     LogDeferredMgr_;
+static LogDeferredMgr& GetLogDeferredMgr() {
+   // 在第一次 StartLogDeferred() 時才建構,
+   // 如此在程式結束時, 會比之前已啟動的 LogFile 先解構, 讓剩餘的 log 能寫入檔案.
+   static LogDeferredMgr mgr;
+   LogDeferredMgr_ = &mgr;
+   return mgr;
+}
+
+static thread_local LogDeferredRing*   TlsLogDeferredRing_;
+static thread_local bool               TlsIsLogDeferredConsumer_;
+static LogDeferredRing* const          kLogDeferredRingEnded = reinterpret_cast<LogDeferredRing*>(1);
+struct LogDeferredRingHolder {
+   bool  IsUsed_{false};
+   ~LogDeferredRingHolder() {
+      if (LogDeferredRing* ring = TlsLogDeferredRing_) {
+         TlsLogDeferredRing_ = kLogDeferredRingEnded;
+         if (ring != kLogDeferredRingEnded)
+            ring->IsThreadEnded_.store(true, std::memory_order_release);
+      }
+   }
+};
+static thread_local LogDeferredRingHolder TlsLogDeferredRingHolder_;
+
+/// 取得 this_thread 的 ring(若沒有則建立), 並設定 ring->IsProducing_;
+/// 之後必須呼叫 ring->CommitEntry(), 或 ring->AllocEntry() 失敗(會自動清除 IsProducing_).
+/// 若未啟用延遲格式化, 或 this_thread 已結束, 或 this_thread 為背景 thread, 則傳回 nullptr.
+static LogDeferredRing* GetLogDeferredRing() {
+   if (fon9_LIKELY(!IsLogDeferred_.load(std::memory_order_relaxed)))
+      return nullptr;
+   LogDeferredRing* ring = TlsLogDeferredRing_;
+   if (fon9_UNLIKELY(ring == nullptr)) {
+      if (TlsIsLogDeferredConsumer_)
+         return nullptr;
+      LogDeferredMgr&               mgr = *LogDeferredMgr_;
+      std::lock_guard<std::mutex>   lk{mgr.Mutex_};
+      if (!mgr.IsRunning_)
+         return nullptr;
+      ring = new LogDeferredRing{mgr.Args_.RingSize_};
+      mgr.Rings_.push_back(ring);
+      mgr.IsRingsChanged_.store(true, std::memory_order_release);
+      TlsLogDeferredRingHolder_.IsUsed_ = true; // 確保 thread 結束時會執行 ~LogDeferredRingHolder();
+      TlsLogDeferredRing_ = ring;
+   }
+   else if (ring == kLogDeferredRingEnded)
+      return nullptr;
+   // 先設定 IsProducing_ 再檢查 IsLogDeferred_ (與 StopLogDeferred() 的順序相反, 兩者都使用 seq_cst):
+   // - 若此處看到 IsLogDeferred_ == true, 則背景 thread 結束前必定會看到 IsProducing_, 會等候此筆 log 放入後輸出.
+   // - 否則改由呼叫端直接輸出.
+   ring->IsProducing_.store(true, std::memory_order_seq_cst);
+   if (fon9_LIKELY(IsLogDeferred_.load(std::memory_order_seq_cst)))
+      return ring;
+   ring->IsProducing_.store(false, std::memory_order_release);
+   return nullptr;
+}
+
+byte* LogDeferredRing::AllocEntry(LogLevel level, LogDeferredKind kind, FnLogDeferredFormat fnFormat, size_t argsz, TimeStamp utctm) {
+   const size_t pksz = kLogDeferredHeadSize + argsz;
+   void* pk;
+   if (pksz > this->GetMaxPkSize()) {
+__RETURN_NULL:
+      this->IsProducing_.store(false, std::memory_order_release);
+      return nullptr;
+   }
+   while ((pk = this->Alloc(static_cast<PkSizeT>(pksz))) == nullptr) {
+      if (!IsLogDeferred_.load(std::memory_order_relaxed))
+         goto __RETURN_NULL;
+      LogDeferredMgr_->Cond_.notify_one();
+      std::this_thread::yield();
+   }
+   LogDeferredHead* head = static_cast<LogDeferredHead*>(pk);
+   head->UtcTime_ = utctm;
+   head->FnFormat_ = fnFormat;
+   head->Level_ = level;
+   head->Kind_ = kind;
+   return static_cast<byte*>(pk) + kLogDeferredHeadSize;
+}
+
+fon9_API byte* LogDeferredAlloc(LogLevel level, FnLogDeferredFormat fnFormat, size_t argsz) {
+   if (LogDeferredRing* ring = GetLogDeferredRing())
+      return ring->AllocEntry(level, LogDeferredKind::Format, fnFormat, argsz, UtcNow());
+   return nullptr;
+}
+fon9_API void LogDeferredCommit() {
+   assert(TlsLogDeferredRing_ != nullptr && TlsLogDeferredRing_ != kLogDeferredRingEnded);
+   TlsLogDeferredRing_->CommitEntry();
+}
+/// 把 buf 放入 this_thread 的 ring, 若傳回 false, 則 buf 不變, 由呼叫端自行處理.
+static bool LogDeferredPushBuffer(LogDeferredKind kind, const LogArgs& logArgs, BufferList& buf) {
+   LogDeferredRing* ring = GetLogDeferredRing();
+   if (ring == nullptr)
+      return false;
+   byte* pout = ring->AllocEntry(logArgs.Level_, kind, nullptr, sizeof(BufferList), logArgs.UtcTime_);
+   if (pout == nullptr)
+      return false;
+   new (pout) BufferList{std::move(buf)};
+   ring->CommitEntry();
+   return true;
+}
+/// 等候 this_thread 在此之前放入 ring 的 log, 及其他 thread 在此時間之前的 log, 都已交給 FnLogWriter.
+/// - 若延遲格式化已停止(背景 thread 已結束或正在結束), 則 ring 裡面的 log 已經(或即將)全部輸出,
+///   此時直接返回, 由呼叫端繼續同步的 flush.
+/// - 放入 ring 的 Flush 必定會被背景 thread 處理(背景 thread 結束前會清空全部的 ring), 所以不會永久等候.
+static void LogDeferredFlush() {
+   LogDeferredRing* ring = GetLogDeferredRing();
+   if (ring == nullptr)
+      return;
+   CountDownLatch waiter{1};
+   byte* pout = ring->AllocEntry(LogLevel::Info, LogDeferredKind::Flush, nullptr, sizeof(&waiter), UtcNow());
+   if (pout == nullptr)
+      return;
+   CountDownLatch* pwaiter = &waiter;
+   memcpy(pout, &pwaiter, sizeof(pwaiter));
+   ring->CommitEntry();
+   LogDeferredMgr_->Cond_.notify_one();
+   waiter.Wait();
+}
+
+//--------------------------------------------------------------------------//
+
+static void AddLogHeader(RevBufferList& rbuf, StrView thrid, TimeStamp utctm, LogLevel level) {
+   RevPrint(rbuf, thrid, GetLevelStr(level));
+   RevPut_Date_Time_us(rbuf, utctm + LogTimeZoneAdjust_);
+}
+
+bool LogDeferredMgr::WriteNext(const std::vector<LogDeferredRing*>& rings) {
+   LogDeferredRing*  minRing = nullptr;
+   LogDeferredHead*  minHead = nullptr;
+   for (LogDeferredRing* ring : rings) {
+      LogDeferredRing::PkSizeT pksz;
+      if (LogDeferredHead* head = static_cast<LogDeferredHead*>(ring->Peek(1, pksz))) {
+         if (minHead == nullptr || head->UtcTime_ < minHead->UtcTime_) {
+            minRing = ring;
+            minHead = head;
+         }
+      }
+   }
+   if (minHead == nullptr)
+      return false;
+   byte* args = reinterpret_cast<byte*>(minHead) + kLogDeferredHeadSize;
+   switch (minHead->Kind_) {
+   case LogDeferredKind::Format:
+      {
+         RevBufferList rbuf{kLogBlockNodeSize};
+         RevPutChar(rbuf, '\n');
+         minHead->FnFormat_(rbuf, args);
+         AddLogHeader(rbuf, minRing->ThreadId_.GetThreadIdStr(), minHead->UtcTime_, minHead->Level_);
+         FnLogWriter_(LogArgs{minHead->Level_, minHead->UtcTime_}, rbuf.MoveOut());
+      }
+      break;
+   case LogDeferredKind::RevBuffer:
+      {
+         BufferList*    buf = reinterpret_cast<BufferList*>(args);
+         RevBufferList  rbuf{kLogBlockNodeSize, std::move(*buf)};
+         buf->~BufferList();
+         AddLogHeader(rbuf, minRing->ThreadId_.GetThreadIdStr(), minHead->UtcTime_, minHead->Level_);
+         FnLogWriter_(LogArgs{minHead->Level_, minHead->UtcTime_}, rbuf.MoveOut());
+      }
+      break;
+   case LogDeferredKind::Raw:
+      {
+         BufferList* buf = reinterpret_cast<BufferList*>(args);
+         FnLogWriter_(LogArgs{minHead->Level_, minHead->UtcTime_}, std::move(*buf));
+         buf->~BufferList();
+      }
+      break;
+   case LogDeferredKind::Flush:
+      {
+         CountDownLatch* waiter;
+         memcpy(&waiter, args, sizeof(waiter));
+         waiter->CountDown();
+      }
+      break;
+   }
+   minRing->Consume(1);
+   return true;
+}
+void LogDeferredMgr::RemoveEndedRings() {
+   for (size_t idx = this->Rings_.size(); idx > 0;) {
+      LogDeferredRing* ring = this->Rings_[--idx];
+      if (ring->IsThreadEnded_.load(std::memory_order_acquire) && ring->IsEmpty()) {
+         this->Rings_.erase(this->Rings_.begin() + static_cast<std::ptrdiff_t>(idx));
+         delete ring;
+         this->IsRingsChanged_.store(true, std::memory_order_release);
+      }
+   }
+}
+bool LogDeferredMgr::IsAllRingsIdle() const {
+   // 先確定沒有正在放入的 log, 再檢查 ring 是否已清空:
+   // IsProducing_ 在 Commit() 之後才清除, 所以看到 IsProducing_ == false 時, 必定能看到已放入的 log.
+   for (LogDeferredRing* ring : this->Rings_) {
+      if (ring->IsProducing_.load(std::memory_order_acquire))
+         return false;
+   }
+   for (LogDeferredRing* ring : this->Rings_) {
+      if (!ring->IsEmpty())
+         return false;
+   }
+   return true;
+}
+void LogDeferredMgr::Run() {
+   TlsIsLogDeferredConsumer_ = true;
+   std::vector<LogDeferredRing*> rings;
+   for (;;) {
+      if (this->IsRingsChanged_.exchange(false, std::memory_order_acq_rel)) {
+         std::lock_guard<std::mutex> lk{this->Mutex_};
+         rings = this->Rings_;
+      }
+      if (WriteNext(rings))
+         continue;
+      std::unique_lock<std::mutex> lk{this->Mutex_};
+      this->RemoveEndedRings();
+      if (!this->IsRunning_) {
+         // 結束前: 等候停止前已通過 IsLogDeferred_ 檢查的 thread, 把 log 放入 ring, 並全部輸出.
+         if (this->IsAllRingsIdle())
+            break;
+         rings = this->Rings_;
+         lk.unlock();
+         std::this_thread::yield();
+         continue;
+      }
+      this->Cond_.wait_for(lk, this->Args_.IdleWait_.ToDuration());
+   }
+   TlsIsLogDeferredConsumer_ = false;
+}
+LogDeferredMgr::~LogDeferredMgr() {
+   StopLogDeferred();
+   // 尚未結束的 thread, 可能仍會使用其 ring, 所以只刪除已結束的 ring.
+   std::lock_guard<std::mutex> lk{this->Mutex_};
+   this->RemoveEndedRings();
+   LogDeferredMgr_ = nullptr;
+}
+
+fon9_API void StartLogDeferred(const LogDeferredArgs& args) {
+   LogDeferredMgr&               mgr = GetLogDeferredMgr();
+   std::lock_guard<std::mutex>   lk{mgr.Mutex_};
+   mgr.Args_ = args;
+   if (mgr.IsRunning_)
+      return;
+   mgr.IsRunning_ = true;
+   mgr.IsRingsChanged_.store(true, std::memory_order_release);
+   mgr.Thread_ = std::thread(&LogDeferredMgr::Run, &mgr);
+   IsLogDeferred_.store(true, std::memory_order_release);
+}
+fon9_API void StopLogDeferred() {
+   LogDeferredMgr* mgr = LogDeferredMgr_;
+   if (mgr == nullptr)
+      return;
+   {
+      std::lock_guard<std::mutex> lk{mgr->Mutex_};
+      if (!mgr->IsRunning_)
+         return;
+      IsLogDeferred_.store(false, std::memory_order_seq_cst);
+      mgr->IsRunning_ = false;
+   }
+   mgr->Cond_.notify_one();
+   mgr->Thread_.join();
+}
+fon9_API bool IsLogDeferred() {
+   return IsLogDeferred_.load(std::memory_order_relaxed);
+}
+
+//--------------------------------------------------------------------------//
+
 fon9_API void LogWrite(const LogArgs& logArgs, BufferList&& buf) {
+   if (fon9_UNLIKELY(LogDeferredPushBuffer(LogDeferredKind::Raw, logArgs, buf)))
+      return;
    FnLogWriter_(logArgs, std::move(buf));
 }
 
 fon9_API void AddLogHeader(RevBufferList& rbuf, TimeStamp utctm, LogLevel level) {
-   RevPrint(rbuf, ThisThread_.GetThreadIdStr(), GetLevelStr(level));
-   RevPut_Date_Time_us(rbuf, utctm + LogTimeZoneAdjust_);
+   AddLogHeader(rbuf, ThisThread_.GetThreadIdStr(), utctm, level);
 }
 fon9_API void LogWrite(LogLevel level, RevBufferList&& rbuf) {
    LogArgs logArgs{level};
+   if (fon9_UNLIKELY(IsLogDeferred_.load(std::memory_order_relaxed))) {
+      BufferList buf{rbuf.MoveOut()};
+      if (LogDeferredPushBuffer(LogDeferredKind::RevBuffer, logArgs, buf))
+         return;
+      rbuf = RevBufferList{kLogBlockNodeSize, std::move(buf)};
+   }
    AddLogHeader(rbuf, logArgs.UtcTime_, level);
    FnLogWriter_(logArgs, rbuf.MoveOut());
 }
 
 fon9_API void WaitLogFlush() {
+   LogDeferredFlush();
    if (FnLogFlusher_)
       FnLogFlusher_();
    else {
@@ -92,6 +92,199 @@ fon9_API void WaitLogFlush();
 enum {
    kLogBlockNodeSize = 128 + sizeof(fon9::NumOutBuf),
 };
+
+//--------------------------------------------------------------------------//
+
+/// \ingroup Misc
+/// 延遲格式化(deferred format) log 的設定.
+struct LogDeferredArgs {
+   /// 每個 thread 各自擁有的 ring buffer 大小.
+   size_t         RingSize_;
+   /// 背景輸出 thread 沒有 log 可處理時, 每次等候的時間.
+   TimeInterval   IdleWait_;
+   LogDeferredArgs(size_t ringSize = 1024 * 1024, TimeInterval idleWait = TimeInterval_Millisecond(1))
+      : RingSize_{ringSize}, IdleWait_{idleWait} {
+   }
+};
+
+/// \ingroup Misc
+/// 啟用延遲格式化 log:
+/// - fon9_LOG_*() 若參數都可延遲格式化(數字、enum、Decimal、TimeStamp、TimeInterval、字串),
+///   則只把「格式化函式 + 參數原始內容」放入「呼叫端 thread 專屬的 ring buffer」,
+///   由背景 thread 依時間順序合併各 ring, 格式化成文字之後再交給 FnLogWriter.
+/// - 其他無法延遲的參數(例如: 帶有 FmtDef), 仍在呼叫端格式化, 同樣經由 ring 依序輸出.
+/// - 輸出的格式與原本相同: `YYYYMMDD-HHMMSS.uuuuuu thrid[LEVEL]...\n`
+/// - 背景 thread 格式化時使用的是該 thread 的 NumPunct_Current, 而非呼叫端的設定.
+/// - 若已啟用, 則僅更新設定: 已建立的 ring 不會改變大小, 之後新建立的 ring 才會使用新的 args.RingSize_.
+fon9_API void StartLogDeferred(const LogDeferredArgs& args = LogDeferredArgs{});
+/// \ingroup Misc
+/// 等候已放入 ring 的 log 輸出完畢後, 結束背景 thread, 恢復成「在呼叫端格式化」的方式.
+/// - 停止前已開始放入 ring 的 log(包含 WaitLogFlush()), 背景 thread 會等候放入完畢並輸出後才結束.
+/// - 不可與 StartLogDeferred() 同時呼叫.
+fon9_API void StopLogDeferred();
+/// \ingroup Misc
+/// 是否已啟用延遲格式化 log.
+fon9_API bool IsLogDeferred();
+
+/// 延遲格式化函式: 從 args 取出參數並 RevPrint() 到 rbuf, 傳回參數的尾端.
+typedef const byte* (*FnLogDeferredFormat)(RevBufferList& rbuf, const byte* args);
+/// 在呼叫端 thread 的 ring 分配一筆延遲格式化的 log, 傳回參數的存放位置.
+/// - 若未啟用延遲格式化, 或 argsz 太大, 或在背景輸出 thread 裡面呼叫, 則傳回 nullptr.
+/// - 填妥參數後, 必須呼叫 LogDeferredCommit();
+fon9_API byte* LogDeferredAlloc(LogLevel level, FnLogDeferredFormat fnFormat, size_t argsz);
+fon9_API void LogDeferredCommit();
+
+namespace impl {
+/// 不支援延遲格式化的參數型別.
+template <class T, class Enable = void>
+struct LogDeferredArgImpl {
+   enum : bool { kIsDeferrable = false };
+};
+/// 直接複製數值的參數, 格式化時再 RevPrint(value);
+template <class T>
+struct LogDeferredArgValue {
+   enum : bool { kIsDeferrable = true };
+   static size_t Size(const T&) {
+      return sizeof(T);
+   }
+   static byte* Put(byte* pout, const T& value) {
+      memcpy(pout, &value, sizeof(T));
+      return pout + sizeof(T);
+   }
+   static const byte* Print(RevBufferList& rbuf, const byte* pin) {
+      T value;
+      memcpy(&value, pin, sizeof(T));
+      RevPrint(rbuf, value);
+      return pin + sizeof(T);
+   }
+};
+template <class T>
+struct LogDeferredArgImpl<T, enable_if_t<std::is_arithmetic<T>::value || std::is_enum<T>::value>>
+   : public LogDeferredArgValue<T> {
+};
+template <class IntTypeT, DecScaleT ScaleN>
+struct LogDeferredArgImpl<Decimal<IntTypeT, ScaleN>> : public LogDeferredArgValue<Decimal<IntTypeT, ScaleN>> {
+};
+template <> struct LogDeferredArgImpl<TimeStamp> : public LogDeferredArgValue<TimeStamp> {};
+template <> struct LogDeferredArgImpl<TimeInterval> : public LogDeferredArgValue<TimeInterval> {};
+
+/// 字串參數: 複製 [長度 + 字串內容], 格式化時再 RevPrint(StrView);
+struct LogDeferredArgStr {
+   enum : bool { kIsDeferrable = true };
+   static size_t Size(StrView str) {
+      return sizeof(size_t) + str.size();
+   }
+   static byte* Put(byte* pout, StrView str) {
+      const size_t sz = str.size();
+      memcpy(pout, &sz, sizeof(sz));
+      if (sz)
+         memcpy(pout + sizeof(sz), str.begin(), sz);
+      return pout + sizeof(sz) + sz;
+   }
+   static const byte* Print(RevBufferList& rbuf, const byte* pin) {
+      size_t sz;
+      memcpy(&sz, pin, sizeof(sz));
+      pin += sizeof(sz);
+      RevPutMem(rbuf, pin, sz);
+      return pin + sz;
+   }
+};
+template <> struct LogDeferredArgImpl<StrView> : public LogDeferredArgStr {};
+template <> struct LogDeferredArgImpl<const char*> : public LogDeferredArgStr {
+   static size_t Size(const char* str) { return LogDeferredArgStr::Size(ToStrView(str)); }
+   static byte* Put(byte* pout, const char* str) { return LogDeferredArgStr::Put(pout, ToStrView(str)); }
+};
+template <> struct LogDeferredArgImpl<char*> : public LogDeferredArgImpl<const char*> {};
+template <> struct LogDeferredArgImpl<std::string> : public LogDeferredArgStr {
+   static size_t Size(const std::string& str) { return LogDeferredArgStr::Size(ToStrView(str)); }
+   static byte* Put(byte* pout, const std::string& str) { return LogDeferredArgStr::Put(pout, ToStrView(str)); }
+};
+
+/// T = 移除 reference 之後的參數型別, 字元陣列需要區分 const 與否:
+/// - const char[N]: 與 RevPrint() 相同, 若最後字元為 EOS 則不含 EOS.
+/// - char[N]: 與 RevPrint() 相同, 使用 StrView_eos_or_all();
+template <class T>
+struct LogDeferredArg : public LogDeferredArgImpl<typename std::remove_cv<T>::type> {
+};
+template <size_t arysz>
+struct LogDeferredArg<const char[arysz]> : public LogDeferredArgStr {
+   static size_t Size(const char (&chary)[arysz]) { return LogDeferredArgStr::Size(ToStr(chary)); }
+   static byte* Put(byte* pout, const char (&chary)[arysz]) { return LogDeferredArgStr::Put(pout, ToStr(chary)); }
+   static StrView ToStr(const char (&chary)[arysz]) {
+      return StrView{chary, arysz - (chary[arysz - 1] == 0)};
+   }
+};
+template <size_t arysz>
+struct LogDeferredArg<char[arysz]> : public LogDeferredArgStr {
+   static size_t Size(const char (&cstr)[arysz]) { return LogDeferredArgStr::Size(StrView_eos_or_all(cstr)); }
+   static byte* Put(byte* pout, const char (&cstr)[arysz]) { return LogDeferredArgStr::Put(pout, StrView_eos_or_all(cstr)); }
+};
+
+/// 參數依照「反向」順序存放: 格式化時可依序取出並 RevPrint(), 結果與 RevPrint(rbuf, args...) 相同.
+template <class... ArgsT>
+struct LogDeferredCodec {
+   enum : bool { kIsDeferrable = true };
+   static size_t Size() { return 0; }
+   static byte* Put(byte* pout) { return pout; }
+   static const byte* Print(RevBufferList&, const byte* pin) { return pin; }
+};
+template <class A0, class... AN>
+struct LogDeferredCodec<A0, AN...> {
+   using Arg0 = LogDeferredArg<A0>;
+   using Rest = LogDeferredCodec<AN...>;
+   enum : bool { kIsDeferrable = Arg0::kIsDeferrable && Rest::kIsDeferrable };
+
+   template <class T0, class... TN>
+   static size_t Size(const T0& a0, const TN&... an) {
+      return Arg0::Size(a0) + Rest::Size(an...);
+   }
+   template <class T0, class... TN>
+   static byte* Put(byte* pout, const T0& a0, const TN&... an) {
+      return Arg0::Put(Rest::Put(pout, an...), a0);
+   }
+   static const byte* Print(RevBufferList& rbuf, const byte* pin) {
+      return Arg0::Print(rbuf, Rest::Print(rbuf, pin));
+   }
+};
+template <class... ArgsT>
+using LogDeferredCodecT = LogDeferredCodec<typename std::remove_reference<ArgsT>::type...>;
+} // namespace impl
+
+/// \ingroup Misc
+/// 若 args 無法延遲格式化, 則傳回 false.
+template <class... ArgsT>
+inline auto LogDeferredWrite(LogLevel, const typename std::remove_reference<ArgsT>::type&...)
+-> enable_if_t<!impl::LogDeferredCodecT<ArgsT...>::kIsDeferrable, bool> {
+   return false;
+}
+/// \ingroup Misc
+/// 把 args 放入呼叫端 thread 的 ring, 由背景 thread 格式化後輸出.
+/// 傳回 false 表示: 未啟用延遲格式化, 或無法放入 ring, 此時應由呼叫端自行格式化輸出.
+template <class... ArgsT>
+inline auto LogDeferredWrite(LogLevel level, const typename std::remove_reference<ArgsT>::type&... args)
+-> enable_if_t<impl::LogDeferredCodecT<ArgsT...>::kIsDeferrable, bool> {
+   using Codec = impl::LogDeferredCodecT<ArgsT...>;
+   byte* pout = LogDeferredAlloc(level, &Codec::Print, Codec::Size(args...));
+   if (fon9_LIKELY(pout == nullptr))
+      return false;
+   Codec::Put(pout, args...);
+   LogDeferredCommit();
+   return true;
+}
+
+/// \ingroup Misc
+/// fon9_LOG() 使用: 若可以延遲格式化, 則放入 ring; 否則立即格式化後 LogWrite();
+template <class... ArgsT>
+inline void LogPrint(LogLevel level, ArgsT&&... args) {
+   if (LogDeferredWrite<ArgsT...>(level, args...))
+      return;
+   RevBufferList rbuf_{kLogBlockNodeSize};
+   RevPutChar(rbuf_, '\n');
+   RevPrint(rbuf_, std::forward<ArgsT>(args)...);
+   LogWrite(level, std::move(rbuf_));
+}
+
+//--------------------------------------------------------------------------//
 /// \ingroup Misc
 /// 根據Log等級(level), 寫入 Log.
 /// 記錄的格式: `YYYYMMDD-HHMMSS.uuuuuu thrid[LEVEL]...\n`
@@ -101,13 +294,10 @@ enum {
 ///   - 範例:
 ///      - fon9_LOG_ERROR("TimedFile.OpenNewFile|FileName=", newFile.GetOpenName(), "|OpenMode=", newFile.GetOpenMode(), "|err=", res);
 ///      - fon9_LOG_INFO("DllMgr.LoadConfig|seedName=", this->Name_, "|cfgFileName=", cfgFileName);
+/// - 若有啟用 StartLogDeferred(); 則參數可能會延遲到背景 thread 才格式化.
 #define fon9_LOG(level, ...) do {                           \
-   if (fon9_UNLIKELY(level >= fon9::LogLevel_)) {           \
-      fon9::RevBufferList rbuf_{fon9::kLogBlockNodeSize};   \
-      fon9::RevPutChar(rbuf_, '\n');                        \
-      fon9::RevPrint(rbuf_, __VA_ARGS__);                   \
-      fon9::LogWrite(level, std::move(rbuf_));              \
-   }                                                        \
+   if (fon9_UNLIKELY(level >= fon9::LogLevel_))             \
+      fon9::LogPrint(level, __VA_ARGS__);                   \
 } while(0)
 
 #ifdef fon9_NOLOG_TRACE
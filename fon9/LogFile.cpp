@@ -156,8 +156,11 @@ fon9_API File::Result InitLogWriteToFile(std::string fmtFileName,
 }
 
 fon9_API bool WaitLogFileFlushed() {
-   if (LogFileImpl::gLogFile)
+   if (LogFileImpl::gLogFile) {
+      if (IsLogDeferred()) // 先等候尚未格式化的 log 交給 FnLogWriter.
+         WaitLogFlush();
       return LogFileImpl::gLogFile->WaitFlushed();
+   }
    return false;
 }
 
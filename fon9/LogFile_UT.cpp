@@ -7,8 +7,11 @@
 #include "fon9/RevFormat.hpp"
 #include "fon9/ThreadId.hpp"
 #include "fon9/ThreadTools.hpp"
+#include "fon9/Tools.hpp"
 #include <vector>
 #include <numeric>
+#include <mutex>
+#include <atomic>
 
 unsigned gNumberOfThreads{0};
 
@@ -193,6 +196,157 @@ void TestThreadsWriteLatency() {
 
 //--------------------------------------------------------------------------//
 
+static std::vector<std::string>  gCapturedLogs;
+static std::mutex                gCapturedLogsMutex;
+static void CaptureLogWriter(const fon9::LogArgs&, fon9::BufferList&& buf) {
+   using Result = fon9::File::Result;
+   std::string str;
+   fon9::DeviceOutputBlock(fon9::DcQueueList{std::move(buf)}, [&str](const void* mem, size_t sz)->Result {
+      str.append(static_cast<const char*>(mem), sz);
+      return Result{sz};
+   });
+   // StopLogDeferred() 期間, 背景 thread 與呼叫端可能同時輸出.
+   std::lock_guard<std::mutex> lk{gCapturedLogsMutex};
+   if (!str.empty()) // WaitLogFlush() 的 BufferNodeWaiter 沒有內容.
+      gCapturedLogs.push_back(str.substr(sizeof("YYYYMMDD-HHMMSS.uuuuuu") - 1)); // 移除時間後比對.
+}
+static void LogDeferredSamples() {
+   char        chary[16] = "chary";
+   std::string str{"std::string"};
+   const char* cstr = "cstr";
+   const char* cnull = nullptr;
+   fon9_LOG_INFO("Values|i=", -123, "|u=", 456u, "|ch=", 'K', "|b=", true, "|d=", 1.5,
+                 "|dec=", fon9::Decimal<int64_t, 6>(-42.42));
+   fon9_LOG_WARN("Strings|", chary, '|', str, '|', cstr, '|', fon9::StrView{"StrView"}, "|null=", cnull, '|');
+   fon9_LOG_ERROR("Times|ts=", fon9::TimeStamp{fon9::TimeStamp::Make<3>(1234567890123)},
+                  "|ti=", fon9::TimeInterval_Millisecond(1234), "|enum=", fon9::HowWait::Busy);
+   // 無法延遲格式化的參數: 在呼叫端格式化, 但仍需維持順序.
+   fon9_LOG_INFO(fon9::Fmt{"NotDeferred|{0}|{1:x}"}, 123, 0x456u);
+   fon9::RevBufferList rbuf{fon9::kLogBlockNodeSize};
+   fon9::RevPrint(rbuf, "RevBuffer|", 789, '\n');
+   fon9::LogWrite(fon9::LogLevel::Important, std::move(rbuf));
+   // 超過 ring 容量的 log.
+   fon9_LOG_INFO("Long|", std::string(5000, 'x'));
+   fon9_LOG_FATAL("Last");
+}
+static void TestLogDeferredImpl() {
+   const auto  origLevel = fon9::LogLevel_;
+   fon9::LogLevel_ = fon9::LogLevel::Trace;
+   fon9::SetLogWriter(&CaptureLogWriter, fon9::TimeZoneOffset{});
+
+   LogDeferredSamples();
+   std::vector<std::string> immLogs;
+   immLogs.swap(gCapturedLogs);
+
+   // 使用最小的 ring, 讓 ring 滿的情況也能被測試到.
+   fon9::StartLogDeferred(fon9::LogDeferredArgs{4096});
+   LogDeferredSamples();
+   fon9::WaitLogFlush();
+   // 僅比對 this_thread 的 log, 背景的 thread(例: TimerThread) 可能也會寫 log.
+   const std::string thrid = fon9::GetThisThreadId().GetThreadIdStr().ToString() + "[";
+   gCapturedLogs.erase(std::remove_if(gCapturedLogs.begin(), gCapturedLogs.end(), [&thrid](const std::string& ln) {
+      return ln.compare(0, thrid.size(), thrid) != 0;
+   }), gCapturedLogs.end());
+   std::cout << "[TEST ] LogDeferred.Format";
+   if (immLogs != gCapturedLogs) {
+      std::cout << "|err=output not match." << std::endl;
+      for (size_t L = 0; L < std::max(immLogs.size(), gCapturedLogs.size()); ++L)
+         std::cout << "imm: " << (L < immLogs.size() ? immLogs[L] : std::string{"\n"})
+                   << "def: " << (L < gCapturedLogs.size() ? gCapturedLogs[L] : std::string{"\n"});
+      std::cout << std::endl;
+      abort();
+   }
+   std::cout << "\r[OK   ]" << std::endl;
+
+   // 多個 thread 同時寫入: 每個 thread 的 log 必須依序輸出, 且不可遺漏.
+   std::cout << "[TEST ] LogDeferred.Threads";
+   gCapturedLogs.clear();
+   const unsigned kThreadCount = 4;
+   const unsigned kTimes = 10000;
+   std::vector<std::thread> thrs;
+   for (unsigned thrIdx = 0; thrIdx < kThreadCount; ++thrIdx) {
+      thrs.emplace_back([thrIdx]() {
+         for (unsigned L = 0; L < kTimes; ++L)
+            fon9_LOG_INFO("|", thrIdx, "|", L);
+      });
+   }
+   fon9::JoinThreads(thrs);
+   fon9::WaitLogFlush();
+   std::vector<unsigned> nextSeq(kThreadCount, 0);
+   size_t count = 0;
+   for (const std::string& ln : gCapturedLogs) {
+      fon9::StrView  rd{&ln};
+      if (fon9::StrFetchNoTrim(rd, '|').end() != ln.c_str() + ln.find("]|") + 1)
+         continue; // 不是此處測試的 log.
+      ++count;
+      unsigned thrIdx = fon9::StrTo(fon9::StrFetchNoTrim(rd, '|'), 0u);
+      unsigned seq = fon9::StrTo(rd, 0u);
+      if (thrIdx >= kThreadCount || nextSeq[thrIdx] != seq) {
+         std::cout << "|err=out of order|log=" << ln << std::endl;
+         abort();
+      }
+      ++nextSeq[thrIdx];
+   }
+   if (count != kThreadCount * kTimes) {
+      std::cout << "|err=lost|count=" << count << std::endl;
+      abort();
+   }
+   std::cout << "\r[OK   ]" << std::endl;
+
+   // 在多個 thread 寫入期間 StopLogDeferred(): 不可遺漏, 且 WaitLogFlush() 不可永久等候.
+   std::cout << "[TEST ] LogDeferred.StopWhileLogging";
+   gCapturedLogs.clear();
+   thrs.clear();
+   std::atomic<unsigned> startedCount{0};
+   for (unsigned thrIdx = 0; thrIdx < kThreadCount; ++thrIdx) {
+      thrs.emplace_back([thrIdx, &startedCount]() {
+         for (unsigned L = 0; L < kTimes; ++L) {
+            fon9_LOG_INFO("|", thrIdx, "|", L);
+            if (L == 100)
+               ++startedCount;
+            if (thrIdx == 0 && L % 1000 == 0)
+               fon9::WaitLogFlush();
+         }
+      });
+   }
+   while (startedCount < kThreadCount)
+      std::this_thread::yield();
+   fon9::StopLogDeferred();
+   fon9::JoinThreads(thrs);
+   fon9::WaitLogFlush();
+   std::vector<std::vector<bool>> received(kThreadCount, std::vector<bool>(kTimes, false));
+   count = 0;
+   for (const std::string& ln : gCapturedLogs) {
+      fon9::StrView  rd{&ln};
+      if (fon9::StrFetchNoTrim(rd, '|').end() != ln.c_str() + ln.find("]|") + 1)
+         continue;
+      unsigned thrIdx = fon9::StrTo(fon9::StrFetchNoTrim(rd, '|'), 0u);
+      unsigned seq = fon9::StrTo(rd, 0u);
+      if (thrIdx >= kThreadCount || seq >= kTimes || received[thrIdx][seq]) {
+         std::cout << "|err=unexpected|log=" << ln << std::endl;
+         abort();
+      }
+      received[thrIdx][seq] = true;
+      ++count;
+   }
+   if (count != kThreadCount * kTimes) {
+      std::cout << "|err=lost|count=" << count << std::endl;
+      abort();
+   }
+   std::cout << "\r[OK   ]" << std::endl;
+
+   fon9::UnsetLogWriter(&CaptureLogWriter);
+   gCapturedLogs.clear();
+   fon9::LogLevel_ = origLevel;
+}
+static void TestLogDeferred() {
+   // 在另一個 thread 測試: 測試用的小 ring 會在 thread 結束後釋放, 不影響之後 main thread 的 benchmark.
+   std::thread thr{&TestLogDeferredImpl};
+   thr.join();
+}
+
+//--------------------------------------------------------------------------//
+
 int main(int argc, char** argv) {
 #if defined(_MSC_VER) && defined(_DEBUG)
    _CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
@@ -203,10 +357,12 @@ int main(int argc, char** argv) {
       if ((gNumberOfThreads = std::thread::hardware_concurrency()) <= 0)
          gNumberOfThreads = 4;
    }
-   if (argc >= 3 && strcmp(argv[2], "lat")==0) {
+   if (argc >= 3 && (strcmp(argv[2], "lat") == 0 || strcmp(argv[2], "dlat") == 0)) {
       const char* latlog = "./logs/fon9-latency.log";
       remove(latlog);
       fon9::InitLogWriteToFile(latlog, fon9::TimeChecker::TimeScale::No, 0, 0);
+      if (argv[2][0] == 'd')
+         fon9::StartLogDeferred();
       auto fon9BenchmarkFn = [](unsigned i, char const * const cstr) {
          fon9_LOG_INFO("Logging ", cstr, i, 0, 'K', fon9::Decimal<int64_t, 6>(-42.42));
       };
@@ -215,6 +371,9 @@ int main(int argc, char** argv) {
    }
 
    fon9::AutoPrintTestInfo utinfo{"LogFile"};
+   TestLogDeferred();
+   utinfo.PrintSplitter();
+
    auto res = fon9::InitLogWriteToFile("./logs/Scale_Second_{0:f-t+8}.{1:04}.log", fon9::TimeChecker::TimeScale::Second, 1024, 0);
 
    fon9::RevBufferFixedSize<1024> rbuf;
@@ -248,5 +407,16 @@ int main(int argc, char** argv) {
 
    utinfo.PrintSplitter();
    TestThreadsWriteLatency();
+
+   // 延遲格式化: 與上面相同的測試, 比較呼叫端的負擔.
+   utinfo.PrintSplitter();
+   fon9::StartLogDeferred();
+   fon9::SetLogWriter(&NopLogWriter, fon9::TimeZoneOffset{});
+   gLogBytes = 0;
+   LogBenchmark("deferred nop");
+   BenchLogToFile("./logs/bench-deferred.log");
+   utinfo.PrintSplitter();
+   TestThreadsWriteLatency();
+   fon9::StopLogDeferred();
    return 0;
 }
@@ -4,10 +4,12 @@
 #define __fon9_MessageQueue_hpp__
 #include "fon9/ThreadController.hpp"
 #include "fon9/ThreadTools.hpp"
+#include "fon9/MpscQueue.hpp"
 #include "fon9/Log.hpp"
 fon9_BEFORE_INCLUDE_STD;
 #include <deque>
 #include <vector>
+#include <atomic>
 fon9_AFTER_INCLUDE_STD;
 
 namespace fon9 {
@@ -207,5 +209,217 @@ public:
    }
 };
 
+//--------------------------------------------------------------------------//
+
+fon9_WARN_DISABLE_PADDING;
+/// \ingroup Thrs
+/// lock-free 的 multi-producer single-consumer 訊息佇列.
+/// - 使用方式與 MessageQueue 相同, 可依使用場合選擇:
+///   - 多個 producer, 但只需要 1 個 consumer thread 的情況, 使用 MessageQueueMpsc;
+///     加入訊息時不需要 lock, 只有在 consumer thread 正在等候時, 才需要喚醒(lock + notify).
+///   - 需要多個 consumer thread, 或需要在 lock 狀態下處理佇列, 則使用 MessageQueue.
+/// - 訊息存放在 MpscQueue, 節點會重複使用, 請參考 MpscQueue 的說明.
+/// - MessageHandlerT 必須提供:
+///   - `typename MessageHandlerT::MessageType;`
+///   - `MessageHandlerT::MessageHandlerT(MessageQueueMpsc&);`
+///   - 處理訊息, 底下函式二選一, 只能提供其中一種:
+///      - 一次一筆
+///         `void MessageHandlerT::OnMessage(MessageType&);`
+///      - 一次一批, 用完後會自動清除 container.
+///         `void MessageHandlerT::OnMessage(MessageContainerT& container);`
+///   - 因為沒有 lock, 所以不支援 `OnMessage(Locker&)` 及 `OnAfterWakeup(Locker&)`.
+///   - `void MessageHandlerT::OnThreadEnd(const std::string& thrName);`
+/// - WaitPolicyT: consumer thread 沒有訊息時的等候方式, 例: WaitPolicy_CV.
+template <
+   class MessageHandlerT,
+   class MessageT = typename MessageHandlerT::MessageType,
+   class MessageContainerT = std::vector<MessageT>,
+   class WaitPolicyT = WaitPolicy_CV
+>
+class MessageQueueMpsc {
+   fon9_NON_COPY_NON_MOVE(MessageQueueMpsc);
+   using WaitMutex = typename WaitPolicyT::Mutex;
+   using WaitLocker = typename WaitPolicyT::Locker;
+
+   MpscQueue<MessageT>                 Queue_;
+   std::atomic<ThreadState>            State_{ThreadState::Idle};
+   /// 正在 EmplaceMessage() 的 producer 數量, 請參考 WaitProducersDone();
+   std::atomic<unsigned>               PushingCount_{0};
+   /// consumer thread 是否已進入(或準備進入)等候狀態.
+   std::atomic<bool>                   IsSleeping_{false};
+   WaitMutex                           WaitMutex_;
+   WaitPolicyT                         WaitPolicy_;
+   std::thread                         Thread_;
+
+   template <class MessageHandler>
+   auto OnMessage(MessageHandler& messageHandler, MessageContainerT*)
+      -> decltype(messageHandler.OnMessage(std::declval<MessageT&>()), bool()) {
+      return this->Queue_.PopFront([&messageHandler](MessageT& msg) {
+         messageHandler.OnMessage(msg);
+      });
+   }
+   template <class MessageHandler>
+   auto OnMessage(MessageHandler& messageHandler, MessageContainerT* msgs)
+      -> decltype(messageHandler.OnMessage(*msgs), bool()) {
+      // 一次取出目前可取得的訊息, 整批交給 messageHandler.
+      const auto fnMoveTo = [msgs](MessageT& msg) {
+         msgs->emplace_back(std::move(msg));
+      };
+      if (!this->Queue_.PopFront(fnMoveTo))
+         return false;
+      while (this->Queue_.PopFront(fnMoveTo)) {
+      }
+      messageHandler.OnMessage(*msgs);
+      msgs->clear();
+      return true;
+   }
+   /// \retval true  佇列已空.
+   /// \retval false 收到 EndNow 通知.
+   bool DoMessages(MessageHandlerT& messageHandler, MessageContainerT& msgs) {
+      while (this->State_.load(std::memory_order_acquire) != ThreadState::EndNow) {
+         if (!this->OnMessage(messageHandler, &msgs))
+            return true;
+      }
+      return false;
+   }
+   /// 等候「在 State_ 改變之前已通過檢查」的 producer 完成加入.
+   /// 之後不會再有新加入的訊息: 新的 producer 必定會看到 State_ > ThreadState::ExecutingOrWaiting.
+   void WaitProducersDone() {
+      while (this->PushingCount_.load(std::memory_order_seq_cst) != 0)
+         std::this_thread::yield();
+   }
+   void Wait() {
+      this->IsSleeping_.store(true, std::memory_order_seq_cst);
+      if (!this->Queue_.IsEmpty() || this->State_.load(std::memory_order_seq_cst) > ThreadState::ExecutingOrWaiting) {
+         this->IsSleeping_.store(false, std::memory_order_relaxed);
+         return;
+      }
+      WaitLocker locker{this->WaitMutex_};
+      while (this->IsSleeping_.load(std::memory_order_acquire))
+         this->WaitPolicy_.Wait(locker);
+   }
+   void Wakeup() {
+      if (this->IsSleeping_.load(std::memory_order_seq_cst)
+          && this->IsSleeping_.exchange(false, std::memory_order_acq_rel)) {
+         WaitLocker locker{this->WaitMutex_};
+         this->WaitPolicy_.NotifyOne(locker);
+      }
+   }
+
+   static void ThrRun(std::string thrName, MessageQueueMpsc* pthis) {
+      SetCurrentThreadName(thrName.c_str());
+      fon9_LOG_ThrRun("MessageQueueMpsc.ThrRun|name=", thrName);
+      MessageHandlerT   messageHandler(*pthis);
+      MessageContainerT msgs;
+      while (pthis->DoMessages(messageHandler, msgs)) {
+         if (pthis->State_.load(std::memory_order_seq_cst) == ThreadState::EndAfterWorkDone) {
+            // 在 State_ 改變之前已通過檢查的 producer, 可能尚未完成加入:
+            // 等它們完成後, 若佇列仍有訊息, 則必須再處理一次, 否則這些訊息會留在佇列裡面.
+            pthis->WaitProducersDone();
+            if (pthis->Queue_.IsEmpty())
+               break;
+            continue;
+         }
+         pthis->Wait();
+      }
+      messageHandler.OnThreadEnd(thrName);
+      fon9_LOG_ThrRun("MessageQueueMpsc.ThrRun.End|name=", thrName);
+   }
+
+   void NotifyForEnd(ThreadState st) {
+      ThreadState curr = this->State_.load(std::memory_order_acquire);
+      while (curr < st) {
+         if (this->State_.compare_exchange_weak(curr, st, std::memory_order_seq_cst))
+            break;
+      }
+      this->IsSleeping_.store(false, std::memory_order_seq_cst);
+      WaitLocker locker{this->WaitMutex_};
+      this->WaitPolicy_.NotifyAll(locker);
+   }
+   void WaitThreadJoin() {
+      JoinThread(this->Thread_);
+      this->State_.store(ThreadState::Terminated, std::memory_order_release);
+   }
+
+public:
+   using MessageHandler = MessageHandlerT;
+   using MessageType = MessageT;
+   using MessageContainer = MessageContainerT;
+   using WaitPolicyType = WaitPolicyT;
+
+   MessageQueueMpsc() = default;
+   /// 若有剩餘未執行的訊息，將會被拋棄。
+   ~MessageQueueMpsc() {
+      this->WaitForEndNow();
+      this->WaitProducersDone();
+   }
+
+   /// 只會啟動 1 個 consumer thread.
+   void StartThread(StrView thrName) {
+      assert(this->State_.load() == ThreadState::Idle);
+      this->State_.store(ThreadState::ExecutingOrWaiting, std::memory_order_release);
+      this->Thread_ = std::thread(&ThrRun, thrName.ToString(), this);
+   }
+   size_t GetThreadCount() const {
+      return this->Thread_.joinable() ? 1u : 0u;
+   }
+
+   /// 通知結束，若有剩餘未執行的訊息，可透過 WaitForEndNow(remainMessageHandler) 處理。
+   void NotifyForEndNow() {
+      this->NotifyForEnd(ThreadState::EndNow);
+   }
+   /// 通知結束, 並在 thread 結束後, 透過 remainMessageHandler 處理剩餘訊息.
+   void WaitForEndNow(MessageHandlerT& remainMessageHandler) {
+      this->WaitForEndNow();
+      this->WaitProducersDone();
+      MessageContainerT msgs;
+      while (this->OnMessage(remainMessageHandler, &msgs)) {
+      }
+   }
+   /// 通知結束, 並在 thread 結束後返回, 但不處理剩餘訊息.
+   /// 可再呼叫 `WaitForEndNow(MessageHandlerT& remainMessageHandler);` 處理剩餘訊息.
+   void WaitForEndNow() {
+      this->NotifyForEnd(ThreadState::EndNow);
+      this->WaitThreadJoin();
+   }
+
+   /// 通知訊息處理完畢後結束 thread.
+   void NotifyForEndAfterWorkDone() {
+      this->NotifyForEnd(ThreadState::EndAfterWorkDone);
+   }
+   /// 等候 thread 處理完訊息後, 結束 thread.
+   void WaitForEndAfterWorkDone() {
+      this->NotifyForEnd(ThreadState::EndAfterWorkDone);
+      this->WaitThreadJoin();
+   }
+
+   /// 傳回 <= ThreadState::ExecutingOrWaiting 表示有加入 MessageQueueMpsc.
+   /// 可在任意 thread 呼叫, 不需要 lock; 只有在 consumer thread 等候中時, 才需要喚醒.
+   template <class... ArgsT>
+   ThreadState EmplaceMessage(ArgsT&&... args) {
+      // 先增加 PushingCount_ 再檢查 State_, 與結束時的順序相反(都使用 seq_cst):
+      // consumer 在 State_ 改變後看到 PushingCount_ == 0, 就表示已通過檢查的訊息都已加入佇列.
+      struct PushingGuard {
+         std::atomic<unsigned>& Count_;
+         ~PushingGuard() {
+            this->Count_.fetch_sub(1, std::memory_order_release);
+         }
+      };
+      this->PushingCount_.fetch_add(1, std::memory_order_seq_cst);
+      PushingGuard guard{this->PushingCount_};
+      const ThreadState st = this->State_.load(std::memory_order_seq_cst);
+      if (st <= ThreadState::ExecutingOrWaiting) {
+         this->Queue_.Emplace(std::forward<ArgsT>(args)...);
+         this->Wakeup();
+      }
+      return st;
+   }
+
+   ThreadState GetThreadState() const {
+      return this->State_.load(std::memory_order_acquire);
+   }
+};
+fon9_WARN_POP;
+
 } // namespace
 #endif//__fon9_MessageQueue_hpp__
@@ -0,0 +1,205 @@
+﻿/// \file fon9/MpscQueue.hpp
+/// \author fonwinz@gmail.com
+#ifndef __fon9_MpscQueue_hpp__
+#define __fon9_MpscQueue_hpp__
+#include "fon9/sys/Config.hpp"
+
+fon9_BEFORE_INCLUDE_STD
+#include <atomic>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <cassert>
+fon9_AFTER_INCLUDE_STD
+
+namespace fon9 {
+
+fon9_WARN_DISABLE_PADDING;
+/// \ingroup Thrs
+/// lock-free 的 multi-producer single-consumer 佇列, 不包含 thread 及等候機制.
+/// - Emplace() 可在任意 thread 呼叫, 不需要 lock.
+/// - PopFront(), IsEmpty() 只能在 consumer thread 呼叫, 同一時間只能有一個 consumer.
+/// - intrusive MPSC node based queue,
+///   原始來源 http://www.1024cores.net/home/lock-free-algorithms/queues/intrusive-mpsc-node-based-queue
+/// - 節點會重複使用, 不會每筆資料配置一次:
+///   - consumer 用完的節點, 先放在 consumer 自己的 FreeLocal_;
+///     當 FreeShared_ 為空時, 整串交給 FreeShared_.
+///   - producer 自己的節點用完時, 從 FreeShared_ 整串取走(exchange), 放在 thread_local 快取.
+///   - 整串交換, 不會有單一節點 pop 的 ABA 問題.
+///   - 同一種 T 的 MpscQueue 共用 thread_local 快取, 快取的節點在 thread 結束時釋放.
+template <class T>
+class MpscQueue {
+   fon9_NON_COPY_NON_MOVE(MpscQueue);
+   struct NodeBase {
+      std::atomic<NodeBase*>  Next_{nullptr};
+   };
+   struct Node : public NodeBase {
+      typename std::aligned_storage<sizeof(T), alignof(T)>::type ValueStorage_;
+      T& Value() {
+         return *reinterpret_cast<T*>(&this->ValueStorage_);
+      }
+   };
+   enum : unsigned {
+      /// consumer 保留的節點數量上限, 超過的部分直接釋放.
+      kMaxFreeLocal = 1024,
+   };
+
+   struct TlsCache {
+      NodeBase* Head_{nullptr};
+      ~TlsCache() {
+         FreeChain(this->Head_);
+      }
+   };
+   static TlsCache& GetTlsCache() {
+      static thread_local TlsCache cache;
+      return cache;
+   }
+   static void FreeChain(NodeBase* node) {
+      while (node) {
+         NodeBase* next = node->Next_.load(std::memory_order_relaxed);
+         delete static_cast<Node*>(node);
+         node = next;
+      }
+   }
+
+   // producers 共用的部分, 與 consumer 使用的 Head_ 分開, 避免 false sharing.
+   std::atomic<NodeBase*>  Back_;
+   char                    Padding1_[64];
+   NodeBase*               Head_;
+   NodeBase                Stub_;
+   NodeBase*               FreeLocal_{nullptr};
+   unsigned                FreeLocalCount_{0};
+   char                    Padding2_[64];
+   std::atomic<NodeBase*>  FreeShared_{nullptr};
+
+   Node* AllocNode() {
+      TlsCache& cache = GetTlsCache();
+      if (cache.Head_ == nullptr && this->FreeShared_.load(std::memory_order_relaxed) != nullptr)
+         cache.Head_ = this->FreeShared_.exchange(nullptr, std::memory_order_acquire);
+      if (NodeBase* node = cache.Head_) {
+         cache.Head_ = node->Next_.load(std::memory_order_relaxed);
+         return static_cast<Node*>(node);
+      }
+      return new Node;
+   }
+   /// 建構 T 失敗時, 將 node 放回 producer 的快取.
+   static void UnallocNode(Node* node) {
+      TlsCache& cache = GetTlsCache();
+      node->Next_.store(cache.Head_, std::memory_order_relaxed);
+      cache.Head_ = node;
+   }
+   /// 只能在 consumer thread 呼叫, node->Value() 必須已解構.
+   void RecycleNode(Node* node) {
+      if (this->FreeLocalCount_ >= kMaxFreeLocal) {
+         delete node;
+         return;
+      }
+      node->Next_.store(this->FreeLocal_, std::memory_order_relaxed);
+      this->FreeLocal_ = node;
+      ++this->FreeLocalCount_;
+      if (this->FreeShared_.load(std::memory_order_relaxed) == nullptr) {
+         // 只有 consumer 會從 nullptr 改成非 nullptr, 所以不會有 ABA 的問題.
+         NodeBase* expected = nullptr;
+         if (this->FreeShared_.compare_exchange_strong(expected, this->FreeLocal_,
+                                                       std::memory_order_release, std::memory_order_relaxed)) {
+            this->FreeLocal_ = nullptr;
+            this->FreeLocalCount_ = 0;
+         }
+      }
+   }
+
+   void PushNode(NodeBase* node) {
+      node->Next_.store(nullptr, std::memory_order_relaxed); // Stub_ 會重複放入, 所以必須清除.
+      // 此處的 exchange() 必須是 seq_cst, 讓使用者可以用 IsEmpty() 與其他 seq_cst 的旗標構成 Dekker 的檢查.
+      NodeBase* prev = this->Back_.exchange(node, std::memory_order_seq_cst);
+      // 在此之前, consumer 可能看到「尚未串接完成」的節點, 此時 PopNode() 會傳回 BusyNode().
+      prev->Next_.store(node, std::memory_order_release);
+   }
+   static NodeBase* BusyNode() {
+      return reinterpret_cast<NodeBase*>(static_cast<uintptr_t>(1));
+   }
+   /// \retval nullptr    佇列為空.
+   /// \retval BusyNode() 有 producer 正在加入, 稍後再試.
+   NodeBase* PopNode() {
+      NodeBase* head = this->Head_;
+      NodeBase* next = head->Next_.load(std::memory_order_acquire);
+      if (head == &this->Stub_) {
+         if (next == nullptr)
+            return this->IsEmpty() ? nullptr : BusyNode();
+         this->Head_ = head = next;
+         next = next->Next_.load(std::memory_order_acquire);
+      }
+      if (next) {
+         this->Head_ = next;
+         return head;
+      }
+      if (head != this->Back_.load(std::memory_order_acquire))
+         return BusyNode();
+      // head 是最後一個節點, 放回 Stub_ 之後才能取出 head.
+      this->PushNode(&this->Stub_);
+      if ((next = head->Next_.load(std::memory_order_acquire)) == nullptr)
+         return BusyNode();
+      this->Head_ = next;
+      return head;
+   }
+
+public:
+   using value_type = T;
+
+   MpscQueue() : Back_{&Stub_}, Head_{&Stub_} {
+   }
+   /// 解構時, 必須已沒有 producer 正在呼叫 Emplace(); 剩餘的資料直接解構.
+   ~MpscQueue() {
+      while (this->PopFront([](T&) {})) {
+      }
+      FreeChain(this->FreeLocal_);
+      FreeChain(this->FreeShared_.load(std::memory_order_acquire));
+   }
+
+   /// 可在任意 thread 呼叫.
+   template <class... ArgsT>
+   void Emplace(ArgsT&&... args) {
+      Node* node = this->AllocNode();
+      try {
+         new (&node->ValueStorage_) T(std::forward<ArgsT>(args)...);
+      }
+      catch (...) {
+         UnallocNode(node);
+         throw;
+      }
+      this->PushNode(node);
+   }
+
+   /// 只能在 consumer thread 呼叫: 取出第一筆資料, 交給 fnConsumer(T&) 處理, 處理完畢後解構.
+   /// - 若有 producer 正在加入(已排入順序, 但尚未串接完成), 則等候串接完成.
+   /// \retval false 佇列為空, 沒有呼叫 fnConsumer.
+   template <class FnConsumer>
+   bool PopFront(FnConsumer&& fnConsumer) {
+      NodeBase* node;
+      while ((node = this->PopNode()) == BusyNode())
+         std::this_thread::yield();
+      if (node == nullptr)
+         return false;
+      struct Recycler {
+         MpscQueue* Owner_;
+         Node*      Node_;
+         ~Recycler() {
+            this->Node_->Value().~T();
+            this->Owner_->RecycleNode(this->Node_);
+         }
+      } recycler{this, static_cast<Node*>(node)};
+      fnConsumer(recycler.Node_->Value());
+      return true;
+   }
+
+   /// 只能在 consumer thread 呼叫.
+   /// Back_ 使用 seq_cst 讀取, 可與其他 seq_cst 的旗標構成 Dekker 的檢查.
+   bool IsEmpty() const {
+      return this->Head_ == &this->Stub_
+         && this->Back_.load(std::memory_order_seq_cst) == &this->Stub_;
+   }
+};
+fon9_WARN_POP;
+
+} // namespace
+#endif//__fon9_MpscQueue_hpp__
@@ -5,6 +5,7 @@
 #include "fon9/Utility.hpp"
 fon9_BEFORE_INCLUDE_STD;
 #include <mutex>
+#include <thread>
 fon9_AFTER_INCLUDE_STD;
 
 namespace fon9 {
@@ -90,6 +91,12 @@ public:
    ConstLocker Lock() const { return ConstLocker{*this}; }
    ConstLocker ConstLock() const { return ConstLocker{*this}; }
 
+   /// 提供給自行管理鎖定的特殊 MutexT 使用, 例: fon9::fmkt::SymbShardMutex 的分區鎖定.
+   /// 呼叫端必須自行確保已在適當的鎖定狀態, 一般情況請使用 Lock().
+   MutexT& UnsafeGetMutex() const { return this->Mutex_; }
+   BaseT& UnsafeGetBase() { return this->Base_; }
+   const BaseT& UnsafeGetBase() const { return this->Base_; }
+
    static MustLock& StaticCast(BaseT& pbase) {
       return ContainerOf(pbase, &MustLock::Base_);
    }
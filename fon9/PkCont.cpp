@@ -1,21 +1,430 @@
 ﻿// \file fon9/PkCont.cpp
 // \author fonwinz@gmail.com
 #include "fon9/PkCont.hpp"
+#include "fon9/Log.hpp"
+
+#ifdef fon9_WINDOWS
+#include <intrin.h>
+#pragma intrinsic(_BitScanForward64)
+#pragma intrinsic(_BitScanReverse64)
+#endif
 
 namespace fon9 {
 
+static inline unsigned CountTrailingZero(uint64_t mask) {
+   assert(mask != 0);
+#ifdef fon9_WINDOWS
+   unsigned long res;
+   _BitScanForward64(&res, mask);
+   return static_cast<unsigned>(res);
+#else
+   return static_cast<unsigned>(__builtin_ctzll(mask));
+#endif
+}
+static inline unsigned CountLeadingZero(uint64_t mask) {
+   assert(mask != 0);
+#ifdef fon9_WINDOWS
+   unsigned long res;
+   _BitScanReverse64(&res, mask);
+   return static_cast<unsigned>(63 - res);
+#else
+   return static_cast<unsigned>(__builtin_clzll(mask));
+#endif
+}
+
+PkContWindow::PkContWindow(uint32_t capacity, uint32_t slotSize)
+   : Capacity_{64}
+   , SlotSize_{slotSize} {
+   if (capacity > kMaxCapacity)
+      capacity = kMaxCapacity;
+   while (this->Capacity_ < capacity)
+      this->Capacity_ <<= 1;
+}
+PkContWindow::~PkContWindow() {
+}
+void PkContWindow::Alloc(uint32_t capacity) {
+   this->Capacity_ = capacity;
+   this->Slots_.reset(new PkRec[capacity]);
+   this->Pool_.reset(new char[static_cast<size_t>(capacity) * this->SlotSize_]);
+   this->Filled_.reset(new uint64_t[capacity / 64]);
+   memset(this->Filled_.get(), 0, capacity / 64 * sizeof(uint64_t));
+}
+void PkContWindow::Grow(SeqT span) {
+   assert(span <= kMaxCapacity);
+   uint32_t newCapacity = this->Capacity_;
+   while (newCapacity < span)
+      newCapacity <<= 1;
+   std::unique_ptr<PkRec[]>    oldSlots{std::move(this->Slots_)};
+   std::unique_ptr<char[]>     oldPool{std::move(this->Pool_)};
+   std::unique_ptr<uint64_t[]> oldFilled{std::move(this->Filled_)};
+   const uint32_t              oldCapacity = this->Capacity_;
+   this->Alloc(newCapacity);
+   for (uint32_t idx = 0; idx < oldCapacity; ++idx) {
+      if ((oldFilled[idx / 64] & (static_cast<uint64_t>(1) << (idx % 64))) == 0)
+         continue;
+      PkRec&         src = oldSlots[idx];
+      const uint32_t newIdx = this->SlotIndex(src.Seq_);
+      PkRec&         dst = this->Slots_[newIdx];
+      dst.Seq_ = src.Seq_;
+      this->Assign(dst, newIdx, src.Data_, src.Size_);
+      this->Filled_[newIdx / 64] |= (static_cast<uint64_t>(1) << (newIdx % 64));
+   }
+}
+void PkContWindow::Assign(PkRec& rec, uint32_t idx, const void* pk, unsigned pksz) {
+   rec.Size_ = pksz;
+   if (fon9_LIKELY(pksz <= this->SlotSize_)) {
+      char* pdst = this->Pool_.get() + static_cast<size_t>(idx) * this->SlotSize_;
+      memcpy(pdst, pk, pksz);
+      rec.Data_ = pdst;
+   }
+   else {
+      rec.Overflow_.assign(static_cast<const char*>(pk), pksz);
+      rec.Data_ = rec.Overflow_.data();
+   }
+}
+bool PkContWindow::Insert(SeqT seq, const void* pk, unsigned pksz, size_t* evicted) {
+   if (this->Count_ == 0) {
+      if (!this->Slots_)
+         this->Alloc(this->Capacity_);
+      this->MinSeq_ = this->MaxSeq_ = seq;
+   }
+   else {
+      const SeqT minSeq = (seq < this->MinSeq_ ? seq : this->MinSeq_);
+      const SeqT maxSeq = (seq > this->MaxSeq_ ? seq : this->MaxSeq_);
+      if (fon9_UNLIKELY(maxSeq - minSeq >= this->Capacity_)) {
+         if (maxSeq - minSeq >= kMaxCapacity) {
+            // 保留距離期望序號較近(序號較小)的封包.
+            if (seq > this->MaxSeq_)
+               return false;
+            const size_t count = this->EraseFrom(seq + kMaxCapacity);
+            if (evicted)
+               *evicted += count;
+            return this->Insert(seq, pk, pksz, evicted);
+         }
+         this->Grow(maxSeq - minSeq + 1);
+      }
+      else if (this->IsFilled(this->SlotIndex(seq))) {
+         // 範圍小於容量, 所以同一個 slot 只可能是相同序號.
+         assert(this->Slot(seq).Seq_ == seq);
+         return false;
+      }
+      this->MinSeq_ = minSeq;
+      this->MaxSeq_ = maxSeq;
+   }
+   const uint32_t idx = this->SlotIndex(seq);
+   PkRec&         rec = this->Slots_[idx];
+   rec.Seq_ = seq;
+   this->Assign(rec, idx, pk, pksz);
+   this->Filled_[idx / 64] |= (static_cast<uint64_t>(1) << (idx % 64));
+   ++this->Count_;
+   return true;
+}
+PkContWindow::SeqT PkContWindow::NextFilled(SeqT seq) const {
+   if (this->Count_ == 0 || seq > this->MaxSeq_)
+      return this->EndSeq();
+   if (seq < this->MinSeq_)
+      seq = this->MinSeq_;
+   // 從 seq 所在的 slot 開始, 每次檢查 64 個 slot 的 bitmap.
+   for (;;) {
+      const uint32_t idx = this->SlotIndex(seq);
+      const uint64_t bits = this->Filled_[idx / 64] >> (idx % 64);
+      if (bits) {
+         // 若超過 MaxSeq_, 則表示此 bit 是繞回來的較小序號(已走訪過), 所以已沒有封包.
+         seq += CountTrailingZero(bits);
+         return seq > this->MaxSeq_ ? this->EndSeq() : seq;
+      }
+      seq += 64 - (idx % 64);
+      if (seq > this->MaxSeq_)
+         return this->EndSeq();
+   }
+}
+PkContWindow::SeqT PkContWindow::PrevFilled(SeqT seq) const {
+   assert(this->Count_ > 0 && this->MinSeq_ <= seq);
+   // 從 seq 所在的 slot 開始往前, 每次檢查 64 個 slot 的 bitmap.
+   // > seq 的 slot 都沒有封包, 所以找到的 bit 必定是 <= seq 的序號.
+   for (;;) {
+      const uint32_t idx = this->SlotIndex(seq);
+      const uint64_t bits = this->Filled_[idx / 64] << (63 - idx % 64);
+      if (bits)
+         return seq - CountLeadingZero(bits);
+      seq -= (idx % 64) + 1;
+      assert(seq >= this->MinSeq_);
+   }
+}
+size_t PkContWindow::EraseFrom(SeqT seq) {
+   if (this->Count_ == 0 || seq > this->MaxSeq_)
+      return 0;
+   if (seq <= this->MinSeq_) {
+      const size_t count = this->Count_;
+      this->clear();
+      return count;
+   }
+   size_t count = 0;
+   for (SeqT cur = this->NextFilled(seq); cur <= this->MaxSeq_; cur = this->NextFilled(cur + 1)) {
+      const uint32_t idx = this->SlotIndex(cur);
+      this->Filled_[idx / 64] &= ~(static_cast<uint64_t>(1) << (idx % 64));
+      ++count;
+   }
+   this->Count_ -= count;
+   this->MaxSeq_ = this->PrevFilled(seq - 1);
+   return count;
+}
+void PkContWindow::erase(const_iterator first, const_iterator last) {
+   assert(first == this->begin());
+   (void)first;
+   if (last == this->end()) {
+      this->clear();
+      return;
+   }
+   for (SeqT seq = this->MinSeq_; seq < last.GetSeq(); seq = this->NextFilled(seq + 1)) {
+      const uint32_t idx = this->SlotIndex(seq);
+      this->Filled_[idx / 64] &= ~(static_cast<uint64_t>(1) << (idx % 64));
+      --this->Count_;
+   }
+   this->MinSeq_ = last.GetSeq();
+}
+void PkContWindow::clear() {
+   if (this->Count_ == 0)
+      return;
+   if (this->MaxSeq_ - this->MinSeq_ >= this->Capacity_ / 2)
+      memset(this->Filled_.get(), 0, this->Capacity_ / 64 * sizeof(uint64_t));
+   else {
+      for (SeqT seq = this->MinSeq_; seq <= this->MaxSeq_; seq += 64) {
+         const uint32_t idx = this->SlotIndex(seq);
+         this->Filled_[idx / 64] = 0;
+      }
+      const uint32_t idx = this->SlotIndex(this->MaxSeq_);
+      this->Filled_[idx / 64] = 0;
+   }
+   this->Count_ = 0;
+}
+//--------------------------------------------------------------------------//
+
+unsigned PkContArbiterArgs::RegLine(StrView name) {
+   std::lock_guard<std::mutex> lk{this->RegMutex_};
+   const unsigned count = this->LineCount_.load(std::memory_order_relaxed);
+   for (unsigned L = 0; L < count; ++L) {
+      if (name == &this->LineNames_[L])
+         return L;
+   }
+   if (count >= kMaxLineCount)
+      return kMaxLineCount;
+   this->LineNames_[count] = name.ToString();
+   this->LineCount_.store(count + 1, std::memory_order_release);
+   return count;
+}
+//--------------------------------------------------------------------------//
+fon9_WARN_DISABLE_PADDING;
+/// 仲裁狀態: 由 Owner_.PkPendings_ 保護.
+struct PkContFeeder::Arbiter {
+   fon9_NON_COPY_NON_MOVE(Arbiter);
+   /// 記錄最近 kArrivalCount 個序號的抵達狀態, 用來判斷: 哪條線路先到、落後多久、是否已送達.
+   enum : uint32_t {
+      kArrivalCount = 4096,
+   };
+   struct Arrival {
+      SeqT        Seq_{0};
+      TimeStamp   Time_;
+      /// 已送達的線路: bit(1 << lineIndex);
+      uint8_t     LineMask_{0};
+      /// 此序號由非主要線路先送達, 正在等候主要線路.
+      bool        IsHeld_{false};
+   };
+   PkContFeeder&              Owner_;
+   const PkContArbiterArgs&   Args_;
+   bool                       IsNeedsHoldTimer_{false};
+   PkContLineStat             Lines_[PkContArbiterArgs::kMaxLineCount];
+   std::unique_ptr<Arrival[]> Arrivals_{new Arrival[kArrivalCount]};
+   /// PreferPrimary: 等候主要線路期間, 保留的封包.
+   PkContWindow               Held_;
+
+   static void EmitOnTimer(TimerEntry* timer, TimeStamp now);
+   DataMemberEmitOnTimer<&Arbiter::EmitOnTimer> Timer_;
+
+   Arbiter(PkContFeeder& owner, const PkContArbiterArgs& args) : Owner_(owner), Args_(args) {
+   }
+   void Reset() {
+      for (PkContLineStat& st : this->Lines_)
+         st = PkContLineStat{};
+      this->ResetSeq();
+   }
+   /// 序號重置: 舊的抵達記錄若不清除, 新序號會被誤判為「其他線路已送達」而拋棄.
+   void ResetSeq() {
+      for (PkContLineStat& st : this->Lines_)
+         st.LastSeq_ = 0;
+      for (uint32_t L = 0; L < kArrivalCount; ++L)
+         this->Arrivals_[L] = Arrival{};
+      this->Held_.clear();
+   }
+   static uint64_t ToUs(TimeInterval ti) {
+      return ti.GetOrigValue() > 0 ? static_cast<uint64_t>(ti.ShiftUnit<6>()) : 0u;
+   }
+   void UpdateLag(unsigned lineIndex, TimeInterval lag) {
+      PkContLineStat& st = this->Lines_[lineIndex];
+      const uint64_t  us = ToUs(lag);
+      if (us) {
+         st.LagSumUs_ += us;
+         if (st.LagMaxUs_ < us)
+            st.LagMaxUs_ = us;
+      }
+      // EWMA: alpha = 1/16;
+      st.LagAvgUs_ = (st.LagAvgUs_ * 15 + us + 8) / 16;
+      const uint64_t degradeUs = ToUs(this->Args_.DegradeLag_);
+      if (degradeUs == 0)
+         return;
+      if (!st.IsDegraded_) {
+         if (st.LagAvgUs_ > degradeUs) {
+            st.IsDegraded_ = true;
+            fon9_LOG_WARN("PkContArbiter.Degraded|line=", this->Args_.GetLineName(lineIndex),
+                          "|lagAvgUs=", st.LagAvgUs_, "|lagMaxUs=", st.LagMaxUs_,
+                          "|win=", st.WinCount_, "|lose=", st.LoseCount_, "|gap=", st.GapCount_);
+         }
+      }
+      else if (st.LagAvgUs_ < degradeUs / 2) {
+         st.IsDegraded_ = false;
+         fon9_LOG_INFO("PkContArbiter.Recovered|line=", this->Args_.GetLineName(lineIndex),
+                       "|lagAvgUs=", st.LagAvgUs_);
+      }
+   }
+   bool IsHoldRequired(unsigned lineIndex, SeqT seq, TimeStamp now) const {
+      if (this->Args_.Policy_ != PkContArbiterArgs::Policy::PreferPrimary
+          || lineIndex == this->Args_.PrimaryLine_
+          || seq < this->Owner_.NextSeq_)
+         return false;
+      const PkContLineStat& primary = this->Lines_[this->Args_.PrimaryLine_];
+      return !primary.IsDegraded_ && (now - primary.LastRecvTime_) < this->Args_.HoldTimeout_;
+   }
+   /// 釋放: 已逾時, 或主要線路已跳過(主要線路遺漏)的保留封包.
+   /// \retval true 需要啟動 Owner_.Timer_;
+   bool ReleaseHeld(PkPendings::Locker& pks, TimeStamp now) {
+      const PkContLineStat& primary = this->Lines_[this->Args_.PrimaryLine_];
+      bool isNeedsRunAfter = false;
+      auto ibeg = this->Held_.begin();
+      auto iend = this->Held_.end();
+      auto i = ibeg;
+      for (; i != iend; ++i) {
+         Arrival& arr = this->Arrivals_[i->Seq_ % kArrivalCount];
+         if (arr.Seq_ == i->Seq_) {
+            if (!arr.IsHeld_) // 主要線路已送達.
+               continue;
+            if (now - arr.Time_ < this->Args_.HoldTimeout_ && primary.LastSeq_ < i->Seq_)
+               break;
+            arr.IsHeld_ = false;
+         }
+         if (this->Owner_.FeedPacketLocked(pks, i->data(), static_cast<unsigned>(i->size()), i->Seq_))
+            isNeedsRunAfter = true;
+      }
+      if (i != ibeg)
+         this->Held_.erase(ibeg, i);
+      return isNeedsRunAfter;
+   }
+   /// \retval true 需要啟動 Owner_.Timer_;
+   bool OnArrived(PkPendings::Locker& pks, unsigned lineIndex, const void* pk, unsigned pksz, SeqT seq) {
+      const TimeStamp now = UtcNow();
+      PkContLineStat& st = this->Lines_[lineIndex];
+      ++st.RecvCount_;
+      st.LastRecvTime_ = now;
+      if (st.LastSeq_ < seq) {
+         if (st.LastSeq_ != 0 && st.LastSeq_ + 1 < seq) {
+            ++st.GapCount_;
+            st.GapPkCount_ += seq - st.LastSeq_ - 1;
+         }
+         st.LastSeq_ = seq;
+      }
+      const uint8_t  lineBit = static_cast<uint8_t>(1u << lineIndex);
+      Arrival&       arr = this->Arrivals_[seq % kArrivalCount];
+      bool           isNeedsRunAfter = false;
+      if (fon9_LIKELY(arr.Seq_ < seq)) { // 此序號第一次抵達.
+         arr.Seq_ = seq;
+         arr.Time_ = now;
+         arr.LineMask_ = lineBit;
+         ++st.WinCount_;
+         this->UpdateLag(lineIndex, TimeInterval{});
+         if ((arr.IsHeld_ = this->IsHoldRequired(lineIndex, seq, now)) == true) {
+            const bool isFirstHeld = this->Held_.empty();
+            if (this->Held_.Insert(seq, pk, pksz)) {
+               if (isFirstHeld)
+                  this->IsNeedsHoldTimer_ = true;
+               return isNeedsRunAfter;
+            }
+            // 與保留中的序號範圍差距太大(超過 PkContWindow::kMaxCapacity), 不保留, 直接處理.
+            arr.IsHeld_ = false;
+         }
+         isNeedsRunAfter = this->Owner_.FeedPacketLocked(pks, pk, pksz, seq);
+      }
+      else if (arr.Seq_ == seq) {
+         // 其他線路已送達: 只更新統計, 不用再進入連續性檢查.
+         // 若是同一線路重複送出, 則直接拋棄.
+         if ((arr.LineMask_ & lineBit) == 0) {
+            arr.LineMask_ = static_cast<uint8_t>(arr.LineMask_ | lineBit);
+            ++st.LoseCount_;
+            this->UpdateLag(lineIndex, now - arr.Time_);
+            if (arr.IsHeld_ && lineIndex == this->Args_.PrimaryLine_) {
+               // 主要線路送達, 保留的封包在 ReleaseHeld() 時拋棄.
+               arr.IsHeld_ = false;
+               isNeedsRunAfter = this->Owner_.FeedPacketLocked(pks, pk, pksz, seq);
+            }
+         }
+      }
+      else {
+         // 序號比記錄範圍還舊(或序號重置), 交給連續性檢查處理.
+         isNeedsRunAfter = this->Owner_.FeedPacketLocked(pks, pk, pksz, seq);
+      }
+      if (!this->Held_.empty() && this->ReleaseHeld(pks, now))
+         isNeedsRunAfter = true;
+      return isNeedsRunAfter;
+   }
+};
+fon9_WARN_POP;
+
+void PkContFeeder::Arbiter::EmitOnTimer(TimerEntry* timer, TimeStamp now) {
+   Arbiter&     rthis = ContainerOf(*static_cast<decltype(Arbiter::Timer_)*>(timer), &Arbiter::Timer_);
+   PkContFeeder& owner = rthis.Owner_;
+   bool isNeedsRunAfter, isNeedsHoldTimer;
+   {
+      PkPendings::Locker pks{owner.PkPendings_};
+      isNeedsRunAfter = (!rthis.Held_.empty() && rthis.ReleaseHeld(pks, now));
+      isNeedsHoldTimer = !rthis.Held_.empty();
+   }
+   if (isNeedsRunAfter)
+      owner.Timer_.RunAfter(owner.WaitInterval_);
+   if (isNeedsHoldTimer)
+      rthis.Timer_.RunAfter(rthis.Args_.HoldTimeout_);
+}
+//--------------------------------------------------------------------------//
+
 PkContFeeder::PkContFeeder() {
 }
 PkContFeeder::~PkContFeeder() {
    this->Timer_.DisposeAndWait();
+   if (this->Arbiter_)
+      this->Arbiter_->Timer_.DisposeAndWait();
 }
 void PkContFeeder::Clear() {
    this->Timer_.StopAndWait();
+   Arbiter* arb;
+   {
+      PkPendings::Locker pks{this->PkPendings_};
+      arb = this->Arbiter_.get();
+   }
+   if (arb)
+      arb->Timer_.StopAndWait();
    PkPendings::Locker pks{this->PkPendings_};
+   if (arb)
+      arb->Reset();
    pks->clear();
    this->ReceivedCount_ = 0;
    this->DroppedCount_ = 0;
    this->LostCount_ = 0;
+   this->OverflowCount_ = 0;
+   this->OverflowLogMinSeq_ = 0;
+   this->NextSeq_ = 0;
+}
+void PkContFeeder::ResetSeqLocked(PkPendings::Locker& pks) {
+   if (this->Arbiter_)
+      this->Arbiter_->ResetSeq();
+   pks->clear();
+   this->OverflowLogMinSeq_ = 0;
    this->NextSeq_ = 0;
 }
 void PkContFeeder::EmitOnTimer(TimerEntry* timer, TimeStamp now) {
@@ -34,41 +443,90 @@ void PkContFeeder::PkContOnDropped(const void* pk, unsigned pksz, SeqT seq) {
    (void)pk; (void)pksz; (void)seq;
 }
 void PkContFeeder::FeedPacket(const void* pk, unsigned pksz, SeqT seq) {
+   bool isNeedsRunAfter;
    {  // lock this->PkPendings_;
       PkPendings::Locker pks{this->PkPendings_};
-      if (fon9_LIKELY(seq == this->NextSeq_)) {
+      isNeedsRunAfter = this->FeedPacketLocked(pks, pk, pksz, seq);
+   } // auto unlock this->PkPendings_.
+   if (isNeedsRunAfter)
+      this->Timer_.RunAfter(this->WaitInterval_);
+}
+bool PkContFeeder::FeedPacketLocked(PkPendings::Locker& pks, const void* pk, unsigned pksz, SeqT seq) {
+   if (fon9_LIKELY(seq == this->NextSeq_)) {
 __PK_RECEIVED:
-         this->CallOnReceived(pk, pksz, seq);
-         if (fon9_LIKELY(pks->empty()))
-            return;
-         auto const ibeg = pks->begin();
-         auto const iend = pks->end();
-         auto i = ibeg;
-         while (i->Seq_ == this->NextSeq_) {
-            this->CallOnReceived(i->data(), static_cast<unsigned>(i->size()), i->Seq_);
-            if (++i == iend)
-               break;
-         }
-         if (ibeg != i)
-            pks->erase(ibeg, i);
-         return;
+      this->CallOnReceived(pk, pksz, seq);
+      if (fon9_LIKELY(pks->empty()))
+         return false;
+      auto const ibeg = pks->begin();
+      auto const iend = pks->end();
+      auto i = ibeg;
+      while (i->Seq_ == this->NextSeq_) {
+         this->CallOnReceived(i->data(), static_cast<unsigned>(i->size()), i->Seq_);
+         if (++i == iend)
+            break;
       }
-      if (seq < this->NextSeq_) {
-         ++this->DroppedCount_;
-         this->PkContOnDropped(pk, pksz, seq);
-         return;
-      }
-      if (this->NextSeq_ == 0 || this->WaitInterval_.GetOrigValue() == 0)
-         goto __PK_RECEIVED;
-      bool isNeedsRunAfter = pks->empty();
-      auto ires = pks->insert(PkRec{seq});
-      if (!ires.second)
-         return;
-      ires.first->assign(static_cast<const char*>(pk), pksz);
-      if (!isNeedsRunAfter)
-         return;
+      if (ibeg != i)
+         pks->erase(ibeg, i);
+      return false;
+   }
+   if (seq < this->NextSeq_) {
+      ++this->DroppedCount_;
+      this->PkContOnDropped(pk, pksz, seq);
+      return false;
+   }
+   if (this->NextSeq_ == 0 || this->WaitInterval_.GetOrigValue() == 0)
+      goto __PK_RECEIVED;
+   const bool isNeedsRunAfter = pks->empty();
+   size_t     evicted = 0;
+   if (!pks->Insert(seq, pk, pksz, &evicted)) {
+      // 序號大於保留的最大序號, 表示超過重排視窗範圍, 否則為重複封包.
+      if (seq > pks->back().Seq_)
+         this->OnWindowOverflow(pks, seq, 1);
+      return false;
+   }
+   if (fon9_UNLIKELY(evicted))
+      this->OnWindowOverflow(pks, seq, evicted);
+   return isNeedsRunAfter;
+}
+void PkContFeeder::OnWindowOverflow(PkPendings::Locker& pks, SeqT seq, size_t count) {
+   this->OverflowCount_ += count;
+   const SeqT minSeq = pks->front().Seq_;
+   if (this->OverflowLogMinSeq_ == minSeq)
+      return;
+   this->OverflowLogMinSeq_ = minSeq;
+   fon9_LOG_WARN("PkCont.WindowOverflow|seq=", seq, "|nextSeq=", this->NextSeq_,
+                 "|pendings=", minSeq, '-', pks->back().Seq_,
+                 "|discard=", count, "|overflowCount=", this->OverflowCount_);
+}
+void PkContFeeder::FeedPacketFrom(unsigned lineIndex, const void* pk, unsigned pksz, SeqT seq) {
+   if (this->ArbiterArgs_ == nullptr || lineIndex >= PkContArbiterArgs::kMaxLineCount) {
+      this->FeedPacket(pk, pksz, seq);
+      return;
+   }
+   bool     isNeedsRunAfter, isNeedsHoldTimer;
+   Arbiter* arb;
+   {  // lock this->PkPendings_;
+      PkPendings::Locker pks{this->PkPendings_};
+      if (fon9_UNLIKELY(!this->Arbiter_))
+         this->Arbiter_.reset(new Arbiter{*this, *this->ArbiterArgs_});
+      arb = this->Arbiter_.get();
+      isNeedsRunAfter = arb->OnArrived(pks, lineIndex, pk, pksz, seq);
+      isNeedsHoldTimer = arb->IsNeedsHoldTimer_;
+      arb->IsNeedsHoldTimer_ = false;
    } // auto unlock this->PkPendings_.
-   this->Timer_.RunAfter(this->WaitInterval_);
+   if (isNeedsRunAfter)
+      this->Timer_.RunAfter(this->WaitInterval_);
+   if (isNeedsHoldTimer)
+      arb->Timer_.RunAfter(this->ArbiterArgs_->HoldTimeout_);
+}
+bool PkContFeeder::GetLineStat(unsigned lineIndex, PkContLineStat& stat) const {
+   if (lineIndex >= PkContArbiterArgs::kMaxLineCount)
+      return false;
+   PkPendings::ConstLocker pks{this->PkPendings_};
+   if (!this->Arbiter_)
+      return false;
+   stat = this->Arbiter_->Lines_[lineIndex];
+   return true;
 }
 
 } // namespaces
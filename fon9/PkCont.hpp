@@ -2,11 +2,223 @@
 // \author fonwinz@gmail.com
 #ifndef __fon9_PkCont_hpp__
 #define __fon9_PkCont_hpp__
-#include "fon9/SortedVector.hpp"
 #include "fon9/Timer.hpp"
+#include "fon9/MustLock.hpp"
+#include "fon9/StrView.hpp"
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <string>
 
 namespace fon9 {
 
+fon9_WARN_DISABLE_PADDING;
+/// \ingroup Misc.
+/// PkContFeeder 用來保留「不連續封包」的重排視窗.
+/// - 使用 seq 當作索引的環狀陣列: slot = seq & (capacity - 1);
+///   - 加入、移除、尋找下一個封包: O(1), 不需要排序、搬移.
+///   - 使用 bitmap 記錄有封包的 slot, 依序走訪時可快速跳過空的 slot.
+/// - 封包內容存放在預先分配的「固定大小 slot 記憶體」, 不用每個封包都分配記憶體.
+///   - 超過 slot 大小的封包(很少見), 才使用額外的記憶體.
+/// - 在第一次需要保留封包時, 才分配記憶體.
+/// - 若保留的序號範圍(最大序號 - 最小序號)超過容量, 則自動擴充容量(不會因此放棄封包),
+///   例: 等候回補期間, 持續收到新的封包.
+///   - 但容量最多為 kMaxCapacity, 避免分配過大的記憶體; 超過此範圍時, 保留序號較小(距離期望序號較近)的封包:
+///     - 新封包的序號較大(例: 序號異常跳躍): 拋棄新封包(Insert() 傳回 false);
+///     - 新封包的序號較小(例: 回補封包): 移除序號最大的那些封包, 讓新封包可以加入.
+///   - 等候逾時後, 保留的封包處理完畢, 就可以接受新的序號範圍.
+class fon9_API PkContWindow {
+   fon9_NON_COPY_NON_MOVE(PkContWindow);
+public:
+   using SeqT = uint64_t;
+   enum : uint32_t {
+      kDefaultCapacity = 256,
+      kDefaultSlotSize = 256,
+      kMaxCapacity = 1024 * 64,
+   };
+   PkContWindow(uint32_t capacity = kDefaultCapacity, uint32_t slotSize = kDefaultSlotSize);
+   ~PkContWindow();
+
+   struct PkRec {
+      fon9_NON_COPY_NON_MOVE(PkRec);
+      PkRec() = default;
+      SeqT        Seq_{0};
+      const char* Data_{nullptr};
+      uint32_t    Size_{0};
+      /// 超過 slot 大小的封包, 存放在此.
+      std::string Overflow_;
+      const char* data() const {
+         return this->Data_;
+      }
+      size_t size() const {
+         return this->Size_;
+      }
+   };
+   /// 依照序號由小到大走訪.
+   class const_iterator {
+      const PkContWindow* Owner_;
+      SeqT                Seq_;
+   public:
+      const_iterator(const PkContWindow* owner, SeqT seq) : Owner_{owner}, Seq_{seq} {
+      }
+      const PkRec& operator*() const {
+         return this->Owner_->Slot(this->Seq_);
+      }
+      const PkRec* operator->() const {
+         return &this->Owner_->Slot(this->Seq_);
+      }
+      const_iterator& operator++() {
+         this->Seq_ = this->Owner_->NextFilled(this->Seq_ + 1);
+         return *this;
+      }
+      bool operator==(const const_iterator& rhs) const {
+         return this->Seq_ == rhs.Seq_;
+      }
+      bool operator!=(const const_iterator& rhs) const {
+         return this->Seq_ != rhs.Seq_;
+      }
+      SeqT GetSeq() const {
+         return this->Seq_;
+      }
+   };
+   using iterator = const_iterator;
+
+   bool empty() const {
+      return this->Count_ == 0;
+   }
+   size_t size() const {
+      return this->Count_;
+   }
+   const_iterator begin() const {
+      return const_iterator{this, this->Count_ ? this->MinSeq_ : this->EndSeq()};
+   }
+   const_iterator end() const {
+      return const_iterator{this, this->EndSeq()};
+   }
+   const PkRec& front() const {
+      assert(!this->empty());
+      return this->Slot(this->MinSeq_);
+   }
+   const PkRec& back() const {
+      assert(!this->empty());
+      return this->Slot(this->MaxSeq_);
+   }
+   uint32_t GetCapacity() const {
+      return this->Capacity_;
+   }
+
+   /// 加入一個封包.
+   /// 若因為序號範圍超過 kMaxCapacity, 而移除了序號較大的封包, 則將移除的數量加到 *evicted;
+   /// \retval false 此序號已存在, 或 seq 大於保留的最大序號且加入後的序號範圍超過 kMaxCapacity.
+   bool Insert(SeqT seq, const void* pk, unsigned pksz, size_t* evicted = nullptr);
+   /// 移除 [begin(), last) 的封包.
+   void erase(const_iterator first, const_iterator last);
+   void clear();
+
+private:
+   uint32_t                   Capacity_;
+   const uint32_t             SlotSize_;
+   size_t                     Count_{0};
+   SeqT                       MinSeq_{0};
+   SeqT                       MaxSeq_{0};
+   std::unique_ptr<PkRec[]>   Slots_;
+   std::unique_ptr<char[]>    Pool_;
+   /// 有封包的 slot, 每個 bit 對應一個 slot.
+   std::unique_ptr<uint64_t[]> Filled_;
+
+   SeqT EndSeq() const {
+      return this->Count_ ? this->MaxSeq_ + 1 : 0;
+   }
+   uint32_t SlotIndex(SeqT seq) const {
+      return static_cast<uint32_t>(seq & (this->Capacity_ - 1));
+   }
+   const PkRec& Slot(SeqT seq) const {
+      return this->Slots_[this->SlotIndex(seq)];
+   }
+   bool IsFilled(uint32_t idx) const {
+      return (this->Filled_[idx / 64] & (static_cast<uint64_t>(1) << (idx % 64))) != 0;
+   }
+   /// 傳回 >= seq 的第一個封包序號, 若沒有則傳回 EndSeq();
+   SeqT NextFilled(SeqT seq) const;
+   /// 傳回 <= seq 的最後一個封包序號, 呼叫前必須確定 [MinSeq_, seq] 之間有封包, 且 > seq 的 slot 沒有封包.
+   SeqT PrevFilled(SeqT seq) const;
+   /// 移除 >= seq 的封包, 傳回移除的數量.
+   size_t EraseFrom(SeqT seq);
+   void Alloc(uint32_t capacity);
+   void Grow(SeqT span);
+   void Assign(PkRec& rec, uint32_t idx, const void* pk, unsigned pksz);
+};
+fon9_WARN_POP;
+
+/// \ingroup Misc.
+/// 多線路(例: A/B 線)仲裁的設定, 可由多個 PkContFeeder 共用(例: 同一個交易所的全部 channels).
+/// - 每條線路有一個索引(RegLine() 的傳回值), 透過 PkContFeeder::FeedPacketFrom(lineIndex, ...) 餵入封包.
+/// - 必須在開始餵入封包之前設定完畢, 除了 RegLine() 之外, 餵入封包期間不可再改變.
+struct fon9_API PkContArbiterArgs {
+   fon9_NON_COPY_NON_MOVE(PkContArbiterArgs);
+   PkContArbiterArgs() = default;
+
+   enum : unsigned {
+      kMaxLineCount = 4,
+   };
+   enum class Policy : uint8_t {
+      /// 最先抵達的封包, 立即處理.
+      FirstArrival,
+      /// 優先使用 PrimaryLine_ 的封包:
+      /// - 其他線路先抵達的封包, 最多保留 HoldTimeout_, 若期間內主要線路仍未送達, 才使用保留的封包.
+      /// - 若主要線路已劣化(IsDegraded_), 或超過 HoldTimeout_ 沒有收到主要線路的封包,
+      ///   則不保留, 直接使用最先抵達的封包.
+      PreferPrimary,
+   };
+   Policy         Policy_{Policy::FirstArrival};
+   uint8_t        PrimaryLine_{0};
+   char           Padding____[6];
+   /// PreferPrimary: 其他線路先抵達的封包, 最多等候主要線路多久.
+   /// 應小於 PkContFeeder 的 WaitInterval, 否則等候期間可能被誤判為封包遺失.
+   TimeInterval   HoldTimeout_{TimeInterval_Microsecond(500)};
+   /// 平均落後時間(EWMA) 超過此值, 視為線路品質劣化; 降到此值的一半以下, 視為恢復.
+   /// 0 表示不判斷線路品質.
+   TimeInterval   DegradeLag_{TimeInterval_Millisecond(1)};
+
+   /// 註冊線路名稱, 若名稱已存在, 則傳回原本的索引.
+   /// 傳回 kMaxLineCount 表示線路數量已滿.
+   unsigned RegLine(StrView name);
+   unsigned GetLineCount() const {
+      return this->LineCount_.load(std::memory_order_acquire);
+   }
+   StrView GetLineName(unsigned lineIndex) const {
+      return lineIndex < this->GetLineCount() ? StrView{&this->LineNames_[lineIndex]} : StrView{};
+   }
+
+private:
+   std::mutex              RegMutex_;
+   std::atomic<unsigned>   LineCount_{0};
+   std::string             LineNames_[kMaxLineCount];
+};
+
+/// 仲裁時, 每條線路的統計資料.
+struct PkContLineStat {
+   /// 此線路收到的封包數量.
+   uint64_t    RecvCount_{0};
+   /// 此線路最先抵達的封包數量.
+   uint64_t    WinCount_{0};
+   /// 此線路比其他線路晚抵達的封包數量.
+   uint64_t    LoseCount_{0};
+   /// 此線路自身序號跳號的次數, 及跳過的封包數量.
+   uint64_t    GapCount_{0};
+   uint64_t    GapPkCount_{0};
+   /// 晚抵達時, 落後的時間(us): 合計、最大值.
+   uint64_t    LagSumUs_{0};
+   uint64_t    LagMaxUs_{0};
+   /// 落後時間的移動平均(EWMA, us), 最先抵達時視為落後 0;
+   uint64_t    LagAvgUs_{0};
+   uint64_t    LastSeq_{0};
+   TimeStamp   LastRecvTime_;
+   /// LagAvgUs_ 超過 PkContArbiterArgs::DegradeLag_;
+   bool        IsDegraded_{false};
+   char        Padding____[7];
+};
+
 /// \ingroup Misc.
 /// 確保收到封包的連續性.
 /// - 可能有多個資訊源, 但序號相同.
@@ -31,6 +243,23 @@ public:
    ///   - 等候一小段時間(this->WaitInterval_), 若無法取得連續封包, 則強制繼續處理.
    void FeedPacket(const void* pk, unsigned pksz, SeqT seq);
 
+   /// 設定多線路仲裁, 必須在餵入封包之前設定, args 的生命週期必須比 this 長.
+   /// 預設為 nullptr: 不仲裁, FeedPacketFrom() 等同 FeedPacket().
+   void SetArbiterArgs(const PkContArbiterArgs* args) {
+      this->ArbiterArgs_ = args;
+   }
+   const PkContArbiterArgs* GetArbiterArgs() const {
+      return this->ArbiterArgs_;
+   }
+   /// 從 lineIndex 線路收到的封包.
+   /// - 仲裁與連續性檢查在同一個 lock(PkPendings_) 之內處理, 不會額外增加 lock.
+   /// - 其他線路已送達的序號, 只更新統計後直接拋棄, 不會進入連續性檢查, 也不計入 DroppedCount_.
+   /// - 仲裁的判斷方式請參考 PkContArbiterArgs::Policy;
+   void FeedPacketFrom(unsigned lineIndex, const void* pk, unsigned pksz, SeqT seq);
+   /// 取得仲裁統計資料.
+   /// \retval false 沒有仲裁, 或 lineIndex 不正確.
+   bool GetLineStat(unsigned lineIndex, PkContLineStat& stat) const;
+
    /// 如果封包序號不連續, 要等候多少時間? 才觸發「繼續處理」事件.
    void SetWaitInterval(TimeInterval v) {
       this->WaitInterval_ = v;
@@ -46,24 +275,24 @@ protected:
    /// 遺失的封包數量: 根據 Seq 計算.
    /// 不含第一個封包前的遺失數量.
    SeqT           LostCount_{0};
+   /// 因為超過重排視窗的最大範圍(PkContWindow::kMaxCapacity), 而拋棄(或從視窗移除)的封包數量.
+   /// 這些封包之後若沒有補齊, 會在處理後續封包時計入 LostCount_;
+   SeqT           OverflowCount_{0};
    /// 預計在 PkContOnReceived(..., seq) 處理完後的下一個封包序號.
    /// 您可以在 PkContOnReceived() 返回前改變此值.
    /// 預設為 seq + 1;
    SeqT           AfterNextSeq_;
    TimeInterval   WaitInterval_{TimeInterval_Millisecond(5)};
    
-   struct PkRec : public std::string {
-      SeqT  Seq_;
-      PkRec(SeqT seq) : Seq_{seq} {
-      }
-      bool operator<(const PkRec& rhs) const {
-         return this->Seq_ < rhs.Seq_;
-      }
-   };
-   using PkPendingsImpl = SortedVectorSet<PkRec>;
+   using PkRec = PkContWindow::PkRec;
+   using PkPendingsImpl = PkContWindow;
    using PkPendings = MustLock<PkPendingsImpl>;
    PkPendings  PkPendings_;
 
+   /// 在 PkPendings_ locked 狀態下, 處理一個封包.
+   /// \retval true 需要啟動 Timer_;
+   bool FeedPacketLocked(PkPendings::Locker& pks, const void* pk, unsigned pksz, SeqT seq);
+
    virtual void PkContOnTimer(PkPendings::Locker&& pks);
    static void EmitOnTimer(TimerEntry* timer, TimeStamp now);
    DataMemberEmitOnTimer<&PkContFeeder::EmitOnTimer> Timer_;
@@ -90,12 +319,27 @@ protected:
       ++this->ReceivedCount_;
    }
 
+   /// 序號重置(例: 交易所的 SeqReset), 必須在 PkPendings_ locked 狀態下呼叫.
+   /// - 拋棄等候中的封包, NextSeq_ = 0;
+   /// - 清除仲裁的序號記錄及保留中的封包, 但保留各線路的統計資料.
+   void ResetSeqLocked(PkPendings::Locker& pks);
+
    void ResetBiggerNextSeq(SeqT newNextSeq) {
       if (this->NextSeq_ < newNextSeq) {
          this->LostCount_ += (newNextSeq - this->NextSeq_);
          this->NextSeq_ = newNextSeq;
       }
    }
+
+private:
+   /// 最後一次記錄 overflow log 時, 保留的最小序號; 同一段等候期間只記錄一次 log.
+   SeqT                       OverflowLogMinSeq_{0};
+   void OnWindowOverflow(PkPendings::Locker& pks, SeqT seq, size_t count);
+
+   const PkContArbiterArgs*   ArbiterArgs_{nullptr};
+   /// 在第一次 FeedPacketFrom() 時建立, 由 PkPendings_ 保護.
+   struct Arbiter;
+   std::unique_ptr<Arbiter>   Arbiter_;
 };
 
 } // namespaces
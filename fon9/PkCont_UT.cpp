@@ -5,23 +5,45 @@
 #include "fon9/TestTools.hpp"
 #include "fon9/Endian.hpp"
 #include "fon9/CountDownLatch.hpp"
+#include <vector>
+#include <thread>
 
 struct Feeder : public fon9::PkContFeeder {
    fon9_NON_COPY_NON_MOVE(Feeder);
    using base = fon9::PkContFeeder;
    Feeder() {
+      memset(this->FedFromLine_, 0, sizeof(this->FedFromLine_));
    }
    using base::NextSeq_;
    using base::ReceivedCount_;
    using base::DroppedCount_;
    using base::WaitInterval_;
-   SeqT  ExpectedNextSeq_{0};
-   SeqT  ExpectedSeq_{0};
+   using base::PkPendings_;
+   using base::LostCount_;
+   using base::OverflowCount_;
+   using base::ResetSeqLocked;
+   SeqT     ExpectedNextSeq_{0};
+   SeqT     ExpectedSeq_{0};
+   unsigned PkSize_{sizeof(SeqT)};
+   bool     IsPrintGap_{true};
+   char     Padding___[3];
+   std::vector<char> PkBuf_;
+   /// 封包內容的線路代號(在 seq 之後的 1 byte), 用來檢查處理的是哪條線路的封包.
+   SeqT     FedFromLine_[fon9::PkContArbiterArgs::kMaxLineCount + 1];
+
+   void FeedFrom(unsigned line, SeqT seq) {
+      if (this->PkBuf_.size() < this->PkSize_)
+         this->PkBuf_.resize(this->PkSize_, 'x');
+      fon9::PutBigEndian(this->PkBuf_.data(), seq);
+      this->PkBuf_[sizeof(seq)] = static_cast<char>(line);
+      this->FeedPacketFrom(line, this->PkBuf_.data(), this->PkSize_, seq);
+   }
 
    void Feed(SeqT seq) {
-      SeqT pk;
-      fon9::PutBigEndian(&pk, seq);
-      this->FeedPacket(&pk, sizeof(pk), seq);
+      if (this->PkBuf_.size() < this->PkSize_)
+         this->PkBuf_.resize(this->PkSize_, 'x');
+      fon9::PutBigEndian(this->PkBuf_.data(), seq);
+      this->FeedPacket(this->PkBuf_.data(), this->PkSize_, seq);
    }
    void PkContOnReceived(const void* pk, unsigned pksz, SeqT seq) override {
       if (this->ExpectedSeq_ != seq) {
@@ -29,7 +51,7 @@ struct Feeder : public fon9::PkContFeeder {
             << "\r[ERROR]" << std::endl;
          abort();
       }
-      if (pksz != sizeof(SeqT) || fon9::GetBigEndian<SeqT>(pk) != seq) {
+      if (pksz != this->PkSize_ || fon9::GetBigEndian<SeqT>(pk) != seq) {
          std::cout << "|err=Invalid pk contents." "\r[ERROR]" << std::endl;
          abort();
       }
@@ -39,9 +61,13 @@ struct Feeder : public fon9::PkContFeeder {
             << "\r[ERROR]" << std::endl;
          abort();
       }
+      if (pksz > sizeof(seq)) {
+         const unsigned line = static_cast<unsigned char>(static_cast<const char*>(pk)[sizeof(seq)]);
+         ++this->FedFromLine_[line < fon9::PkContArbiterArgs::kMaxLineCount ? line : fon9::PkContArbiterArgs::kMaxLineCount];
+      }
       this->ExpectedNextSeq_ = seq + 1;
       ++this->ExpectedSeq_;
-      if (this->NextSeq_ != seq)
+      if (this->NextSeq_ != seq && this->IsPrintGap_)
          std::cout << "|gap=[" << this->NextSeq_ << ".." << seq << ")";
    }
    void CheckReceivedCount(SeqT expected) {
@@ -55,6 +81,238 @@ struct Feeder : public fon9::PkContFeeder {
    }
 };
 
+//--------------------------------------------------------------------------//
+/// 亂序、重複、遺漏後補齊的壓力測試.
+/// - reorderWindow: 每 reorderWindow 個封包打亂順序, 且每個封包有 1/2 的機會重複收到(模擬 A/B 線路).
+/// - gapCount: 每 gapCount * 4 個封包, 先送後面的封包, 最後才補齊前面 gapCount 個封包(模擬等候回補).
+/// - 此測試不會有「真正遺失」的封包, 所以收到的封包必定連續.
+void TestPkContStress(const char* name, unsigned pkCount, unsigned reorderWindow, unsigned gapCount, unsigned pksz) {
+   Feeder feeder;
+   feeder.WaitInterval_ = fon9::TimeInterval_Second(60); // 測試期間不要觸發 timer 強制處理.
+   feeder.PkSize_ = pksz;
+   feeder.IsPrintGap_ = false;
+   feeder.ExpectedSeq_ = 1;
+   feeder.Feed(1);
+
+   // 先產生要送出的序號, 避免計時包含產生序號的時間.
+   std::vector<Feeder::SeqT> seqs;
+   seqs.reserve(pkCount * 2);
+   uint32_t rnd = 12345;
+   auto     nextRnd = [&rnd]() {
+      rnd = rnd * 1103515245u + 12345u;
+      return (rnd >> 16);
+   };
+   Feeder::SeqT seqFrom = 2;
+   const Feeder::SeqT seqEnd = seqFrom + pkCount;
+   while (seqFrom < seqEnd) {
+      const size_t ibeg = seqs.size();
+      if (gapCount) {
+         Feeder::SeqT seqTo = std::min(seqFrom + gapCount * 4, seqEnd);
+         for (Feeder::SeqT seq = seqFrom + gapCount; seq < seqTo; ++seq)
+            seqs.push_back(seq);
+         for (Feeder::SeqT seq = seqFrom; seq < seqFrom + gapCount && seq < seqTo; ++seq)
+            seqs.push_back(seq);
+         seqFrom = seqTo;
+      }
+      else {
+         Feeder::SeqT seqTo = std::min(seqFrom + reorderWindow, seqEnd);
+         for (Feeder::SeqT seq = seqFrom; seq < seqTo; ++seq) {
+            seqs.push_back(seq);
+            if (nextRnd() % 2)
+               seqs.push_back(seq);
+         }
+         for (size_t L = seqs.size() - 1; L > ibeg; --L)
+            std::swap(seqs[L], seqs[ibeg + nextRnd() % (L - ibeg + 1)]);
+         seqFrom = seqTo;
+      }
+   }
+   char msg[128];
+   sprintf(msg, "%s|window=%u|gap=%u|pksz=%u", name, reorderWindow, gapCount, pksz);
+   fon9::StopWatch stopWatch;
+   for (Feeder::SeqT seq : seqs)
+      feeder.Feed(seq);
+   stopWatch.PrintResultNoEOL(msg, seqs.size())
+      << "|capacity=" << feeder.PkPendings_.Lock()->GetCapacity();
+   feeder.CheckReceivedCount(pkCount + 1);
+}
+
+//--------------------------------------------------------------------------//
+void CheckResult(const char* item, uint64_t value, uint64_t expected) {
+   std::cout << '|' << item << '=' << value;
+   if (value != expected) {
+      std::cout << "|err=expected=" << expected << "\r[ERROR]" << std::endl;
+      abort();
+   }
+}
+fon9::PkContLineStat GetLineStat(const Feeder& feeder, unsigned line) {
+   fon9::PkContLineStat stat;
+   if (!feeder.GetLineStat(line, stat)) {
+      std::cout << "|err=GetLineStat()" "\r[ERROR]" << std::endl;
+      abort();
+   }
+   return stat;
+}
+/// A/B 線路仲裁:
+/// - A 線遺漏 seq % 50 == 0; B 線遺漏 seq % 70 == 0 (但 A 線有送達);
+/// - 每個序號由 A 或 B 先送達(亂數決定), 所以兩條線路都不會遺漏的封包, 會收到 2 次.
+template <class TimeWaiter>
+void TestPkContArbiter(fon9::PkContArbiterArgs::Policy policy, unsigned pkCount, TimeWaiter& waiter) {
+   fon9::PkContArbiterArgs args;
+   const unsigned lineA = args.RegLine("A");
+   const unsigned lineB = args.RegLine("B");
+   args.Policy_ = policy;
+   args.PrimaryLine_ = static_cast<uint8_t>(lineA);
+   // 避免測試期間因 thread 切換, 造成等候主要線路逾時.
+   args.HoldTimeout_ = fon9::TimeInterval_Second(1);
+   args.DegradeLag_ = fon9::TimeInterval_Millisecond(1);
+   if (args.RegLine("A") != lineA || lineA == lineB) {
+      std::cout << "[ERROR] RegLine()" << std::endl;
+      abort();
+   }
+
+   Feeder feeder;
+   feeder.SetArbiterArgs(&args);
+   feeder.WaitInterval_ = fon9::TimeInterval_Second(60);
+   feeder.PkSize_ = 100;
+   feeder.IsPrintGap_ = false;
+   feeder.ExpectedSeq_ = 1;
+
+   struct Arrival {
+      unsigned     Line_;
+      Feeder::SeqT Seq_;
+   };
+   std::vector<Arrival> arrivals;
+   arrivals.reserve(pkCount * 2);
+   uint32_t rnd = 12345;
+   Feeder::SeqT lostA = 0, lostB = 0, winA = 0;
+   // 線路自身的跳號: 遺漏之後, 必須有收到下一個封包, 才能得知跳號.
+   Feeder::SeqT gapA = 0, gapPkB = 0, lastA = 0, lastB = 0;
+   for (Feeder::SeqT seq = 1; seq <= pkCount; ++seq) {
+      rnd = rnd * 1103515245u + 12345u;
+      // 第 1 個封包由 A 先送達: 在收到主要線路的封包之前, 不會保留其他線路的封包.
+      const bool isAFirst = (seq == 1 || (rnd >> 16) % 4 != 0);
+      const bool hasA = (seq % 50 != 0);
+      const bool hasB = (seq % 70 != 0 || !hasA);
+      lostA += !hasA;
+      lostB += !hasB;
+      if (hasA) {
+         gapA += (lastA + 1 < seq && lastA != 0);
+         lastA = seq;
+      }
+      if (hasB) {
+         gapPkB += (lastB + 1 < seq && lastB != 0) ? (seq - lastB - 1) : 0;
+         lastB = seq;
+      }
+      if (hasA && (isAFirst || !hasB)) {
+         ++winA;
+         arrivals.push_back(Arrival{lineA, seq});
+         if (hasB)
+            arrivals.push_back(Arrival{lineB, seq});
+      }
+      else {
+         arrivals.push_back(Arrival{lineB, seq});
+         if (hasA)
+            arrivals.push_back(Arrival{lineA, seq});
+      }
+   }
+   const bool isPreferA = (policy == fon9::PkContArbiterArgs::Policy::PreferPrimary);
+   std::cout << "[TEST ] PkContArbiter|policy=" << (isPreferA ? "PreferA" : "FirstArrival");
+   fon9::StopWatch stopWatch;
+   for (const Arrival& a : arrivals)
+      feeder.FeedFrom(a.Line_, a.Seq_);
+   stopWatch.PrintResultNoEOL("", arrivals.size());
+
+   const fon9::PkContLineStat statA = GetLineStat(feeder, lineA);
+   const fon9::PkContLineStat statB = GetLineStat(feeder, lineB);
+   CheckResult("A.recv", statA.RecvCount_, pkCount - lostA);
+   CheckResult("B.recv", statB.RecvCount_, pkCount - lostB);
+   CheckResult("A.win", statA.WinCount_, winA);
+   CheckResult("B.win", statB.WinCount_, pkCount - winA);
+   CheckResult("A.lose", statA.LoseCount_, statA.RecvCount_ - winA);
+   CheckResult("A.gap", statA.GapCount_, gapA);
+   CheckResult("B.gapPk", statB.GapPkCount_, gapPkB);
+   CheckResult("dropped", feeder.DroppedCount_, 0);
+   if (isPreferA) {
+      // 只有 A 線遺漏的封包, 才會使用 B 線的封包.
+      // A 線最後遺漏的封包(之後 A 線沒有新封包), 仍在等候 A 線(HoldTimeout_)尚未處理.
+      CheckResult("fedA", feeder.FedFromLine_[lineA], pkCount - lostA);
+      CheckResult("fedB", feeder.FedFromLine_[lineB], gapA);
+      feeder.CheckReceivedCount(pkCount - (lostA - gapA));
+   }
+   else {
+      CheckResult("fedA", feeder.FedFromLine_[lineA], winA);
+      CheckResult("fedB", feeder.FedFromLine_[lineB], pkCount - winA);
+      feeder.CheckReceivedCount(pkCount);
+   }
+
+   if (isPreferA) {
+      // A 線沒有送達: B 線的封包在 HoldTimeout_ 之後處理.
+      // A 線收到 pkCount + 1 之後, 保留的 B 線封包(A 線遺漏)會立即處理.
+      std::cout << "[TEST ] PkContArbiter.HoldTimeout";
+      args.HoldTimeout_ = fon9::TimeInterval_Millisecond(10);
+      feeder.FeedFrom(lineA, pkCount + 1);
+      feeder.FeedFrom(lineB, pkCount + 2);
+      CheckResult("beforeTimeout", feeder.ReceivedCount_, pkCount + 1);
+      waiter.WaitFor(args.HoldTimeout_ + fon9::TimeInterval_Millisecond(50));
+      CheckResult("fedB", feeder.FedFromLine_[lineB], lostA + 1);
+      feeder.CheckReceivedCount(pkCount + 2);
+   }
+   else {
+      // B 線每次都落後 2ms: 應判定為劣化; 之後 B 線每次都先送達: 應恢復.
+      std::cout << "[TEST ] PkContArbiter.Degrade";
+      Feeder::SeqT seq = pkCount;
+      for (unsigned L = 0; L < 20; ++L) {
+         feeder.FeedFrom(lineA, ++seq);
+         std::this_thread::sleep_for(std::chrono::milliseconds(2));
+         feeder.FeedFrom(lineB, seq);
+      }
+      CheckResult("B.degraded", GetLineStat(feeder, lineB).IsDegraded_, true);
+      for (unsigned L = 0; L < 100; ++L) {
+         feeder.FeedFrom(lineB, ++seq);
+         feeder.FeedFrom(lineA, seq);
+      }
+      CheckResult("B.degraded", GetLineStat(feeder, lineB).IsDegraded_, false);
+      feeder.CheckReceivedCount(seq);
+   }
+}
+
+/// 序號重置(例: 交易所的 SeqReset)之後, 重新從 1 開始的序號, 不可被仲裁誤判為「其他線路已送達」.
+void TestPkContArbiterSeqReset(unsigned pkCount) {
+   fon9::PkContArbiterArgs args;
+   const unsigned lineA = args.RegLine("A");
+   const unsigned lineB = args.RegLine("B");
+   Feeder feeder;
+   feeder.SetArbiterArgs(&args);
+   feeder.WaitInterval_ = fon9::TimeInterval_Second(60);
+   feeder.PkSize_ = 100;
+   feeder.IsPrintGap_ = false;
+   feeder.ExpectedSeq_ = 1;
+   std::cout << "[TEST ] PkContArbiter.SeqReset|count=" << pkCount;
+   for (Feeder::SeqT seq = 1; seq <= pkCount; ++seq) {
+      feeder.FeedFrom(lineA, seq);
+      feeder.FeedFrom(lineB, seq);
+   }
+   CheckResult("beforeReset", feeder.ReceivedCount_, pkCount);
+   {
+      auto pks = feeder.PkPendings_.Lock();
+      feeder.ResetSeqLocked(pks);
+   }
+   CheckResult("A.lastSeq", GetLineStat(feeder, lineA).LastSeq_, 0);
+   feeder.ExpectedSeq_ = 1;
+   feeder.ExpectedNextSeq_ = 0;
+   for (Feeder::SeqT seq = 1; seq <= pkCount; ++seq) {
+      feeder.FeedFrom(lineB, seq);
+      feeder.FeedFrom(lineA, seq);
+   }
+   const fon9::PkContLineStat statA = GetLineStat(feeder, lineA);
+   const fon9::PkContLineStat statB = GetLineStat(feeder, lineB);
+   CheckResult("A.gap", statA.GapCount_, 0);
+   CheckResult("B.win", statB.WinCount_, pkCount);
+   CheckResult("fedB", feeder.FedFromLine_[lineB], pkCount);
+   CheckResult("dropped", feeder.DroppedCount_, 0);
+   feeder.CheckReceivedCount(pkCount * 2);
+}
+
 int main(int argc, char* argv[]) {
    (void)argc; (void)argv;
    fon9::AutoPrintTestInfo utinfo{"PkCont"};
@@ -109,4 +367,77 @@ int main(int argc, char* argv[]) {
       feeder.Feed(seq + L);
    waiter.WaitFor(feeder.WaitInterval_ + fon9::TimeInterval_Millisecond(1));
    feeder.CheckReceivedCount(pkcount += kGapCount + 1);
+
+   // 序號異常跳躍(超過 PkContWindow::kMaxCapacity): 不可擴充容量, 拋棄超過範圍的封包;
+   // 等候逾時後, 處理保留的封包, 之後就可以接受新的序號範圍.
+   seq += kGapCount + 1;
+   const Feeder::SeqT kHugeGap = (static_cast<Feeder::SeqT>(1) << 32) + 7;
+   std::cout << "[TEST ] PkCont.huge gap|gap=" << kHugeGap << "|seq=" << seq;
+   feeder.ExpectedSeq_ = seq + 1;
+   feeder.Feed(seq + 1);
+   feeder.Feed(seq + kHugeGap);
+   feeder.Feed(seq + 2);
+   {
+      auto pks = feeder.PkPendings_.Lock();
+      CheckResult("pendings", pks->size(), 2);
+      CheckResult("capacity", pks->GetCapacity(), fon9::PkContWindow::kDefaultCapacity);
+   }
+   waiter.WaitFor(feeder.WaitInterval_ + fon9::TimeInterval_Millisecond(1));
+   feeder.CheckReceivedCount(pkcount += 2);
+
+   seq += kHugeGap;
+   feeder.ExpectedSeq_ = seq;
+   std::cout << "[TEST ] PkCont.after huge gap|seq=" << seq;
+   feeder.Feed(seq);
+   feeder.Feed(seq + 1);
+   waiter.WaitFor(feeder.WaitInterval_ + fon9::TimeInterval_Millisecond(1));
+   feeder.CheckReceivedCount(pkcount += 2);
+
+   fon9::PkContWindow window;
+   std::cout << "[TEST ] PkContWindow.huge span";
+   CheckResult("insert.first", window.Insert(10, "a", 1), true);
+   CheckResult("insert.huge", window.Insert(10 + (static_cast<Feeder::SeqT>(1) << 33), "b", 1), false);
+   CheckResult("insert.max", window.Insert(10 + fon9::PkContWindow::kMaxCapacity - 1, "c", 1), true);
+   CheckResult("insert.over", window.Insert(10 + fon9::PkContWindow::kMaxCapacity, "d", 1), false);
+   CheckResult("size", window.size(), 2);
+   CheckResult("capacity", window.GetCapacity(), fon9::PkContWindow::kMaxCapacity);
+   // 加入較小的序號(距離期望序號較近): 移除序號最大的封包.
+   size_t evicted = 0;
+   CheckResult("insert.lower", window.Insert(9, "e", 1, &evicted), true);
+   CheckResult("evicted", evicted, 1);
+   CheckResult("size", window.size(), 2);
+   CheckResult("front", window.front().Seq_, 9);
+   CheckResult("back", window.back().Seq_, 10);
+   std::cout << "\r[OK   ]" << std::endl;
+
+   // 超過重排視窗範圍: 計入 OverflowCount_, 且保留距離期望序號較近的封包, 回補後可以繼續處理.
+   seq += 2;
+   feeder.ExpectedSeq_ = seq;
+   feeder.WaitInterval_ = fon9::TimeInterval_Second(60); // 測試期間不要觸發 timer 強制處理.
+   std::cout << "[TEST ] PkCont.window overflow|seq=" << seq;
+   const Feeder::SeqT overflowCount = feeder.OverflowCount_; // 之前的 huge gap 測試, 已有拋棄的封包.
+   feeder.Feed(seq + 2);
+   feeder.Feed(seq + 2 + fon9::PkContWindow::kMaxCapacity);     // 超過範圍, 拋棄.
+   feeder.Feed(seq + 1 + fon9::PkContWindow::kMaxCapacity);     // 範圍內, 保留.
+   CheckResult("overflow.drop", feeder.OverflowCount_ - overflowCount, 1);
+   feeder.Feed(seq + 1);                                         // 較近的封包: 移除 seq+1+kMaxCapacity.
+   CheckResult("overflow.evict", feeder.OverflowCount_ - overflowCount, 2);
+   feeder.Feed(seq);                                             // 補齊 gap: 處理 seq..seq+2;
+   CheckResult("pendings", feeder.PkPendings_.Lock()->size(), 0);
+   CheckResult("nextSeq", feeder.NextSeq_, seq + 3);
+   feeder.CheckReceivedCount(pkcount += 3);
+
+   utinfo.PrintSplitter();
+   const unsigned kStressCount = 1000 * 1000;
+   TestPkContStress("Reorder", kStressCount, 4, 0, 100);
+   TestPkContStress("Reorder", kStressCount, 64, 0, 100);
+   TestPkContStress("Reorder", kStressCount, 1024, 0, 100);
+   TestPkContStress("GapFill", kStressCount, 0, 100, 100);
+   TestPkContStress("GapFill", kStressCount, 0, 5000, 100);
+   TestPkContStress("Overflow", kStressCount, 64, 0, 1000);
+
+   utinfo.PrintSplitter();
+   TestPkContArbiter(fon9::PkContArbiterArgs::Policy::FirstArrival, kStressCount, waiter);
+   TestPkContArbiter(fon9::PkContArbiterArgs::Policy::PreferPrimary, kStressCount, waiter);
+   TestPkContArbiterSeqReset(1000);
 }
@@ -1,20 +1,273 @@
 ﻿// \file fon9/PkReceiver.cpp
 // \author fonwinz@gmail.com
 #include "fon9/PkReceiver.hpp"
+#include <atomic>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define fon9_PkReceiver_HAVE_X64_SIMD
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#pragma intrinsic(_BitScanForward)
+#define fon9_TARGET_AVX2
+#else
+#define fon9_TARGET_AVX2   __attribute__((target("avx2")))
+#endif
+#endif
 
 namespace fon9 {
 
+//--------------------------------------------------------------------------//
+// Scalar: 一次處理 8 bytes, 剩餘不足 8 bytes 則逐 byte 處理.
+static char XorBytes_Scalar(const char* beg, size_t size) {
+   uint64_t acc = 0;
+   for (; size >= sizeof(acc); size -= sizeof(acc), beg += sizeof(acc)) {
+      uint64_t v;
+      memcpy(&v, beg, sizeof(v));
+      acc ^= v;
+   }
+   acc ^= (acc >> 32);
+   acc ^= (acc >> 16);
+   acc ^= (acc >> 8);
+   unsigned char cks = static_cast<unsigned char>(acc);
+   while (size > 0) {
+      cks = static_cast<unsigned char>(cks ^ static_cast<unsigned char>(*beg++));
+      --size;
+   }
+   return static_cast<char>(cks);
+}
+static const char* FindPkHeadLeader_Scalar(const char* beg, const char* end) {
+   return static_cast<const char*>(memchr(beg, PkReceiver::kPkHeadLeader, static_cast<size_t>(end - beg)));
+}
+
+//--------------------------------------------------------------------------//
+#ifdef fon9_PkReceiver_HAVE_X64_SIMD
+static inline unsigned CountTrailingZero(unsigned mask) {
+#ifdef _MSC_VER
+   unsigned long res;
+   _BitScanForward(&res, mask);
+   return static_cast<unsigned>(res);
+#else
+   return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+}
+static inline char FoldXor128(__m128i acc) {
+   acc = _mm_xor_si128(acc, _mm_srli_si128(acc, 8));
+   acc = _mm_xor_si128(acc, _mm_srli_si128(acc, 4));
+   acc = _mm_xor_si128(acc, _mm_srli_si128(acc, 2));
+   acc = _mm_xor_si128(acc, _mm_srli_si128(acc, 1));
+   return static_cast<char>(_mm_cvtsi128_si32(acc));
+}
+// x64 必定支援 SSE2.
+static char XorBytes_SSE2(const char* beg, size_t size) {
+   __m128i acc = _mm_setzero_si128();
+   if (size >= 64) {
+      // 使用多個 acc, 避免每次 XOR 都要等候前一次的結果.
+      __m128i acc1 = _mm_setzero_si128();
+      __m128i acc2 = _mm_setzero_si128();
+      __m128i acc3 = _mm_setzero_si128();
+      for (; size >= 64; size -= 64, beg += 64) {
+         acc  = _mm_xor_si128(acc,  _mm_loadu_si128(reinterpret_cast<const __m128i*>(beg)));
+         acc1 = _mm_xor_si128(acc1, _mm_loadu_si128(reinterpret_cast<const __m128i*>(beg + 16)));
+         acc2 = _mm_xor_si128(acc2, _mm_loadu_si128(reinterpret_cast<const __m128i*>(beg + 32)));
+         acc3 = _mm_xor_si128(acc3, _mm_loadu_si128(reinterpret_cast<const __m128i*>(beg + 48)));
+      }
+      acc = _mm_xor_si128(_mm_xor_si128(acc, acc1), _mm_xor_si128(acc2, acc3));
+   }
+   for (; size >= 16; size -= 16, beg += 16)
+      acc = _mm_xor_si128(acc, _mm_loadu_si128(reinterpret_cast<const __m128i*>(beg)));
+   return static_cast<char>(FoldXor128(acc) ^ XorBytes_Scalar(beg, size));
+}
+static const char* FindPkHeadLeader_SSE2(const char* beg, const char* end) {
+   const __m128i leader = _mm_set1_epi8(static_cast<char>(PkReceiver::kPkHeadLeader));
+   for (; end - beg >= 16; beg += 16) {
+      const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(beg));
+      if (const unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, leader))))
+         return beg + CountTrailingZero(mask);
+   }
+   return FindPkHeadLeader_Scalar(beg, end);
+}
+
+fon9_TARGET_AVX2 static char XorBytes_AVX2(const char* beg, size_t size) {
+   __m256i acc = _mm256_setzero_si256();
+   if (size >= 128) {
+      __m256i acc1 = _mm256_setzero_si256();
+      __m256i acc2 = _mm256_setzero_si256();
+      __m256i acc3 = _mm256_setzero_si256();
+      for (; size >= 128; size -= 128, beg += 128) {
+         acc  = _mm256_xor_si256(acc,  _mm256_loadu_si256(reinterpret_cast<const __m256i*>(beg)));
+         acc1 = _mm256_xor_si256(acc1, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(beg + 32)));
+         acc2 = _mm256_xor_si256(acc2, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(beg + 64)));
+         acc3 = _mm256_xor_si256(acc3, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(beg + 96)));
+      }
+      acc = _mm256_xor_si256(_mm256_xor_si256(acc, acc1), _mm256_xor_si256(acc2, acc3));
+   }
+   for (; size >= 32; size -= 32, beg += 32)
+      acc = _mm256_xor_si256(acc, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(beg)));
+   __m128i acc128 = _mm_xor_si128(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+   if (size >= 16) {
+      acc128 = _mm_xor_si128(acc128, _mm_loadu_si128(reinterpret_cast<const __m128i*>(beg)));
+      size -= 16;
+      beg += 16;
+   }
+   return static_cast<char>(FoldXor128(acc128) ^ XorBytes_Scalar(beg, size));
+}
+fon9_TARGET_AVX2 static const char* FindPkHeadLeader_AVX2(const char* beg, const char* end) {
+   const __m256i leader = _mm256_set1_epi8(static_cast<char>(PkReceiver::kPkHeadLeader));
+   for (; end - beg >= 32; beg += 32) {
+      const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(beg));
+      if (const unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, leader))))
+         return beg + CountTrailingZero(mask);
+   }
+   return FindPkHeadLeader_SSE2(beg, end);
+}
+
+static bool IsCpuSupportAVX2() {
+#ifdef _MSC_VER
+   int regs[4];
+   __cpuid(regs, 0);
+   if (regs[0] < 7)
+      return false;
+   __cpuid(regs, 1);
+   // OSXSAVE(bit 27) & AVX(bit 28); 且 OS 必須有保存 YMM 暫存器.
+   if ((regs[2] & (3 << 27)) != (3 << 27) || (_xgetbv(0) & 6) != 6)
+      return false;
+   __cpuidex(regs, 7, 0);
+   return (regs[1] & (1 << 5)) != 0;
+#else
+   __builtin_cpu_init();
+   return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+#endif // fon9_PkReceiver_HAVE_X64_SIMD
+
+//--------------------------------------------------------------------------//
+struct PkScanKernels {
+   PkReceiver::ScanImpl Impl_;
+   char (*XorBytes_)(const char* beg, size_t size);
+   const char* (*FindPkHeadLeader_)(const char* beg, const char* end);
+};
+static const PkScanKernels PkScanKernels_Scalar{PkReceiver::ScanImpl::Scalar,
+   &XorBytes_Scalar, &FindPkHeadLeader_Scalar};
+#ifdef fon9_PkReceiver_HAVE_X64_SIMD
+static const PkScanKernels PkScanKernels_SSE2{PkReceiver::ScanImpl::SSE2,
+   &XorBytes_SSE2, &FindPkHeadLeader_SSE2};
+static const PkScanKernels PkScanKernels_AVX2{PkReceiver::ScanImpl::AVX2,
+   &XorBytes_AVX2, &FindPkHeadLeader_AVX2};
+#endif
+
+static const PkScanKernels* GetPkScanKernels(PkReceiver::ScanImpl impl) {
+   switch (impl) {
+   case PkReceiver::ScanImpl::Scalar:
+      return &PkScanKernels_Scalar;
+#ifdef fon9_PkReceiver_HAVE_X64_SIMD
+   case PkReceiver::ScanImpl::SSE2:
+      return &PkScanKernels_SSE2;
+   case PkReceiver::ScanImpl::AVX2:
+      return IsCpuSupportAVX2() ? &PkScanKernels_AVX2 : nullptr;
+#else
+   case PkReceiver::ScanImpl::SSE2:
+   case PkReceiver::ScanImpl::AVX2:
+      break;
+#endif
+   }
+   return nullptr;
+}
+static const PkScanKernels* GetBestPkScanKernels() {
+#ifdef fon9_PkReceiver_HAVE_X64_SIMD
+   return IsCpuSupportAVX2() ? &PkScanKernels_AVX2 : &PkScanKernels_SSE2;
+#else
+   return &PkScanKernels_Scalar;
+#endif
+}
+// 在 static 初始化完成前(例: 其他 static 物件的建構), 使用 Scalar 版.
+static std::atomic<const PkScanKernels*>  PkScanKernels_{&PkScanKernels_Scalar};
+static const bool PkScanKernels_Init_ = (PkScanKernels_.store(GetBestPkScanKernels(), std::memory_order_relaxed), true);
+
+static inline const PkScanKernels& CurrPkScanKernels() {
+   return *PkScanKernels_.load(std::memory_order_relaxed);
+}
+
+bool PkReceiver::SetScanImpl(ScanImpl impl) {
+   if (const PkScanKernels* k = GetPkScanKernels(impl)) {
+      PkScanKernels_.store(k, std::memory_order_relaxed);
+      return true;
+   }
+   return false;
+}
+PkReceiver::ScanImpl PkReceiver::GetScanImpl() {
+   return CurrPkScanKernels().Impl_;
+}
+PkReceiver::ScanImpl PkReceiver::GetBestScanImpl() {
+   return GetBestPkScanKernels()->Impl_;
+}
+const char* PkReceiver::GetScanImplName(ScanImpl impl) {
+   switch (impl) {
+   case ScanImpl::Scalar:  return "Scalar";
+   case ScanImpl::SSE2:    return "SSE2";
+   case ScanImpl::AVX2:    return "AVX2";
+   }
+   return "?";
+}
+char PkReceiver::XorBytes(const char* beg, size_t size) {
+   return CurrPkScanKernels().XorBytes_(beg, size);
+}
+const char* PkReceiver::FindPkHeadLeader(const char* beg, const char* end) {
+   return CurrPkScanKernels().FindPkHeadLeader_(beg, end);
+}
+
+/// 移除 rxbuf 前端不是 kPkHeadLeader 的資料, 傳回移除的資料量.
+static size_t PopUnknownPkHeadLeader(DcQueue& rxbuf) {
+   size_t removedBytes = 0;
+   for (;;) {
+      auto blk = rxbuf.PeekCurrBlock();
+      if (blk.first == nullptr)
+         break;
+      const char* beg = reinterpret_cast<const char*>(blk.first);
+      if (const char* pch = PkReceiver::FindPkHeadLeader(beg, beg + blk.second)) {
+         if (const size_t sz = static_cast<size_t>(pch - beg)) {
+            removedBytes += sz;
+            rxbuf.PopConsumed(sz);
+         }
+         break;
+      }
+      rxbuf.PopConsumed(blk.second);
+      removedBytes += blk.second;
+   }
+   return removedBytes;
+}
+
+//--------------------------------------------------------------------------//
+
 PkReceiver::~PkReceiver() {
 }
+const void* PkReceiver::PeekStitched(DcQueue& rxbuf, unsigned sz) {
+   if (!this->StitchBuf_) {
+      // 資料量不足時(例: rxbuf 已用完), 不用分配暫存區.
+      if (!rxbuf.IsSizeEnough(sz))
+         return nullptr;
+      this->StitchBuf_.reset(new char[kMaxPacketSize]);
+   }
+   return rxbuf.Peek(this->StitchBuf_.get(), sz);
+}
 bool PkReceiver::FeedBuffer(DcQueue& rxbuf) {
-   char  peekbuf[kMaxPacketSize];
-   while (const void* pkptr = rxbuf.Peek(peekbuf, this->PkHeadSize_)) {
+   for (;;) {
+      const void* pkptr = rxbuf.Peek1();
+      if (fon9_UNLIKELY(rxbuf.GetCurrBlockSize() < this->PkHeadSize_)) {
+         if ((pkptr = this->PeekStitched(rxbuf, this->PkHeadSize_)) == nullptr)
+            break;
+      }
       if (fon9_LIKELY(*static_cast<const char*>(pkptr) == this->kPkHeadLeader)) {
          const unsigned  pksz = this->GetPkSize(pkptr);
          if (fon9_LIKELY(this->PkHeadSize_ + 2 < pksz && pksz < kMaxPacketSize)) {
-            pkptr = rxbuf.Peek(peekbuf, pksz);
-            if (fon9_UNLIKELY(pkptr == nullptr)) // rxbuf 資料不足 Length_
-               break;
+            const bool isContiguous = (pksz <= rxbuf.GetCurrBlockSize());
+            if (fon9_LIKELY(isContiguous))
+               pkptr = rxbuf.Peek1();
+            else {
+               pkptr = this->PeekStitched(rxbuf, pksz);
+               if (fon9_UNLIKELY(pkptr == nullptr)) // rxbuf 資料不足 Length_
+                  break;
+            }
             // rxbuf 的資料長度足夠一個封包.
             const char* pkL = static_cast<const char*>(pkptr);
             if (fon9_LIKELY(pkL[pksz - 2] == 0x0d && pkL[pksz - 1] == 0x0a)) {
@@ -22,6 +275,10 @@ bool PkReceiver::FeedBuffer(DcQueue& rxbuf) {
                if (fon9_LIKELY(CalcCheckSum(pkL, pksz + 1) == 0)) {
                   // CheckSum 正確, 解析封包內容.
                   ++this->ReceivedCount_;
+                  if (fon9_LIKELY(isContiguous))
+                     ++this->ContiguousCount_;
+                  else
+                     ++this->StitchedCount_;
                   if (!this->OnPkReceived(pkptr, pksz)) {
                      rxbuf.PopConsumed(pksz);
                      return false;
@@ -38,7 +295,7 @@ bool PkReceiver::FeedBuffer(DcQueue& rxbuf) {
          rxbuf.PopConsumed(1);
          ++this->DroppedBytes_;
       } // else: first code is not this->PkHeadLeader_.
-      this->DroppedBytes_ += rxbuf.PopUnknownChar(this->kPkHeadLeader);
+      this->DroppedBytes_ += PopUnknownPkHeadLeader(rxbuf);
    }
    if (this->IsDgram_ && rxbuf.Peek1()) {
       if (size_t remain = rxbuf.CalcSize()) {
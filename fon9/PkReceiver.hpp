@@ -3,6 +3,7 @@
 #ifndef __fon9_PkReceiver_hpp__
 #define __fon9_PkReceiver_hpp__
 #include "fon9/buffer/DcQueue.hpp"
+#include <memory> // std::unique_ptr
 
 namespace fon9 {
 
@@ -38,37 +39,66 @@ public:
    /// - 返回時機: rxbuf 用完, 或 rxbuf 剩餘資料不足一個封包.
    /// - 封包框架正確 & CheckSum 正確, 則會呼叫 OnPkReceived() 通知衍生者.
    ///
+   /// - 若封包完整位於 rxbuf 的目前節點, 則直接使用節點內的資料呼叫 OnPkReceived(), 不會複製;
+   ///   只有跨越多個節點的封包, 才會先複製到暫存區.
+   ///
    /// \retval false 呼叫 OnPkReceived() 時返回 false, 中斷 FeedBuffer();
    /// \retval true  rxbuf 資料不足, 或已解析完畢.
    bool FeedBuffer(DcQueue& rxbuf);
 
+   /// 計算封包的 CheckSum: XOR(pkL[1] .. pkL[pksz-4]).
+   /// - 排除 kPkHeadLeader, 及最後 3 bytes(CheckSum, 0x0d, 0x0a).
+   /// - 若 pksz 包含 CheckSum(例: 傳入 pksz + 1), 則正確的封包應傳回 0.
    static char CalcCheckSum(const char* pkL, unsigned pksz) {
-      const char* pkend = pkL + pksz - 4; // -4 = 排除 kPkHeadLeader, CheckSum, 0x0d, 0x0a.
-      char        cks = *++pkL; // ++pk = 排除 kPkHeadLeader.
-      while (pkL != pkend) {
-         fon9_GCC_WARN_DISABLE("-Wconversion");
-         cks ^= *++pkL;
-         fon9_GCC_WARN_POP;
-      }
-      return cks;
+      return XorBytes(pkL + 1, pksz - 4);
    }
 
+   /// CalcCheckSum(), FindPkHeadLeader() 使用的實作方式.
+   /// 程式啟動時, 會依照 CPU 支援的指令集, 自動選擇最快的實作.
+   enum class ScanImpl : uint8_t {
+      Scalar,
+      SSE2,
+      AVX2,
+   };
+   /// 強制使用指定的實作, 例: 效率測試時, 比較不同實作的差異.
+   /// \retval false CPU 不支援 impl, 不改變目前的設定.
+   static bool SetScanImpl(ScanImpl impl);
+   static ScanImpl GetScanImpl();
+   /// 此 CPU 可用的最快實作.
+   static ScanImpl GetBestScanImpl();
+   static const char* GetScanImplName(ScanImpl impl);
+
+   /// 計算 [beg..beg+size) 每個 byte 的 XOR.
+   static char XorBytes(const char* beg, size_t size);
+   /// 在 [beg..end) 之間尋找 kPkHeadLeader.
+   /// \retval nullptr 找不到.
+   static const char* FindPkHeadLeader(const char* beg, const char* end);
+
    void ClearStatus() {
       this->ReceivedCount_ = 0;
       this->ChkSumErrCount_ = 0;
       this->DroppedBytes_ = 0;
+      this->ContiguousCount_ = 0;
+      this->StitchedCount_ = 0;
    }
 
    /// this->OnPkReceived(); 的呼叫次數.
    uint64_t GetReceivedCount()  const { return this->ReceivedCount_;  }
    uint64_t GetChkSumErrCount() const { return this->ChkSumErrCount_; }
    uint64_t GetDroppedBytes()   const { return this->DroppedBytes_;   }
+   /// 封包完整位於 rxbuf 的單一節點, 不需要複製的數量.
+   /// 與 StitchedCount 相同, 只計算尾碼及 CheckSum 正確的封包, 所以兩者的合計 = ReceivedCount.
+   uint64_t GetContiguousCount() const { return this->ContiguousCount_; }
+   /// 封包跨越 rxbuf 的多個節點, 需要複製到暫存區的數量.
+   uint64_t GetStitchedCount()   const { return this->StitchedCount_;   }
 
 protected:
    char     Padding___[3];
    uint64_t ReceivedCount_{0};
    uint64_t ChkSumErrCount_{0};
    uint64_t DroppedBytes_{0};
+   uint64_t ContiguousCount_{0};
+   uint64_t StitchedCount_{0};
 
    /// 當收到 Head 時通知, 由衍生者計算封包大小.
    /// 返回完整封包大小(包含: Head、Body、Tail).
@@ -77,6 +107,13 @@ protected:
    /// \retval false 結束 FeedBuffer();
    /// \retval true  繼續 FeedBuffer();
    virtual bool OnPkReceived(const void* pk, unsigned pksz) = 0;
+
+private:
+   /// 跨越節點的封包, 複製到這裡; 在第一次需要時才分配 kMaxPacketSize.
+   std::unique_ptr<char[]> StitchBuf_;
+   /// rxbuf 目前節點的資料量不足 sz 時, 將資料複製到 this->StitchBuf_.
+   /// \retval nullptr rxbuf 的資料量不足 sz.
+   const void* PeekStitched(DcQueue& rxbuf, unsigned sz);
 };
 
 } // namespaces
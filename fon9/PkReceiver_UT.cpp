@@ -0,0 +1,234 @@
+﻿// \file fon9/PkReceiver_UT.cpp
+//
+// 測試 PkReceiver 的 CheckSum 及封包框架搜尋(Scalar/SSE2/AVX2), 並比較各種實作的效率.
+//
+// \author fonwinz@gmail.com
+#define _CRT_SECURE_NO_WARNINGS
+#include "fon9/PkReceiver.hpp"
+#include "fon9/TestTools.hpp"
+#include "fon9/Endian.hpp"
+#include "fon9/buffer/DcQueueList.hpp"
+#include "fon9/buffer/FwdBufferList.hpp"
+
+using ScanImpl = fon9::PkReceiver::ScanImpl;
+static const ScanImpl   ScanImplList[] = {ScanImpl::Scalar, ScanImpl::SSE2, ScanImpl::AVX2};
+
+fon9_NOINLINE(static char XorBytes_Ref(const char* beg, size_t size));
+static char XorBytes_Ref(const char* beg, size_t size) {
+   char cks = 0;
+   while (size-- > 0)
+      cks = static_cast<char>(cks ^ *beg++);
+   return cks;
+}
+static void CheckResult(bool isOK, const char* msg, size_t pos, size_t size) {
+   if (isOK)
+      return;
+   std::cout << "|err=" << msg << "|pos=" << pos << "|size=" << size << "\r[ERROR]" << std::endl;
+   abort();
+}
+
+static void TestScanKernels(ScanImpl impl) {
+   std::cout << "[TEST ] " << fon9::PkReceiver::GetScanImplName(impl) << std::flush;
+   // buf 前端保留一些空間, 用來測試不同的對齊位置.
+   char  buf[64 + 300 + 2];
+   for (size_t L = 0; L < sizeof(buf); ++L)
+      buf[L] = static_cast<char>(L % 26 + 'A'); // 避開 kPkHeadLeader 及 0x0d, 0x0a.
+   for (size_t ofs = 0; ofs < 64; ++ofs) {
+      char* const beg = buf + ofs;
+      for (size_t size = 0; size <= 300; ++size) {
+         char* const end = beg + size;
+         CheckResult(fon9::PkReceiver::XorBytes(beg, size) == XorBytes_Ref(beg, size), "XorBytes", ofs, size);
+         CheckResult(fon9::PkReceiver::FindPkHeadLeader(beg, end) == nullptr, "FindPkHeadLeader:NotFound", ofs, size);
+         // 每個位置都測試一次.
+         for (size_t pos = 0; pos < size; ++pos) {
+            const char old0 = beg[pos];
+            beg[pos] = fon9::PkReceiver::kPkHeadLeader;
+            CheckResult(fon9::PkReceiver::FindPkHeadLeader(beg, end) == beg + pos, "FindPkHeadLeader", pos, size);
+            beg[pos] = old0;
+         }
+      }
+   }
+   std::cout << "\r[OK   ]" << std::endl;
+}
+
+//--------------------------------------------------------------------------//
+// 測試用的封包格式: kPkHeadLeader + Length(BigEndian uint16) + Body + CheckSum + 0x0d + 0x0a
+struct TestPkReceiver : public fon9::PkReceiver {
+   fon9_NON_COPY_NON_MOVE(TestPkReceiver);
+   using base = fon9::PkReceiver;
+   uint64_t BodyBytes_{0};
+   TestPkReceiver() : base{3} {
+   }
+   unsigned GetPkSize(const void* pkptr) override {
+      return fon9::GetBigEndian<uint16_t>(static_cast<const char*>(pkptr) + 1);
+   }
+   bool OnPkReceived(const void* pk, unsigned pksz) override {
+      (void)pk;
+      this->BodyBytes_ += pksz;
+      return true;
+   }
+   bool IsSameResult(const TestPkReceiver& rhs) const {
+      return this->ReceivedCount_ == rhs.ReceivedCount_
+         && this->ChkSumErrCount_ == rhs.ChkSumErrCount_
+         && this->DroppedBytes_ == rhs.DroppedBytes_
+         && this->BodyBytes_ == rhs.BodyBytes_;
+   }
+   void PrintResult() const {
+      std::cout << "|ReceivedCount=" << this->ReceivedCount_
+         << "|ChkSumErrCount=" << this->ChkSumErrCount_
+         << "|DroppedBytes=" << this->DroppedBytes_;
+   }
+};
+/// 建立 pkCount 個封包, 封包大小在 [minSize..maxSize] 之間,
+/// 每 64 個封包插入一段垃圾資料, 每 100 個封包有一個 CheckSum 錯誤.
+static std::string MakeTestPackets(unsigned pkCount, unsigned minSize, unsigned maxSize) {
+   std::string pks;
+   uint32_t    rnd = 1;
+   for (unsigned L = 0; L < pkCount; ++L) {
+      rnd = rnd * 1103515245 + 12345;
+      const unsigned pksz = minSize + (rnd >> 8) % (maxSize - minSize + 1);
+      const size_t   ipk = pks.size();
+      pks.resize(ipk + pksz);
+      char* pk = &pks[ipk];
+      pk[0] = fon9::PkReceiver::kPkHeadLeader;
+      fon9::PutBigEndian(pk + 1, static_cast<uint16_t>(pksz));
+      for (unsigned i = 3; i < pksz - 3; ++i)
+         pk[i] = static_cast<char>(((rnd >> 16) + i) % 10 + '0');
+      pk[pksz - 3] = fon9::PkReceiver::XorBytes(pk + 1, pksz - 4);
+      if (L % 100 == 99)
+         ++pk[pksz - 3];
+      pk[pksz - 2] = 0x0d;
+      pk[pksz - 1] = 0x0a;
+      if (L % 64 == 63)
+         pks.append(static_cast<size_t>(rnd % 1000 + 1), 'x');
+   }
+   return pks;
+}
+
+static void TestFeedBuffer(const std::string& pks, unsigned pkCount, const char* msg, unsigned times) {
+   std::cout << "--- " << msg << "|bytes=" << pks.size() << "|pkCount=" << pkCount << std::endl;
+   std::unique_ptr<TestPkReceiver> firstResult;
+   for (ScanImpl impl : ScanImplList) {
+      if (!fon9::PkReceiver::SetScanImpl(impl))
+         continue;
+      std::unique_ptr<TestPkReceiver> pkReceiver;
+      fon9::StopWatch stopWatch;
+      for (unsigned L = 0; L < times; ++L) {
+         pkReceiver.reset(new TestPkReceiver);
+         fon9::DcQueueFixedMem dcq{pks.data(), pks.size()};
+         pkReceiver->FeedBuffer(dcq);
+      }
+      const double span = stopWatch.StopTimer();
+      if (!firstResult)
+         firstResult = std::move(pkReceiver);
+      else if (!pkReceiver->IsSameResult(*firstResult)) {
+         pkReceiver->PrintResult();
+         std::cout << "|err=Result not same as first.\r[ERROR]" << std::endl;
+         abort();
+      }
+      char implmsg[64];
+      sprintf(implmsg, "FeedBuffer|%-6s", fon9::PkReceiver::GetScanImplName(impl));
+      fon9::StopWatch::PrintResultNoEOL(span, implmsg, firstResult->GetReceivedCount() * times);
+      std::cout << std::endl;
+   }
+   firstResult->PrintResult();
+   std::cout << std::endl;
+   if (firstResult->GetReceivedCount() != pkCount - pkCount / 100
+       || firstResult->GetChkSumErrCount() != pkCount / 100) {
+      std::cout << "|err=Unexpected ReceivedCount or ChkSumErrCount.\r[ERROR]" << std::endl;
+      abort();
+   }
+}
+
+/// 比較各種實作的 XorBytes() 效率, Bytewise = 原本逐 byte 計算的方式.
+/// 只使用 pks 前端 64K, 避免測到的是記憶體頻寬.
+static void TestXorBytesSpeed(const std::string& pks, unsigned chunkSize, unsigned times) {
+   const char* const pbeg = pks.data();
+   const size_t      chunkCount = std::min(pks.size(), static_cast<size_t>(64 * 1024)) / chunkSize;
+   const uint64_t    runCount = static_cast<uint64_t>(chunkCount) * times;
+   char              msg[64];
+   char              cks = 0;
+   fon9::StopWatch   stopWatch;
+   for (unsigned L = 0; L < times; ++L) {
+      for (size_t i = 0; i < chunkCount; ++i)
+         cks = static_cast<char>(cks ^ XorBytes_Ref(pbeg + i * chunkSize, chunkSize));
+   }
+   sprintf(msg, "XorBytes(%u)|Bytewise", chunkSize);
+   stopWatch.PrintResult(msg, runCount);
+   for (ScanImpl impl : ScanImplList) {
+      if (!fon9::PkReceiver::SetScanImpl(impl))
+         continue;
+      char cksImpl = 0;
+      stopWatch.ResetTimer();
+      for (unsigned L = 0; L < times; ++L) {
+         for (size_t i = 0; i < chunkCount; ++i)
+            cksImpl = static_cast<char>(cksImpl ^ fon9::PkReceiver::XorBytes(pbeg + i * chunkSize, chunkSize));
+      }
+      sprintf(msg, "XorBytes(%u)|%-8s", chunkSize, fon9::PkReceiver::GetScanImplName(impl));
+      stopWatch.PrintResult(msg, runCount);
+      CheckResult(cks == cksImpl, "XorBytes:Speed", 0, chunkSize);
+   }
+}
+
+/// 將 pks 切成 step 大小的節點放入 DcQueueList, 檢查:
+/// - 結果與一次餵入相同.
+/// - 跨節點的封包數量(StitchedCount) 正確.
+/// - ContiguousCount + StitchedCount 只計算 CheckSum 正確的封包(= ReceivedCount).
+static void TestFeedStitched(const std::string& pks, size_t step) {
+   std::cout << "[TEST ] FeedStitched|step=" << step << std::flush;
+   TestPkReceiver pkAll;
+   fon9::DcQueueFixedMem dcqAll{pks.data(), pks.size()};
+   pkAll.FeedBuffer(dcqAll);
+   CheckResult(pkAll.GetStitchedCount() == 0, "FeedAll:StitchedCount!=0", 0, pks.size());
+   CheckResult(pkAll.GetContiguousCount() == pkAll.GetReceivedCount() && pkAll.GetChkSumErrCount() > 0,
+               "FeedAll:ContiguousCount!=ReceivedCount", 0, pks.size());
+
+   TestPkReceiver   pkStep;
+   fon9::BufferList buf;
+   for (size_t pos = 0; pos < pks.size(); pos += step) {
+      // 每 step 一個節點, 不使用 AppendToBuffer(), 避免填入前一個節點的剩餘空間.
+      const size_t         sz = std::min(step, pks.size() - pos);
+      fon9::FwdBufferNode* node = fon9::FwdBufferNode::Alloc(sz);
+      memcpy(node->GetDataEnd(), pks.data() + pos, sz);
+      node->SetDataEnd(node->GetDataEnd() + sz);
+      buf.push_back(node);
+   }
+   fon9::DcQueueList dcqStep{std::move(buf)};
+   pkStep.FeedBuffer(dcqStep);
+   CheckResult(pkStep.IsSameResult(pkAll), "FeedStitched:Result", 0, step);
+   CheckResult(pkStep.GetContiguousCount() + pkStep.GetStitchedCount() == pkStep.GetReceivedCount(),
+               "FeedStitched:Count", 0, step);
+   std::cout << "|contiguous=" << pkStep.GetContiguousCount()
+             << "|stitched=" << pkStep.GetStitchedCount();
+   CheckResult(pkStep.GetStitchedCount() > 0 || step >= pks.size(), "FeedStitched:StitchedCount==0", 0, step);
+   std::cout << "\r[OK   ]" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+   (void)argc; (void)argv;
+   fon9::AutoPrintTestInfo utinfo{"PkReceiver"};
+   const ScanImpl bestImpl = fon9::PkReceiver::GetBestScanImpl();
+   std::cout << "BestScanImpl=" << fon9::PkReceiver::GetScanImplName(bestImpl) << std::endl;
+
+   for (ScanImpl impl : ScanImplList) {
+      if (fon9::PkReceiver::SetScanImpl(impl))
+         TestScanKernels(impl);
+      else
+         std::cout << "[SKIP ] " << fon9::PkReceiver::GetScanImplName(impl) << ": Not supported." << std::endl;
+   }
+
+   const std::string stitchPks = MakeTestPackets(1000, 40, 200);
+   for (size_t step : {1u, 7u, 64u, 1000u, 4096u})
+      TestFeedStitched(stitchPks, step);
+
+   utinfo.PrintSplitter();
+   const unsigned kPkCount = 1000 * 100;
+   const std::string smallPks = MakeTestPackets(kPkCount, 40, 200);
+   TestFeedBuffer(smallPks, kPkCount, "Small packets", 20);
+   TestFeedBuffer(MakeTestPackets(kPkCount, 500, 1500), kPkCount, "Large packets", 5);
+
+   utinfo.PrintSplitter();
+   TestXorBytesSpeed(smallPks, 100, 2000);
+   TestXorBytesSpeed(smallPks, 1000, 2000);
+   fon9::PkReceiver::SetScanImpl(bestImpl);
+}
@@ -0,0 +1,147 @@
+﻿/// \file fon9/SpscRing.hpp
+/// \author fonwinz@gmail.com
+#ifndef __fon9_SpscRing_hpp__
+#define __fon9_SpscRing_hpp__
+#include "fon9/sys/Config.hpp"
+
+fon9_BEFORE_INCLUDE_STD
+#include <atomic>
+#include <memory>
+#include <cstring>
+#include <cassert>
+fon9_AFTER_INCLUDE_STD
+
+namespace fon9 {
+
+fon9_WARN_DISABLE_PADDING;
+/// \ingroup Thrs
+/// 固定容量、不定長度封包的 lock-free 環狀緩衝區.
+/// - 1 個 producer, 依序經過 kStageCount 個 consumer(stage) 處理, 例:
+///   - receive thread(producer) => decode thread(stage 1) => publish thread(stage 2);
+///   - stage n 只能取得 stage n-1 已處理完畢的封包, 最後一個 stage 處理完畢後, 才會釋放空間.
+///   - 每個 cursor 只會由 1 個 thread 寫入, 所以相鄰的 2 個 stage 之間, 就是一個 SPSC 的關係.
+/// - 同一個 stage 若有多個 thread 呼叫, 則必須由使用者確保「不會同時」呼叫.
+///   例: 多條線路餵入同一個 producer, 但由 producer 端的 mutex 保護.
+/// - 封包在 ring 裡面是連續的記憶體, 不會跨越尾端:
+///   若尾端剩餘空間不足, 則尾端剩餘空間會放一個 skip 記號, 封包從頭開始存放.
+template <unsigned kStageCount = 1>
+class SpscPkRing {
+   fon9_NON_COPY_NON_MOVE(SpscPkRing);
+   static_assert(kStageCount > 0, "SpscPkRing: kStageCount must > 0.");
+public:
+   using PosT = uint64_t;
+   using PkSizeT = uint32_t;
+   enum : PkSizeT {
+      kPkAlign = 8,
+      kPkHeadSize = 8,
+      kSkipMark = 0xffffffff,
+   };
+
+   /// capacity 會調整成 2 的冪次, 最少為 4K bytes.
+   explicit SpscPkRing(size_t capacity) {
+      PosT cap = 4 * 1024;
+      while (cap < capacity)
+         cap <<= 1;
+      this->Capacity_ = cap;
+      this->Mask_ = cap - 1;
+      this->Buffer_.reset(new uint64_t[cap / sizeof(uint64_t)]);
+   }
+
+   PosT GetCapacity() const {
+      return this->Capacity_;
+   }
+   /// 可放入的最大封包大小.
+   PkSizeT GetMaxPkSize() const {
+      return static_cast<PkSizeT>(this->Capacity_ / 2 - kPkHeadSize);
+   }
+   /// 是否全部的封包都已經過最後一個 stage 處理完畢?
+   bool IsEmpty() const {
+      return this->Cursors_[0].Pos_.load(std::memory_order_acquire)
+         == this->Cursors_[kStageCount].Pos_.load(std::memory_order_acquire);
+   }
+   /// stage 是否還有尚未處理的封包?
+   bool IsStageEmpty(unsigned stage) const {
+      assert(0 < stage && stage <= kStageCount);
+      return this->Cursors_[stage - 1].Pos_.load(std::memory_order_acquire)
+         == this->Cursors_[stage].Pos_.load(std::memory_order_relaxed);
+   }
+
+   /// producer: 分配一個 pksz 大小的封包空間.
+   /// - 傳回 nullptr 表示空間不足(或 pksz > GetMaxPkSize()), 可稍後再試.
+   /// - 填妥內容後, 必須呼叫 Commit() 才會讓 stage 1 看見.
+   /// - 在 Commit() 之前, 不可再次呼叫 Alloc().
+   void* Alloc(PkSizeT pksz) {
+      if (fon9_UNLIKELY(pksz > this->GetMaxPkSize()))
+         return nullptr;
+      const PosT need = CalcPkSpace(pksz);
+      PosT       wpos = this->Cursors_[0].Pos_.load(std::memory_order_relaxed);
+      const PosT tail = this->Capacity_ - (wpos & this->Mask_);
+      const PosT skip = (tail < need ? tail : 0);
+      if (wpos + skip + need - this->Cursors_[kStageCount].Pos_.load(std::memory_order_acquire) > this->Capacity_)
+         return nullptr;
+      if (skip) {
+         *this->PkHead(wpos) = kSkipMark;
+         wpos += skip;
+      }
+      this->AllocPos_ = wpos + need;
+      PkSizeT* phead = this->PkHead(wpos);
+      *phead = pksz;
+      return reinterpret_cast<char*>(phead) + kPkHeadSize;
+   }
+   /// producer: 讓 stage 1 可以取得 Alloc() 的封包.
+   void Commit() {
+      assert(this->AllocPos_ > this->Cursors_[0].Pos_.load(std::memory_order_relaxed));
+      this->Cursors_[0].Pos_.store(this->AllocPos_, std::memory_order_release);
+   }
+
+   /// stage consumer: 取得 stage 的下一個封包.
+   /// - 傳回 nullptr 表示沒有封包.
+   /// - 處理完畢後, 必須呼叫 Consume(stage) 才會移到下一個封包.
+   void* Peek(unsigned stage, PkSizeT& pksz) {
+      assert(0 < stage && stage <= kStageCount);
+      const PosT rpos = this->Cursors_[stage].Pos_.load(std::memory_order_relaxed);
+      if (rpos == this->Cursors_[stage - 1].Pos_.load(std::memory_order_acquire))
+         return nullptr;
+      PkSizeT* phead = this->PkHead(this->SkipMark(rpos));
+      pksz = *phead;
+      return reinterpret_cast<char*>(phead) + kPkHeadSize;
+   }
+   /// stage consumer: 移到下一個封包.
+   /// 必須確定 stage 有封包(Peek() 有傳回封包), 才能呼叫.
+   void Consume(unsigned stage) {
+      assert(0 < stage && stage <= kStageCount);
+      assert(!this->IsStageEmpty(stage));
+      PosT rpos = this->SkipMark(this->Cursors_[stage].Pos_.load(std::memory_order_relaxed));
+      rpos += CalcPkSpace(*this->PkHead(rpos));
+      this->Cursors_[stage].Pos_.store(rpos, std::memory_order_release);
+   }
+
+private:
+   static PosT CalcPkSpace(PkSizeT pksz) {
+      return kPkHeadSize + ((static_cast<PosT>(pksz) + (kPkAlign - 1)) & ~static_cast<PosT>(kPkAlign - 1));
+   }
+   PkSizeT* PkHead(PosT pos) const {
+      return reinterpret_cast<PkSizeT*>(reinterpret_cast<char*>(this->Buffer_.get()) + (pos & this->Mask_));
+   }
+   PosT SkipMark(PosT pos) const {
+      if (*this->PkHead(pos) == kSkipMark)
+         pos += this->Capacity_ - (pos & this->Mask_);
+      return pos;
+   }
+
+   /// 每個 cursor 獨佔一個 cache line, 避免 false sharing.
+   struct Cursor {
+      std::atomic<PosT> Pos_{0};
+      char              Padding_[64 - sizeof(std::atomic<PosT>)];
+   };
+   Cursor   Cursors_[kStageCount + 1];
+   /// 由 producer 使用: Alloc() 之後, Commit() 時要設定的位置.
+   PosT     AllocPos_{0};
+   PosT     Capacity_;
+   PosT     Mask_;
+   std::unique_ptr<uint64_t[]> Buffer_;
+};
+fon9_WARN_POP;
+
+} // namespace fon9
+#endif//__fon9_SpscRing_hpp__
@@ -0,0 +1,109 @@
+﻿/// \file fon9/SpscRing_UT.cpp
+///
+/// 測試 SpscPkRing:
+/// - 1 個 producer thread 放入不定長度的封包.
+/// - stage 1 thread: 檢查封包內容及順序, 並在封包內填入檢查碼.
+/// - stage 2 thread: 檢查 stage 1 填入的檢查碼.
+///
+/// >SpscRing_UT [pkCount ringSize]
+///
+/// \author fonwinz@gmail.com
+#include "fon9/SpscRing.hpp"
+#include "fon9/TestTools.hpp"
+#include "fon9/StrTo.hpp"
+#include <thread>
+
+//--------------------------------------------------------------------------//
+
+using PkRing = fon9::SpscPkRing<2>;
+
+struct TestPkHead {
+   uint64_t Seq_;
+   uint64_t Stage1Mark_;
+};
+inline PkRing::PkSizeT TestPkSize(uint64_t seq) {
+   return static_cast<PkRing::PkSizeT>(sizeof(TestPkHead) + (seq * 7) % 500);
+}
+inline char TestPkByte(uint64_t seq) {
+   return static_cast<char>('A' + seq % 26);
+}
+
+void RunProducer(PkRing& ring, uint64_t pkCount) {
+   for (uint64_t seq = 1; seq <= pkCount; ++seq) {
+      const PkRing::PkSizeT pksz = TestPkSize(seq);
+      void* pk;
+      while ((pk = ring.Alloc(pksz)) == nullptr)
+         std::this_thread::yield();
+      TestPkHead* head = static_cast<TestPkHead*>(pk);
+      head->Seq_ = seq;
+      head->Stage1Mark_ = 0;
+      memset(head + 1, TestPkByte(seq), pksz - sizeof(TestPkHead));
+      ring.Commit();
+   }
+}
+uint64_t RunStage(PkRing& ring, unsigned stage, uint64_t pkCount) {
+   uint64_t errCount = 0;
+   uint64_t expectedSeq = 1;
+   while (expectedSeq <= pkCount) {
+      PkRing::PkSizeT pksz;
+      void* pk = ring.Peek(stage, pksz);
+      if (pk == nullptr) {
+         std::this_thread::yield();
+         continue;
+      }
+      TestPkHead* head = static_cast<TestPkHead*>(pk);
+      if (head->Seq_ != expectedSeq || pksz != TestPkSize(expectedSeq))
+         ++errCount;
+      if (stage == 1) {
+         const char* pbeg = reinterpret_cast<const char*>(head + 1);
+         const char* pend = reinterpret_cast<const char*>(pk) + pksz;
+         const char  ch = TestPkByte(expectedSeq);
+         for (; pbeg != pend; ++pbeg) {
+            if (*pbeg != ch) {
+               ++errCount;
+               break;
+            }
+         }
+         head->Stage1Mark_ = ~head->Seq_;
+      }
+      else if (head->Stage1Mark_ != ~head->Seq_)
+         ++errCount;
+      ring.Consume(stage);
+      ++expectedSeq;
+   }
+   return errCount;
+}
+
+void TestSpscRing(uint64_t pkCount, size_t ringSize) {
+   PkRing   ring{ringSize};
+   uint64_t errCount1 = 0, errCount2 = 0;
+   char     msg[128];
+   sprintf(msg, "SpscPkRing|capacity=%-8u", static_cast<unsigned>(ring.GetCapacity()));
+
+   fon9::StopWatch stopWatch;
+   std::thread     stage1{[&]() { errCount1 = RunStage(ring, 1, pkCount); }};
+   std::thread     stage2{[&]() { errCount2 = RunStage(ring, 2, pkCount); }};
+   RunProducer(ring, pkCount);
+   stage1.join();
+   stage2.join();
+   stopWatch.PrintResultNoEOL(msg, pkCount)
+      << "|err1=" << errCount1 << "|err2=" << errCount2 << std::endl;
+   if (errCount1 || errCount2 || !ring.IsEmpty()) {
+      std::cout << "[ERROR] isEmpty=" << ring.IsEmpty() << std::endl;
+      abort();
+   }
+}
+
+int main(int argc, char** argv) {
+   fon9::AutoPrintTestInfo utinfo{"SpscRing"};
+
+   const uint64_t pkCount = (argc > 1 ? fon9::StrTo(fon9::StrView_cstr(argv[1]), 0u) : 0u);
+   const size_t   ringSize = (argc > 2 ? fon9::StrTo(fon9::StrView_cstr(argv[2]), 0u) : 0u);
+   if (ringSize > 0) {
+      TestSpscRing(pkCount ? pkCount : 10000000u, ringSize);
+      return 0;
+   }
+   static const size_t ringSizeList[] = {4 * 1024, 64 * 1024, 1024 * 1024};
+   for (size_t sz : ringSizeList)
+      TestSpscRing(pkCount ? pkCount : 10000000u, sz);
+}
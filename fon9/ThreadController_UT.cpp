@@ -2,6 +2,7 @@
 // \author fonwinz@gmail.com
 #include "fon9/Worker.hpp"
 #include "fon9/MessageQueue.hpp"
+#include "fon9/DefaultThreadPool.hpp"
 #include "fon9/TestTools.hpp"
 
 //--------------------------------------------------------------------------//
@@ -263,6 +264,253 @@ public:
 
 //--------------------------------------------------------------------------//
 
+// 比較 DefaultThreadPool(work stealing) 與「共用一個 MessageQueue」的 thread pool.
+// - 4 個 thread 同時加入工作, 每個工作有 1/8 的機率, 會在 pool 的 thread 裡面再加入一個工作.
+// - 檢查全部的工作都有執行.
+struct FuncTaskHandler {
+   using MessageType = std::function<void()>;
+   using FuncQueue = fon9::MessageQueue<FuncTaskHandler>;
+   FuncTaskHandler(FuncQueue&) {
+   }
+   void OnMessage(MessageType& task) {
+      task();
+   }
+   void OnThreadEnd(const std::string&) {
+   }
+};
+static const uint32_t   kPoolTaskTimes = 1000 * 1000;
+static const uint32_t   kPoolAddThreadCount = 4;
+static const uint32_t   kPoolThreadCount = 4;
+
+template <class ThreadPool>
+void TestThreadPool(const char* testName, ThreadPool& thrPool, std::function<void()> fnWaitDone) {
+   std::atomic<uint64_t>   taskCount{0}, taskSum{0}, subTaskCount{0};
+   std::array<std::thread, kPoolAddThreadCount> addTaskThreads;
+   fon9::StopWatch stopWatch;
+   for (uint32_t thrIdx = 0; thrIdx < addTaskThreads.size(); ++thrIdx) {
+      addTaskThreads[thrIdx] = std::thread([&, thrIdx]() {
+         for (uint32_t L = thrIdx; L < kPoolTaskTimes; L += kPoolAddThreadCount) {
+            thrPool.EmplaceMessage([&, L]() {
+               ++taskCount;
+               taskSum += L;
+               if ((L % 8) == 0) {
+                  thrPool.EmplaceMessage([&]() {
+                     ++subTaskCount;
+                  });
+               }
+            });
+         }
+      });
+   }
+   fon9::JoinThreads(addTaskThreads);
+   // 在 pool 的 thread 裡面加入的工作, 不能在結束 thread pool 之後加入, 所以先等候全部的工作完成.
+   while (taskCount < kPoolTaskTimes || subTaskCount < (kPoolTaskTimes + 7) / 8)
+      std::this_thread::yield();
+   stopWatch.PrintResult(testName, kPoolTaskTimes);
+   fnWaitDone();
+   const uint64_t expectedSum = static_cast<uint64_t>(kPoolTaskTimes) * (kPoolTaskTimes - 1) / 2;
+   if (taskCount != kPoolTaskTimes || taskSum != expectedSum || subTaskCount != (kPoolTaskTimes + 7) / 8) {
+      std::cout << "|taskCount=" << taskCount << "|taskSum=" << taskSum << "|expected=" << expectedSum
+         << "|subTaskCount=" << subTaskCount
+         << "\n[ERROR] " << testName << std::endl;
+      abort();
+   }
+}
+void TestDefaultThreadPool() {
+   {
+      fon9::DefaultThreadPoolArgs args;
+      args.ThreadCount_ = kPoolThreadCount;
+      fon9::DefaultThreadPool thrPool;
+      thrPool.StartThread(args, "DefaultThreadPool");
+      TestThreadPool("DefaultThreadPool(work stealing)", thrPool, [&thrPool]() {
+         thrPool.WaitForEndAfterWorkDone();
+      });
+      if (thrPool.EmplaceMessage([]() {}) <= fon9::ThreadState::ExecutingOrWaiting) {
+         std::cout << "[ERROR] DefaultThreadPool: Add task after terminated." << std::endl;
+         abort();
+      }
+   }
+   {
+      FuncTaskHandler::FuncQueue thrPool;
+      thrPool.StartThread(kPoolThreadCount, "FuncQueue");
+      TestThreadPool("MessageQueue<std::function>     ", thrPool, [&thrPool]() {
+         thrPool.WaitForEndAfterWorkDone();
+      });
+   }
+}
+
+//--------------------------------------------------------------------------//
+
+// 比較 MessageQueue(1 個 consumer thread) 與 MessageQueueMpsc(lock-free).
+// - 4 個 thread 同時加入訊息, 1 個 thread 處理訊息.
+static std::atomic<uint64_t> gMpscCount{0}, gMpscSum{0};
+struct MpscSumHandler {
+   using MessageType = uint64_t;
+   uint64_t Count_{0};
+   uint64_t Sum_{0};
+   template <class MessageQueueT>
+   MpscSumHandler(MessageQueueT&) {
+   }
+   void OnMessage(MessageType v) {
+      ++this->Count_;
+      this->Sum_ += v;
+   }
+   void OnThreadEnd(const std::string&) {
+      gMpscCount += this->Count_;
+      gMpscSum += this->Sum_;
+   }
+};
+struct MpscBatchHandler : public MpscSumHandler {
+   template <class MessageQueueT>
+   MpscBatchHandler(MessageQueueT& qu) : MpscSumHandler(qu) {
+   }
+   void OnMessage(std::vector<MessageType>& msgs) {
+      for (MessageType v : msgs)
+         MpscSumHandler::OnMessage(v);
+   }
+};
+static const uint32_t   kMpscMessageTimes = 1000 * 1000;
+static const uint32_t   kMpscProducerCount = 4;
+
+template <class MessageQueueT>
+void TestMpscQueue(const char* testName, MessageQueueT& qu) {
+   gMpscCount = 0;
+   gMpscSum = 0;
+   std::array<std::thread, kMpscProducerCount> producers;
+   fon9::StopWatch stopWatch;
+   for (uint32_t thrIdx = 0; thrIdx < producers.size(); ++thrIdx) {
+      producers[thrIdx] = std::thread([&qu, thrIdx]() {
+         for (uint32_t L = thrIdx; L < kMpscMessageTimes; L += kMpscProducerCount)
+            qu.EmplaceMessage(L);
+      });
+   }
+   fon9::JoinThreads(producers);
+   qu.WaitForEndAfterWorkDone();
+   stopWatch.PrintResult(testName, kMpscMessageTimes);
+   const uint64_t expectedSum = static_cast<uint64_t>(kMpscMessageTimes) * (kMpscMessageTimes - 1) / 2;
+   if (gMpscCount != kMpscMessageTimes || gMpscSum != expectedSum
+       || qu.EmplaceMessage(0u) <= fon9::ThreadState::ExecutingOrWaiting) {
+      std::cout << "|count=" << gMpscCount << "|sum=" << gMpscSum << "|expected=" << expectedSum
+         << "\n[ERROR] " << testName << std::endl;
+      abort();
+   }
+}
+void TestMessageQueueMpsc() {
+   {
+      fon9::MessageQueue<MpscSumHandler> qu;
+      qu.StartThread(1, "MessageQueue");
+      TestMpscQueue("MessageQueue               ", qu);
+   }
+   {
+      fon9::MessageQueueMpsc<MpscSumHandler> qu;
+      qu.StartThread("MessageQueueMpsc");
+      TestMpscQueue("MessageQueueMpsc           ", qu);
+   }
+   {
+      fon9::MessageQueueMpsc<MpscBatchHandler> qu;
+      qu.StartThread("MessageQueueMpsc.Batch");
+      TestMpscQueue("MessageQueueMpsc(batch)    ", qu);
+   }
+   {  // 結束後剩餘的訊息, 由 remainMessageHandler 處理.
+      using Queue = fon9::MessageQueueMpsc<MpscSumHandler>;
+      Queue qu;
+      qu.StartThread("MessageQueueMpsc.Remain");
+      gMpscCount = 0;
+      gMpscSum = 0;
+      for (uint32_t L = 0; L < kMpscMessageTimes; ++L)
+         qu.EmplaceMessage(L);
+      MpscSumHandler remainMessageHandler{qu};
+      qu.WaitForEndNow(remainMessageHandler);
+      remainMessageHandler.OnThreadEnd("Remain");
+      if (gMpscCount != kMpscMessageTimes) {
+         std::cout << "|count=" << gMpscCount << "\n[ERROR] MessageQueueMpsc.Remain" << std::endl;
+         abort();
+      }
+   }
+}
+
+// 結束(EndAfterWorkDone)時仍有 producer 正在加入訊息:
+// EmplaceMessage() 傳回 <= ThreadState::ExecutingOrWaiting 的訊息, 都必須被處理.
+void TestMessageQueueMpscEndRace() {
+   using Queue = fon9::MessageQueueMpsc<MpscSumHandler>;
+   const unsigned kRounds = 200;
+   std::cout << "[TEST ] MessageQueueMpsc: EndAfterWorkDone while producing";
+   for (unsigned L = 0; L < kRounds; ++L) {
+      Queue qu;
+      qu.StartThread("MessageQueueMpsc.EndRace");
+      gMpscCount = 0;
+      gMpscSum = 0;
+      std::atomic<uint64_t> accepted{0};
+      std::array<std::thread, kMpscProducerCount> producers;
+      for (auto& thr : producers) {
+         thr = std::thread([&qu, &accepted]() {
+            while (qu.EmplaceMessage(1u) <= fon9::ThreadState::ExecutingOrWaiting)
+               ++accepted;
+         });
+      }
+      std::this_thread::yield();
+      qu.WaitForEndAfterWorkDone();
+      fon9::JoinThreads(producers);
+      if (gMpscCount != accepted) {
+         std::cout << "|round=" << L << "|count=" << gMpscCount << "|accepted=" << accepted
+            << "\r[ERROR]" << std::endl;
+         abort();
+      }
+   }
+   std::cout << "|rounds=" << kRounds << "\r[OK   ]" << std::endl;
+}
+
+// MpscQueue: 節點重複使用; 解構時, 剩餘的資料必須解構.
+struct MpscCountedValue {
+   static int  Alive_;
+   int         Value_;
+   MpscCountedValue(int v) : Value_{v} { ++Alive_; }
+   MpscCountedValue(const MpscCountedValue& r) : Value_{r.Value_} { ++Alive_; }
+   ~MpscCountedValue() { --Alive_; }
+};
+int MpscCountedValue::Alive_ = 0;
+void TestMpscQueueNodes() {
+   std::cout << "[TEST ] MpscQueue: values & nodes";
+   {
+      fon9::MpscQueue<MpscCountedValue> qu;
+      int sum = 0;
+      for (int round = 0; round < 100; ++round) {
+         for (int L = 0; L < 100; ++L)
+            qu.Emplace(L);
+         while (qu.PopFront([&sum](MpscCountedValue& v) { sum += v.Value_; })) {
+         }
+      }
+      for (int L = 0; L < 10; ++L)
+         qu.Emplace(L);
+      if (sum != 100 * (99 * 100 / 2) || MpscCountedValue::Alive_ != 10 || qu.IsEmpty()) {
+         std::cout << "|sum=" << sum << "|alive=" << MpscCountedValue::Alive_ << "\r[ERROR]" << std::endl;
+         abort();
+      }
+   }
+   if (MpscCountedValue::Alive_ != 0) {
+      std::cout << "|alive after dtor=" << MpscCountedValue::Alive_ << "\r[ERROR]" << std::endl;
+      abort();
+   }
+   std::cout << "\r[OK   ]" << std::endl;
+}
+
+// WaitPolicy_Adaptive: 先 spin, 再 yield, 最後才 block.
+void TestWaitPolicyAdaptive() {
+   using AdaptiveWait = fon9::WaitPolicy_Adaptive<>;
+   {
+      fon9::MessageQueue<MpscSumHandler, uint64_t, std::deque<uint64_t>, AdaptiveWait> qu;
+      qu.StartThread(1, "MessageQueue.Adaptive");
+      TestMpscQueue("MessageQueue(Adaptive)     ", qu);
+   }
+   {
+      fon9::MessageQueueMpsc<MpscSumHandler, uint64_t, std::vector<uint64_t>, AdaptiveWait> qu;
+      qu.StartThread("MessageQueueMpsc.Adaptive");
+      TestMpscQueue("MessageQueueMpsc(Adaptive) ", qu);
+   }
+}
+
+//--------------------------------------------------------------------------//
+
 int main()
 {
    fon9::AutoPrintTestInfo utinfo{"ThreadController/MessageQueue/Worker"};
@@ -273,4 +521,15 @@ int main()
 
    utinfo.PrintSplitter();
    TestWorkerInMessageQueue();
+
+   utinfo.PrintSplitter();
+   TestDefaultThreadPool();
+
+   utinfo.PrintSplitter();
+   TestMessageQueueMpsc();
+   TestMessageQueueMpscEndRace();
+   TestMpscQueueNodes();
+
+   utinfo.PrintSplitter();
+   TestWaitPolicyAdaptive();
 }
@@ -25,13 +25,13 @@ TimerThreadSP GetDefaultTimerThread() {
 //--------------------------------------------------------------------------//
 TimerEntry::~TimerEntry() {
    if (this->TimerThread_->TimerController_.IsThreadEnding())
-      TimerThread::Locker{this->TimerThread_->TimerController_}->Erase(this->Key_);
+      TimerThread::Locker{this->TimerThread_->TimerController_}->Erase(*this);
 }
 void TimerEntry::DisposeAndWait() {
    while(!this->TimerThread_->TimerController_.IsThreadEnding()) {
       TimerThread::Locker   timerThread{this->TimerThread_->TimerController_};
       if (IsTimerWaitInLine(this->Key_.SeqNo_)) {
-         timerThread->Erase(this->Key_);
+         timerThread->Erase(*this);
          this->Key_.SeqNo_ = TimerSeqNo::Disposed;
          this->Key_.EmitTime_.AssignNull();
       }
@@ -44,7 +44,7 @@ void TimerEntry::StopAndWait() {
       TimerThread::Locker   timerThread{this->TimerThread_->TimerController_};
       if (this->Key_.SeqNo_ == TimerSeqNo::Disposed)
          break;
-      timerThread->Erase(this->Key_);
+      timerThread->Erase(*this);
       this->Key_.SeqNo_ = TimerSeqNo::NoWaiting;
       this->Key_.EmitTime_.AssignNull();
       if (!this->TimerThread_->CheckCurrEmit(timerThread, *this))
@@ -56,7 +56,7 @@ void TimerEntry::DisposeNoWait() {
    if (this->TimerThread_->TimerController_.IsThreadEnding())
       return;
    if (IsTimerWaitInLine(this->Key_.SeqNo_))
-      timerThread->Erase(this->Key_);
+      timerThread->Erase(*this);
    this->Key_.SeqNo_ = TimerSeqNo::Disposed;
 }
 void TimerEntry::StopNoWait() {
@@ -64,32 +64,28 @@ void TimerEntry::StopNoWait() {
    if (this->TimerThread_->TimerController_.IsThreadEnding())
       return;
    if (IsTimerWaitInLine(this->Key_.SeqNo_)) {
-      timerThread->Erase(this->Key_);
+      timerThread->Erase(*this);
       this->Key_.SeqNo_ = TimerSeqNo::NoWaiting;
    }
 }
-void TimerEntry::SetupRun(TimeStamp atTimePoint, const TimeInterval* after) {
+void TimerEntry::SetupRun(TimeStamp atTimePoint) {
    TimerThread::Locker   timerThread{this->TimerThread_->TimerController_};
    if (this->TimerThread_->TimerController_.IsThreadEnding())
       return;
    if (this->Key_.SeqNo_ == TimerSeqNo::Disposed)
       return;
-   if (IsTimerWaitInLine(this->Key_.SeqNo_))
-      timerThread->Erase(this->Key_);
 
    this->Key_.EmitTime_ = atTimePoint;
    timerThread->LastSeqNo_ = static_cast<TimerSeqNo>(cast_to_underlying(timerThread->LastSeqNo_) + 1);
    if (fon9_UNLIKELY(!IsTimerWaitInLine(timerThread->LastSeqNo_)))
       timerThread->LastSeqNo_ = TimerSeqNo::WaitInLine;
    this->Key_.SeqNo_ = timerThread->LastSeqNo_;
+   timerThread->Insert(*this);
 
-   auto ifind = timerThread->Timers_.insert(TimerThread::TimerThreadData::Timers::value_type{this->Key_, this}).first;
-   if (fon9_LIKELY(ifind != timerThread->Timers_.end() - 1))
-      return;
-   TimeInterval wsecs = after ? *after : TimeInterval{atTimePoint - UtcNow()};
-   if (fon9_UNLIKELY(timerThread->CvWaitSecs_ == wsecs))
+   // 比 TimerThread 預計醒來的時間還早, 才需要叫醒 TimerThread.
+   if (fon9_LIKELY(!(atTimePoint < timerThread->WakeTime_)))
       return;
-   timerThread->CvWaitSecs_ = wsecs;
+   timerThread->WakeTime_ = atTimePoint;
    this->TimerThread_->TimerController_.NotifyOne(timerThread);
 }
 void TimerEntry::OnTimer(TimeStamp /*now*/) {
@@ -114,17 +110,210 @@ void DataMemberTimer::OnTimerEntryReleased() {
 
 //--------------------------------------------------------------------------//
 
+#ifdef _MSC_VER
+#pragma intrinsic(_BitScanReverse64)
+#pragma intrinsic(_BitScanForward64)
+#endif
+/// v 不可為 0.
+static inline unsigned TimerBitScanReverse(uint64_t v) {
+#ifdef _MSC_VER
+   unsigned long res;
+   _BitScanReverse64(&res, v);
+   return static_cast<unsigned>(res);
+#else
+   return static_cast<unsigned>(63 - __builtin_clzll(v));
+#endif
+}
+/// v 不可為 0.
+static inline unsigned TimerBitScanForward(uint64_t v) {
+#ifdef _MSC_VER
+   unsigned long res;
+   _BitScanForward64(&res, v);
+   return static_cast<unsigned>(res);
+#else
+   return static_cast<unsigned>(__builtin_ctzll(v));
+#endif
+}
+
+TimerThread::TimerThreadData::TimerThreadData()
+   : CurrTick_{ToTick(UtcNow())}
+   , SlotBits_{} {
+}
+void TimerThread::TimerThreadData::PushBack(TimerEntryList& list, TimerEntry& timer) {
+   timer.OwnerList_ = &list;
+   timer.Next_ = nullptr;
+   if ((timer.Prev_ = list.Tail_) != nullptr)
+      list.Tail_->Next_ = &timer;
+   else
+      list.Head_ = &timer;
+   list.Tail_ = &timer;
+}
+void TimerThread::TimerThreadData::InsertExpired(TimerEntry& timer) {
+   // 通常新加入的 timer 時間較晚, 所以從尾端往前找.
+   TimerEntry* prev = this->Expired_.Tail_;
+   while (prev && timer.Key_.IsEmitBefore(prev->Key_))
+      prev = prev->Prev_;
+   if (prev == this->Expired_.Tail_)
+      return this->PushBack(this->Expired_, timer);
+   timer.OwnerList_ = &this->Expired_;
+   timer.Prev_ = prev;
+   if (prev) {
+      timer.Next_ = prev->Next_;
+      prev->Next_ = &timer;
+   }
+   else {
+      timer.Next_ = this->Expired_.Head_;
+      this->Expired_.Head_ = &timer;
+   }
+   timer.Next_->Prev_ = &timer;
+}
+void TimerThread::TimerThreadData::Place(TimerEntry& timer) {
+   const uint64_t tick = ToTick(timer.Key_.EmitTime_);
+   if (tick <= this->CurrTick_)
+      return this->InsertExpired(timer);
+   // 與 CurrTick_ 不同的最高 bit, 決定要放在哪一層:
+   // 當 CurrTick_ 進入該 slot 的範圍時, 再往下層分配.
+   const unsigned lv = TimerBitScanReverse(tick ^ this->CurrTick_) / kSlotBits;
+   if (fon9_UNLIKELY(lv >= kLevelCount))
+      return this->PushBack(this->Overflow_, timer);
+   const unsigned slot = static_cast<unsigned>(tick >> (lv * kSlotBits)) & (kSlotCount - 1);
+   this->SlotBits_[lv] |= (uint64_t{1} << slot);
+   this->PushBack(this->Slots_[lv][slot], timer);
+}
+void TimerThread::TimerThreadData::Unlink(TimerEntry& timer) {
+   TimerEntryList* list = timer.OwnerList_;
+   assert(list != nullptr);
+   if (timer.Prev_)
+      timer.Prev_->Next_ = timer.Next_;
+   else
+      list->Head_ = timer.Next_;
+   if (timer.Next_)
+      timer.Next_->Prev_ = timer.Prev_;
+   else
+      list->Tail_ = timer.Prev_;
+   timer.OwnerList_ = nullptr;
+   timer.Prev_ = timer.Next_ = nullptr;
+   if (list->empty() && list != &this->Expired_ && list != &this->Overflow_) {
+      const auto idx = static_cast<unsigned>(list - &this->Slots_[0][0]);
+      this->SlotBits_[idx / kSlotCount] &= ~(uint64_t{1} << (idx % kSlotCount));
+   }
+}
+void TimerThread::TimerThreadData::Erase(TimerEntry& timer) {
+   if (timer.OwnerList_ == nullptr)
+      return;
+   this->Detach(timer);
+   intrusive_ptr_release(&timer);
+}
+void TimerThread::TimerThreadData::Insert(TimerEntry& timer) {
+   if (timer.OwnerList_)
+      this->Unlink(timer);
+   else {
+      intrusive_ptr_add_ref(&timer);
+      ++this->Count_;
+   }
+   this->Place(timer);
+}
+void TimerThread::TimerThreadData::DetachAll(std::vector<TimerEntry*>& out) {
+   auto moveOut = [&out](TimerEntryList& list) {
+      for (TimerEntry* timer = list.Head_; timer;) {
+         TimerEntry* next = timer->Next_;
+         timer->OwnerList_ = nullptr;
+         timer->Prev_ = timer->Next_ = nullptr;
+         timer->Key_.SeqNo_ = TimerSeqNo::NoWaiting;
+         out.push_back(timer);
+         timer = next;
+      }
+      list.Head_ = list.Tail_ = nullptr;
+   };
+   moveOut(this->Expired_);
+   moveOut(this->Overflow_);
+   for (unsigned lv = 0; lv < kLevelCount; ++lv) {
+      for (uint64_t bits = this->SlotBits_[lv]; bits; bits &= bits - 1)
+         moveOut(this->Slots_[lv][TimerBitScanForward(bits)]);
+      this->SlotBits_[lv] = 0;
+   }
+   this->Count_ = 0;
+}
+void TimerThread::TimerThreadData::Advance(uint64_t nowTick) {
+   for (;;) {
+      // 下層 slot 的範圍, 必定在上層 slot 之前, 所以只要找最下層有 timer 的 slot.
+      unsigned          lv = 0;
+      uint64_t          tick;
+      TimerEntryList*   list;
+      while (lv < kLevelCount && this->SlotBits_[lv] == 0)
+         ++lv;
+      if (fon9_LIKELY(lv < kLevelCount)) {
+         const unsigned shift = lv * kSlotBits;
+         const unsigned slot = TimerBitScanForward(this->SlotBits_[lv]);
+         tick = ((this->CurrTick_ >> (shift + kSlotBits)) << (shift + kSlotBits))
+              | (static_cast<uint64_t>(slot) << shift);
+         if (tick > nowTick)
+            break;
+         list = &this->Slots_[lv][slot];
+         this->SlotBits_[lv] &= ~(uint64_t{1} << slot);
+      }
+      else {
+         if (this->Overflow_.empty())
+            break;
+         const unsigned shift = kLevelCount * kSlotBits;
+         tick = ((this->CurrTick_ >> shift) + 1) << shift;
+         if (tick > nowTick)
+            break;
+         list = &this->Overflow_;
+      }
+      // 進入 list 的範圍, 將 list 的 timers 重新分配.
+      this->CurrTick_ = tick;
+      TimerEntry* timer = list->Head_;
+      *list = TimerEntryList{};
+      while (timer) {
+         TimerEntry* next = timer->Next_;
+         this->Place(*timer);
+         timer = next;
+      }
+   }
+   if (this->CurrTick_ < nowTick)
+      this->CurrTick_ = nowTick;
+}
+TimeStamp TimerThread::TimerThreadData::GetNextCheckTime() const {
+   if (!this->Expired_.empty())
+      return this->Expired_.Head_->Key_.EmitTime_;
+   uint64_t tick;
+   unsigned lv = 0;
+   while (lv < kLevelCount && this->SlotBits_[lv] == 0)
+      ++lv;
+   if (fon9_LIKELY(lv < kLevelCount)) {
+      const unsigned shift = lv * kSlotBits;
+      tick = ((this->CurrTick_ >> (shift + kSlotBits)) << (shift + kSlotBits))
+           | (static_cast<uint64_t>(TimerBitScanForward(this->SlotBits_[lv])) << shift);
+   }
+   else {
+      if (this->Overflow_.empty())
+         return TimeStamp::Null();
+      const unsigned shift = kLevelCount * kSlotBits;
+      tick = ((this->CurrTick_ >> shift) + 1) << shift;
+   }
+   return TimeStamp{TimeStamp::Make<6>(static_cast<TimeStamp::OrigType>(tick) * kTickUS)};
+}
+
+//--------------------------------------------------------------------------//
+
 TimerThread::TimerThread(std::string timerName) {
    this->TimerController_.OnBeforeThreadStart(1);
    this->Thread_ = std::thread(&TimerThread::ThrRun, this, std::move(timerName));
 }
 TimerThread::~TimerThread() {
    this->WaitForEndNow();
-   assert(Locker{this->TimerController_}->Timers_.empty());
+   assert(Locker{this->TimerController_}->empty());
 }
 void TimerThread::WaitForEndNow() {
    this->TimerController_.WaitForEndNow();
    JoinThread(this->Thread_);
+   // TimerThread 已結束, 不會再觸發, 也不能再啟動 timer.
+   // 在解鎖後才釋放, 因為 ~TimerEntry() 會再次鎖定 TimerController_.
+   std::vector<TimerEntry*> timers;
+   Locker{this->TimerController_}->DetachAll(timers);
+   for (TimerEntry* timer : timers)
+      intrusive_ptr_release(timer);
 }
 
 bool TimerThread::CheckCurrEmit(Locker& timerThread, TimerEntry& timer) {
@@ -136,25 +325,31 @@ bool TimerThread::CheckCurrEmit(Locker& timerThread, TimerEntry& timer) {
 }
 
 bool TimerThread::RunTimer(Locker& timerThread) {
+   // 處理 timers 期間, 不需要因 TimerEntry::SetupRun() 而叫醒 TimerThread.
+   timerThread->WakeTime_ = TimeStamp::Null();
    while (this->TimerController_.GetState(timerThread) == ThreadState::ExecutingOrWaiting) {
-      if (timerThread->Timers_.empty()) {
-         timerThread->CvWaitSecs_ = TimeInterval_Second(-1);
-         return true;
-      }
-      TimerEntrySP   timer = timerThread->Timers_.back().second;
-      TimeStamp      now = UtcNow();
-      TimeInterval   ti = timer->Key_.EmitTime_ - now;
-      if (ti.GetOrigValue() > 0) {
-         timerThread->CvWaitSecs_ = ti;
+      TimeStamp   now = UtcNow();
+      timerThread->Advance(TimerThreadData::ToTick(now));
+      TimerEntry* timer = timerThread->Expired_.Head_;
+      if (timer == nullptr || timer->Key_.EmitTime_ > now) {
+         TimeStamp next = timerThread->GetNextCheckTime();
+         if (next.IsNull()) {
+            timerThread->CvWaitSecs_ = TimeInterval_Second(-1);
+            timerThread->WakeTime_ = TimeStamp{TimeStamp::max()};
+         }
+         else {
+            timerThread->CvWaitSecs_ = next - now;
+            timerThread->WakeTime_ = next;
+         }
          return true;
       }
       timer->Key_.SeqNo_ = TimerSeqNo::NoWaiting;
-      timerThread->Timers_.pop_back();
-      timerThread->CurrEntry_ = timer.get();
+      timerThread->Detach(*timer);
+      timerThread->CurrEntry_ = timer;
       timerThread.unlock();
       // callback in unlock...
-      // 在這兒 timer.detach(), 然後在 EmitOnTimer() 裡面 intrusive_ptr_release(timer);
-      timer.detach()->EmitOnTimer(now);
+      // TimerThread 對 timer 的參考, 在 EmitOnTimer() 裡面 intrusive_ptr_release(timer);
+      timer->EmitOnTimer(now);
       timerThread.lock();
       timerThread->CurrEntry_ = nullptr;
    }
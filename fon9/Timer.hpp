@@ -30,12 +30,21 @@ struct TimerEntryKey {
    /// 非0表示:已啟動計時器,等候觸發.
    TimerSeqNo  SeqNo_{TimerSeqNo::NoWaiting};
 
-   /// 把時間較小的排到 SortedVector 尾端 (先觸發, vector 移除尾端的負擔很小),
-   /// 所以傳回值是 > 的結果.
-   bool operator< (const TimerEntryKey& rhs) const {
+   /// 觸發順序: 時間較小的先觸發, 時間相同則先啟動的先觸發.
+   bool IsEmitBefore(const TimerEntryKey& rhs) const {
       return fon9_UNLIKELY(this->EmitTime_ == rhs.EmitTime_)
-         ? this->SeqNo_ > rhs.SeqNo_
-         : this->EmitTime_ > rhs.EmitTime_;
+         ? this->SeqNo_ < rhs.SeqNo_
+         : this->EmitTime_ < rhs.EmitTime_;
+   }
+};
+
+class fon9_API TimerEntry;
+/// TimerThread 計時輪的一個 slot (或到期隊列), 使用 TimerEntry 裡面的 link 串起來(intrusive list).
+struct TimerEntryList {
+   TimerEntry* Head_{nullptr};
+   TimerEntry* Tail_{nullptr};
+   bool empty() const {
+      return this->Head_ == nullptr;
    }
 };
 
@@ -96,8 +105,12 @@ class fon9_API TimerEntry : public intrusive_ref_counter<TimerEntry> {
 
    friend class TimerThread;
    TimerEntryKey  Key_;
+   /// 在 TimerThread 裡面等候時, 所在的 list 及前後節點, 由 TimerThread 在 lock 狀態下維護.
+   TimerEntryList*   OwnerList_{nullptr};
+   TimerEntry*       Prev_{nullptr};
+   TimerEntry*       Next_{nullptr};
 
-   void SetupRun(TimeStamp atTimePoint, const TimeInterval* after);
+   void SetupRun(TimeStamp atTimePoint);
 public:
    const TimerThreadSP  TimerThread_;
 
@@ -127,11 +140,11 @@ public:
    void StopAndWait();
 
    void RunAt(TimeStamp atTimePoint) {
-      this->SetupRun(atTimePoint, nullptr);
+      this->SetupRun(atTimePoint);
    }
 
    void RunAfter(TimeInterval after) {
-      this->SetupRun(TimeStamp{UtcNow() + after}, &after);
+      this->SetupRun(TimeStamp{UtcNow() + after});
    }
 };
 
@@ -228,26 +241,77 @@ public:
 fon9_WARN_DISABLE_PADDING;
 /// \ingroup Thrs
 /// 實際的 TimerEntry 放在 TimerThread 裡面執行.
+/// - 等候中的 timers 放在「階層式計時輪(hierarchical timing wheel)」裡面:
+///   - 1 tick = 1 ms; 共 kLevelCount 層, 每層 kSlotCount 個 slot;
+///     超過計時輪範圍(約 795 天)的 timer 放在 Overflow_.
+///   - 啟動(RunAfter, RunAt)、停止(Stop..., Dispose...) 都是 O(1): 直接加入 slot list 尾端, 或從 list 移除.
+///   - 當時間進入上層 slot 的範圍時, 才將該 slot 的 timers 分配到下層.
+///   - 到期(tick <= CurrTick_)的 timers 移到 Expired_, 依照 TimerEntryKey::IsEmitBefore() 排序,
+///     所以仍然是: 時間到了才觸發(精確度與之前相同), 觸發順序依照 EmitTime, SeqNo.
 class fon9_API TimerThread : public intrusive_ref_counter<TimerThread> {
    fon9_NON_COPY_NON_MOVE(TimerThread);
    friend class TimerEntry;
 
    struct TimerThreadData {
-      void Erase(TimerEntryKey& key) {
-         if (key.SeqNo_ == TimerSeqNo::NoWaiting)
-            return;
-         auto ifind = this->Timers_.find(key);
-         if (ifind != this->Timers_.end())
-            this->Timers_.erase(ifind);
+      enum : unsigned {
+         kSlotBits = 6,
+         kSlotCount = (1u << kSlotBits),
+         kLevelCount = 6,
+      };
+      /// 每個 tick 的 us 數.
+      static constexpr TimeStamp::OrigType kTickUS = 1000;
+
+      /// 若 timer 在等候中(在某個 list 裡面), 則從 list 移除, 並釋放 TimerThread 對 timer 的參考.
+      void Erase(TimerEntry& timer);
+      /// 依照 timer.Key_.EmitTime_ 加入 timer (若已在等候中, 則移到新的位置).
+      /// 若為新加入, 則增加 TimerThread 對 timer 的參考.
+      void Insert(TimerEntry& timer);
+      /// 從 list 移除, 但不釋放 TimerThread 對 timer 的參考, 由呼叫端負責.
+      void Detach(TimerEntry& timer) {
+         this->Unlink(timer);
+         --this->Count_;
+      }
+      /// 移除全部等候中的 timers(Expired_, Overflow_, Slots_), 放入 out;
+      /// 由呼叫端在解鎖後, 釋放 TimerThread 對 timer 的參考.
+      void DetachAll(std::vector<TimerEntry*>& out);
+      /// 將 CurrTick_ 推進到 nowTick, 並將到期的 timers 移到 Expired_.
+      void Advance(uint64_t nowTick);
+      /// 下次需要檢查的時間: Expired_ 的第一個 timer 的時間, 或下一個需要分配的 slot 的時間.
+      /// 沒有任何 timer 則傳回 TimeStamp::Null();
+      TimeStamp GetNextCheckTime() const;
+      bool empty() const {
+         return this->Count_ == 0;
+      }
+
+      static uint64_t ToTick(TimeStamp ts) {
+         return ts.GetOrigValue() <= 0 ? 0u : static_cast<uint64_t>(ts.GetOrigValue() / kTickUS);
       }
 
-      using Timers = SortedVector<TimerEntryKey, TimerEntrySP>;
       TimerSeqNo        LastSeqNo_{TimerSeqNo::WaitInLine};
-      Timers            Timers_;
       TimeInterval      CvWaitSecs_;
+      /// TimerThread 預計醒來的時間, 若啟動的 timer 早於此時間, 才需要通知 TimerThread.
+      /// TimerThread 正在處理 timers 時(尚未進入等候), 設為 TimeStamp::Null(), 表示不用通知.
+      TimeStamp         WakeTime_{TimeStamp::Null()};
       /// 如果在 TimerThread 正在觸發, 則會設定此值.
       /// 讓另一 thread 呼叫 TimerEntry::StopAndWait() 時, 可以等到 OnTimer() 真的結束後才返回.
       TimerEntry* CurrEntry_{};
+
+      uint64_t          CurrTick_{};
+      size_t            Count_{};
+      /// 到期的 timers, 依照觸發順序排列.
+      TimerEntryList    Expired_;
+      TimerEntryList    Overflow_;
+      /// SlotBits_[lv] 的 bit(n) = Slots_[lv][n] 有 timer.
+      uint64_t          SlotBits_[kLevelCount];
+      TimerEntryList    Slots_[kLevelCount][kSlotCount];
+
+      TimerThreadData();
+
+      /// 依照 timer 的 tick 放到 Expired_, Slots_, 或 Overflow_.
+      void Place(TimerEntry& timer);
+      void PushBack(TimerEntryList& list, TimerEntry& timer);
+      void InsertExpired(TimerEntry& timer);
+      void Unlink(TimerEntry& timer);
    };
    using TimerController = ThreadController<TimerThreadData, WaitPolicy_CV>;
    using Locker = TimerController::Locker;
@@ -267,6 +331,8 @@ public:
    TimerThread(std::string timerName);
    virtual ~TimerThread();
 
+   /// 結束 TimerThread, 並釋放仍在等候中的 timers:
+   /// 因為 timer 有 TimerThreadSP, 若不釋放, 則 timer 與 TimerThread 互相參考, 都無法釋放.
    void WaitForEndNow();
 
    bool InThisThread() const {
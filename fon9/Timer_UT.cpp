@@ -179,8 +179,139 @@ void TestTimerThread() {
 
 //--------------------------------------------------------------------------//
 
+fon9_WARN_DISABLE_PADDING;
+/// 檢查觸發順序: 依照 EmitTime 由小到大觸發, 且不可早於 EmitTime.
+struct OrderCheckTimer : public fon9::TimerEntry {
+   fon9_NON_COPY_NON_MOVE(OrderCheckTimer);
+   using base = fon9::TimerEntry;
+   using base::base;
+   fon9::TimeStamp   Target_;
+   static fon9::TimeStamp        LastTarget_;
+   static std::atomic<uint64_t>  EmitCount_, ErrEarly_, ErrOrder_;
+   void OnTimer(fon9::TimeStamp now) override {
+      if (now < this->Target_)
+         ++ErrEarly_;
+      if (this->Target_ < LastTarget_)
+         ++ErrOrder_;
+      LastTarget_ = this->Target_;
+      ++EmitCount_;
+   }
+};
+fon9_WARN_POP;
+fon9::TimeStamp         OrderCheckTimer::LastTarget_;
+std::atomic<uint64_t>   OrderCheckTimer::EmitCount_, OrderCheckTimer::ErrEarly_, OrderCheckTimer::ErrOrder_;
+
+void TestTimerOrder() {
+   std::cout << "[TEST ] Timer emit order.";
+   fon9::TimerThreadSP timerThread{new fon9::TimerThread{"TestTimerOrder"}};
+   const uint32_t    kTimerCount = 10000;
+   std::vector<fon9::TimerEntrySP> timers;
+   timers.reserve(kTimerCount);
+   // 預留 500ms 讓 timer 全部加入後, 才開始觸發, 避免「加入較早時間的 timer 時, 較晚的已觸發」造成順序誤判.
+   fon9::TimeStamp   now = fon9::UtcNow() + fon9::TimeInterval_Millisecond(500);
+   uint32_t          rnd = 12345;
+   for (uint32_t L = 0; L < kTimerCount; ++L) {
+      rnd = rnd * 1103515245 + 12345;
+      OrderCheckTimer* timer = new OrderCheckTimer{timerThread};
+      timers.emplace_back(timer);
+      // 0..300ms: 包含需要從上層移到下層的 timer.
+      timer->Target_ = now + fon9::TimeInterval_Microsecond(static_cast<int64_t>((rnd >> 8) % 300000));
+      timer->RunAt(timer->Target_);
+   }
+   // 取消一半, 再重新啟動其中一半.
+   for (uint32_t L = 0; L < kTimerCount; L += 2)
+      timers[L]->StopAndWait();
+   now = fon9::UtcNow() + fon9::TimeInterval_Millisecond(500);
+   for (uint32_t L = 0; L < kTimerCount; L += 4) {
+      OrderCheckTimer* timer = static_cast<OrderCheckTimer*>(timers[L].get());
+      timer->Target_ = now + fon9::TimeInterval_Millisecond(static_cast<int64_t>(L % 200));
+      timer->RunAt(timer->Target_);
+   }
+   const uint64_t kExpected = kTimerCount / 2 + kTimerCount / 4;
+   for (unsigned L = 0; L < 200 && OrderCheckTimer::EmitCount_ < kExpected; ++L)
+      std::this_thread::sleep_for(std::chrono::milliseconds{10});
+   std::this_thread::sleep_for(std::chrono::milliseconds{10});
+   if (OrderCheckTimer::EmitCount_ != kExpected || OrderCheckTimer::ErrEarly_ || OrderCheckTimer::ErrOrder_) {
+      std::cout << "\r[ERROR]"
+         << "|emit=" << OrderCheckTimer::EmitCount_ << "|expected=" << kExpected
+         << "|early=" << OrderCheckTimer::ErrEarly_ << "|order=" << OrderCheckTimer::ErrOrder_
+         << std::endl;
+      abort();
+   }
+   std::cout << "\r[OK   ]" << std::endl;
+}
+
+void TestTimerStartStop() {
+   // 大量 timer 的 RunAfter(), StopNoWait() 的負擔.
+   // 例: 數萬個連線, 每個連線都有 heartbeat timer, 每次收送訊息都會重新啟動計時.
+   fon9::TimerThreadSP timerThread{new fon9::TimerThread{"TestTimerStartStop"}};
+   const uint32_t    kTimerCount = 100000;
+   std::vector<fon9::TimerEntrySP> timers;
+   timers.reserve(kTimerCount);
+   for (uint32_t L = 0; L < kTimerCount; ++L)
+      timers.emplace_back(new fon9::TimerEntry{timerThread});
+   uint32_t          rnd = 12345;
+   fon9::StopWatch   stopWatch;
+   for (fon9::TimerEntrySP& timer : timers) {
+      rnd = rnd * 1103515245 + 12345;
+      timer->RunAfter(fon9::TimeInterval_Millisecond(10000 + ((rnd >> 8) % 60000)));
+   }
+   stopWatch.PrintResult("RunAfter(new)   ", kTimerCount);
+   for (fon9::TimerEntrySP& timer : timers) {
+      rnd = rnd * 1103515245 + 12345;
+      timer->RunAfter(fon9::TimeInterval_Millisecond(10000 + ((rnd >> 8) % 60000)));
+   }
+   stopWatch.PrintResult("RunAfter(again) ", kTimerCount);
+   for (fon9::TimerEntrySP& timer : timers)
+      timer->StopNoWait();
+   stopWatch.PrintResult("StopNoWait      ", kTimerCount);
+}
+
+/// TimerThread 結束時, 仍在等候的 timers 必須被釋放.
+struct ReleaseCheckTimer : public fon9::TimerEntry {
+   fon9_NON_COPY_NON_MOVE(ReleaseCheckTimer);
+   using base = fon9::TimerEntry;
+   using base::base;
+   static std::atomic<uint32_t>  ReleasedCount_;
+   void OnTimerEntryReleased() override {
+      ++ReleasedCount_;
+      delete this;
+   }
+};
+std::atomic<uint32_t>   ReleaseCheckTimer::ReleasedCount_;
+
+void TestTimerReleaseOnEnd() {
+   std::cout << "[TEST ] Release waiting timers on TimerThread end.";
+   fon9::TimerThreadSP timerThread{new fon9::TimerThread{"TestTimerReleaseOnEnd"}};
+   // 分散在各層 Slots_ 及 Overflow_.
+   static const fon9::TimeInterval kIntervals[] = {
+      fon9::TimeInterval_Second(10),
+      fon9::TimeInterval_Minute(10),
+      fon9::TimeInterval_Hour(10),
+      fon9::TimeInterval_Day(10),
+      fon9::TimeInterval_Day(1000),
+   };
+   const uint32_t kTimerCount = 100 * static_cast<uint32_t>(fon9::numofele(kIntervals));
+   for (uint32_t L = 0; L < kTimerCount; ++L)
+      (new ReleaseCheckTimer{timerThread})->RunAfter(kIntervals[L % fon9::numofele(kIntervals)]
+                                                     + fon9::TimeInterval_Millisecond(L));
+   timerThread->WaitForEndNow();
+   if (ReleaseCheckTimer::ReleasedCount_ != kTimerCount) {
+      std::cout << "\r[ERROR]"
+         << "|released=" << ReleaseCheckTimer::ReleasedCount_ << "|expected=" << kTimerCount
+         << std::endl;
+      abort();
+   }
+   std::cout << "\r[OK   ]" << std::endl;
+}
+
+//--------------------------------------------------------------------------//
+
 int main() {
    fon9::AutoPrintTestInfo utinfo{"Timer"};
+   TestTimerOrder();
+   TestTimerStartStop();
+   TestTimerReleaseOnEnd();
    TestTimerThread();
 
    // 測試在 main() 結束後, DefaultTimerThread 是否能正常結束.
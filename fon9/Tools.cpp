@@ -12,6 +12,7 @@ static const StrView howWaitStrMap[]{
    fon9_MAKE_ENUM_CLASS_StrView_NoSeq(1, HowWait, Block),
    fon9_MAKE_ENUM_CLASS_StrView_NoSeq(2, HowWait, Yield),
    fon9_MAKE_ENUM_CLASS_StrView_NoSeq(3, HowWait, Busy),
+   fon9_MAKE_ENUM_CLASS_StrView_NoSeq(4, HowWait, Adaptive),
 };
 
 fon9_API HowWait StrToHowWait(StrView value) {
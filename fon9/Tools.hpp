@@ -5,6 +5,10 @@
 #include "fon9/Outcome.hpp"
 #include "fon9/StrView.hpp"
 
+fon9_BEFORE_INCLUDE_STD;
+#include <thread>
+fon9_AFTER_INCLUDE_STD;
+
 namespace fon9 {
 
 enum class HowWait {
@@ -12,6 +16,8 @@ enum class HowWait {
    Block,
    Yield,
    Busy,
+   /// 先 spin, 再 yield, 最後才 block; 參考 AdaptiveWaitArgs.
+   Adaptive,
 };
 inline bool IsBlockWait(HowWait value) {
    return value <= HowWait::Block;
@@ -19,6 +25,53 @@ inline bool IsBlockWait(HowWait value) {
 fon9_API HowWait StrToHowWait(StrView value);
 fon9_API StrView HowWaitToStr(HowWait value);
 
+/// \ingroup Thrs
+/// HowWait::Adaptive 的參數: 沒有事件時, 先 spin, 再 yield, 最後才進入 block 等候.
+/// - 行情爆量期間, 事件之間的間隔很短, 在 spin 階段即可取得下一個事件, 不用付出喚醒的延遲.
+/// - 閒置一段時間後進入 block, 不會一直佔用 cpu.
+struct AdaptiveWaitArgs {
+   /// 連續閒置時, 先 spin(不讓出 cpu) 檢查的次數.
+   uint32_t SpinCount_;
+   /// spin 之後, 再用 yield 檢查的次數; 之後才進入 block 等候.
+   uint32_t YieldCount_;
+
+   AdaptiveWaitArgs(uint32_t spinCount = 20000, uint32_t yieldCount = 200)
+      : SpinCount_{spinCount}
+      , YieldCount_{yieldCount} {
+   }
+};
+
+/// \ingroup Thrs
+/// 記錄連續閒置的次數, 判斷 HowWait::Adaptive 目前在哪個階段.
+/// - 有事件時: 呼叫 Reset();
+/// - 沒有事件時: 呼叫 OnIdle(); 傳回 false 表示應進入 block 等候.
+class AdaptiveWaitCounter {
+   uint32_t IdleCount_{0};
+public:
+   void Reset() {
+      this->IdleCount_ = 0;
+   }
+   /// 是否已用完 spin, yield 的次數, 應進入 block 等候?
+   bool IsBlockStage(const AdaptiveWaitArgs& args) const {
+      return this->IdleCount_ >= args.SpinCount_
+         && this->IdleCount_ - args.SpinCount_ >= args.YieldCount_;
+   }
+   /// 閒置一次: 在 spin 階段立即返回, 在 yield 階段呼叫 std::this_thread::yield().
+   /// \retval false 已用完 spin, yield 的次數, 應進入 block 等候.
+   bool OnIdle(const AdaptiveWaitArgs& args) {
+      if (this->IdleCount_ < args.SpinCount_) {
+         ++this->IdleCount_;
+         return true;
+      }
+      if (this->IdleCount_ - args.SpinCount_ < args.YieldCount_) {
+         ++this->IdleCount_;
+         std::this_thread::yield();
+         return true;
+      }
+      return false;
+   }
+};
+
 /// \ingroup Misc
 /// 設定「現在 thread」的 CPU 綁定.
 /// \retval Result3::kNoResult()    cpuAffinity < 0: 不綁定.
@@ -2,6 +2,7 @@
 // \author fonwinz@gmail.com
 #include "fon9/TsAppend.hpp"
 #include "fon9/BitvFixedInt.hpp"
+#include <algorithm>
 
 namespace fon9 {
 
@@ -17,5 +18,113 @@ fon9_API void TsAppend(AsyncFileAppender& pklog, TimeStamp now,
    memcpy(pbuf + sizeof(now) + sizeof(pksz), pkptr, pksz);
    pklog.Append(rbuf);
 }
+//--------------------------------------------------------------------------//
+TsAppendIndex::~TsAppendIndex() {
+}
+void TsAppendIndex::Close() {
+   this->IdxFile_.reset();
+   this->Entries_.clear();
+   this->Marks_.clear();
+   this->NextPos_ = 0;
+   this->LastSeq_ = 0;
+   this->IsSeqAscending_ = true;
+}
+File::Result TsAppendIndex::Open(std::string fname, File::SizeType pklogSize) {
+   this->Close();
+   File         fd;
+   File::Result res = fd.Open(fname, FileMode::CreatePath | FileMode::OpenAlways | FileMode::Read | FileMode::Write);
+   if (res.IsError())
+      return res;
+   if ((res = fd.GetFileSize()).IsError())
+      return res;
+   const File::SizeType idxSize = res.GetResult();
+   std::vector<byte>    buf(static_cast<size_t>(idxSize));
+   if (idxSize > 0 && (res = fd.Read(0, buf.data(), idxSize)).IsError())
+      return res;
+   // 載入索引: 排除位置超過 pklog 的索引, 及位置沒有遞增的索引(索引檔損毀).
+   const size_t count = static_cast<size_t>(res.GetResult() / kEntrySize);
+   size_t       validCount = 0;
+   this->Entries_.reserve(count + 1024);
+   for (; validCount < count; ++validCount) {
+      const byte* pentry = buf.data() + validCount * kEntrySize;
+      Entry       e;
+      e.Seq_ = GetBigEndian<uint64_t>(pentry);
+      e.Time_.SetOrigValue(GetBigEndian<TimeStamp::OrigType>(pentry + 8));
+      e.Pos_ = GetBigEndian<File::PosType>(pentry + 16);
+      if (e.Pos_ >= pklogSize)
+         break;
+      const auto kind = static_cast<EntryKind>(GetBigEndian<uint64_t>(pentry + 24));
+      if (kind == EntryKind::Mark) {
+         this->Marks_.push_back(e);
+         continue;
+      }
+      if (kind != EntryKind::Index || (!this->Entries_.empty() && e.Pos_ <= this->Entries_.back().Pos_))
+         break;
+      if (!this->Entries_.empty() && e.Seq_ < this->Entries_.back().Seq_)
+         this->IsSeqAscending_ = false;
+      this->Entries_.push_back(e);
+   }
+   const File::SizeType validSize = validCount * kEntrySize;
+   if (validSize != idxSize && (res = fd.SetFileSize(validSize)).IsError())
+      return res;
+   fd.Close();
+   this->IdxFile_ = AsyncFileAppender::Make();
+   res = this->IdxFile_->OpenImmediately(fname, FileMode::CreatePath | FileMode::Append);
+   if (res.IsError()) {
+      this->IdxFile_.reset();
+      return res;
+   }
+   this->NextPos_ = pklogSize;
+   if (!this->Entries_.empty())
+      this->LastSeq_ = this->Entries_.back().Seq_;
+   return File::Result{this->Entries_.size()};
+}
+void TsAppendIndex::AddEntry(const Entry& e) {
+   if (!this->Entries_.empty() && e.Seq_ < this->Entries_.back().Seq_)
+      this->IsSeqAscending_ = false;
+   this->Entries_.push_back(e);
+   this->WriteEntry(e, EntryKind::Index);
+}
+void TsAppendIndex::AddMark(uint64_t seq, TimeStamp tm, File::PosType pos) {
+   assert(this->IsOpened() && pos <= this->NextPos_);
+   this->Marks_.push_back(Entry{seq, tm, pos});
+   this->WriteEntry(this->Marks_.back(), EntryKind::Mark);
+}
+void TsAppendIndex::WriteEntry(const Entry& e, EntryKind kind) {
+   byte buf[kEntrySize];
+   PutBigEndian(buf, e.Seq_);
+   PutBigEndian(buf + 8, e.Time_.GetOrigValue());
+   PutBigEndian(buf + 16, e.Pos_);
+   PutBigEndian(buf + 24, static_cast<uint64_t>(kind));
+   this->IdxFile_->Append(buf, sizeof(buf));
+}
+void TsAppendIndex::OnAppend(uint64_t seq, TimeStamp now, size_t recsz) {
+   assert(this->IsOpened());
+   if (this->Entries_.empty()
+       || seq < this->LastSeq_ // 序號重置.
+       || seq - this->Entries_.back().Seq_ >= this->SeqInterval_
+       || now - this->Entries_.back().Time_ >= this->TimeInterval_)
+      this->AddEntry(Entry{seq, now, this->NextPos_});
+   this->LastSeq_ = seq;
+   this->NextPos_ += recsz;
+}
+File::PosType TsAppendIndex::FindPosBySeq(uint64_t seq) const {
+   if (this->IsSeqAscending_) {
+      auto ifind = std::lower_bound(this->Entries_.begin(), this->Entries_.end(), seq,
+                                    [](const Entry& e, uint64_t v) { return e.Seq_ < v; });
+      return ifind == this->Entries_.begin() ? 0 : (ifind - 1)->Pos_;
+   }
+   // 序號曾經重置: 從尾端往前找, 找到的位置之後, 可能仍有序號較小的封包, 但不會遺漏 >= seq 的封包.
+   for (auto i = this->Entries_.rbegin(); i != this->Entries_.rend(); ++i) {
+      if (i->Seq_ < seq)
+         return i->Pos_;
+   }
+   return 0;
+}
+File::PosType TsAppendIndex::FindPosByTime(TimeStamp tm) const {
+   auto ifind = std::lower_bound(this->Entries_.begin(), this->Entries_.end(), tm,
+                                 [](const Entry& e, TimeStamp v) { return e.Time_ < v; });
+   return ifind == this->Entries_.begin() ? 0 : (ifind - 1)->Pos_;
+}
 
 } // namespaces
@@ -4,6 +4,7 @@
 #define __fon9_TsAppend_hpp__
 #include "fon9/FileAppender.hpp"
 #include "fon9/TimeStamp.hpp"
+#include <vector>
 
 namespace fon9 {
 
@@ -15,5 +16,101 @@ namespace fon9 {
 fon9_API void TsAppend(AsyncFileAppender& pklog, TimeStamp now,
                        const void* pkptr, uint16_t pksz);
 
+/// TsAppend() 每筆封包在 pklog 裡面的大小.
+constexpr size_t TsAppendRecordSize(uint16_t pksz) {
+   return pksz + sizeof(TimeStamp) + sizeof(pksz);
+}
+
+fon9_WARN_DISABLE_PADDING;
+/// \ingroup Misc
+/// TsAppend() 寫入的 pklog 的稀疏索引(另存一個索引檔), 用來直接找到重播的起點, 不用從頭讀取整個 pklog.
+/// - 每隔 SeqInterval_ 筆封包, 或每隔 TimeInterval_ 時間, 或序號重置時, 記錄一筆 {seq, time, pklog 檔案位置}.
+/// - 使用者可另外加入「標記」(AddMark()), 例: 輪播 channel 的完整循環起點.
+/// - 索引檔格式: 每筆 kEntrySize bytes, BigEndian: seq(8) + time.us(8) + pos(8) + kind(8);
+/// - 開啟時載入全部的索引(索引數量約為 封包數量 / SeqInterval_);
+///   若索引的位置超過 pklog 的大小(例: pklog 尾端沒寫入), 則移除這些索引, 並重寫索引檔.
+/// - 若索引檔不存在, 但 pklog 已有資料, 則只會為之後加入的封包建立索引;
+///   此時尋找較早的封包會傳回 0, 從頭讀取 pklog.
+/// - 沒有 lock 保護, 由使用者確保不會同時呼叫.
+class fon9_API TsAppendIndex {
+   fon9_NON_COPY_NON_MOVE(TsAppendIndex);
+public:
+   struct Entry {
+      uint64_t       Seq_;
+      TimeStamp      Time_;
+      File::PosType  Pos_;
+   };
+   enum : uint32_t {
+      kEntrySize = 32,
+   };
+   enum class EntryKind : uint64_t {
+      Index = 0,
+      Mark = 1,
+   };
+   /// 每隔多少筆封包, 記錄一筆索引.
+   uint32_t       SeqInterval_{1024};
+   /// 每隔多少時間, 記錄一筆索引, 讓時間索引在封包較少時仍有足夠的精確度.
+   TimeInterval   TimeInterval_{TimeInterval_Second(1)};
+
+   TsAppendIndex() = default;
+   ~TsAppendIndex();
+
+   /// 在 pklog 開啟後, 開啟 pklog 的索引檔, 並載入既有的索引.
+   /// \param fname     索引檔名, 通常為 pklog 檔名 + ".idx";
+   /// \param pklogSize pklog 目前的大小, 之後加入的封包, 從此位置開始計算.
+   File::Result Open(std::string fname, File::SizeType pklogSize);
+   void Close();
+   bool IsOpened() const {
+      return this->IdxFile_.get() != nullptr;
+   }
+
+   /// 在 TsAppend() 之前呼叫: 記錄封包在 pklog 的位置, 若符合稀疏條件, 則加入一筆索引.
+   void OnAppend(uint64_t seq, TimeStamp now, size_t recsz);
+
+   /// 傳回最後一筆 Seq_ < seq 的索引位置:
+   /// - 從該位置開始讀取, 不會遺漏 >= seq 的封包.
+   /// - 若序號曾經重置, 則以最後一次重置之後為準.
+   /// - 若沒有符合的索引, 則傳回 0: 從頭讀取.
+   File::PosType FindPosBySeq(uint64_t seq) const;
+   /// 傳回最後一筆 Time_ < tm 的索引位置, 若沒有則傳回 0.
+   File::PosType FindPosByTime(TimeStamp tm) const;
+
+   /// 下一個封包在 pklog 的位置.
+   File::PosType GetNextPos() const {
+      return this->NextPos_;
+   }
+   /// 加入一個標記, pos 通常是之前透過 GetNextPos() 取得的位置.
+   void AddMark(uint64_t seq, TimeStamp tm, File::PosType pos);
+   /// 傳回最後一個標記, 若沒有則傳回 nullptr.
+   const Entry* GetLastMark() const {
+      return this->Marks_.empty() ? nullptr : &this->Marks_.back();
+   }
+
+   const std::vector<Entry>& GetEntries() const {
+      return this->Entries_;
+   }
+
+private:
+   AsyncFileAppenderSP  IdxFile_;
+   std::vector<Entry>   Entries_;
+   std::vector<Entry>   Marks_;
+   File::PosType        NextPos_{0};
+   uint64_t             LastSeq_{0};
+   /// Entries_ 的序號是否遞增? 若是, 則可使用二分搜尋.
+   bool                 IsSeqAscending_{true};
+
+   void AddEntry(const Entry& e);
+   void WriteEntry(const Entry& e, EntryKind kind);
+};
+fon9_WARN_POP;
+
+/// 同 TsAppend(pklog, now, pkptr, pksz); 並透過 idx.OnAppend() 更新索引.
+inline void TsAppend(AsyncFileAppender& pklog, TsAppendIndex& idx, TimeStamp now,
+                     const void* pkptr, uint16_t pksz, uint64_t seq) {
+   if (idx.IsOpened())
+      idx.OnAppend(seq, now, TsAppendRecordSize(pksz));
+   TsAppend(pklog, now, pkptr, pksz);
+}
+
 } // namespaces
 #endif//__fon9_TsAppend_hpp__
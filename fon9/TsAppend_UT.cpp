@@ -0,0 +1,148 @@
+﻿// \file fon9/TsAppend_UT.cpp
+// \author fonwinz@gmail.com
+#define _CRT_SECURE_NO_WARNINGS
+#include "fon9/TsAppend.hpp"
+#include "fon9/TestTools.hpp"
+#include <map>
+
+static const char kPkLogFileName[] = "TsAppend_UT.tsbin";
+static const char kIdxFileName[] = "TsAppend_UT.tsbin.idx";
+
+//--------------------------------------------------------------------------//
+struct PkLogWriter {
+   fon9_NON_COPY_NON_MOVE(PkLogWriter);
+   PkLogWriter() = default;
+   fon9::AsyncFileAppenderSP  PkLog_;
+   fon9::TsAppendIndex        Idx_;
+   /// pklog 裡面: 每個封包的位置 => 序號.
+   std::map<fon9::File::PosType, uint64_t> PosToSeq_;
+   fon9::File::PosType        NextPos_{0};
+   fon9::TimeStamp            Time_{fon9::TimeStamp{} + fon9::TimeInterval_Second(1000)};
+
+   void Open() {
+      this->PkLog_ = fon9::AsyncFileAppender::Make();
+      auto res = this->PkLog_->OpenImmediately(kPkLogFileName, fon9::FileMode::CreatePath | fon9::FileMode::Read | fon9::FileMode::Append);
+      if (res.IsError() || (res = this->PkLog_->GetFileSize()).IsError()) {
+         std::cout << "[ERROR] Open pklog: " << res.GetError().message() << std::endl;
+         abort();
+      }
+      this->NextPos_ = res.GetResult();
+      res = this->Idx_.Open(kIdxFileName, this->NextPos_);
+      if (res.IsError()) {
+         std::cout << "[ERROR] Open idx: " << res.GetError().message() << std::endl;
+         abort();
+      }
+      this->Idx_.SeqInterval_ = 100;
+   }
+   void Close() {
+      this->PkLog_.reset();
+      this->Idx_.Close();
+   }
+   void Append(uint64_t seq) {
+      char           pk[200];
+      const uint16_t pksz = static_cast<uint16_t>(10 + seq % 150);
+      memset(pk, static_cast<char>(seq), pksz);
+      this->Time_ += fon9::TimeInterval_Millisecond(1);
+      fon9::TsAppend(*this->PkLog_, this->Idx_, this->Time_, pk, pksz, seq);
+      this->PosToSeq_[this->NextPos_] = seq;
+      this->NextPos_ += fon9::TsAppendRecordSize(pksz);
+   }
+};
+
+/// 從 FindPosBySeq(seq) 的位置開始讀, 不可遺漏 seq; 且不應該距離 seq 太遠.
+void CheckFindPosBySeq(const PkLogWriter& wr, uint64_t seq, uint64_t maxDistance) {
+   const fon9::File::PosType pos = wr.Idx_.FindPosBySeq(seq);
+   auto ifind = wr.PosToSeq_.find(pos);
+   if (pos != 0 && ifind == wr.PosToSeq_.end()) {
+      std::cout << "|seq=" << seq << "|pos=" << pos << "|err=pos not a record." "\r[ERROR]" << std::endl;
+      abort();
+   }
+   const uint64_t idxSeq = (pos == 0 ? 0 : ifind->second);
+   if (idxSeq >= seq || seq - idxSeq > maxDistance) {
+      std::cout << "|seq=" << seq << "|pos=" << pos << "|idxSeq=" << idxSeq
+         << "|err=Invalid FindPosBySeq()" "\r[ERROR]" << std::endl;
+      abort();
+   }
+}
+
+int main(int argc, char* argv[]) {
+   (void)argc; (void)argv;
+   fon9::AutoPrintTestInfo utinfo{"TsAppend"};
+   remove(kPkLogFileName);
+   remove(kIdxFileName);
+
+   const uint64_t kPkCount = 100000;
+   PkLogWriter    wr;
+   std::cout << "[TEST ] TsAppendIndex.FindPosBySeq";
+   wr.Open();
+   for (uint64_t seq = 1; seq <= kPkCount; ++seq)
+      wr.Append(seq);
+   std::cout << "|entries=" << wr.Idx_.GetEntries().size();
+   for (uint64_t seq = 1; seq <= kPkCount; seq += 7)
+      CheckFindPosBySeq(wr, seq, wr.Idx_.SeqInterval_);
+   std::cout << "\r[OK   ]" << std::endl;
+
+   std::cout << "[TEST ] TsAppendIndex.FindPosByTime";
+   {  // 每個封包間隔 1ms, 索引每 100 筆一筆: 所以找到的位置, 最多比指定的時間早 100ms.
+      const fon9::TimeStamp tmBegin = wr.Time_ - fon9::TimeInterval_Millisecond(kPkCount);
+      for (uint64_t seq = 2; seq <= kPkCount; seq += 13) {
+         const fon9::TimeStamp tm = tmBegin + fon9::TimeInterval_Millisecond(static_cast<int64_t>(seq));
+         auto ifind = wr.PosToSeq_.find(wr.Idx_.FindPosByTime(tm));
+         if (ifind == wr.PosToSeq_.end() || ifind->second >= seq || seq - ifind->second > wr.Idx_.SeqInterval_) {
+            std::cout << "|seq=" << seq << "|err=Invalid FindPosByTime()" "\r[ERROR]" << std::endl;
+            abort();
+         }
+      }
+   }
+   std::cout << "\r[OK   ]" << std::endl;
+
+   std::cout << "[TEST ] TsAppendIndex.SeqReset";
+   // 序號重置(例: 快照更新每輪從 1 開始), 並加入標記: 之後應以最後一次重置為準.
+   const fon9::File::PosType markPos = wr.Idx_.GetNextPos();
+   wr.Idx_.AddMark(1, wr.Time_, markPos);
+   for (uint64_t seq = 1; seq <= 1000; ++seq)
+      wr.Append(seq);
+   CheckFindPosBySeq(wr, 500, wr.Idx_.SeqInterval_);
+   if (wr.Idx_.FindPosBySeq(500) < markPos) {
+      std::cout << "|err=FindPosBySeq() before SeqReset." "\r[ERROR]" << std::endl;
+      abort();
+   }
+   std::cout << "\r[OK   ]" << std::endl;
+
+   std::cout << "[TEST ] TsAppendIndex.Reopen";
+   const size_t entryCount = wr.Idx_.GetEntries().size();
+   wr.Close();
+   wr.Open();
+   if (wr.Idx_.GetEntries().size() != entryCount
+       || wr.Idx_.GetLastMark() == nullptr || wr.Idx_.GetLastMark()->Pos_ != markPos) {
+      std::cout << "|entries=" << wr.Idx_.GetEntries().size() << "|err=Reload index." "\r[ERROR]" << std::endl;
+      abort();
+   }
+   CheckFindPosBySeq(wr, 500, wr.Idx_.SeqInterval_);
+   std::cout << "\r[OK   ]" << std::endl;
+
+   std::cout << "[TEST ] TsAppendIndex.PkLogTruncated";
+   // pklog 尾端遺失(例: 當機): 超過 pklog 大小的索引(含標記)應移除.
+   wr.Close();
+   {
+      fon9::File fd;
+      fd.Open(kPkLogFileName, fon9::FileMode::Write);
+      fd.SetFileSize(markPos);
+   }
+   wr.Open();
+   if (wr.Idx_.GetLastMark() != nullptr || wr.Idx_.GetEntries().back().Pos_ >= markPos) {
+      std::cout << "|err=Entry after pklog size." "\r[ERROR]" << std::endl;
+      abort();
+   }
+   std::cout << "|entries=" << wr.Idx_.GetEntries().size();
+   for (auto i = wr.PosToSeq_.lower_bound(markPos); i != wr.PosToSeq_.end();)
+      i = wr.PosToSeq_.erase(i);
+   for (uint64_t seq = kPkCount - 10; seq <= kPkCount + 1000; ++seq) // 重複序號, 再加入新的序號.
+      wr.Append(seq);
+   CheckFindPosBySeq(wr, kPkCount + 500, wr.Idx_.SeqInterval_);
+   std::cout << "\r[OK   ]" << std::endl;
+
+   wr.Close();
+   remove(kPkLogFileName);
+   remove(kIdxFileName);
+}
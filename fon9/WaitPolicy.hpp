@@ -3,6 +3,7 @@
 #ifndef __fon9_WaitPolicy_hpp__
 #define __fon9_WaitPolicy_hpp__
 #include "fon9/SpinMutex.hpp"
+#include "fon9/Tools.hpp"
 #include <mutex>
 #include <condition_variable>
 
@@ -108,5 +109,78 @@ public:
 
 using WaitPolicy_SpinBusy = WaitPolicy_Spin<SpinBusy>;
 
+fon9_WARN_DISABLE_PADDING;
+/// \ingroup Thrs
+/// 先 spin, 再 yield, 最後才使用 std::condition_variable 等候(HowWait::Adaptive).
+/// - Wait(): 解鎖後, 先 spin kSpinCount 次, 再 yield kYieldCount 次, 檢查是否有 Notify;
+///   都沒有 Notify, 才再次鎖定並進入 condition_variable 等候.
+/// - Notify: 只有在有 thread 進入 condition_variable 等候時, 才需要呼叫 notify(系統呼叫).
+/// - 與 WaitPolicy_CV 相同, 呼叫 Notify 時必須在 lock 狀態.
+/// - Wait() 返回後, 呼叫端必須自行檢查條件是否成立(可能是其他原因的喚醒).
+template <uint32_t kSpinCount = 20000, uint32_t kYieldCount = 200>
+class WaitPolicy_Adaptive {
+   fon9_NON_COPY_NON_MOVE(WaitPolicy_Adaptive);
+   using NotifyIdType = uint64_t;
+   std::atomic<NotifyIdType>  NotifyCount_{0};
+   /// 在 condition_variable 等候中的 thread 數量, 必須在 lock 狀態下存取.
+   uint32_t                   BlockingCount_{0};
+   std::condition_variable    CV_;
+
+public:
+   using Mutex = std::mutex;
+   using Locker = std::unique_lock<Mutex>;
+
+   WaitPolicy_Adaptive() = default;
+
+   void Wait(Locker& locker) {
+      if (this->SpinWait(locker))
+         return;
+      ++this->BlockingCount_;
+      this->CV_.wait(locker);
+      --this->BlockingCount_;
+   }
+
+   template<class Duration>
+   void WaitFor(Locker& locker, const Duration& dur) {
+      if (this->SpinWait(locker))
+         return;
+      ++this->BlockingCount_;
+      this->CV_.wait_for(locker, dur);
+      --this->BlockingCount_;
+   }
+
+   void NotifyAll(const Locker&) {
+      this->NotifyCount_.fetch_add(1, std::memory_order_release);
+      if (this->BlockingCount_)
+         this->CV_.notify_all();
+   }
+
+   void NotifyOne(const Locker&) {
+      this->NotifyCount_.fetch_add(1, std::memory_order_release);
+      if (this->BlockingCount_)
+         this->CV_.notify_one();
+   }
+
+private:
+   /// 在解鎖狀態下 spin, yield 等候 Notify.
+   /// 返回時必定為 lock 狀態, 傳回 false 表示沒有等到 Notify, 應進入 condition_variable 等候.
+   bool SpinWait(Locker& locker) {
+      const NotifyIdType currId = this->NotifyCount_.load(std::memory_order_relaxed);
+      const AdaptiveWaitArgs  args{kSpinCount, kYieldCount};
+      AdaptiveWaitCounter     counter;
+      locker.unlock();
+      while (counter.OnIdle(args)) {
+         if (this->NotifyCount_.load(std::memory_order_acquire) != currId) {
+            locker.lock();
+            return true;
+         }
+      }
+      locker.lock();
+      // 在 lock 狀態下再檢查一次, 之後的 Notify 必定在 CV_.wait() 之後.
+      return this->NotifyCount_.load(std::memory_order_relaxed) != currId;
+   }
+};
+fon9_WARN_POP;
+
 } // namespaces
 #endif//__fon9_WaitPolicy_hpp__
@@ -2,9 +2,293 @@
 // \author fonwinz@gmail.com
 #include "fon9/fix/FixParser.hpp"
 #include "fon9/StrTo.hpp"
+#include <atomic>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define fon9_FixParser_HAVE_X64_SIMD
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#pragma intrinsic(_BitScanForward64)
+#define fon9_TARGET_AVX2
+#else
+#define fon9_TARGET_AVX2   __attribute__((target("avx2")))
+#endif
+#endif
 
 namespace fon9 { namespace fix {
 
+// 掃描區塊大小: 每個區塊的 '=', SOH 位置, 各用一個 uint64_t 的 bit mask 表示.
+static constexpr size_t kScanBlockSize = 64;
+
+//--------------------------------------------------------------------------//
+static uint32_t SumBytes_Scalar(const char* beg, size_t size) {
+   uint32_t sum = 0;
+   for (; size >= 4; size -= 4, beg += 4)
+      sum += static_cast<uint32_t>(static_cast<byte>(beg[0]) + static_cast<byte>(beg[1])
+                                 + static_cast<byte>(beg[2]) + static_cast<byte>(beg[3]));
+   while (size > 0) {
+      sum += static_cast<byte>(*beg++);
+      --size;
+   }
+   return sum;
+}
+static uint32_t ScanBlock_Scalar(const char* blk, uint64_t& eqMask, uint64_t& splMask) {
+   uint64_t eq = 0, spl = 0;
+   uint32_t sum = 0;
+   for (unsigned L = 0; L < kScanBlockSize; ++L) {
+      const byte ch = static_cast<byte>(blk[L]);
+      sum += ch;
+      if (ch == '=')
+         eq |= (uint64_t{1} << L);
+      else if (ch == static_cast<byte>(f9fix_kCHAR_SPL))
+         spl |= (uint64_t{1} << L);
+   }
+   eqMask = eq;
+   splMask = spl;
+   return sum;
+}
+
+#ifdef fon9_FixParser_HAVE_X64_SIMD
+static inline unsigned CountTrailingZero64(uint64_t mask) {
+#ifdef _MSC_VER
+   unsigned long res;
+   _BitScanForward64(&res, mask);
+   return static_cast<unsigned>(res);
+#else
+   return static_cast<unsigned>(__builtin_ctzll(mask));
+#endif
+}
+static inline uint32_t FoldSad128(__m128i acc) {
+   return static_cast<uint32_t>(_mm_cvtsi128_si32(acc) + _mm_cvtsi128_si32(_mm_srli_si128(acc, 8)));
+}
+// x64 必定支援 SSE2.
+static uint32_t SumBytes_SSE2(const char* beg, size_t size) {
+   const __m128i zero = _mm_setzero_si128();
+   __m128i acc = zero;
+   for (; size >= 16; size -= 16, beg += 16)
+      acc = _mm_add_epi64(acc, _mm_sad_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(beg)), zero));
+   return FoldSad128(acc) + SumBytes_Scalar(beg, size);
+}
+static uint32_t ScanBlock_SSE2(const char* blk, uint64_t& eqMask, uint64_t& splMask) {
+   const __m128i zero = _mm_setzero_si128();
+   const __m128i veq = _mm_set1_epi8('=');
+   const __m128i vspl = _mm_set1_epi8(f9fix_kCHAR_SPL);
+   const __m128i v0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(blk));
+   const __m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(blk + 16));
+   const __m128i v2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(blk + 32));
+   const __m128i v3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(blk + 48));
+   #define f9fix_MASK64(vcmp) \
+      ( static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v0, vcmp)))) \
+      | static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v1, vcmp)))) << 16 \
+      | static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v2, vcmp)))) << 32 \
+      | static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v3, vcmp)))) << 48 )
+   eqMask = f9fix_MASK64(veq);
+   splMask = f9fix_MASK64(vspl);
+   #undef f9fix_MASK64
+   const __m128i acc = _mm_add_epi64(_mm_add_epi64(_mm_sad_epu8(v0, zero), _mm_sad_epu8(v1, zero)),
+                                     _mm_add_epi64(_mm_sad_epu8(v2, zero), _mm_sad_epu8(v3, zero)));
+   return FoldSad128(acc);
+}
+
+fon9_TARGET_AVX2 static uint32_t FoldSad256(__m256i acc) {
+   return FoldSad128(_mm_add_epi64(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1)));
+}
+fon9_TARGET_AVX2 static uint32_t SumBytes_AVX2(const char* beg, size_t size) {
+   const __m256i zero = _mm256_setzero_si256();
+   __m256i acc = zero;
+   for (; size >= 32; size -= 32, beg += 32)
+      acc = _mm256_add_epi64(acc, _mm256_sad_epu8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(beg)), zero));
+   return FoldSad256(acc) + SumBytes_SSE2(beg, size);
+}
+fon9_TARGET_AVX2 static uint32_t ScanBlock_AVX2(const char* blk, uint64_t& eqMask, uint64_t& splMask) {
+   const __m256i zero = _mm256_setzero_si256();
+   const __m256i veq = _mm256_set1_epi8('=');
+   const __m256i vspl = _mm256_set1_epi8(f9fix_kCHAR_SPL);
+   const __m256i v0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(blk));
+   const __m256i v1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(blk + 32));
+   eqMask = static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v0, veq))))
+          | static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v1, veq)))) << 32;
+   splMask = static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v0, vspl))))
+           | static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v1, vspl)))) << 32;
+   return FoldSad256(_mm256_add_epi64(_mm256_sad_epu8(v0, zero), _mm256_sad_epu8(v1, zero)));
+}
+
+static bool IsCpuSupportAVX2() {
+#ifdef _MSC_VER
+   int regs[4];
+   __cpuid(regs, 0);
+   if (regs[0] < 7)
+      return false;
+   __cpuid(regs, 1);
+   // OSXSAVE(bit 27) & AVX(bit 28); 且 OS 必須有保存 YMM 暫存器.
+   if ((regs[2] & (3 << 27)) != (3 << 27) || (_xgetbv(0) & 6) != 6)
+      return false;
+   __cpuidex(regs, 7, 0);
+   return (regs[1] & (1 << 5)) != 0;
+#else
+   __builtin_cpu_init();
+   return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+#else
+static inline unsigned CountTrailingZero64(uint64_t mask) {
+   unsigned res = 0;
+   while ((mask & 1) == 0) {
+      mask >>= 1;
+      ++res;
+   }
+   return res;
+}
+#endif // fon9_FixParser_HAVE_X64_SIMD
+
+//--------------------------------------------------------------------------//
+struct FixScanKernels {
+   FixParser::ScanImpl Impl_;
+   uint32_t (*SumBytes_)(const char* beg, size_t size);
+   /// 掃描 blk[0..kScanBlockSize), 傳回 byte 的總和.
+   uint32_t (*ScanBlock_)(const char* blk, uint64_t& eqMask, uint64_t& splMask);
+};
+static const FixScanKernels FixScanKernels_Scalar{FixParser::ScanImpl::Scalar, &SumBytes_Scalar, &ScanBlock_Scalar};
+#ifdef fon9_FixParser_HAVE_X64_SIMD
+static const FixScanKernels FixScanKernels_SSE2{FixParser::ScanImpl::SSE2, &SumBytes_SSE2, &ScanBlock_SSE2};
+static const FixScanKernels FixScanKernels_AVX2{FixParser::ScanImpl::AVX2, &SumBytes_AVX2, &ScanBlock_AVX2};
+#endif
+
+static const FixScanKernels* GetFixScanKernels(FixParser::ScanImpl impl) {
+   switch (impl) {
+   case FixParser::ScanImpl::Scalar:
+      return &FixScanKernels_Scalar;
+#ifdef fon9_FixParser_HAVE_X64_SIMD
+   case FixParser::ScanImpl::SSE2:
+      return &FixScanKernels_SSE2;
+   case FixParser::ScanImpl::AVX2:
+      return IsCpuSupportAVX2() ? &FixScanKernels_AVX2 : nullptr;
+#else
+   case FixParser::ScanImpl::SSE2:
+   case FixParser::ScanImpl::AVX2:
+      break;
+#endif
+   }
+   return nullptr;
+}
+static const FixScanKernels* GetBestFixScanKernels() {
+#ifdef fon9_FixParser_HAVE_X64_SIMD
+   return IsCpuSupportAVX2() ? &FixScanKernels_AVX2 : &FixScanKernels_SSE2;
+#else
+   return &FixScanKernels_Scalar;
+#endif
+}
+// 在 static 初始化完成前(例: 其他 static 物件的建構), 使用 Scalar 版.
+static std::atomic<const FixScanKernels*>  FixScanKernels_{&FixScanKernels_Scalar};
+static const bool FixScanKernels_Init_ = (FixScanKernels_.store(GetBestFixScanKernels(), std::memory_order_relaxed), true);
+
+static inline const FixScanKernels& CurrFixScanKernels() {
+   return *FixScanKernels_.load(std::memory_order_relaxed);
+}
+
+bool FixParser::SetScanImpl(ScanImpl impl) {
+   if (const FixScanKernels* k = GetFixScanKernels(impl)) {
+      FixScanKernels_.store(k, std::memory_order_relaxed);
+      return true;
+   }
+   return false;
+}
+FixParser::ScanImpl FixParser::GetScanImpl() {
+   return CurrFixScanKernels().Impl_;
+}
+FixParser::ScanImpl FixParser::GetBestScanImpl() {
+   return GetBestFixScanKernels()->Impl_;
+}
+const char* FixParser::GetScanImplName(ScanImpl impl) {
+   switch (impl) {
+   case ScanImpl::Scalar:  return "Scalar";
+   case ScanImpl::SSE2:    return "SSE2";
+   case ScanImpl::AVX2:    return "AVX2";
+   }
+   return "?";
+}
+
+//--------------------------------------------------------------------------//
+/// 依序掃描 [beg..end) 的每個區塊, 取得 '=' 及 SOH 的位置, 並累計 byte 的總和.
+/// - 每個區塊只會掃描一次, 所以 Sum_ 不會重複計算.
+/// - 尋找的位置必須遞增.
+struct FixParser::FieldScanner {
+   fon9_NON_COPY_NON_MOVE(FieldScanner);
+   const FixScanKernels&   Kernels_;
+   const char* const       Beg_;
+   const size_t            Size_;
+   /// 目前區塊在 Beg_ 的位置, Beg_ + BlockOfs_ 之前(不含目前區塊)已掃描完畢.
+   size_t                  BlockOfs_{0};
+   uint64_t                EqMask_{0};
+   uint64_t                SplMask_{0};
+   uint32_t                Sum_{0};
+   bool                    IsBlockLoaded_{false};
+   char                    Padding____[3];
+
+   FieldScanner(const char* beg, const char* end)
+      : Kernels_(CurrFixScanKernels())
+      , Beg_{beg}
+      , Size_{static_cast<size_t>(end - beg)} {
+      this->LoadBlock();
+   }
+   /// 載入 Beg_ + BlockOfs_ 的區塊.
+   bool LoadBlock() {
+      if (this->BlockOfs_ >= this->Size_)
+         return this->IsBlockLoaded_ = false;
+      const size_t remain = this->Size_ - this->BlockOfs_;
+      if (fon9_LIKELY(remain >= kScanBlockSize))
+         this->Sum_ += this->Kernels_.ScanBlock_(this->Beg_ + this->BlockOfs_, this->EqMask_, this->SplMask_);
+      else {
+         // 最後一個區塊: 補 0, 不影響 '=', SOH 及 byte 的總和.
+         char blk[kScanBlockSize];
+         memcpy(blk, this->Beg_ + this->BlockOfs_, remain);
+         memset(blk + remain, 0, kScanBlockSize - remain);
+         this->Sum_ += this->Kernels_.ScanBlock_(blk, this->EqMask_, this->SplMask_);
+      }
+      return this->IsBlockLoaded_ = true;
+   }
+   bool NextBlock() {
+      if (!this->IsBlockLoaded_)
+         return false;
+      this->BlockOfs_ += kScanBlockSize;
+      return this->LoadBlock();
+   }
+   /// 從 from 開始, 尋找 mask 標示的字元.
+   /// \retval nullptr 找不到.
+   const char* Find(uint64_t FieldScanner::*mask, const char* from) {
+      const size_t ofs = static_cast<size_t>(from - this->Beg_);
+      while (this->IsBlockLoaded_) {
+         if (ofs < this->BlockOfs_ + kScanBlockSize) {
+            uint64_t m = this->*mask;
+            if (ofs > this->BlockOfs_)
+               m &= (~uint64_t{0} << (ofs - this->BlockOfs_));
+            if (m)
+               return this->Beg_ + this->BlockOfs_ + CountTrailingZero64(m);
+         }
+         this->NextBlock();
+      }
+      return nullptr;
+   }
+   const char* FindEq(const char* from) {
+      return this->Find(&FieldScanner::EqMask_, from);
+   }
+   const char* FindSpl(const char* from) {
+      return this->Find(&FieldScanner::SplMask_, from);
+   }
+   /// 掃描剩餘的區塊, 完成 Sum_ 的計算.
+   uint32_t FinishSum() {
+      if (this->IsBlockLoaded_) {
+         const size_t ofs = this->BlockOfs_ + kScanBlockSize;
+         if (ofs < this->Size_)
+            this->Sum_ += this->Kernels_.SumBytes_(this->Beg_ + ofs, this->Size_ - ofs);
+         this->IsBlockLoaded_ = false;
+         this->BlockOfs_ = this->Size_;
+      }
+      return this->Sum_;
+   }
+};
+
 FixParser::FixParser() {
    // 預先分配必用(常用)的欄位: 1..511.
    // 0..0xff(255)
@@ -81,8 +365,7 @@ FixParser::Result FixParser::Verify(StrView& fixmsg, VerifyItem vitem) {
           || pend[3] != '=')
          return EFormat;
       byte cks = Pic9StrTo<3, byte>(pend + 4);// static_cast<byte>(((pend[4] - '0') * 10 + (pend[5] - '0')) * 10 + (pend[6] - '0'));
-      while (pbeg < pend)
-         cks = static_cast<byte>(cks - static_cast<byte>(*pbeg++));
+      cks = static_cast<byte>(cks - CurrFixScanKernels().SumBytes_(pbeg, static_cast<size_t>(pend - pbeg)));
       if (cks != f9fix_kCHAR_SPL) {
          this->Clear();
          this->ExpectSize_ = static_cast<ExpectSize>(expsz);
@@ -93,24 +376,75 @@ FixParser::Result FixParser::Verify(StrView& fixmsg, VerifyItem vitem) {
    return static_cast<Result>(expsz);
 }
 FixParser::Result FixParser::Parse(StrView& fixmsg, Until until) {
-   Result rcode = this->Verify(fixmsg, until== Until::FullMessage ? VerifyAll : VerifyLengthOnly);
-   if (rcode == NeedsMore || rcode == ECheckSum)
+   if (until != Until::FullMessage) {
+      Result rcode = this->Verify(fixmsg, VerifyLengthOnly);
+      if (rcode == NeedsMore)
+         return rcode;
+      this->Clear();
+      if (rcode < NeedsMore)
+         return rcode;
+      Result pcode = this->ParseFields(fixmsg, until);
+      if (pcode < 0) // 發生錯誤, 傳回錯誤代碼.
+         return pcode;
+      return rcode;
+   }
+   // 在解析欄位的同時計算 check sum, 所以 Verify() 不檢查 check sum.
+   const char* const pmsg = fixmsg.begin();
+   Result rcode = this->Verify(fixmsg, VerifyHeader);
+   if (rcode == NeedsMore)
       return rcode;
    this->Clear();
    if (rcode < NeedsMore)
       return rcode;
-   Result pcode = this->ParseFields(fixmsg, until);
+   //  |10=xxx
+   // [0123456]
+   const char* const pbody = fixmsg.begin();
+   const char* const pend = fixmsg.end();
+   if (pend[0] != f9fix_kCHAR_SPL
+       || pend[1] != '1'
+       || pend[2] != '0'
+       || pend[3] != '=') {
+      fixmsg.SetBegin(pbody - 1);
+      return EFormat;
+   }
+   FieldScanner scanner{pbody, pend};
+   Result       pcode = this->ParseFields(fixmsg, until, scanner);
+   const byte   cks = static_cast<byte>(Pic9StrTo<3, byte>(pend + 4)
+                                        - scanner.FinishSum()
+                                        - CurrFixScanKernels().SumBytes_(pmsg, static_cast<size_t>(pbody - pmsg)));
+   if (cks != f9fix_kCHAR_SPL) {
+      this->Clear();
+      this->ExpectSize_ = static_cast<ExpectSize>(rcode);
+      return ECheckSum;
+   }
    if (pcode < 0) // 發生錯誤, 傳回錯誤代碼.
       return pcode;
    return rcode;
 }
 FixParser::Result FixParser::ParseFields(StrView& fixmsg, Until until) {
+   FieldScanner scanner{fixmsg.begin(), fixmsg.end()};
+   return this->ParseFields(fixmsg, until, scanner);
+}
+FixParser::Result FixParser::ParseFields(StrView& fixmsg, Until until, FieldScanner& scanner) {
    const char* msgend = fixmsg.end();
-   while (fixmsg.begin() < msgend) {
-      const FixTag tag = StrTo(&fixmsg, 0u);
-      if (fon9_UNLIKELY(tag == 0 || fixmsg.Get1st() != '='))
+   const char* pcur = fixmsg.begin();
+   bool        isMsgSeqNumParsed = false;
+   while (pcur < msgend) {
+      // tag: 在 '=' 之前必須全都是數字.
+      const char* const peq = scanner.FindEq(pcur);
+      const char* const ptagEnd = (peq ? peq : msgend);
+      FixTag            tag = 0;
+      for (; pcur < ptagEnd; ++pcur) {
+         const FixTag digit = static_cast<FixTag>(static_cast<byte>(*pcur) - static_cast<byte>('0'));
+         if (digit > 9)
+            break;
+         tag = tag * 10 + digit;
+      }
+      if (fon9_UNLIKELY(tag == 0 || pcur != peq)) {
+         fixmsg.SetBegin(pcur);
          return EFormat;
-      fixmsg.SetBegin(fixmsg.begin() + 1); //移除 '='
+      }
+      fixmsg.SetBegin(++pcur); //移除 '='
 
       FixField& fld = this->FieldArray_[tag];
       if (fon9_UNLIKELY(fld.ValueCount_ >= kMaxDupFieldCount + 1))
@@ -131,24 +465,33 @@ FixParser::Result FixParser::ParseFields(StrView& fixmsg, Until until) {
          pValue = &this->MFields_[fld.MIndex_ * static_cast<size_t>(kMaxDupFieldCount) + (fld.ValueCount_ - 1)];
       }
 
-      if (fon9_LIKELY(tag != f9fix_kTAG_RawData))
-         *pValue = StrFetchNoTrim(fixmsg, f9fix_kCHAR_SPL);
-      else { // RawData 可包含任意字元, 所以要用 RawDataLength 來判斷長度.
-         const FixField* fldRawDataLength = GetField(f9fix_kTAG_RawDataLength);
-         if (fon9_UNLIKELY(!fldRawDataLength)) {
-            // 如果沒有 RawDataLength 則使用分隔字元.
-            *pValue = StrFetchNoTrim(fixmsg, f9fix_kCHAR_SPL);
-            // return ERawData;
+      const FixField* fldRawDataLength;
+      if (fon9_LIKELY(tag != f9fix_kTAG_RawData)
+          // 如果沒有 RawDataLength 則使用分隔字元.
+          || fon9_UNLIKELY((fldRawDataLength = GetField(f9fix_kTAG_RawDataLength)) == nullptr)) {
+         if (const char* pspl = scanner.FindSpl(pcur)) {
+            pValue->Reset(pcur, pspl);
+            pcur = pspl + 1;
          }
          else {
-            uint32_t rawDataLength = StrTo(fldRawDataLength->Value_, static_cast<uint32_t>(-1));
-            if (fon9_UNLIKELY(rawDataLength > fixmsg.size()))
-               return ERawData;
-            if (fon9_UNLIKELY(fixmsg.begin()[rawDataLength] != f9fix_kCHAR_SPL))
-               return ERawData;
-            pValue->Reset(fixmsg.begin(), fixmsg.begin() + rawDataLength);
-            fixmsg.SetBegin(pValue->end() + 1);// +1 移除 f9fix_kCHAR_SPL
+            pValue->Reset(pcur, msgend);
+            pcur = msgend;
          }
+         fixmsg.SetBegin(pcur);
+      }
+      else { // RawData 可包含任意字元, 所以要用 RawDataLength 來判斷長度.
+         uint32_t rawDataLength = StrTo(fldRawDataLength->Value_, static_cast<uint32_t>(-1));
+         if (fon9_UNLIKELY(rawDataLength > fixmsg.size()))
+            return ERawData;
+         if (fon9_UNLIKELY(fixmsg.begin()[rawDataLength] != f9fix_kCHAR_SPL))
+            return ERawData;
+         pValue->Reset(fixmsg.begin(), fixmsg.begin() + rawDataLength);
+         fixmsg.SetBegin(pcur = pValue->end() + 1);// +1 移除 f9fix_kCHAR_SPL
+      }
+      if (tag == f9fix_kTAG_MsgSeqNum && fld.ValueCount_ == 0) {
+         // 訊息內容仍在 cache, 直接轉換, 不用在解析完畢後再找一次.
+         this->MsgSeqNum_ = StrTo(*pValue, 0u);
+         isMsgSeqNumParsed = true;
       }
       ++fld.ValueCount_;
       this->FieldList_.push_back(&fld);
@@ -165,8 +508,11 @@ FixParser::Result FixParser::ParseFields(StrView& fixmsg, Until until) {
       if (until == Until::FullMessage)
          break;
    }
-   const FixField* fldMsgSeqNum = this->GetField(f9fix_kTAG_MsgSeqNum);
-   this->MsgSeqNum_ = (fldMsgSeqNum ? StrTo(fldMsgSeqNum->Value_, 0u) : 0);
+   if (!isMsgSeqNumParsed) {
+      // 在 Clear() 之後, 之前的 ParseFields() 已解析過 MsgSeqNum.
+      const FixField* fldMsgSeqNum = this->GetField(f9fix_kTAG_MsgSeqNum);
+      this->MsgSeqNum_ = (fldMsgSeqNum ? StrTo(fldMsgSeqNum->Value_, 0u) : 0);
+   }
    return ParseEnd;
 }
 StrView FixParser::GetValue(const FixField& fld, unsigned index) const {
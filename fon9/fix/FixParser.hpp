@@ -21,6 +21,8 @@ namespace fon9 { namespace fix {
 ///   - 通常一個 FixSession 擁有一個 FixParser 處理解析後的結果.
 ///   - 直到 FixSession 結束後釋放 FixParser.
 /// - 不解析 "8=BeginString" 及 "9=BodyLength", 所以 GetField(8) 及 GetField(9) 都傳回 nullptr.
+/// - 解析時, 每次掃描 64 bytes(SSE2: 4*16, AVX2: 2*32), 一次取得區塊內全部 '=' 及 SOH 的位置,
+///   並同時累計 check sum; 所以 Parse(Until::FullMessage) 只需要掃描訊息一次.
 class fon9_API FixParser {
    fon9_NON_COPY_NON_MOVE(FixParser);
 public:
@@ -44,6 +46,21 @@ public:
 
    FixParser();
 
+   /// Parse(), ParseFields(), Verify() 掃描訊息使用的實作方式.
+   /// 程式啟動時, 會依照 CPU 支援的指令集, 自動選擇最快的實作.
+   enum class ScanImpl : uint8_t {
+      Scalar,
+      SSE2,
+      AVX2,
+   };
+   /// 強制使用指定的實作, 例: 效率測試時, 比較不同實作的差異.
+   /// \retval false CPU 不支援 impl, 不改變目前的設定.
+   static bool SetScanImpl(ScanImpl impl);
+   static ScanImpl GetScanImpl();
+   /// 此 CPU 可用的最快實作.
+   static ScanImpl GetBestScanImpl();
+   static const char* GetScanImplName(ScanImpl impl);
+
    /// 清除上次解析的欄位 & expect size.
    /// 之後的 GetField() 都會傳回 nullptr.
    void Clear();
@@ -188,6 +205,9 @@ public:
       return this->FieldList_.size();
    }
 private:
+   struct FieldScanner;
+   Result ParseFields(StrView& fixmsg, Until until, FieldScanner& scanner);
+
    using FieldArray = LevelArray<FixTag, FixField>;
    CharVector  ExpectHeader_;
    FieldArray  FieldArray_;
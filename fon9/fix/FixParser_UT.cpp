@@ -78,19 +78,9 @@ f9fix::FixParser::Result TestFixParser(const char* testName,
    return res;
 }
 
-int main(int argc, char** args) {
-   (void)argc; (void)args;
-
-#if defined(_MSC_VER) && defined(_DEBUG)
-   _CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
-#endif
-
-   fon9::AutoPrintTestInfo utinfo{"FixParser/FixBuilder"};
-   fon9::GetDefaultTimerThread();
-   std::this_thread::sleep_for(std::chrono::milliseconds{10});
-
+#define _   f9fix_kCSTR_SPL
+void TestFixParsers() {
    f9fix::FixParser   fixpr;
-   #define _   f9fix_kCSTR_SPL
 
    // 一般訊息.
    const FldValue vs1[] = {{35,"A"},{56,"Client"},{49,"Server"},{34,"1"},{52,"20170426-00:49:26.625"},{108,"3000"},{98,"0"}};
@@ -153,4 +143,85 @@ int main(int argc, char** args) {
                  "98=0" _ "98=1" _ "98=2" _ "98=3" _ "98=4" _
                  "99=A" _ "99=B" _ "99=C" _ "99=D" _ "99=E" _ "10=240" _,
                  vs7, fon9::numofele(vs7));
+
+   // Test: check sum 錯誤.
+   fixmsg = fon9::StrView{"8=FIX.4.4" _ "9=69" _ "35=A" _ "56=Client" _ "49=Server" _ "34=1" _ "52=20170426-00:49:26.625" _ "108=3000" _ "98=0" _ "10=068" _};
+   const auto msgsz = fixmsg.size();
+   if (fixpr.Parse(fixmsg) != f9fix::FixParser::ECheckSum || fixpr.GetExpectSize() != msgsz || fixpr.GetField(35)) {
+      std::cout << "Unexpected ECheckSum." << std::endl;
+      abort();
+   }
+   // Test: 欄位格式錯誤 & check sum 錯誤, 應傳回 ECheckSum.
+   fixmsg = fon9::StrView{"8=FIX.4.4" _ "9=70" _ "3x5=A" _ "56=Client" _ "49=Server" _ "34=4" _ "52=20170426-00:49:26.625" _ "108=3000" _ "98=0" _ "10=183" _};
+   if (fixpr.Parse(fixmsg) != f9fix::FixParser::ECheckSum) {
+      std::cout << "Unexpected ECheckSum(EFormat)." << std::endl;
+      abort();
+   }
+}
+//--------------------------------------------------------------------------//
+void BenchmarkFixParser(const char* msgName, const fon9::StrView fixmsg) {
+   const unsigned    kTimes = 1000 * 1000;
+   f9fix::FixParser  fixpr;
+   fon9::StopWatch   stopWatch;
+   std::string       testName;
+   for (f9fix::FixParser::ScanImpl impl : {f9fix::FixParser::ScanImpl::Scalar,
+                                           f9fix::FixParser::ScanImpl::SSE2,
+                                           f9fix::FixParser::ScanImpl::AVX2}) {
+      if (!f9fix::FixParser::SetScanImpl(impl))
+         continue;
+      testName.assign(msgName);
+      testName.append("|impl=");
+      testName.append(f9fix::FixParser::GetScanImplName(impl));
+      stopWatch.ResetTimer();
+      for (unsigned L = 0; L < kTimes; ++L) {
+         fon9::StrView msg{fixmsg};
+         if (fixpr.Parse(msg) != static_cast<f9fix::FixParser::Result>(fixmsg.size())) {
+            std::cout << testName << "|err=Parse()" "\r" "[ERROR]" << std::endl;
+            abort();
+         }
+      }
+      const double span = stopWatch.StopTimer();
+      stopWatch.PrintResultNoEOL(span, testName.c_str(), kTimes)
+         << "|" << static_cast<double>(fixmsg.size()) * kTimes / span / 1024 / 1024 << " MB/s"
+         << std::endl;
+   }
+   f9fix::FixParser::SetScanImpl(f9fix::FixParser::GetBestScanImpl());
+}
+//--------------------------------------------------------------------------//
+
+int main(int argc, char** args) {
+   (void)argc; (void)args;
+
+#if defined(_MSC_VER) && defined(_DEBUG)
+   _CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
+#endif
+
+   fon9::AutoPrintTestInfo utinfo{"FixParser/FixBuilder"};
+   fon9::GetDefaultTimerThread();
+   std::this_thread::sleep_for(std::chrono::milliseconds{10});
+
+   const f9fix::FixParser::ScanImpl bestImpl = f9fix::FixParser::GetBestScanImpl();
+   for (f9fix::FixParser::ScanImpl impl : {f9fix::FixParser::ScanImpl::Scalar,
+                                           f9fix::FixParser::ScanImpl::SSE2,
+                                           f9fix::FixParser::ScanImpl::AVX2}) {
+      if (!f9fix::FixParser::SetScanImpl(impl))
+         continue;
+      std::cout << "----- ScanImpl=" << f9fix::FixParser::GetScanImplName(impl) << std::endl;
+      TestFixParsers();
+   }
+   f9fix::FixParser::SetScanImpl(bestImpl);
+
+   utinfo.PrintSplitter();
+   BenchmarkFixParser("Logon",
+                      "8=FIX.4.4" _ "9=69" _ "35=A" _ "56=Client" _ "49=Server" _ "34=1" _ "52=20170426-00:49:26.625" _ "108=3000" _ "98=0" _ "10=067" _);
+   // 典型的成交回報(drop copy).
+   f9fix::FixBuilder fixb;
+   fon9::RevPrint(fixb.GetBuffer(),
+                  f9fix_SPLTAGEQ(MsgType) "8"
+                  _ "49=Server" _ "56=Client" _ "50=SenderSubID" _ "57=TargetSubID" _ "34=1234567" _ "52=20170426-08:49:28.123"
+                  _ "1=ACCOUNT-0001234" _ "6=523.5000" _ "11=ClOrdID-20170426-000123" _ "14=3000" _ "17=ExecID-20170426-00098765"
+                  _ "20=0" _ "31=523.5000" _ "32=1000" _ "37=OrderID-000000456789" _ "38=5000" _ "39=1" _ "40=2" _ "44=523.5000"
+                  _ "54=1" _ "55=2330" _ "59=0" _ "60=20170426-08:49:28.120" _ "150=F" _ "151=2000" _ "207=TW" _ "10000=Y");
+   const std::string execRpt = fon9::BufferTo<std::string>(fixb.Final(f9fix_BEGIN_HEADER_V44));
+   BenchmarkFixParser("ExecutionReport", fon9::ToStrView(execRpt));
 }
@@ -1,10 +1,12 @@
 ﻿// \file fon9/fix/FixRecorder.cpp
 // \author fonwinz@gmail.com
 #include "fon9/fix/FixRecorder_Searcher.hpp"
+#include <set>
 
 namespace fon9 { namespace fix {
 
 FixRecorder::~FixRecorder() {
+   this->Timer_.DisposeAndWait();
    this->DisposeAsync();
    RevBufferList rbuf{256 + sizeof(NumOutBuf)};
    RevPrint(rbuf, f9fix_kCSTR_HdrInfo, UtcNow(), " f9fix.FixRecorder dtor.\n\n"); // 尾端多一個換行,可以比較容易區分重啟.
@@ -14,33 +16,142 @@ FixRecorder::~FixRecorder() {
    this->Worker_.TakeCallLocked(std::move(lk));
 }
 
-File::Result FixRecorder::Initialize(std::string fileName) {
+struct FixRecorderOpenedNames {
+   std::mutex              Mutex_;
+   std::set<std::string>   Names_;
+};
+static FixRecorderOpenedNames& GetFixRecorderOpenedNames() {
+   static FixRecorderOpenedNames names;
+   return names;
+}
+bool FixRecorder::OpenedName::Acquire(const std::string& fileName) {
+   assert(this->FileName_.empty());
+   FixRecorderOpenedNames&       names = GetFixRecorderOpenedNames();
+   std::lock_guard<std::mutex>   lk{names.Mutex_};
+   if (!names.Names_.insert(fileName).second)
+      return false;
+   this->FileName_ = fileName;
+   return true;
+}
+void FixRecorder::OpenedName::Release() {
+   if (this->FileName_.empty())
+      return;
+   FixRecorderOpenedNames&       names = GetFixRecorderOpenedNames();
+   std::lock_guard<std::mutex>   lk{names.Mutex_};
+   names.Names_.erase(this->FileName_);
+   this->FileName_.clear();
+}
+
+File::Result FixRecorder::Initialize(std::string fileName, bool isUseSeqIndex) {
    if (this->GetStorage().IsOpened())
       return File::Result{std::errc::text_file_busy};
-   auto res = this->OpenImmediately(std::move(fileName), FileMode::Append | FileMode::CreatePath | FileMode::Read | FileMode::DenyWrite);
-   if (!res)
+   if (!this->OpenedName_.Acquire(fileName))
+      return File::Result{std::errc::text_file_busy};
+   auto res = this->OpenImmediately(fileName, FileMode::Append | FileMode::CreatePath | FileMode::Read | FileMode::DenyWrite);
+   if (!res) {
+      this->OpenedName_.Release();
       return res;
+   }
    FixParser fixParser;
    fixParser.ResetExpectHeader(ToStrView(this->BeginHeader_));
-   LastSeqSearcher   seqSearcher{fixParser};
-   File&             file = this->GetStorage();
-   res = seqSearcher.Start(file);
-   if (!res)
-      file.Close();
-   else {
-      if ((this->NextSendSeq_ = seqSearcher.NextSendSeq_) == 0)
-         this->NextSendSeq_ = 1;
-      if ((this->NextRecvSeq_ = seqSearcher.NextRecvSeq_) == 0)
-         this->NextRecvSeq_ = 1;
-      this->IdxInfoSizeInterval_ = 0;
-      this->Write(f9fix_kCSTR_HdrInfo,
-                  "f9fix.FixRecorder Initialized"
-                  "|NextSendSeq=", this->NextSendSeq_,
-                  "|NextRecvSeq=", this->NextRecvSeq_);
+   File&    file = this->GetStorage();
+   if (isUseSeqIndex) {
+      res = this->SeqIndex_.Open(fileName + ".idx", file, fixParser);
+      if (res) {
+         this->NextSendSeq_ = this->SeqIndex_.GetNextSendSeq();
+         this->NextRecvSeq_ = this->SeqIndex_.GetNextRecvSeq();
+      }
+      else {
+         this->SeqIndex_.Close();
+         isUseSeqIndex = false;
+      }
+   }
+   if (!isUseSeqIndex) {
+      LastSeqSearcher seqSearcher{fixParser};
+      res = seqSearcher.Start(file);
+      if (!res) {
+         file.Close();
+         this->OpenedName_.Release();
+         return res;
+      }
+      this->NextSendSeq_ = seqSearcher.NextSendSeq_;
+      this->NextRecvSeq_ = seqSearcher.NextRecvSeq_;
    }
+   if (this->NextSendSeq_ == 0)
+      this->NextSendSeq_ = 1;
+   if (this->NextRecvSeq_ == 0)
+      this->NextRecvSeq_ = 1;
+   this->IdxInfoSizeInterval_ = 0;
+   this->Write(f9fix_kCSTR_HdrInfo,
+               "f9fix.FixRecorder Initialized"
+               "|NextSendSeq=", this->NextSendSeq_,
+               "|NextRecvSeq=", this->NextRecvSeq_,
+               "|SeqIndex=", isUseSeqIndex ? StrView{"Y"} : StrView{"N"});
    return res;
 }
 
+ConfigParser::Result FixRecorderArgs::OnTagValue(StrView tag, StrView& value) {
+   if (tag == "FixLogFlush") {
+      const char* endptr;
+      this->FlushInterval_ = StrTo(value, TimeInterval{}, &endptr);
+      if (endptr != value.end() || this->FlushInterval_.GetOrigValue() < 0)
+         return ConfigParser::Result::EInvalidValue;
+   }
+   else if (tag == "FixLogSync")
+      this->IsSyncEachBatch_ = (toupper(value.Get1st()) == 'Y');
+   else if (tag == "FixSeqIndex")
+      this->IsUseSeqIndex_ = (toupper(value.Get1st()) == 'Y');
+   else
+      return ConfigParser::Result::EUnknownTag;
+   return ConfigParser::Result::Success;
+}
+//--------------------------------------------------------------------------//
+void FixRecorder::SetWritePolicy(TimeInterval flushInterval, bool isSyncEachBatch) {
+   {
+      auto lk{this->Worker_.Lock()};
+      this->FlushInterval_ = flushInterval;
+      this->IsSyncEachBatch_ = isSyncEachBatch;
+   }
+   if (flushInterval.GetOrigValue() > 0)
+      this->Timer_.RunAfter(flushInterval);
+   else
+      this->Timer_.StopNoWait();
+}
+void FixRecorder::EmitOnTimer(TimerEntry* timer, TimeStamp /*now*/) {
+   FixRecorder& rthis = ContainerOf(*static_cast<Timer*>(timer), &FixRecorder::Timer_);
+   TimeInterval flushInterval;
+   {
+      WorkContentLocker lk{rthis.Worker_.Lock()};
+      flushInterval = rthis.FlushInterval_;
+      if (lk->GetQueuingNodeCount() > 0)
+         if (!rthis.MakeCallNow(std::move(lk)))
+            return;
+   }
+   if (flushInterval.GetOrigValue() > 0)
+      timer->RunAfter(flushInterval);
+}
+void FixRecorder::MakeCallForWork(WorkContentLocker&& lk) {
+   // 與 LogFileAppender 相同: {通知寫檔 thread} 很花時間, 所以批次寫檔時, 盡量由 Timer 通知.
+   if (this->FlushInterval_.GetOrigValue() <= 0
+       || lk->GetQueuingNodeCount() > kBatchFlushNodeCount
+       || this->IsHighWaterLevel(lk))
+      base::MakeCallForWork(std::move(lk));
+}
+void FixRecorder::ConsumeAppendBuffer(DcQueueList& buffer) {
+   base::ConsumeAppendBuffer(buffer);
+   bool       isSync;
+   BufferList idxEntries;
+   {
+      auto lk{this->Worker_.Lock()};
+      isSync = this->IsSyncEachBatch_;
+      if (this->SeqIndex_.IsOpened())
+         idxEntries = this->SeqIndex_.MovePending();
+   }
+   if (isSync)
+      this->GetStorage().Sync();
+   // 索引在記錄檔之後寫入: 若在兩者之間結束, 下次開啟時由 FixSeqIndex::Open() 從記錄檔補齊.
+   this->SeqIndex_.WritePending(std::move(idxEntries), isSync);
+}
 void FixRecorder::WriteBuffer(Locker&& lk, RevBufferList&& rbuf) {
    BufferList wbuf = rbuf.MoveOut();
    if (fon9_UNLIKELY((this->IdxInfoSizeInterval_ += CalcDataSize(wbuf.cfront())) > kIdxInfoSizeInterval)) {
@@ -51,9 +162,28 @@ void FixRecorder::WriteBuffer(Locker&& lk, RevBufferList&& rbuf) {
                '\n');
       wbuf.push_back(rbuf.MoveOut());
    }
+   this->SeqIndex_.OnAppend(CalcDataSize(wbuf.cfront()));
    WorkContentController* app = static_cast<WorkContentController*>(&WorkContentController::StaticCast(*lk));
    app->AddWork(std::move(lk), std::move(wbuf));
 }
+void FixRecorder::WriteAfterSend(Locker&& lk, RevBufferList&& lineMessage, FixSeqNum nextSendSeq, bool isSeqReset) {
+   if (this->SeqIndex_.IsOpened()) {
+      const BufferNode* front = lineMessage.cfront();
+      const PosType     pos = this->SeqIndex_.GetNextPos();
+      if (front && front->GetDataSize() > 0 && *front->GetDataBegin() == f9fix_kCSTR_HdrSend[0])
+         this->SeqIndex_.Add(FixSeqIndex::EntryKind::Send, this->NextSendSeq_, pos);
+      if (isSeqReset) {
+         // "RST|S=nextSendSeq\n" 在 lineMessage 的尾端.
+         NumOutBuf nbuf;
+         const size_t rstsz = sizeof(f9fix_kCSTR_HdrRst f9fix_kCSTR_HdrNextSendSeq) - 1
+            + static_cast<size_t>(nbuf.end() - UIntToStrRev(nbuf.end(), nextSendSeq)) + 1;
+         this->SeqIndex_.Add(FixSeqIndex::EntryKind::RstSend, nextSendSeq,
+                             pos + CalcDataSize(front) - rstsz);
+      }
+   }
+   this->NextSendSeq_ = nextSendSeq;
+   this->WriteBuffer(std::move(lk), std::move(lineMessage));
+}
 void FixRecorder::WriteInputSeqReset(const StrView& fixmsg, FixSeqNum newSeqNo, bool isGapFill) {
    RevBufferList rbuf{static_cast<BufferNodeSize>(fixmsg.size() + 64)};
    RevPrint(rbuf,
@@ -62,6 +192,18 @@ void FixRecorder::WriteInputSeqReset(const StrView& fixmsg, FixSeqNum newSeqNo,
             f9fix_kCSTR_HdrNextRecvSeq, newSeqNo, '\n');
    auto lk{this->Worker_.Lock()};
    this->NextRecvSeq_ = newSeqNo;
+   if (this->SeqIndex_.IsOpened()) {
+      // 與 FixSeqIndex 從記錄檔重建索引的規則相同: "R timestamp FIX Message\n" + "IDX|R=n\n" or "RST|R=n\n"
+      const PosType pos = this->SeqIndex_.GetNextPos();
+      FixParser     fixParser;
+      StrView       fixmsgFields{fixmsg};
+      fixParser.ResetExpectHeader(ToStrView(this->BeginHeader_));
+      fixParser.ParseFields(fixmsgFields, FixParser::Until::MsgSeqNum);
+      if (fixParser.GetMsgSeqNum() > 0)
+         this->SeqIndex_.Add(FixSeqIndex::EntryKind::Recv, fixParser.GetMsgSeqNum(), pos);
+      this->SeqIndex_.Add(isGapFill ? FixSeqIndex::EntryKind::NextRecv : FixSeqIndex::EntryKind::RstRecv, newSeqNo,
+                          pos + sizeof(f9fix_kCSTR_HdrRecv) - 1 + kTimeStampWidth + 1 + fixmsg.size() + 1);
+   }
    this->WriteBuffer(std::move(lk), std::move(rbuf));
 }
 void FixRecorder::ForceResetRecvSeq(const StrView& info, FixSeqNum newSeqNo) {
@@ -71,6 +213,9 @@ void FixRecorder::ForceResetRecvSeq(const StrView& info, FixSeqNum newSeqNo) {
             f9fix_kCSTR_HdrRst f9fix_kCSTR_HdrNextRecvSeq, newSeqNo, '\n');
    auto lk{this->Worker_.Lock()};
    this->NextRecvSeq_ = newSeqNo;
+   if (this->SeqIndex_.IsOpened())
+      this->SeqIndex_.Add(FixSeqIndex::EntryKind::RstRecv, newSeqNo,
+                          this->SeqIndex_.GetNextPos() + sizeof(f9fix_kCSTR_HdrInfo) - 1 + kTimeStampWidth + 1 + info.size() + 1);
    this->WriteBuffer(std::move(lk), std::move(rbuf));
 }
 
@@ -4,12 +4,37 @@
 #define __fon9_fix_FixRecorder_hpp__
 #include "fon9/fix/FixParser.hpp"
 #include "fon9/fix/FixCompID.hpp"
+#include "fon9/fix/FixSeqIndex.hpp"
 #include "fon9/buffer/RevBufferList.hpp"
 #include "fon9/FileAppender.hpp"
+#include "fon9/Timer.hpp"
+#include "fon9/ConfigParser.hpp"
 
 namespace fon9 { namespace fix {
 
 fon9_WARN_DISABLE_PADDING;
+/// \ingroup fix
+/// FixRecorder 的寫檔設定, 參考 FixRecorder::SetWritePolicy(), FixRecorder::Initialize();
+/// - cfg = "FixLogFlush=0.001|FixLogSync=Y|FixSeqIndex=Y";
+struct fon9_API FixRecorderArgs {
+   /// 批次寫檔的間隔時間, 0 = 立即通知寫檔(預設).
+   TimeInterval   FlushInterval_;
+   /// 每批資料寫入後, 是否呼叫 File::Sync().
+   bool           IsSyncEachBatch_;
+   /// 是否使用序號索引檔, 參考 FixRecorder::Initialize() 的 isUseSeqIndex;
+   bool           IsUseSeqIndex_;
+
+   void Clear() {
+      this->FlushInterval_ = TimeInterval{};
+      this->IsSyncEachBatch_ = false;
+      this->IsUseSeqIndex_ = false;
+   }
+   /// tag = "FixLogFlush"; value = 間隔時間(例: "0.001" or "1ms");
+   /// tag = "FixLogSync";  value = "Y" or "N";
+   /// tag = "FixSeqIndex"; value = "Y" or "N";
+   ConfigParser::Result OnTagValue(StrView tag, StrView& value);
+};
+
 /// \ingroup fix
 /// FIX Message 記錄器.
 /// - 每個 Session 一個記錄器.
@@ -38,17 +63,55 @@ fon9_WARN_DISABLE_PADDING;
 ///               FIX 有 Sequence Reset 機制, 當發生此情況時, 必定會跟隨一個 RST 訊息.
 ///        其他 = 額外資訊, 參考 f9fix_kCSTR_Hdr*
 ///   \endcode
+/// - 序號索引檔: 記錄檔名 + ".idx", 參考 FixSeqIndex.
+/// - 寫檔: 在 lock 狀態下, 僅將要寫入的資料(及索引)放入佇列, 由背景寫檔 thread 批次寫入,
+///   寫檔策略參考 SetWritePolicy().
 class fon9_API FixRecorder : protected AsyncFileAppender {
    fon9_NON_COPY_NON_MOVE(FixRecorder);
    using base = AsyncFileAppender;
-   FixSeqNum   NextSendSeq_{0};
-   FixSeqNum   NextRecvSeq_{0};
-   size_t      IdxInfoSizeInterval_;
-   
+   FixSeqNum      NextSendSeq_{0};
+   FixSeqNum      NextRecvSeq_{0};
+   size_t         IdxInfoSizeInterval_;
+   /// 同一個 process 之中, 同一個記錄檔只能由一個 FixRecorder 使用.
+   /// - File 的 DenyWrite 使用 fcntl(): 無法阻止同一個 process 重複開啟.
+   /// - 在 Initialize() 取得, 在 SeqIndex_ 解構(索引寫入完畢)之後才釋放(所以必須宣告在 SeqIndex_ 之前);
+   ///   避免舊的 FixRecorder(可能在其他 thread 延遲解構)尚未寫完時, 新的 FixRecorder 讀到不完整的記錄.
+   struct OpenedName {
+      fon9_NON_COPY_NON_MOVE(OpenedName);
+      OpenedName() = default;
+      ~OpenedName() {
+         this->Release();
+      }
+      bool Acquire(const std::string& fileName);
+      void Release();
+   private:
+      std::string FileName_;
+   };
+   OpenedName     OpenedName_;
+   FixSeqIndex    SeqIndex_;
+   TimeInterval   FlushInterval_{};
+   bool           IsSyncEachBatch_{false};
+
+   static void EmitOnTimer(TimerEntry* timer, TimeStamp now);
+   using Timer = DataMemberEmitOnTimer<&FixRecorder::EmitOnTimer>;
+   Timer          Timer_{GetDefaultTimerThread()};
+
    struct FixRevSercher;
    struct LastSeqSearcher;
    struct SentMessageSearcher;
    friend intrusive_ptr<FixRecorder>;
+
+protected:
+   /// 批次寫檔時, 節點數量超過此值, 立即通知寫檔, 不等 FlushInterval.
+   enum : size_t {
+      kBatchFlushNodeCount = 1024,
+   };
+   /// - 若 FlushInterval <= 0: 與 AsyncFileAppender 相同, 立即通知寫檔.
+   /// - 否則: 節點數量 > kBatchFlushNodeCount 才立即通知, 其餘由 Timer 定時通知.
+   virtual void MakeCallForWork(WorkContentLocker&& lk) override;
+   /// 寫入記錄檔之後, 將累積的索引寫入索引檔(FixSeqIndex::WritePending()).
+   virtual void ConsumeAppendBuffer(DcQueueList& buffer) override;
+
 public:
    using Locker = base::WorkContentLocker;
 
@@ -78,11 +141,26 @@ public:
 
    using base::WaitFlushed;
 
+   /// 設定寫檔策略, 預設為: 立即通知寫檔(flushInterval=0), 不呼叫 File::Sync().
+   /// \param flushInterval  > 0 則為批次寫檔:
+   ///   - 寫入要求(例: FixSender::Send())不用每次都通知寫檔 thread, 可降低鎖定時間.
+   ///   - 資料最多延遲 flushInterval 寫入; 若在此期間程式異常結束, 則最後送出的訊息可能沒有記錄,
+   ///     重啟後的 NextSendSeq 可能小於對方已收到的序號.
+   /// \param isSyncEachBatch 每批資料寫入後, 是否呼叫 File::Sync(): 確保資料寫入磁碟(OS crash 也不會遺失).
+   void SetWritePolicy(TimeInterval flushInterval, bool isSyncEachBatch);
+   void SetWritePolicy(const FixRecorderArgs& args) {
+      this->SetWritePolicy(args.FlushInterval_, args.IsSyncEachBatch_);
+   }
+
    /// 初次建立 FixRecorder:
    /// 1. 開啟記錄檔.
    /// 2. 取得 NextRecvSeq_, NextSeqSeq_
-   /// 若重複呼叫(之前已成功過), 則返回 std::errc::text_file_busy;
-   File::Result Initialize(std::string fileName);
+   /// 若重複呼叫(之前已成功過), 或同一個 process 裡面有其他 FixRecorder 正在使用 fileName,
+   /// 則返回 std::errc::text_file_busy;
+   /// \param isUseSeqIndex 是否使用序號索引檔(fileName + ".idx"), 預設不使用:
+   ///   - 使用索引檔取得 NextRecvSeq_, NextSeqSeq_, 及取回已送出的訊息.
+   ///   - 若索引檔開啟失敗, 則仍使用從檔尾往前搜尋的方式.
+   File::Result Initialize(std::string fileName, bool isUseSeqIndex = false);
 
    FixSeqNum GetNextSendSeq(const Locker&) const {
       return this->NextSendSeq_;
@@ -125,10 +203,8 @@ public:
    /// lineMessage 必須為一行完整的訊息: "S " + timestamp + ' ' + FIX Message + '\n';
    /// 請參考 FixSender::Send()
    /// 返回前 lk 可能已被解鎖!
-   void WriteAfterSend(Locker&& lk, RevBufferList&& lineMessage, FixSeqNum nextSendSeq) {
-      this->NextSendSeq_ = nextSendSeq;
-      this->WriteBuffer(std::move(lk), std::move(lineMessage));
-   }
+   /// 若 lineMessage 尾端有 "RST|S=nextSendSeq\n", 則 isSeqReset 必須為 true;
+   void WriteAfterSend(Locker&& lk, RevBufferList&& lineMessage, FixSeqNum nextSendSeq, bool isSeqReset = false);
 
    /// 寫入依正常順序收到的 FIX Message.
    /// 返回前 ++this->NextRecvSeq_;
@@ -136,6 +212,8 @@ public:
       RevBufferList rbuf{static_cast<BufferNodeSize>(fixmsg.size() + 64)};
       RevPrint(rbuf, f9fix_kCSTR_HdrRecv, UtcNow(), ' ', fixmsg, '\n');
       auto  lk{this->Worker_.Lock()};
+      if (this->SeqIndex_.IsOpened())
+         this->SeqIndex_.Add(FixSeqIndex::EntryKind::Recv, this->NextRecvSeq_, this->SeqIndex_.GetNextPos());
       ++this->NextRecvSeq_;
       this->WriteBuffer(std::move(lk), std::move(rbuf));
    }
@@ -145,7 +223,9 @@ public:
    /// 寫入 buf, 前後都不加料.
    /// 返回前 lk 可能已被解鎖!
    void Append(Locker&& lk, BufferList&& buf) {
-      this->IdxInfoSizeInterval_ += CalcDataSize(buf.cfront());
+      const size_t sz = CalcDataSize(buf.cfront());
+      this->IdxInfoSizeInterval_ += sz;
+      this->SeqIndex_.OnAppend(sz);
       WorkContentController* app = static_cast<WorkContentController*>(&WorkContentController::StaticCast(*lk));
       app->AddWork(std::move(lk), std::move(buf));
    }
@@ -160,6 +240,10 @@ public:
       const char* FoundDataEnd_;
       friend struct SentMessageSearcher;
       bool InitStart(FixRecorder& fixRecorder, FixSeqNum seqFrom);
+      /// 使用 fixRecorder.SeqIndex_ 尋找第一筆 MsgSeqNum >= seqFrom 的送出訊息.
+      /// 若成功, 則 this->CurMsg_ = 找到的訊息, 返回該訊息在記錄檔的位置(行首).
+      /// \retval FixSeqIndex::kInvalidPos 索引不可用, 或找不到, 或與記錄檔不符.
+      PosType LoadFromSeqIndex(FixRecorder& fixRecorder, FixSeqNum seqFrom);
 
    public:
       FixParser  FixParser_;
@@ -203,9 +203,43 @@ bool FixRecorder::ReloadSent::InitStart(FixRecorder& fixRecorder, FixSeqNum seqF
    fixRecorder.WaitFlushed();
    return true;
 }
+FixRecorder::PosType FixRecorder::ReloadSent::LoadFromSeqIndex(FixRecorder& fixRecorder, FixSeqNum seqFrom) {
+   FixSeqNum   foundSeq = 0;
+   PosType     pos;
+   {
+      auto lk{fixRecorder.Lock()};
+      if (!fixRecorder.SeqIndex_.IsOpened())
+         return FixSeqIndex::kInvalidPos;
+      pos = fixRecorder.SeqIndex_.FindSendPos(seqFrom, &foundSeq);
+   }
+   if (pos == FixSeqIndex::kInvalidPos)
+      return pos;
+   File::Result res = fixRecorder.GetStorage().Read(pos, this->Buffer_, kReloadSentBufferSize);
+   if (!res || res.GetResult() <= 0)
+      return FixSeqIndex::kInvalidPos;
+   const char* pbeg = this->Buffer_;
+   const char* pend = reinterpret_cast<const char*>(memchr(pbeg, '\n', res.GetResult()));
+   if (pend == nullptr || *pbeg != f9fix_kCSTR_HdrSend[0] || (pbeg = SkipTimestamp(pbeg, pend)) == nullptr)
+      return FixSeqIndex::kInvalidPos;
+   StrView fixmsg{pbeg, pend};
+   this->FixParser_.Clear();
+   this->FixParser_.ParseFields(fixmsg, FixParser::Until::MsgSeqNum);
+   if (this->FixParser_.GetMsgSeqNum() != foundSeq)
+      return FixSeqIndex::kInvalidPos;
+   this->CurBufferPos_ = pos;
+   this->FoundDataEnd_ = this->Buffer_ + res.GetResult();
+   this->CurMsg_ = StrView{pbeg, pend};
+   return pos;
+}
 StrView FixRecorder::ReloadSent::Find(FixRecorder& fixRecorder, FixSeqNum seq) {
    if (!this->InitStart(fixRecorder, seq))
       return StrView{};
+   if (this->LoadFromSeqIndex(fixRecorder, seq) != FixSeqIndex::kInvalidPos) {
+      if (this->FixParser_.GetMsgSeqNum() == seq)
+         return this->CurMsg_;
+      this->CurMsg_.Reset(nullptr);
+      return StrView{};
+   }
    SentMessageSearcher  searcher{*this};
    File::Result         res = searcher.Start(*this, seq, fixRecorder.GetStorage());
    if (fon9_LIKELY(res && !searcher.FoundLine_.empty())) {
@@ -217,6 +251,16 @@ StrView FixRecorder::ReloadSent::Find(FixRecorder& fixRecorder, FixSeqNum seq) {
 StrView FixRecorder::ReloadSent::Start(FixRecorder& fixRecorder, FixSeqNum seqFrom) {
    if (!this->InitStart(fixRecorder, seqFrom))
       return StrView{};
+   const PosType idxPos = this->LoadFromSeqIndex(fixRecorder, seqFrom);
+   if (idxPos != FixSeqIndex::kInvalidPos) {
+      fixRecorder.Write(f9fix_kCSTR_HdrInfo,
+                        "ReloadSent:"
+                        "|seq=", seqFrom,
+                        "|foundAt=", idxPos,
+                        "|foundSeq=", this->FixParser_.GetMsgSeqNum(),
+                        "|bySeqIndex");
+      return this->CurMsg_;
+   }
    SentMessageSearcher  searcher{*this};
    File::Result         res = searcher.Start(*this, seqFrom, fixRecorder.GetStorage());
    if (!res)
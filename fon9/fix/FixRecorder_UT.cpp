@@ -2,7 +2,7 @@
 // \author fonwinz@gmail.com
 #define _CRT_SECURE_NO_WARNINGS
 #include "fon9/TestTools.hpp"
-#include "fon9/fix/FixRecorder.hpp"
+#include "fon9/fix/FixRecorder_Searcher.hpp"
 #include "fon9/fix/FixBuilder.hpp"
 #include "fon9/Timer.hpp"
 #include "fon9/DefaultThreadPool.hpp"
@@ -64,6 +64,113 @@ void CheckReloadSent(f9fix::FixRecorder& fixr, f9fix::FixSeqNum seqFrom, f9fix::
    }
 }
 //--------------------------------------------------------------------------//
+void ReopenFixRecorder(f9fix::FixRecorderSP& fixr, const f9fix::CompIDs& compIds, const char* fixrFileName, bool isUseSeqIndex) {
+   fixr.reset(new f9fix::FixRecorder(f9fix_BEGIN_HEADER_V42, f9fix::CompIDs{compIds}));
+   fon9::File::Result res;
+   int count = 100;
+   while (!(res = fixr->Initialize(fixrFileName, isUseSeqIndex))) {
+      if (--count <= 0) {
+         std::cout << "Reopen FixRecorder|fileName=" << fixrFileName
+            << "|err=" << fon9::RevPrintTo<std::string>(res) << std::endl;
+         abort();
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds{10});
+   }
+}
+void CheckNextSeq(f9fix::FixRecorder& fixr, f9fix::FixSeqNum expectNextRecvSeq, f9fix::FixSeqNum expectNextSendSeq) {
+   if (fixr.GetNextRecvSeq() != expectNextRecvSeq || fixr.GetNextSendSeq(fixr.Lock()) != expectNextSendSeq) {
+      std::cout << "Reopen FixRecorder"
+         << "|err=Unexpected NextSeq|expectNextRecvSeq=" << expectNextRecvSeq
+         << "|nextRecvSeq=" << fixr.GetNextRecvSeq()
+         << "|expectNextSendSeq=" << expectNextSendSeq
+         << "|nextSendSeq=" << fixr.GetNextSendSeq(fixr.Lock())
+         << std::endl;
+      abort();
+   }
+}
+/// 分別使用: 既有索引, 重建的索引, 不使用索引; 重新開啟 fixr, 檢查 NextSeq 及 ReloadSent;
+void CheckReopen(f9fix::FixRecorderSP& fixr, const f9fix::CompIDs& compIds, const char* fixrFileName,
+                 f9fix::FixSeqNum expectNextRecvSeq, f9fix::FixSeqNum expectNextSendSeq,
+                 f9fix::FixSeqNum reloadFrom) {
+   const std::string idxFileName = std::string{fixrFileName} + ".idx";
+   for (int L = 0; L < 3; ++L) {
+      if (L == 1) {
+         fixr.reset();
+         fon9::WaitRemoveFile(idxFileName.c_str());
+      }
+      ReopenFixRecorder(fixr, compIds, fixrFileName, L != 2);
+      CheckNextSeq(*fixr, expectNextRecvSeq, expectNextSendSeq);
+      CheckReloadSent(*fixr, reloadFrom, expectNextSendSeq - reloadFrom);
+   }
+   ReopenFixRecorder(fixr, compIds, fixrFileName, true);
+}
+void TestSeqReset(f9fix::FixRecorderSP& fixr, const f9fix::CompIDs& compIds, const char* fixrFileName) {
+   std::cout << "[TEST ] SeqIndex: SeqReset.";
+   // RST|S=1: 之後送出的 MsgSeqNum 從 1 開始.
+   fon9::RevBufferList rbuf{128};
+   fon9::RevPrint(rbuf, f9fix_kCSTR_HdrRst f9fix_kCSTR_HdrNextSendSeq, 1u, '\n');
+   fixr->WriteAfterSend(fixr->Lock(), std::move(rbuf), 1, true);
+   // RST|R=1: 之後收到的 MsgSeqNum 從 1 開始.
+   fixr->ForceResetRecvSeq("SeqIndex test", 1);
+   const unsigned kTimes = 10;
+   TestFixRecorder(*fixr, kTimes);
+   // 因為 RST, 所以不會找到 RST 之前的 MsgSeqNum = kTimes + 1 的訊息.
+   f9fix::FixRecorder::ReloadSent reloader;
+   if (!reloader.Find(*fixr, kTimes + 1).empty()) {
+      std::cout << "|err=Found before RST." "\r" "[ERROR]" << std::endl;
+      abort();
+   }
+   CheckReopen(fixr, compIds, fixrFileName, kTimes + 1, kTimes + 1, 1);
+   std::cout << "\r" "[OK   ]" << std::endl;
+}
+void BenchmarkSeqIndex(f9fix::FixRecorderSP& fixr, const f9fix::CompIDs& compIds, const char* fixrFileName) {
+   const unsigned kTimes = 1000 * 100;
+   const unsigned kFindTimes = 100;
+   TestFixRecorder(*fixr, kTimes);
+   const f9fix::FixSeqNum nextSendSeq = fixr->GetNextSendSeq(fixr->Lock());
+   const f9fix::FixSeqNum nextRecvSeq = fixr->GetNextRecvSeq();
+   fixr->WaitFlushed();
+   std::cout << "SeqIndex benchmark:|messages=" << nextSendSeq - 1 << std::endl;
+
+   fon9::StopWatch stopWatch;
+   for (int L = 0; L < 2; ++L) {
+      const bool  isUseSeqIndex = (L == 0);
+      const char* testName = isUseSeqIndex ? "|SeqIndex=Y" : "|SeqIndex=N";
+      fixr.reset();
+      stopWatch.ResetTimer();
+      ReopenFixRecorder(fixr, compIds, fixrFileName, isUseSeqIndex);
+      stopWatch.PrintResult((std::string{"Initialize"} + testName).c_str(), 1);
+      CheckNextSeq(*fixr, nextRecvSeq, nextSendSeq);
+
+      f9fix::FixRecorder::ReloadSent reloader;
+      stopWatch.ResetTimer();
+      for (unsigned i = 0; i < kFindTimes; ++i) {
+         const f9fix::FixSeqNum seq = static_cast<f9fix::FixSeqNum>(1 + (i * 7919u) % (nextSendSeq - 1));
+         CheckFixMessage(reloader.Find(*fixr, seq), seq);
+      }
+      stopWatch.PrintResult((std::string{"ReloadSent.Find"} + testName).c_str(), kFindTimes);
+   }
+}
+//--------------------------------------------------------------------------//
+
+void TestFixRecorderArgs() {
+   std::cout << "[TEST ] FixRecorderArgs.";
+   f9fix::FixRecorderArgs args;
+   args.Clear();
+   fon9::RevBufferList    rbuf{128};
+   if (!fon9::ParseConfig(args, "FixLogFlush=0.001|FixLogSync=Y|FixSeqIndex=Y", rbuf)
+       || args.FlushInterval_ != fon9::TimeInterval_Millisecond(1)
+       || !args.IsSyncEachBatch_
+       || !args.IsUseSeqIndex_) {
+      std::cout << "|err=Parse good config." "\r" "[ERROR]" << std::endl;
+      abort();
+   }
+   if (fon9::ParseConfig(args, "FixLogFlush=abc", rbuf)) {
+      std::cout << "|err=Parse bad config." "\r" "[ERROR]" << std::endl;
+      abort();
+   }
+   std::cout << "\r" "[OK   ]" << std::endl;
+}
 
 int main(int argc, char** argv) {
 #if defined(_MSC_VER) && defined(_DEBUG)
@@ -74,12 +181,14 @@ int main(int argc, char** argv) {
    fon9::GetDefaultTimerThread();
    fon9::GetDefaultThreadPool();
    std::this_thread::sleep_for(std::chrono::milliseconds{10});
+   TestFixRecorderArgs();
 
    f9fix::CompIDs       compIds{"SenderCoId", "SenderSubId", "TargetCoId", "TargetSubId"};
    f9fix::FixRecorderSP fixr{new f9fix::FixRecorder(f9fix_BEGIN_HEADER_V42, f9fix::CompIDs{compIds})};
    const char           fixrFileName[] = "FixRecorder_UT.log";
    remove(fixrFileName);
-   auto res = fixr->Initialize(fixrFileName);
+   remove((std::string{fixrFileName} + ".idx").c_str());
+   auto res = fixr->Initialize(fixrFileName, true);
    if (!res) {
       std::cout << "Open FixRecorder|fileName=" << fixrFileName
          << "|err=" << fon9::RevPrintTo<std::string>(res) << std::endl;
@@ -112,28 +221,17 @@ int main(int argc, char** argv) {
    BuildTestMessage(fixb, ToStrView(fixr->CompIDs_.Header_), kTimes + 1, fixr->GetNextRecvSeq());
    fixr->WriteInputConform(fon9::ToStrView(fon9::BufferTo<std::string>(fixb.Final(ToStrView(fixr->BeginHeader_)))));
    fixr->WaitFlushed();
-   fixr.reset(new f9fix::FixRecorder(f9fix_BEGIN_HEADER_V42, f9fix::CompIDs{compIds}));
-   int count = 100;
-   do {
-      if (--count <= 0) {
-         std::cout << "Reopen FixRecorder|fileName=" << fixrFileName
-            << "|err=" << fon9::RevPrintTo<std::string>(res) << std::endl;
-         abort();
-      }
-      std::this_thread::sleep_for(std::chrono::milliseconds{10});
-   } while (!fixr->Initialize(fixrFileName));
-   if (fixr->GetNextRecvSeq() != kTimes + 2 || fixr->GetNextSendSeq(fixr->Lock()) != kTimes + 1) {
-      std::cout << "Reopen FixRecorder|fileName=" << fixrFileName
-         << "|err=Unexpected NextSeq|expectNextRecvSeq=" << kTimes + 2
-         << "|nextRecvSeq=" << fixr->GetNextRecvSeq()
-         << "|expectNextSendSeq=" << kTimes + 1
-         << "|nextSendSeq=" << fixr->GetNextSendSeq(fixr->Lock())
-         << std::endl;
-      abort();
-   }
+   std::cout << "[TEST ] Reopen: SeqIndex, rebuild SeqIndex, without SeqIndex.";
+   CheckReopen(fixr, compIds, fixrFileName, kTimes + 2, kTimes + 1, 1);
+   std::cout << "\r" "[OK   ]" << std::endl;
+
+   TestSeqReset(fixr, compIds, fixrFileName);
+   BenchmarkSeqIndex(fixr, compIds, fixrFileName);
 
    // 結束前刪除測試檔.
    fixr.reset();
-   if (!fon9::IsKeepTestFiles(argc, argv))
+   if (!fon9::IsKeepTestFiles(argc, argv)) {
       fon9::WaitRemoveFile(fixrFileName);
+      fon9::WaitRemoveFile((std::string{fixrFileName} + ".idx").c_str());
+   }
 }
@@ -5,22 +5,52 @@
 #include "fon9/fix/FixAdminDef.hpp"
 #include "fon9/fix/FixConfig.hpp"
 #include "fon9/FwdPrint.hpp"
+#include <thread>
 
 namespace fon9 { namespace fix {
 
 FixSender::~FixSender() {
 }
+void FixSender::PutCompIDs(FixBuilder& fixmsgBuilder) const {
+   RevPrint(fixmsgBuilder.GetBuffer(), this->CompIDs_.Header_);
+}
+FixSeqNum FixSender::ReserveSendSeq(const Locker& locker) {
+   if (this->ReservedCount_++ == 0)
+      this->ReservedSendSeq_ = this->GetNextSendSeq(locker);
+   return this->ReservedSendSeq_++;
+}
+void FixSender::WaitReserved(Locker& locker) {
+   // 預約者建立訊息時不會鎖定, 也不會等候其他事件, 所以很快就會送出.
+   while (fon9_UNLIKELY(this->ReservedCount_ > 0)) {
+      locker.unlock();
+      std::this_thread::yield();
+      locker.lock();
+   }
+}
+void FixSender::Send(const StrView& fldMsgType, FixBuilder&& fixmsgBuilder, RevBufferList* fixmsgDupOut) {
+   this->PutCompIDs(fixmsgBuilder);
+   ReadyMsg msg{this->ReserveSendSeq(this->Lock())};
+   this->BuildMessage(msg, fldMsgType, std::move(fixmsgBuilder), fixmsgDupOut);
+   this->CommitMessage(this->Lock(), std::move(msg));
+}
 void FixSender::Send(Locker&&       locker,
                      StrView        fldMsgType,
                      FixBuilder&&   fixmsgBuilder,
                      FixSeqNum      nextSeqNum,
                      RevBufferList* fixmsgDupOut) {
-   // CompIDs
+   // SequenceReset 必須在其他預約都送出之後, 且在同一次鎖定期間內送出, 避免之後的預約使用到舊序號.
+   if (nextSeqNum != 0)
+      this->WaitReserved(locker);
+   ReadyMsg msg{this->ReserveSendSeq(locker)};
+   msg.NewSeqNo_ = nextSeqNum;
+   this->BuildMessage(msg, fldMsgType, std::move(fixmsgBuilder), fixmsgDupOut);
+   this->CommitMessage(std::move(locker), std::move(msg));
+}
+void FixSender::BuildMessage(ReadyMsg& msg, StrView fldMsgType, FixBuilder&& fixmsgBuilder, RevBufferList* fixmsgDupOut) const {
    RevBuffer& msgRBuf = fixmsgBuilder.GetBuffer();
-   RevPrint(msgRBuf, this->CompIDs_.Header_);
    // SendingTime.
    fixmsgBuilder.PutUtcNow();
-   TimeStamp now = this->LastSentTime_ = fixmsgBuilder.GetUtcNow();
+   msg.SendTime_ = fixmsgBuilder.GetUtcNow();
    RevPrint(msgRBuf, f9fix_SPLTAGEQ(SendingTime));
 
    // MsgType: ** ALWAYS THIRD FIELD IN MESSAGE. (Always unencrypted) **
@@ -28,32 +58,57 @@ void FixSender::Send(Locker&&       locker,
    // BeginString|9=BodyLength|35=MsgType|34=MsgSeqNum|52=SendingTime
    //               \________/                            \_ replay時插入額外欄位.
    //
-   FixSeqNum msgSeqNum = this->GetNextSendSeq(locker);
-   RevPrint(msgRBuf, fldMsgType, f9fix_SPLTAGEQ(MsgSeqNum), msgSeqNum);
+   RevPrint(msgRBuf, fldMsgType, f9fix_SPLTAGEQ(MsgSeqNum), msg.MsgSeqNum_);
 
    // 產出 FIX Message.
-   BufferList  fixmsg{fixmsgBuilder.Final(ToStrView(this->BeginHeader_))};
-   const auto  fixmsgSize = CalcDataSize(fixmsg.cfront());
+   msg.FixMsg_ = fixmsgBuilder.Final(ToStrView(this->BeginHeader_));
+   const auto fixmsgSize = msg.FixMsgSize_ = CalcDataSize(msg.FixMsg_.cfront());
    // 建立要寫入 FixRecorder 的訊息.
-   RevBufferList rlog{static_cast<BufferNodeSize>(64 + fixmsgSize)};
-   if (fon9_LIKELY(nextSeqNum == 0))
-      nextSeqNum = msgSeqNum + 1;
-   else
-      RevPrint(rlog, f9fix_kCSTR_HdrRst f9fix_kCSTR_HdrNextSendSeq, nextSeqNum, '\n');
+   RevBufferList& rlog = msg.LogMsg_;
+   rlog = RevBufferList{static_cast<BufferNodeSize>(64 + fixmsgSize)};
+   if (fon9_UNLIKELY(msg.NewSeqNo_ != 0))
+      RevPrint(rlog, f9fix_kCSTR_HdrRst f9fix_kCSTR_HdrNextSendSeq, msg.NewSeqNo_, '\n');
    char* pFixMsgLog = rlog.AllocPrefix(fixmsgSize + 2);
    *--pFixMsgLog = '\n';
-   CopyNodeList(pFixMsgLog -= fixmsgSize, fixmsg.cfront());
+   CopyNodeList(pFixMsgLog -= fixmsgSize, msg.FixMsg_.cfront());
    *(pFixMsgLog - 1) = ' ';
    rlog.SetPrefixUsed(pFixMsgLog - 1);
-   RevPrint(rlog, f9fix_kCSTR_HdrSend, now);
-   // 送出訊息.
-   if (fon9_LIKELY(!this->IsReplayingAll_))
-      this->OnSendFixMessage(locker, std::move(fixmsg));
-   else
-      DcQueueList{std::move(fixmsg)}.PopConsumed(fixmsgSize);
+   RevPrint(rlog, f9fix_kCSTR_HdrSend, msg.SendTime_);
    if (fixmsgDupOut)
       RevPutMem(*fixmsgDupOut, pFixMsgLog, fixmsgSize + 1); // 尾端加上 '\n';
-   this->WriteAfterSend(std::move(locker), std::move(rlog), nextSeqNum);
+}
+void FixSender::CommitMessage(Locker&& locker, ReadyMsg&& msg) {
+   assert(this->ReservedCount_ > 0);
+   if (fon9_UNLIKELY(msg.MsgSeqNum_ != this->GetNextSendSeq(locker))) {
+      // 前方還有其他 thread 預約的序號尚未送出, 由該 thread 依序代為送出.
+      this->ReadyMsgs_.emplace(msg.MsgSeqNum_, std::move(msg));
+      return;
+   }
+   for (;;) {
+      --this->ReservedCount_;
+      this->LastSentTime_ = msg.SendTime_;
+      const bool      isSeqReset = (msg.NewSeqNo_ != 0);
+      const FixSeqNum nextSeqNum = (fon9_LIKELY(!isSeqReset) ? msg.MsgSeqNum_ + 1 : msg.NewSeqNo_);
+      // 送出訊息.
+      if (fon9_LIKELY(!this->IsReplayingAll_))
+         this->OnSendFixMessage(locker, std::move(msg.FixMsg_));
+      else
+         DcQueueList{std::move(msg.FixMsg_)}.PopConsumed(msg.FixMsgSize_);
+      // 必須在 WriteAfterSend() 解鎖之前取出: 已在等候的下一個序號.
+      // 解鎖之後才完成的, 因 NextSendSeq 已更新, 會由完成者自行送出.
+      RevBufferList rlog{std::move(msg.LogMsg_)};
+      auto       inext = this->ReadyMsgs_.begin();
+      const bool hasNext = (inext != this->ReadyMsgs_.end() && inext->first == nextSeqNum);
+      if (hasNext) {
+         msg = std::move(inext->second);
+         this->ReadyMsgs_.erase(inext);
+      }
+      this->WriteAfterSend(std::move(locker), std::move(rlog), nextSeqNum, isSeqReset);
+      if (fon9_LIKELY(!hasNext))
+         return;
+      if (!locker.owns_lock())
+         locker.lock();
+   }
 }
 
 void FixSender::ResetNextSendSeq(FixSeqNum nextSeqNum) {
@@ -61,11 +116,14 @@ void FixSender::ResetNextSendSeq(FixSeqNum nextSeqNum) {
       return;
    RevBufferList rlog{128};
    RevPrint(rlog, f9fix_kCSTR_HdrRst f9fix_kCSTR_HdrNextSendSeq, nextSeqNum, '\n');
-   this->WriteAfterSend(this->Lock(), std::move(rlog), nextSeqNum);
+   Locker locker{this->Lock()};
+   this->WaitReserved(locker);
+   this->WriteAfterSend(std::move(locker), std::move(rlog), nextSeqNum, true);
 }
 void FixSender::SequenceReset(FixSeqNum newSeqNo) {
    FixBuilder msgSequenceReset;
    RevPrint(msgSequenceReset.GetBuffer(), f9fix_SPLTAGEQ(NewSeqNo), newSeqNo);
+   this->PutCompIDs(msgSequenceReset);
    this->Send(this->Lock(), f9fix_SPLFLDMSGTYPE(SequenceReset), std::move(msgSequenceReset), newSeqNo, nullptr);
 }
 
@@ -4,6 +4,7 @@
 #define __fon9_fix_FixSender_hpp__
 #include "fon9/fix/FixRecorder.hpp"
 #include "fon9/fix/FixBuilder.hpp"
+#include <map>
 
 namespace fon9 { namespace fix {
 
@@ -13,6 +14,9 @@ fon9_WARN_DISABLE_PADDING;
 /// - 由 User 填妥 AP 層訊息後, 由 FixSender 完成完整 FIX Message:
 ///   - 填妥 BeginHeader, BodyLength, CompIDs, MsgType, CheckSum.
 /// - 提供 Replay() 重送功能, 重送期間可暫停傳送即時訊息, 直到 replay 結束.
+/// - Send() 僅在鎖定狀態下預約 MsgSeqNum, 然後在解鎖狀態下建立 FIX Message 及 "S time msg" 記錄,
+///   最後再鎖定, 依序號順序送出及寫入記錄.
+///   若完成時前方還有尚未完成的序號, 則暫存在 ReadyMsgs_, 由前一序號的送出者依序代為送出.
 class fon9_API FixSender : protected FixRecorder {
    fon9_NON_COPY_NON_MOVE(FixSender);
    using base = FixRecorder;
@@ -26,6 +30,43 @@ class fon9_API FixSender : protected FixRecorder {
    bool       IsReplayingAll_{false};
    TimeStamp  LastSentTime_;
    struct Replayer;
+
+   /// 已預約序號的訊息, 在解鎖狀態下建立, 等候依序送出.
+   struct ReadyMsg {
+      FixSeqNum      MsgSeqNum_;
+      /// != 0: 此筆為 SequenceReset, 送出後的下一個序號.
+      FixSeqNum      NewSeqNo_{0};
+      TimeStamp      SendTime_;
+      size_t         FixMsgSize_{0};
+      BufferList     FixMsg_;
+      /// 要寫入 FixRecorder 的記錄: "S time FIX Message\n"
+      RevBufferList  LogMsg_{0};
+
+      explicit ReadyMsg(FixSeqNum msgSeqNum) : MsgSeqNum_{msgSeqNum} {
+      }
+      ReadyMsg(ReadyMsg&&) = default;
+      ReadyMsg& operator=(ReadyMsg&&) = default;
+   };
+   /// 已預約, 但尚未送出(包含在 ReadyMsgs_ 等候的)的數量.
+   unsigned               ReservedCount_{0};
+   /// 下一個可預約的序號, 僅在 ReservedCount_ > 0 時有效.
+   FixSeqNum              ReservedSendSeq_{0};
+   /// 已建立好, 但前方還有尚未送出的序號; key = MsgSeqNum.
+   std::map<FixSeqNum, ReadyMsg> ReadyMsgs_;
+
+   FixSeqNum ReserveSendSeq(const Locker& locker);
+   /// 建立 FIX Message 及記錄, 不需要 lock.
+   void BuildMessage(ReadyMsg& msg, StrView fldMsgType, FixBuilder&& fixmsgBuilder, RevBufferList* fixmsgDupOut) const;
+   /// 依序號順序送出 msg(及在 ReadyMsgs_ 等候的後續序號), 並寫入 FixRecorder.
+   /// 返回前 locker 可能已被解鎖!
+   void CommitMessage(Locker&& locker, ReadyMsg&& msg);
+   /// 等候其他 thread 預約的序號全部送出, 用在會改變序號的操作之前(SequenceReset, ResetNextSendSeq).
+   void WaitReserved(Locker& locker);
+
+   /// 在 fixmsgBuilder 前端加上 CompIDs, 不需要 lock, 所以在 Send() 鎖定之前呼叫.
+   void PutCompIDs(FixBuilder& fixmsgBuilder) const;
+   /// 呼叫前必須先 PutCompIDs(fixmsgBuilder);
+   /// 由呼叫端鎖定: 在鎖定狀態下建立 FIX Message.
    void Send(Locker&&       locker,
              StrView        fldMsgType,
              FixBuilder&&   fixmsgBuilder,
@@ -68,15 +109,17 @@ public:
    ///   - MsgSeqNum
    ///   - SendingTime
    /// \param fixmsgDupOut 如果 != nullptr, 則複製一份送出的 FIX Message 且尾端加上 '\n'.
+   /// - 僅在預約序號及送出時鎖定, FIX Message 及記錄在解鎖狀態下建立.
+   /// - 返回時, 若前方還有其他 thread 尚未送出的序號, 則此筆訊息會由該 thread 代為送出.
    void Send(const StrView& fldMsgType,
              FixBuilder&&   fixmsgBuilder,
-             RevBufferList* fixmsgDupOut = nullptr) {
-      this->Send(this->Lock(), fldMsgType, std::move(fixmsgBuilder), 0, fixmsgDupOut);
-   }
+             RevBufferList* fixmsgDupOut = nullptr);
+   /// 由呼叫端鎖定, 在鎖定狀態下建立 FIX Message, 然後依序號順序送出.
    void Send(Locker&&       locker,
              const StrView& fldMsgType,
              FixBuilder&&   fixmsgBuilder,
              RevBufferList* fixmsgDupOut = nullptr) {
+      this->PutCompIDs(fixmsgBuilder);
       this->Send(std::move(locker), fldMsgType, std::move(fixmsgBuilder), 0, fixmsgDupOut);
    }
 
@@ -8,6 +8,7 @@
 #include "fon9/fix/FixFeeder.hpp"
 #include "fon9/Timer.hpp"
 #include "fon9/DefaultThreadPool.hpp"
+#include <thread>
 
 namespace f9fix = fon9::fix;
 #define f9fix_kMSGTYPE_NewOrderSingle  "D"
@@ -64,7 +65,10 @@ int main(int argc, char** argv) {
       f9fix::FixFeeder* FixFeeder_{nullptr};
       f9fix::FixParser  FixParser_;
       f9fix::FixSeqNum  ExpectedSendSeqNum_{0};
+      bool              IsBenchmark_{false};
       void OnSendFixMessage(const Locker&, fon9::BufferList buf) override {
+         if (this->IsBenchmark_)
+            return;
          if (this->FixFeeder_) {
             fon9::DcQueueList dcq{std::move(buf)};
             auto res = this->FixFeeder_->FeedBuffer(dcq);
@@ -110,6 +114,24 @@ int main(int argc, char** argv) {
    TestFixSenderWrite2(*fixSender, 100, f9fix_SPLFLDMSGTYPE(ExecutionReport), f9fix_SPLTAGEQ(Text) "ExecutionReport2");
    std::cout << "\r[OK   ]\n";
 
+   // 多個 thread 同時 Send(): 序號在解鎖狀態下建立訊息, OnSendFixMessage() 仍必須依序號順序;
+   // 之後的 Replay 測試, 會檢查 FixRecorder 記錄的順序.
+   std::cout << "[TEST ] Send() from multiple threads.";
+   {
+      std::vector<std::thread> thrs;
+      for (unsigned L = 0; L < 4; ++L) {
+         thrs.emplace_back([&fixSender, L]() {
+            if (L % 2)
+               TestFixSenderWrite1(*fixSender, 1000, f9fix_SPLFLDMSGTYPE(ExecutionReport), f9fix_SPLTAGEQ(Text) "ExecutionReportMT");
+            else
+               TestFixSenderWrite2(*fixSender, 1000, f9fix_SPLFLDMSGTYPE(NewOrderSingle), f9fix_SPLTAGEQ(Text) "NewOrderSingleMT");
+         });
+      }
+      for (std::thread& thr : thrs)
+         thr.join();
+   }
+   std::cout << "\r[OK   ]\n";
+
    struct FixFeeder : public f9fix::FixFeeder {
       fon9_NON_COPY_NON_MOVE(FixFeeder);
       FixFeeder() = default;
@@ -189,6 +211,71 @@ int main(int argc, char** argv) {
    fixFeeder.CheckReplayDone(nextSendSeq);
    std::cout << "|count(Include SeqReset)=" << fixFeeder.Count_ << "\r[OK   ]\n";
 
+   // Send() 期間 FixRecorder 為鎖定狀態, 比較不同寫檔策略的 Send() 時間:
+   // - 連續送出: 寫檔 thread 通常在工作中, 不用每次通知.
+   // - 間隔送出(冷系統): 每筆送出前, 寫檔 thread 都已休息, 立即寫檔策略: 每次 Send() 都需要通知寫檔 thread.
+   utinfo.PrintSplitter();
+   FixSender* fixSenderImpl = static_cast<FixSender*>(fixSender.get());
+   fixSenderImpl->IsBenchmark_ = true;
+   const unsigned   kTimes = 1000 * 100;
+   fon9::StopWatch  stopWatch;
+   auto benchSend = [&](const char* policyName) {
+      stopWatch.ResetTimer();
+      for (unsigned L = 0; L < kTimes; ++L) {
+         f9fix::FixBuilder fixb;
+         fon9::RevPrint(fixb.GetBuffer(), f9fix_SPLTAGEQ(Text) "NewOrderSingle");
+         fixSender->Send(f9fix_SPLFLDMSGTYPE(NewOrderSingle), std::move(fixb));
+      }
+      std::cout << policyName << '|';
+      stopWatch.PrintResult("Send NewOrderSingle", kTimes);
+      fixSenderImpl->GetFixRecorder().WaitFlushed();
+
+      const unsigned kSparseTimes = 1000;
+      double         spanSend = 0;
+      for (unsigned L = 0; L < kSparseTimes; ++L) {
+         std::this_thread::sleep_for(std::chrono::microseconds(100));
+         f9fix::FixBuilder fixb;
+         fon9::RevPrint(fixb.GetBuffer(), f9fix_SPLTAGEQ(Text) "NewOrderSingle");
+         stopWatch.ResetTimer();
+         fixSender->Send(f9fix_SPLFLDMSGTYPE(NewOrderSingle), std::move(fixb));
+         spanSend += stopWatch.StopTimer();
+      }
+      std::cout << policyName << '|';
+      stopWatch.PrintResult(spanSend, "Send NewOrderSingle|sparse", kSparseTimes);
+      fixSenderImpl->GetFixRecorder().WaitFlushed();
+   };
+   // 多個 thread 同時送出: 比較「由呼叫端鎖定, 在鎖定狀態下建立訊息」與「僅預約序號時鎖定」.
+   auto benchSendMT = [&](const char* policyName, bool isBuildLocked) {
+      const unsigned kThreadCount = 4;
+      std::vector<std::thread> thrs;
+      stopWatch.ResetTimer();
+      for (unsigned T = 0; T < kThreadCount; ++T) {
+         thrs.emplace_back([&fixSender, isBuildLocked, kTimes]() {
+            for (unsigned L = 0; L < kTimes / kThreadCount; ++L) {
+               f9fix::FixBuilder fixb;
+               fon9::RevPrint(fixb.GetBuffer(), f9fix_SPLTAGEQ(Text) "NewOrderSingle");
+               if (isBuildLocked)
+                  fixSender->Send(fixSender->Lock(), f9fix_SPLFLDMSGTYPE(NewOrderSingle), std::move(fixb));
+               else
+                  fixSender->Send(f9fix_SPLFLDMSGTYPE(NewOrderSingle), std::move(fixb));
+            }
+         });
+      }
+      for (std::thread& thr : thrs)
+         thr.join();
+      std::cout << policyName << '|';
+      stopWatch.PrintResult(isBuildLocked ? "Send|4 threads|build locked" : "Send|4 threads|reserve seq", kTimes);
+      fixSenderImpl->GetFixRecorder().WaitFlushed();
+   };
+   benchSendMT("Immediate", true);
+   benchSendMT("Immediate", false);
+   benchSend("Immediate");
+   fixSenderImpl->GetFixRecorder().SetWritePolicy(fon9::TimeInterval_Millisecond(1), false);
+   benchSend("Batch(1ms)");
+   fixSenderImpl->GetFixRecorder().SetWritePolicy(fon9::TimeInterval_Millisecond(1), true);
+   benchSend("Batch(1ms)+Sync");
+   fixSenderImpl->GetFixRecorder().SetWritePolicy(fon9::TimeInterval{}, false);
+
    // 結束前刪除測試檔.
    fixSender.reset();
    if (!fon9::IsKeepTestFiles(argc, argv))
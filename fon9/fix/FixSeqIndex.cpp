@@ -0,0 +1,376 @@
+﻿// \file fon9/fix/FixSeqIndex.cpp
+// \author fonwinz@gmail.com
+#include "fon9/fix/FixSeqIndex.hpp"
+#include "fon9/fix/FixRecorder_Searcher.hpp"
+#include "fon9/buffer/DcQueueList.hpp"
+#include "fon9/Endian.hpp"
+
+namespace fon9 { namespace fix {
+
+//--------------------------------------------------------------------------//
+FixSeqIndex::~FixSeqIndex() {
+   this->Close();
+}
+void FixSeqIndex::Close() {
+   if (this->IdxFile_.IsOpened()) {
+      // 寫入剩餘的索引, 避免關閉後立即重新開啟(例: FixRecorder 重啟)時, 讀到不完整的索引.
+      this->WritePending(this->MovePending(), false);
+      this->IdxFile_.Close();
+   }
+   else
+      this->PendingEntries_ = BufferList{};
+   this->Send_.Clear();
+   this->Recv_.Clear();
+   this->NextPos_ = 0;
+   this->EntryCount_ = 0;
+}
+static bool IsValidEntryKind(FixSeqIndex::EntryKind kind) {
+   switch (kind) {
+   case FixSeqIndex::EntryKind::Send:
+   case FixSeqIndex::EntryKind::Recv:
+   case FixSeqIndex::EntryKind::RstSend:
+   case FixSeqIndex::EntryKind::RstRecv:
+   case FixSeqIndex::EntryKind::NextRecv:
+      return true;
+   }
+   return false;
+}
+struct IdxEntry {
+   FixSeqIndex::PosType    Pos_;
+   FixSeqNum               Seq_;
+   FixSeqIndex::EntryKind  Kind_;
+   void Parse(const byte* pentry) {
+      this->Pos_ = GetBigEndian<FixSeqIndex::PosType>(pentry);
+      this->Seq_ = GetBigEndian<FixSeqNum>(pentry + 8);
+      this->Kind_ = static_cast<FixSeqIndex::EntryKind>(pentry[12]);
+   }
+};
+/// 每次從索引檔讀取的索引數量.
+static constexpr uint64_t kReadEntryCount = 256;
+
+/// 從索引檔的第 idxEnd 筆往前讀取, 每筆呼叫 fn(idx, entry), 直到 fn 傳回 false, 或已讀到第 0 筆.
+/// \retval false 讀檔失敗.
+template <class Fn>
+static bool ScanEntriesBackward(File& fd, uint64_t idxEnd, Fn&& fn) {
+   byte buf[kReadEntryCount * FixSeqIndex::kEntrySize];
+   while (idxEnd > 0) {
+      const uint64_t idxFrom = (idxEnd > kReadEntryCount ? idxEnd - kReadEntryCount : 0);
+      const size_t   rdsz = static_cast<size_t>((idxEnd - idxFrom) * FixSeqIndex::kEntrySize);
+      File::Result   res = fd.Read(idxFrom * FixSeqIndex::kEntrySize, buf, rdsz);
+      if (!res || res.GetResult() != rdsz)
+         return false;
+      IdxEntry entry;
+      while (idxEnd > idxFrom) {
+         --idxEnd;
+         entry.Parse(buf + (idxEnd - idxFrom) * FixSeqIndex::kEntrySize);
+         if (!fn(idxEnd, entry))
+            return true;
+      }
+   }
+   return true;
+}
+/// 從索引檔的第 idx 筆開始往後, 尋找第一筆 kind 的索引.
+/// \retval idxEnd 找不到, 或讀檔失敗.
+static uint64_t FindEntryForward(File& fd, uint64_t idx, uint64_t idxEnd, FixSeqIndex::EntryKind kind, IdxEntry& entry) {
+   byte buf[kReadEntryCount * FixSeqIndex::kEntrySize];
+   while (idx < idxEnd) {
+      const uint64_t count = std::min(idxEnd - idx, kReadEntryCount);
+      const size_t   rdsz = static_cast<size_t>(count * FixSeqIndex::kEntrySize);
+      File::Result   res = fd.Read(idx * FixSeqIndex::kEntrySize, buf, rdsz);
+      if (!res || res.GetResult() != rdsz)
+         return idxEnd;
+      for (uint64_t L = 0; L < count; ++L, ++idx) {
+         entry.Parse(buf + L * FixSeqIndex::kEntrySize);
+         if (entry.Kind_ == kind)
+            return idx;
+      }
+   }
+   return idxEnd;
+}
+static bool ParseLogLine(const char* pbeg, const char* pend, FixParser& fixParser,
+                         FixSeqIndex::EntryKind& kind, FixSeqNum& seq);
+/// 檢查記錄檔在 pos 位置的那行, 是否與索引相符: 種類及序號都必須相同.
+static bool IsLogLineMatch(File& fixlog, File::SizeType logSize, FixParser& fixParser,
+                           FixSeqIndex::PosType pos, FixSeqIndex::EntryKind kind, FixSeqNum seq) {
+   // 只需要解析到 MsgSeqNum, 所以不用讀取完整的 FIX Message.
+   char   buf[FixRecorder::kTimeStampWidth + 1024];
+   size_t rdsz = sizeof(buf);
+   if (rdsz > logSize - pos)
+      rdsz = static_cast<size_t>(logSize - pos);
+   auto res = fixlog.Read(pos, buf, rdsz);
+   if (!res || res.GetResult() <= 0)
+      return false;
+   const char* pend = static_cast<const char*>(memchr(buf, '\n', res.GetResult()));
+   if (pend == nullptr)
+      pend = buf + res.GetResult();
+   FixSeqIndex::EntryKind lnKind;
+   FixSeqNum              lnSeq;
+   return ParseLogLine(buf, pend, fixParser, lnKind, lnSeq)
+      && lnKind == kind && lnSeq == seq;
+}
+File::Result FixSeqIndex::Open(std::string fname, File& fixlog, FixParser& fixParser) {
+   this->Close();
+   File::Result res = fixlog.GetFileSize();
+   if (!res)
+      return res;
+   const File::SizeType logSize = res.GetResult();
+   File fd;
+   res = fd.Open(fname, FileMode::CreatePath | FileMode::OpenAlways | FileMode::Read | FileMode::Write);
+   if (!res)
+      return res;
+   if (!(res = fd.GetFileSize()))
+      return res;
+   const File::SizeType idxSize = res.GetResult();
+   // 從尾端往前: 排除位置超過記錄檔的索引(例: 記錄檔尾端沒寫入), 及損毀的索引.
+   uint64_t validCount = 0;
+   IdxEntry last{};
+   if (!ScanEntriesBackward(fd, idxSize / kEntrySize, [&validCount, &last, logSize](uint64_t idx, const IdxEntry& entry) -> bool {
+      if (!IsValidEntryKind(entry.Kind_) || entry.Pos_ >= logSize)
+         return true;
+      validCount = idx + 1;
+      last = entry;
+      return false;
+   }))
+      return File::Result{std::errc::io_error};
+   // 最後一筆索引與記錄檔不符(例: 記錄檔被更換), 則重建索引.
+   if (validCount > 0 && !IsLogLineMatch(fixlog, logSize, fixParser, last.Pos_, last.Kind_, last.Seq_))
+      validCount = 0;
+   const File::SizeType validSize = validCount * kEntrySize;
+   if (validSize != idxSize && !(res = fd.SetFileSize(validSize)))
+      return res;
+   // 從尾端往前, 直到取得 NextSendSeq, NextRecvSeq;
+   // 途中若遇到 RST, 則順便記錄 SegBegin_, 否則等到 Find() 時才尋找.
+   bool isSendFound = false, isRecvFound = false;
+   const bool isScanOK = ScanEntriesBackward(fd, validCount, [this, &isSendFound, &isRecvFound](uint64_t idx, const IdxEntry& entry) -> bool {
+      switch (entry.Kind_) {
+      case EntryKind::RstSend:
+         if (this->Send_.SegBegin_ == kUnknownIndex)
+            this->Send_.SegBegin_ = idx + 1;
+         /* fall through */
+      case EntryKind::Send:
+         if (!isSendFound) {
+            isSendFound = true;
+            this->Send_.NextSeq_ = entry.Seq_ + (entry.Kind_ == EntryKind::Send);
+         }
+         break;
+      case EntryKind::RstRecv:
+         if (this->Recv_.SegBegin_ == kUnknownIndex)
+            this->Recv_.SegBegin_ = idx + 1;
+         /* fall through */
+      case EntryKind::Recv:
+      case EntryKind::NextRecv:
+         if (!isRecvFound) {
+            isRecvFound = true;
+            this->Recv_.NextSeq_ = entry.Seq_ + (entry.Kind_ == EntryKind::Recv);
+         }
+         break;
+      }
+      return !(isSendFound && isRecvFound);
+   });
+   fd.Close();
+   if (!isScanOK) {
+      this->Close();
+      return File::Result{std::errc::io_error};
+   }
+   res = this->IdxFile_.Open(fname, FileMode::CreatePath | FileMode::Append | FileMode::Read);
+   if (!res) {
+      this->Close();
+      return res;
+   }
+   this->EntryCount_ = validCount;
+   this->NextPos_ = logSize;
+   res = this->SyncFromLog(fixlog, validCount ? last.Pos_ : 0, validCount ? last.Pos_ : kInvalidPos, logSize, fixParser);
+   this->WritePending(this->MovePending(), false);
+   return res;
+}
+//--------------------------------------------------------------------------//
+void FixSeqIndex::Apply(EntryKind kind, FixSeqNum seq) {
+   switch (kind) {
+   case EntryKind::Send:
+      this->Send_.NextSeq_ = seq + 1;
+      break;
+   case EntryKind::Recv:
+      this->Recv_.NextSeq_ = seq + 1;
+      break;
+   case EntryKind::RstSend:
+      this->Send_.NextSeq_ = seq;
+      this->Send_.SegBegin_ = this->EntryCount_ + 1;
+      break;
+   case EntryKind::RstRecv:
+      this->Recv_.NextSeq_ = seq;
+      this->Recv_.SegBegin_ = this->EntryCount_ + 1;
+      break;
+   case EntryKind::NextRecv:
+      this->Recv_.NextSeq_ = seq;
+      break;
+   }
+}
+FixSeqIndex::PosType FixSeqIndex::Find(Side& side, EntryKind msgKind, EntryKind rstKind, FixSeqNum seqFrom, FixSeqNum* foundSeq) {
+   if (!this->IdxFile_.IsOpened())
+      return kInvalidPos;
+   File::Result res = this->IdxFile_.GetFileSize();
+   if (!res)
+      return kInvalidPos;
+   const IndexT count = std::min(static_cast<IndexT>(res.GetResult() / kEntrySize), this->EntryCount_);
+   if (side.SegBegin_ == kUnknownIndex) {
+      // 開啟後尚未有 RST, 所以只需要從索引檔尋找.
+      IndexT segBegin = 0;
+      if (!ScanEntriesBackward(this->IdxFile_, count, [&segBegin, rstKind](uint64_t idx, const IdxEntry& entry) -> bool {
+         if (entry.Kind_ != rstKind)
+            return true;
+         segBegin = idx + 1;
+         return false;
+      }))
+         return kInvalidPos;
+      side.SegBegin_ = segBegin;
+   }
+   // 在 [SegBegin_, count) 之中, 找第一筆 MsgSeqNum >= seqFrom 的 msgKind:
+   // 同一段之中 msgKind 的序號遞增, 所以「mid 之後第一筆 msgKind 的序號 >= seqFrom」是單調的.
+   IdxEntry entry;
+   IndexT   lo = side.SegBegin_, hi = count;
+   while (lo < hi) {
+      const IndexT mid = lo + (hi - lo) / 2;
+      const IndexT idx = FindEntryForward(this->IdxFile_, mid, count, msgKind, entry);
+      if (idx >= count || entry.Seq_ >= seqFrom)
+         hi = mid;
+      else
+         lo = idx + 1;
+   }
+   if (FindEntryForward(this->IdxFile_, lo, count, msgKind, entry) >= count || entry.Seq_ < seqFrom)
+      return kInvalidPos;
+   if (foundSeq)
+      *foundSeq = entry.Seq_;
+   return entry.Pos_;
+}
+void FixSeqIndex::WriteEntry(EntryKind kind, FixSeqNum seq, PosType pos) {
+   byte buf[kEntrySize];
+   PutBigEndian(buf, pos);
+   PutBigEndian(buf + 8, seq);
+   buf[12] = static_cast<byte>(kind);
+   memset(buf + 13, 0, kEntrySize - 13);
+   // 預留空間, 讓連續的索引放在同一個節點, 批次寫入時可以減少 write() 的次數.
+   AppendToBuffer(this->PendingEntries_, buf, sizeof(buf), kEntrySize * 255);
+}
+void FixSeqIndex::WritePending(BufferList&& entries, bool isSync) {
+   if (entries.empty())
+      return;
+   DcQueueList dcq{std::move(entries)};
+   this->IdxFile_.Append(dcq);
+   if (isSync)
+      this->IdxFile_.Sync();
+}
+void FixSeqIndex::Add(EntryKind kind, FixSeqNum seq, PosType pos) {
+   assert(this->IsOpened());
+   this->Apply(kind, seq);
+   this->WriteEntry(kind, seq, pos);
+   ++this->EntryCount_;
+}
+//--------------------------------------------------------------------------//
+/// 解析記錄檔的一行: pbeg = 行首, pend = 行尾('\n'的位置).
+/// 若此行需要建立索引, 則傳回 true, 並填妥 kind, seq;
+static bool ParseLogLine(const char* pbeg, const char* pend, FixParser& fixParser,
+                         FixSeqIndex::EntryKind& kind, FixSeqNum& seq) {
+   switch (*pbeg) {
+   case f9fix_kCSTR_HdrSend[0]:
+   case f9fix_kCSTR_HdrRecv[0]:
+   {  // "S timestamp FIX Message" or "R timestamp FIX Message"
+      if (pend - pbeg < FixRecorder::kTimeStampWidth + kFixMinHeaderWidth)
+         return false;
+      if (pbeg[1] != ' ' || pbeg[2 + FixRecorder::kTimeStampWidth] != ' ')
+         return false;
+      StrView fixmsg{pbeg + 3 + FixRecorder::kTimeStampWidth, pend};
+      fixParser.Clear();
+      fixParser.ParseFields(fixmsg, FixParser::Until::MsgSeqNum);
+      if ((seq = fixParser.GetMsgSeqNum()) <= 0)
+         return false;
+      kind = static_cast<FixSeqIndex::EntryKind>(*pbeg);
+      return true;
+   }
+   case f9fix_kCHAR_HdrCtrlMsgSeqNum:
+   {  // "\x02" "IDX|S=NextSendSeq|R=NextRecvSeq", "\x02" "RST|S=NextSendSeq", "\x02" "RST|R=NextRecvSeq"
+      constexpr size_t kHdrSize = sizeof(f9fix_kCSTR_HdrIdx) - 1;
+      if (static_cast<size_t>(pend - pbeg) < kControlMsgSeqNumMinLength)
+         return false;
+      const bool isRst = (memcmp(pbeg, f9fix_kCSTR_HdrRst, kHdrSize) == 0);
+      if (!isRst && memcmp(pbeg, f9fix_kCSTR_HdrIdx, kHdrSize) != 0)
+         return false;
+      FixSeqNum   nextSend = 0, nextRecv = 0;
+      const char* pfld = pbeg + kHdrSize;
+      while (pend - pfld > 3 && pfld[0] == f9fix_kCHAR_SPL && pfld[2] == '=') {
+         const char  tag = pfld[1];
+         FixSeqNum   val = StrTo(StrView{pfld + 3, pend}, FixSeqNum{0}, &pfld);
+         if (tag == f9fix_kCSTR_HdrNextSendSeq[1])
+            nextSend = val;
+         else if (tag == f9fix_kCSTR_HdrNextRecvSeq[1])
+            nextRecv = val;
+      }
+      if (isRst) {
+         // 若同一行有 S,R, 則只能用一個 kind 表示; FixRecorder 不會寫入此種 RST.
+         if (nextSend > 0) {
+            kind = FixSeqIndex::EntryKind::RstSend;
+            seq = nextSend;
+            return true;
+         }
+         if (nextRecv > 0) {
+            kind = FixSeqIndex::EntryKind::RstRecv;
+            seq = nextRecv;
+            return true;
+         }
+         return false;
+      }
+      // "IDX|R=n" = SequenceReset-GapFill; 定時寫入的 "IDX|S=n|R=m" 不用建立索引.
+      if (nextSend <= 0 && nextRecv > 0) {
+         kind = FixSeqIndex::EntryKind::NextRecv;
+         seq = nextRecv;
+         return true;
+      }
+      return false;
+   }
+   }
+   return false;
+}
+File::Result FixSeqIndex::SyncFromLog(File& fixlog, PosType pos, PosType skipPos, PosType logSize, FixParser& fixParser) {
+   std::string buf;
+   buf.resize(FixRecorder::kReloadSentBufferSize);
+   size_t      bufsz = 0;
+   size_t      addCount = 0;
+   bool        isSkipLine = false; // 單行超過 buf.size() 的內容, 必定不是需要建立索引的訊息.
+   while (pos + bufsz < logSize) {
+      size_t rdsz = buf.size() - bufsz;
+      if (rdsz > logSize - pos - bufsz)
+         rdsz = static_cast<size_t>(logSize - pos - bufsz);
+      File::Result res = fixlog.Read(pos + bufsz, &buf[bufsz], rdsz);
+      if (!res)
+         return res;
+      if (res.GetResult() == 0)
+         break;
+      bufsz += res.GetResult();
+      const char* const pbuf = buf.c_str();
+      const char* const pend = pbuf + bufsz;
+      const char*       pbeg = pbuf;
+      while (const char* pln = static_cast<const char*>(memchr(pbeg, '\n', static_cast<size_t>(pend - pbeg)))) {
+         const PosType lnPos = pos + static_cast<PosType>(pbeg - pbuf);
+         EntryKind     kind;
+         FixSeqNum     seq;
+         if (isSkipLine)
+            isSkipLine = false;
+         else if ((skipPos == kInvalidPos || lnPos > skipPos) && pbeg != pln
+                  && ParseLogLine(pbeg, pln, fixParser, kind, seq)) {
+            this->Add(kind, seq, lnPos);
+            ++addCount;
+         }
+         pbeg = pln + 1;
+      }
+      if (pbeg == pbuf && bufsz == buf.size()) {
+         isSkipLine = true;
+         pbeg = pend;
+      }
+      pos += static_cast<PosType>(pbeg - pbuf);
+      bufsz = static_cast<size_t>(pend - pbeg);
+      if (bufsz > 0)
+         memmove(&buf[0], pbeg, bufsz);
+   }
+   return File::Result{addCount};
+}
+
+} } // namespaces
@@ -0,0 +1,137 @@
+﻿// \file fon9/fix/FixSeqIndex.hpp
+// \author fonwinz@gmail.com
+#ifndef __fon9_fix_FixSeqIndex_hpp__
+#define __fon9_fix_FixSeqIndex_hpp__
+#include "fon9/fix/FixParser.hpp"
+#include "fon9/File.hpp"
+#include "fon9/buffer/BufferList.hpp"
+
+namespace fon9 { namespace fix {
+
+fon9_WARN_DISABLE_PADDING;
+/// \ingroup fix
+/// FixRecorder 的序號索引(另存一個索引檔): MsgSeqNum => FixRecorder 記錄檔的位置.
+/// - 回補(ResendRequest)時, 直接移到所需訊息的位置, 不用從檔尾往前搜尋.
+/// - 初始化時, 直接取得 NextSendSeq, NextRecvSeq, 不用從檔尾往前解析.
+/// - 索引檔格式: 每筆 kEntrySize bytes, BigEndian: pos(8) + seq(4) + kind(1) + reserved(3);
+/// - 不會將索引載入記憶體, 需要時才從索引檔讀取:
+///   - 開啟時, 從索引檔尾端往前讀取, 直到取得 NextSendSeq, NextRecvSeq 為止.
+///   - 若索引的位置超過記錄檔大小(例: 記錄檔尾端沒寫入), 則移除這些索引.
+///   - 若索引檔不存在, 或最後一筆索引與記錄檔不符, 則從記錄檔重建索引.
+///   - 若記錄檔有索引之後的資料(例: 索引檔尾端沒寫入), 則從記錄檔補齊.
+///   - 尋找訊息時, 在「最後一次序號重置(RST)之後」的索引之中, 使用二分搜尋(同一段的 MsgSeqNum 必定遞增).
+/// - 序號重置(RST)之後, 之前送出的訊息不再提供回補, 與 FixRecorder 從檔尾往前搜尋的規則相同.
+/// - 沒有 lock 保護, 由 FixRecorder 在 lock 狀態下呼叫.
+/// - Add() 僅將索引放入 PendingEntries_, 由 FixRecorder 的寫檔 thread 批次寫入索引檔:
+///   在 lock 狀態下 MovePending(), 在 unlock 狀態下 WritePending().
+class fon9_API FixSeqIndex {
+   fon9_NON_COPY_NON_MOVE(FixSeqIndex);
+public:
+   using PosType = File::PosType;
+   enum : PosType {
+      kInvalidPos = ~static_cast<PosType>(0),
+   };
+   enum : uint32_t {
+      kEntrySize = 16,
+   };
+   enum class EntryKind : char {
+      /// 送出的訊息: "S timestamp FIX Message\n" 的位置.
+      Send = 'S',
+      /// 依正常順序收到的訊息: "R timestamp FIX Message\n" 的位置.
+      Recv = 'R',
+      /// "RST|S=NextSendSeq": 之前送出的訊息不再提供回補.
+      RstSend = 's',
+      /// "RST|R=NextRecvSeq"
+      RstRecv = 'r',
+      /// "IDX|R=NextRecvSeq": 收到 SequenceReset-GapFill.
+      NextRecv = 'n',
+   };
+
+   FixSeqIndex() = default;
+   ~FixSeqIndex();
+
+   /// 在 FixRecorder 記錄檔開啟後, 開啟索引檔.
+   /// \param fname      索引檔名, 通常為 FixRecorder 記錄檔名 + ".idx";
+   /// \param fixlog     FixRecorder 記錄檔, 用來檢查索引, 或重建索引.
+   /// \param fixParser  已設定好 ExpectHeader 的 FixParser, 重建索引時用來解析 MsgSeqNum.
+   /// \retval success   傳回從記錄檔補齊(或重建)的索引數量.
+   File::Result Open(std::string fname, File& fixlog, FixParser& fixParser);
+   void Close();
+   bool IsOpened() const {
+      return this->IdxFile_.IsOpened();
+   }
+
+   /// 在寫入記錄檔之前呼叫: 加入一筆索引, pos 通常為 GetNextPos() + 在此次寫入資料的偏移.
+   void Add(EntryKind kind, FixSeqNum seq, PosType pos);
+   /// 取出尚未寫入索引檔的資料, 必須在 FixRecorder lock 狀態下呼叫.
+   BufferList MovePending() {
+      return std::move(this->PendingEntries_);
+   }
+   /// 將 MovePending() 取出的資料寫入索引檔, 可在 FixRecorder unlock 狀態下呼叫.
+   /// 但同一時間只能有一個 thread 呼叫(由 FixRecorder 的寫檔 thread 負責).
+   void WritePending(BufferList&& entries, bool isSync);
+
+   /// 寫入記錄檔之後呼叫, 用來計算下次寫入的位置.
+   void OnAppend(size_t sz) {
+      this->NextPos_ += sz;
+   }
+   /// 下次寫入記錄檔的位置.
+   PosType GetNextPos() const {
+      return this->NextPos_;
+   }
+
+   /// 0 表示索引中沒有相關資料.
+   FixSeqNum GetNextSendSeq() const {
+      return this->Send_.NextSeq_;
+   }
+   FixSeqNum GetNextRecvSeq() const {
+      return this->Recv_.NextSeq_;
+   }
+
+   /// 尋找第一筆 MsgSeqNum >= seqFrom 的送出訊息.
+   /// - 從索引檔讀取, 只會找已寫入索引檔的訊息.
+   /// - 第一次尋找時, 若開啟後尚未有序號重置, 則需從索引檔尾端往前找到最後一次 RST 的位置.
+   /// \retval kInvalidPos 找不到, 或讀取索引檔失敗(此時應使用其他方式尋找).
+   /// \retval else        "S timestamp FIX Message\n" 的位置, 此時 *foundSeq = 該訊息的 MsgSeqNum;
+   PosType FindSendPos(FixSeqNum seqFrom, FixSeqNum* foundSeq) {
+      return this->Find(this->Send_, EntryKind::Send, EntryKind::RstSend, seqFrom, foundSeq);
+   }
+   PosType FindRecvPos(FixSeqNum seqFrom, FixSeqNum* foundSeq) {
+      return this->Find(this->Recv_, EntryKind::Recv, EntryKind::RstRecv, seqFrom, foundSeq);
+   }
+
+private:
+   using IndexT = uint64_t;
+   enum : IndexT {
+      kUnknownIndex = ~static_cast<IndexT>(0),
+   };
+   struct Side {
+      FixSeqNum   NextSeq_{0};
+      /// 最後一次序號重置(RST)之後的第一筆索引(第幾筆, 不是檔案位置).
+      /// kUnknownIndex 表示尚未取得, 在第一次 Find() 時從索引檔尾端往前尋找.
+      IndexT      SegBegin_{kUnknownIndex};
+
+      void Clear() {
+         this->NextSeq_ = 0;
+         this->SegBegin_ = kUnknownIndex;
+      }
+   };
+   Side                 Send_;
+   Side                 Recv_;
+   File                 IdxFile_;
+   BufferList           PendingEntries_;
+   PosType              NextPos_{0};
+   /// 索引的數量, 包含尚未寫入索引檔的 PendingEntries_;
+   IndexT               EntryCount_{0};
+
+   /// 依照新加入的索引(第 EntryCount_ 筆), 更新 NextSeq_ 及 SegBegin_;
+   void Apply(EntryKind kind, FixSeqNum seq);
+   PosType Find(Side& side, EntryKind msgKind, EntryKind rstKind, FixSeqNum seqFrom, FixSeqNum* foundSeq);
+   void WriteEntry(EntryKind kind, FixSeqNum seq, PosType pos);
+   /// 從記錄檔的 pos 開始解析, 補齊 > skipPos 的索引.
+   File::Result SyncFromLog(File& fixlog, PosType pos, PosType skipPos, PosType logSize, FixParser& fixParser);
+};
+fon9_WARN_POP;
+
+} } // namespaces
+#endif//__fon9_fix_FixSeqIndex_hpp__
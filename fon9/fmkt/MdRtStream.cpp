@@ -86,6 +86,8 @@ seed::OpResult MdRtStream::SubscribeStream(SubConn*           pSubConn,
    if (StrTrimHead(&args).Get1st() == ',')
       StrTrimHead(&args, args.begin() + 1);
    recover->SetStartInfoTime(StrTo(&args, DayTime::Null()));
+   if (!recover->IsStarted_)
+      recover->StartPos_ = this->RtTimeIndex_.FindStartPos(recover->StartInfoTime_, this->InnMgr_.DailyClearTime());
    recover->RunAfter(TimeInterval{});
    return seed::OpResult::no_error;
 }
@@ -114,8 +116,7 @@ void MdRtStream::OnSessionChanged(const Symb& symb) {
    // 開啟 Storage, 如果 Storage 有變, 則將 SessionSt 寫入新開啟的 Storage.
    // 這樣在從頭回補時, 才能補到 TDay 及盤別狀態.
    this->InnMgr_.RtOpen(this->RtStorage_, symb);
-   if (prevStream != this->RtStorage_.GetStream().get()) {
-      this->RtStorageSize_ = this->RtStorage_.Size();
+   if (this->OnRtStorageOpened(symb, prevStream)) {
       RevPutMem(rts, pk.begin(), pk.size());
       RevPutBitv(rts, fon9_BitvV_NumberNull); // InfoTime = Null.
       *rts.AllocPacket<uint8_t>() = cast_to_underlying(f9sv_RtsPackType_TradingSessionId);
@@ -143,12 +144,15 @@ void MdRtStream::PublishUpdateBS(const StrView& keyText, SymbBSData& symbBS, Rev
       *rts.AllocPacket<uint8_t>() = cast_to_underlying(IsEnumContains(symbBS.Flags_, f9sv_BSFlag_Calculated)
                                                        ? f9sv_RtsPackType_CalculatedBS
                                                        : f9sv_RtsPackType_SnapshotBS);
+      // 回補時可從這裡開始: SnapshotBS 有明確的 InfoTime, 且之後的 UpdateBS 可依此解析.
+      this->AddTimeIndex(keyText, symbBS.InfoTime_);
    }
    this->Save(std::move(rts), f9sv_MdRtsKind_BS);
 }
 void MdRtStream::Publish(const StrView& keyText, f9sv_RtsPackType pkType, f9sv_MdRtsKind pkKind, const DayTime infoTime, RevBufferList&& rts) {
    assert(!IsEnumContains(pkKind, f9sv_MdRtsKind_NoInfoTime));
-   if ((this->InfoTimeKind_ == pkKind && this->InfoTime_ == infoTime) || infoTime.IsNull())
+   const bool isInfoTimeNull = ((this->InfoTimeKind_ == pkKind && this->InfoTime_ == infoTime) || infoTime.IsNull());
+   if (isInfoTimeNull)
       RevPutBitv(rts, fon9_BitvV_NumberNull);
    else {
       // 訂閱者可用 RtsKind 過濾所需要的封包種類,
@@ -176,6 +180,8 @@ void MdRtStream::Publish(const StrView& keyText, f9sv_RtsPackType pkType, f9sv_M
       }
       fon9_WARN_POP;
    }
+   if (!isInfoTimeNull)
+      this->AddTimeIndex(keyText, infoTime);
    this->Save(std::move(rts), pkKind);
 }
 void MdRtStream::PublishAndSave(const StrView& keyText, f9sv_RtsPackType pkType, f9sv_MdRtsKind pkKind, RevBufferList&& rts) {
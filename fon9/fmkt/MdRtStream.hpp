@@ -18,8 +18,24 @@ class fon9_API MdRtStream : public SymbData {
    DayTime           InfoTime_{DayTime::Null()};
    f9sv_MdRtsKind    InfoTimeKind_{};
    uint32_t          LastTimeSnapshotBS_{};
+   MdRtTimeIndex     RtTimeIndex_;
 
    void Save(RevBufferList&& rts, f9sv_MdRtsKind pkKind);
+   /// 在 this->Save() 之前呼叫, 表示即將儲存的封包有明確的 infoTime, 可以當成回補的開始位置.
+   /// 新增的索引點會寫入 rti 的索引檔.
+   void AddTimeIndex(const StrView& keyText, DayTime infoTime) {
+      if (this->RtStorage_.IsReady() && this->RtTimeIndex_.Add(infoTime, this->RtStorageSize_))
+         this->InnMgr_.RtTimeIndexAppend(keyText, infoTime, this->RtStorageSize_);
+   }
+   /// 在 InnMgr_.RtOpen() 之後呼叫, 若 stream 有變, 則重新取得 RtStorageSize_ 及索引點.
+   /// \retval true  stream 有變.
+   bool OnRtStorageOpened(const Symb& symb, const void* prevStream) {
+      if (prevStream == this->RtStorage_.GetStream().get())
+         return false;
+      this->RtStorageSize_ = this->RtStorage_.Size();
+      this->InnMgr_.RtTimeIndexLoad(symb, this->RtTimeIndex_, this->RtStorageSize_);
+      return true;
+   }
 
    seed::OpResult SubscribeStream(SubConn* pSubConn, seed::Tab& tabRt, SymbPodOp& op, StrView args, seed::FnSeedSubr&& subr);
    seed::OpResult UnsubscribeStream(SubConn* pSubConn) {
@@ -42,8 +58,9 @@ public:
    ~MdRtStream();
 
    void OpenRtStorage(Symb& symb) {
+      const void* prevStream = this->RtStorage_.GetStream().get();
       this->InnMgr_.RtOpen(this->RtStorage_, symb);
-      this->RtStorageSize_ = this->RtStorage_.Size();
+      this->OnRtStorageOpened(symb, prevStream);
    }
 
    /// 移除商品, 通常是因為商品下市.
@@ -58,6 +75,9 @@ public:
    DayTime InfoTime() const {
       return this->InfoTime_;
    }
+   const MdRtTimeIndex& RtTimeIndex() const {
+      return this->RtTimeIndex_;
+   }
 
    static seed::Fields MakeFields();
 
@@ -3,6 +3,7 @@
 #include "fon9/fmkt/MdRtStreamInn.hpp"
 #include "fon9/fmkt/MdSymbs.hpp"
 #include "fon9/TimedFileName.hpp"
+#include "fon9/DefaultThreadPool.hpp"
 #include "fon9/Log.hpp"
 #include "fon9/BitvDecode.hpp"
 
@@ -11,6 +12,16 @@ namespace fon9 { namespace fmkt {
 MdRtSubr::~MdRtSubr() {
 }
 //--------------------------------------------------------------------------//
+ConfigParser::Result MdRtiArgs::OnTagValue(StrView tag, StrView& value) {
+   if (tag == "Archive")
+      this->IsArchiveOnDailyClear_ = (toupper(value.Get1st()) == 'Y');
+   else if (tag == "MapExtentMB")
+      this->RtiMapExtentSize_ = StrTo(value, File::SizeType{0}) * 1024 * 1024;
+   else
+      return ConfigParser::Result::EUnknownTag;
+   return ConfigParser::Result::Success;
+}
+//--------------------------------------------------------------------------//
 MdRtStreamInnMgr::MdRtStreamInnMgr(MdSymbsBase& symbs, std::string rtiPathFmt)
    : RecoverThread_(rtiPathFmt.empty()
                     ? nullptr
@@ -21,27 +32,111 @@ MdRtStreamInnMgr::MdRtStreamInnMgr(MdSymbsBase& symbs, std::string rtiPathFmt)
 MdRtStreamInnMgr::~MdRtStreamInnMgr() {
    if (this->RecoverThread_)
       this->RecoverThread_->WaitForEndNow();
+   this->FlushRtiIdx();
 }
 void MdRtStreamInnMgr::DailyClear(const unsigned tdayYYYYMMDD) {
    assert(this->TDayYYYYMMDD_ < tdayYYYYMMDD);
    this->TDayYYYYMMDD_ = tdayYYYYMMDD;
    if (this->RtiPathFmt_.empty())
       return;
+   if (this->ArchiveMountTree_ && this->RtInn_)
+      this->ArchiveRti();
+   this->FlushRtiIdx();
+   this->RtiIdxFile_.Close();
+   this->RtiIdxLoaded_.clear();
 
    TimedFileName logfn(this->RtiPathFmt_, TimedFileName::TimeScale::Day);
    logfn.RebuildFileNameYYYYMMDD(tdayYYYYMMDD);
 
-   const std::string    logPath = logfn.GetFileName();
-   InnApf::OpenArgs     oargs{logPath + ".rti"};
+   this->RtiPath_ = logfn.GetFileName();
+   InnApf::OpenArgs     oargs{this->RtiPath_ + ".rti"};
    InnStream::OpenArgs  sargs{InnRoomType{}};
    InnApf::OpenResult   res{};
+   oargs.MapExtentSize_ = this->RtiMapExtentSize_;
+   oargs.FlushInterval_ = this->RtiFlushInterval_;
+   oargs.SyncInterval_ = this->RtiSyncInterval_;
    sargs.ExpectedRoomSize_[0] = 1024 * 2;
    sargs.ExpectedRoomSize_[1] = 1024 * 4;
    sargs.ExpectedRoomSize_[2] = 1024 * 8;
    sargs.ExpectedRoomSize_[3] = 1024 * 16;
    this->RtInn_ = InnApf::Make(oargs, sargs, res);
-   if (!this->RtInn_)
+   if (!this->RtInn_) {
       fon9_LOG_FATAL("MdRtStreamInnMgr.DailyClear|fname=", oargs.FileName_, "|tday=", tdayYYYYMMDD, '|', res);
+      return;
+   }
+   this->OpenRtiIdx();
+}
+void MdRtStreamInnMgr::OpenRtiIdx() {
+   const std::string fname = this->RtiPath_ + ".rti.idx";
+   File::Result      res = this->RtiIdxFile_.Open(fname, FileMode::CreatePath | FileMode::OpenAlways | FileMode::Append | FileMode::Read);
+   if (res)
+      res = this->RtiIdxFile_.GetFileSize();
+   std::string buf;
+   if (res && res.GetResult() > 0) {
+      buf.resize(static_cast<size_t>(res.GetResult()));
+      res = this->RtiIdxFile_.Read(0, &*buf.begin(), buf.size());
+      if (res && res.GetResult() != buf.size())
+         res = File::Result{std::errc::io_error};
+   }
+   if (!res) {
+      fon9_LOG_ERROR("MdRtStreamInnMgr.OpenRtiIdx|fname=", fname, '|', res);
+      this->RtiIdxFile_.Close();
+      return;
+   }
+   constexpr size_t  kItemValueSize = sizeof(uint64_t) * 2;
+   const char*       pbeg = buf.c_str();
+   const char* const pend = pbeg + buf.size();
+   size_t            count = 0;
+   while (pbeg < pend) {
+      const size_t keylen = static_cast<byte>(*pbeg);
+      if (static_cast<size_t>(pend - pbeg) < 1 + keylen + kItemValueSize)
+         break;
+      const StrView symbid{pbeg + 1, keylen};
+      pbeg += 1 + keylen;
+      const DayTime infoTime{TimeInterval::Make<TimeInterval::Scale>(static_cast<TimeInterval::OrigType>(GetBigEndian<uint64_t>(pbeg)))};
+      const auto    pos = static_cast<MdRtTimeIndex::PosT>(GetBigEndian<uint64_t>(pbeg + sizeof(uint64_t)));
+      pbeg += kItemValueSize;
+      if (this->RtiIdxLoaded_[CharVector{symbid}].Add(infoTime, pos))
+         ++count;
+   }
+   if (pbeg != pend) {
+      // 最後一筆索引點不完整(寫入時程式異常結束): 移除, 避免之後附加的索引點無法解析.
+      fon9_LOG_WARN("MdRtStreamInnMgr.OpenRtiIdx|fname=", fname,
+                    "|err=Incomplete tail|pos=", pbeg - buf.c_str(), "|len=", pend - pbeg);
+      this->RtiIdxFile_.SetFileSize(static_cast<File::PosType>(pbeg - buf.c_str()));
+   }
+   fon9_LOG_INFO("MdRtStreamInnMgr.OpenRtiIdx|fname=", fname, "|symbs=", this->RtiIdxLoaded_.size(), "|items=", count);
+}
+void MdRtStreamInnMgr::FlushRtiIdx() {
+   if (this->RtiIdxPending_.empty())
+      return;
+   if (this->RtiIdxFile_.IsOpened()) {
+      File::Result res = this->RtiIdxFile_.Append(ToStrView(this->RtiIdxPending_));
+      if (!res)
+         fon9_LOG_ERROR("MdRtStreamInnMgr.FlushRtiIdx|fname=", this->RtiIdxFile_.GetOpenName(), '|', res);
+   }
+   this->RtiIdxPending_.clear();
+}
+void MdRtStreamInnMgr::RtTimeIndexLoad(const Symb& symb, MdRtTimeIndex& idx, MdRtTimeIndex::PosT streamSize) {
+   idx.Clear();
+   auto ifind = this->RtiIdxLoaded_.find(symb.SymbId_);
+   if (ifind == this->RtiIdxLoaded_.end())
+      return;
+   idx = std::move(ifind->second);
+   this->RtiIdxLoaded_.erase(ifind);
+   idx.EraseFrom(streamSize);
+}
+void MdRtStreamInnMgr::RtTimeIndexAppend(StrView symbid, DayTime infoTime, MdRtTimeIndex::PosT pos) {
+   if (!this->RtiIdxFile_.IsOpened() || symbid.size() > 0xff)
+      return;
+   char  vals[sizeof(uint64_t) * 2];
+   PutBigEndian(vals, static_cast<uint64_t>(infoTime.GetOrigValue()));
+   PutBigEndian(vals + sizeof(uint64_t), static_cast<uint64_t>(pos));
+   this->RtiIdxPending_.push_back(static_cast<char>(symbid.size()));
+   this->RtiIdxPending_.append(symbid.begin(), symbid.size());
+   this->RtiIdxPending_.append(vals, sizeof(vals));
+   if (this->RtiIdxPending_.size() >= kRtiIdxFlushSize)
+      this->FlushRtiIdx();
 }
 InnApf::OpenResult MdRtStreamInnMgr::RtOpen(InnApf::StreamRW& rw, const Symb& symb) {
    assert(symb.TDayYYYYMMDD_ == this->TDayYYYYMMDD_);
@@ -54,6 +149,49 @@ InnApf::OpenResult MdRtStreamInnMgr::RtOpen(InnApf::StreamRW& rw, const Symb& sy
    rw.Close();
    return InnApf::OpenResult{std::errc::bad_file_descriptor};
 }
+File::Result MdRtStreamInnMgr::ExportArchive(std::string outFileName, MdRtsArchive::BuildResult* result) {
+   const InnApfSP rti = this->RtInn_;
+   if (!rti)
+      return File::Result{std::errc::bad_file_descriptor};
+   MdRtsArchive::BuildArgs args;
+   args.CtrlFlags_ = this->MdSymbs_.CtrlFlags_;
+   args.DailyClearTime_ = this->DailyClearTime_;
+   return MdRtsArchive::Build(*rti, std::move(outFileName), args, result);
+}
+void MdRtStreamInnMgr::SetArchiveOnDailyClear(seed::MaTreeSP mountTree, std::string mountName) {
+   auto symbs = this->MdSymbs_.SymbMap_.Lock();
+   this->ArchiveMountTree_ = std::move(mountTree);
+   this->ArchiveMountName_ = std::move(mountName);
+}
+static void BuildAndMountArchive(const InnApfSP& rti, const std::string& fname, const MdRtsArchive::BuildArgs& args,
+                                 const seed::MaTreeSP& mountTree, const std::string& mountName) {
+   MdRtsArchive::BuildResult bres;
+   File::Result              res = MdRtsArchive::Build(*rti, fname, args, &bres);
+   MdRtsArchiveSP            arc;
+   if (res) {
+      arc.reset(new MdRtsArchive);
+      res = arc->Open(fname);
+   }
+   if (!res) {
+      fon9_LOG_ERROR("MdRtStreamInnMgr.Archive|fname=", fname, '|', res);
+      return;
+   }
+   fon9_LOG_INFO("MdRtStreamInnMgr.Archive|fname=", fname,
+                 "|symbs=", bres.SymbCount_, "|packets=", bres.PacketCount_,
+                 "|bad=", bres.BadPacketCount_, "|size=", res.GetResult());
+   mountTree->Remove(&mountName);
+   std::string desc = RevPrintTo<std::string>("symbs=", arc->SymbCount());
+   mountTree->AddNamedSapling(MakeMdRtsArchiveTree(std::move(arc)), mountName, "Archive", std::move(desc));
+}
+void MdRtStreamInnMgr::ArchiveRti() {
+   // 轉檔所需時間與 rti 大小有關, 不可在 symb tree lock 狀態下處理, 所以交給 DefaultThreadPool.
+   // 轉檔期間由 task 保留「前一日」的 RtInn_; 換日後的寫入都在新的 rti, 前一日的 rti 不會再變動.
+   MdRtsArchive::BuildArgs args;
+   args.CtrlFlags_ = this->MdSymbs_.CtrlFlags_;
+   args.DailyClearTime_ = this->DailyClearTime_;
+   GetDefaultThreadPool().EmplaceMessage(std::bind(&BuildAndMountArchive, this->RtInn_, this->RtiPath_ + ".mda", args,
+                                                   this->ArchiveMountTree_, this->ArchiveMountName_));
+}
 //--------------------------------------------------------------------------//
 static inline bool IsStartTime(DayTime infoTime, DayTime reqTime, DayTime dailyClearTime) {
    if (infoTime.IsNull())
@@ -70,6 +208,18 @@ static inline bool IsStartTime(DayTime infoTime, DayTime reqTime, DayTime dailyC
    // 資料時間(infoTime)沒有跨日, 回補要求也沒有跨日.
    return infoTime >= reqTime;
 }
+//--------------------------------------------------------------------------//
+MdRtTimeIndex::PosT MdRtTimeIndex::FindStartPos(DayTime startTime, DayTime dailyClearTime) const {
+   // 索引點依照寫入順序(時間順序)排列, 所以可用二元搜尋:
+   // 找到第一個 IsStartTime() 的索引點, 然後使用它的前一個.
+   auto ifind = std::lower_bound(this->Items_.begin(), this->Items_.end(), startTime,
+                                 [dailyClearTime](const Item& item, DayTime tm) {
+      return !IsStartTime(item.InfoTime_, tm, dailyClearTime);
+   });
+   if (ifind == this->Items_.begin())
+      return 0;
+   return (--ifind)->Pos_;
+}
 
 void MdRtRecover::OnTimer(TimeStamp now) {
    (void)now;
@@ -90,7 +240,7 @@ void MdRtRecover::OnTimer(TimeStamp now) {
    // 預設: this->RunAfter(TimeInterval_Millisecond(1)); 大約 1 秒 1000 次回補;
    // 所以一個回補要求, 沒流量管制時, 最大回補流量 = sizeof(rdbuf) * 1000 bytes / 每秒.
    char     rdbuf[4 * 1024];
-   PosT     nextReadPos = nargs.Pos_ = (this->IsStarted_ ? this->LastPos_ : 0);
+   PosT     nextReadPos = nargs.Pos_ = (this->IsStarted_ ? this->LastPos_ : this->StartPos_);
    size_t   bufofs = 0, errlen = 0;
    // - 首次執行(this->IsStarted_ == false), 則一定找到期望開始的位置為止.
    // - this->IsStarted_ == true: 還原上次未處理的資料量?
@@ -110,7 +260,17 @@ void MdRtRecover::OnTimer(TimeStamp now) {
          rdsz = szToEnd;
       if (this->RtSubr_->IsUnsubscribed())
          return;
-      rdsz = this->Reader_->Read(nextReadPos, rdbuf + bufofs, rdsz);
+      // 若 rti 有使用 memory map, 且沒有上次剩餘的資料, 則直接使用 map 的資料, 不用複製.
+      const char* rdptr = nullptr;
+      if (bufofs == 0) {
+         size_t pksz = rdsz;
+         if ((rdptr = reinterpret_cast<const char*>(this->Reader_->Peek(nextReadPos, pksz))) != nullptr)
+            rdsz = pksz;
+      }
+      if (rdptr == nullptr) {
+         rdsz = this->Reader_->Read(nextReadPos, rdbuf + bufofs, rdsz);
+         rdptr = rdbuf;
+      }
       if (rdsz <= 0) {
          fon9_LOG_ERROR("MdRtStream.Read|key=", nargs.KeyText_,
                         "|err=Read 0"
@@ -120,8 +280,8 @@ void MdRtRecover::OnTimer(TimeStamp now) {
       }
       nextReadPos += rdsz;
 
-      const char* const rdend = rdbuf + bufofs + rdsz;
-      DcQueueFixedMem   dcq{rdbuf, rdend};
+      const char* const rdend = rdptr + bufofs + rdsz;
+      DcQueueFixedMem   dcq{rdptr, rdend};
       // ChkHeader 儲存的內容, 請參考 MdRtStream::Save();
       constexpr auto    kChkHeaderSize = sizeof(MdRtStreamInn_ChkValueType) + sizeof(f9sv_MdRtsKind);
       const char*       pchk;
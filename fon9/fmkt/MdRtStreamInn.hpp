@@ -3,10 +3,14 @@
 #ifndef __fon9_fmkt_MdRtStreamInn_hpp__
 #define __fon9_fmkt_MdRtStreamInn_hpp__
 #include "fon9/fmkt/MdRtsTypes.hpp"
+#include "fon9/fmkt/MdRtsArchive.hpp"
 #include "fon9/fmkt/SymbTree.hpp"
+#include "fon9/seed/MaTree.hpp"
 #include "fon9/buffer/RevBufferList.hpp"
+#include "fon9/ConfigParser.hpp"
 #include "fon9/InnApf.hpp"
 #include "fon9/Timer.hpp"
+#include <unordered_map>
 
 namespace fon9 { namespace fmkt {
 
@@ -17,6 +21,75 @@ class fon9_API MdSymbsBase;
 // 當檔案有異常時, 可以用此找到下一個正確的位置.
 using MdRtStreamInn_ChkValueType = uint32_t;
 
+/// \ingroup fmkt
+/// 每個 MdRtStream 在儲存時建立的「稀疏時間索引」: InfoTime => rti stream 的位置.
+/// - 回補要求有指定開始時間時, 直接從最接近的索引點開始讀取, 不用從 stream 開頭逐筆解析.
+/// - 只在儲存「有明確 InfoTime 的封包」時加入索引點(例: 每秒一次的 SnapshotBS),
+///   這樣從索引點開始解析時, 才能取得正確的 InfoTime;
+/// - 相鄰索引點的距離至少 kMinIntervalBytes, 且秒數不同,
+///   所以記憶體用量約為 rti 大小的 1/1000, 從索引點到實際開始位置, 最多只需多讀 kMinIntervalBytes 左右.
+/// - 新增的索引點會另存到 rti 的索引檔(sidecar), 請參考 MdRtStreamInnMgr::RtTimeIndexAppend();
+///   系統重啟後開啟 stream 時, 從索引檔載入, 請參考 MdRtStreamInnMgr::RtTimeIndexLoad();
+/// - 所有的操作 symb tree 必定處在 lock 狀態, 所以這裡不再額外 lock.
+class fon9_API MdRtTimeIndex {
+public:
+   using PosT = InnApf::SizeT;
+   enum : PosT {
+      kMinIntervalBytes = 1024 * 16,
+   };
+
+   void Clear() {
+      this->Items_.clear();
+   }
+   /// 在儲存 infoTime 有明確值的封包之前呼叫, pos = 封包在 stream 的位置.
+   /// \retval true  已加入索引點.
+   /// \retval false 與前一個索引點太接近, 不需要加入.
+   bool Add(DayTime infoTime, PosT pos) {
+      if (!this->Items_.empty()) {
+         const Item& back = this->Items_.back();
+         if (pos < back.Pos_ + kMinIntervalBytes || infoTime.GetIntPart() == back.InfoTime_.GetIntPart())
+            return false;
+      }
+      else if (pos < kMinIntervalBytes)
+         return false;
+      this->Items_.push_back(Item{infoTime, pos});
+      return true;
+   }
+   /// 移除 Pos_ >= streamSize 的索引點.
+   /// 從索引檔載入時使用: 索引檔可能比 rti 先寫入檔案, 此時 rti 尾端的資料已不存在.
+   void EraseFrom(PosT streamSize) {
+      while (!this->Items_.empty() && this->Items_.back().Pos_ >= streamSize)
+         this->Items_.pop_back();
+   }
+   /// 傳回開始讀取的位置: 最後一個 InfoTime < startTime 的索引點.
+   /// - 在索引點之前的封包, InfoTime 都比 startTime 小, 不用回補;
+   /// - 若沒有適當的索引點, 則傳回 0, 從 stream 開頭開始;
+   PosT FindStartPos(DayTime startTime, DayTime dailyClearTime) const;
+
+   size_t size() const {
+      return this->Items_.size();
+   }
+
+private:
+   struct Item {
+      DayTime  InfoTime_;
+      PosT     Pos_;
+   };
+   std::vector<Item> Items_;
+};
+
+//--------------------------------------------------------------------------//
+/// MdSystem 的 rti 設定, 通常由 plugin 的設定字串取得, 請參考 MdSystem::SetRtiConfig();
+/// - "Archive=Y": 換日時將「前一日」的 rti 轉成歸檔, 請參考 MdRtStreamInnMgr::SetArchiveOnDailyClear(); 預設為 N.
+/// - "MapExtentMB=n": 開啟 rti 時使用 memory map, 每次擴充 n MB, 請參考 MdRtStreamInnMgr::SetRtiMapExtentSize();
+///   預設為 0: 不使用 memory map.
+struct fon9_API MdRtiArgs {
+   bool           IsArchiveOnDailyClear_{false};
+   char           Padding____[7];
+   File::SizeType RtiMapExtentSize_{0};
+   ConfigParser::Result OnTagValue(StrView tag, StrView& value);
+};
+
 /// MdRtStream 的儲存機制;
 /// - 即時儲存.
 /// - 歷史回補.
@@ -26,7 +99,32 @@ class fon9_API MdRtStreamInnMgr {
    unsigned TDayYYYYMMDD_{};
    char     Padding______[4];
    InnApfSP RtInn_;
+   /// 目前開啟的 rti 路徑(不含副檔名).
+   std::string    RtiPath_;
+   /// 換日轉出的歸檔, 掛在 ArchiveMountTree_ 的 ArchiveMountName_ 底下;
+   /// ArchiveMountTree_ == nullptr 表示換日時不轉檔.
+   seed::MaTreeSP ArchiveMountTree_;
+   std::string    ArchiveMountName_;
    DayTime  DailyClearTime_;
+   File::SizeType RtiMapExtentSize_{0};
+   TimeInterval   RtiFlushInterval_{TimeInterval_Second(1)};
+   TimeInterval   RtiSyncInterval_{};
+   /// rti 的時間索引檔: RtiPath_ + ".rti.idx"; 每筆索引點的格式(BigEndian):
+   /// symbIdLen(1) + symbId + InfoTime(8, DayTime::GetOrigValue()) + Pos(8);
+   File           RtiIdxFile_;
+   /// 尚未寫入 RtiIdxFile_ 的索引點, 累積到 kRtiIdxFlushSize 才寫入, 減少在 symb tree lock 狀態下的寫檔次數.
+   std::string    RtiIdxPending_;
+   /// 開啟 rti 時, 從 RtiIdxFile_ 載入的索引點; 在 RtTimeIndexLoad() 移交給 MdRtStream.
+   std::unordered_map<CharVector, MdRtTimeIndex> RtiIdxLoaded_;
+   enum : size_t {
+      kRtiIdxFlushSize = 1024 * 4,
+   };
+   void OpenRtiIdx();
+   void FlushRtiIdx();
+
+   /// 在 DailyClear() 換日前呼叫(此時 symb tree 為 lock 狀態):
+   /// 交給 DefaultThreadPool 將目前的 rti 轉成 RtiPath_ + ".mda", 成功則掛到 ArchiveMountTree_;
+   void ArchiveRti();
 
 public:
    const TimerThreadSP  RecoverThread_;
@@ -52,7 +150,45 @@ public:
       return this->DailyClearTime_;
    }
 
+   /// 在 DailyClear() 開啟 rti 檔時, 使用 memory map 讀取, 請參考 InnFile::OpenArgs::MapExtentSize_;
+   /// - 回補時直接從 map 取得資料, 多個回補要求共用 page cache.
+   /// - 0 表示不使用 memory map(預設).
+   void SetRtiMapExtentSize(File::SizeType extentSize) {
+      this->RtiMapExtentSize_ = extentSize;
+   }
+   File::SizeType GetRtiMapExtentSize() const {
+      return this->RtiMapExtentSize_;
+   }
+   /// 在 DailyClear() 開啟 rti 檔時, 寫入執行緒的設定,
+   /// 請參考 InnApf::OpenArgs::FlushInterval_, SyncInterval_;
+   void SetRtiFlushPolicy(TimeInterval flushInterval, TimeInterval syncInterval) {
+      this->RtiFlushInterval_ = flushInterval;
+      this->RtiSyncInterval_ = syncInterval;
+   }
+
    InnApf::OpenResult RtOpen(InnApf::StreamRW& rw, const Symb& symb);
+
+   /// 在 RtOpen() 開啟(或更換) stream 之後呼叫, 取得該商品在索引檔裡面的索引點.
+   /// - idx 原本的內容會被清除.
+   /// - 位置超過 streamSize 的索引點(rti 尚未寫入的部分)不會載入.
+   void RtTimeIndexLoad(const Symb& symb, MdRtTimeIndex& idx, MdRtTimeIndex::PosT streamSize);
+   /// 在 MdRtTimeIndex::Add() 加入索引點之後呼叫, 將索引點寫入索引檔.
+   /// - 累積到 kRtiIdxFlushSize 才寫入, 在 DailyClear() 或解構時寫入剩餘的部分;
+   ///   若程式異常結束, 最後未寫入的索引點會遺失, 回補時會從前一個索引點開始解析.
+   void RtTimeIndexAppend(StrView symbid, DayTime infoTime, MdRtTimeIndex::PosT pos);
+
+   /// 將目前的 rti 轉成欄式歸檔檔案, 請參考 MdRtsArchive::Build();
+   /// - 通常在盤後呼叫, 盤中呼叫則只處理當下已寫入 rti 的資料.
+   /// - 若沒有開啟 rti, 則傳回 std::errc::bad_file_descriptor;
+   File::Result ExportArchive(std::string outFileName, MdRtsArchive::BuildResult* result = nullptr);
+
+   /// 在 DailyClear() 換日時, 將「前一日」的 rti 轉成歸檔檔案(與 rti 同檔名, 副檔名為 .mda);
+   /// - mountTree == nullptr: 不轉檔(預設).
+   /// - 轉檔在 DailyClear() 之後由 DefaultThreadPool 執行, 不會佔用 symb tree 的 lock;
+   ///   轉檔成功後, 使用 MakeMdRtsArchiveTree() 掛在 mountTree 的 mountName 底下, 取代先前掛上的歸檔.
+   /// - 程式啟動後的第一次 DailyClear() 沒有「前一日」的 rti, 不會轉檔.
+   /// - 不可在 symb tree lock 狀態下呼叫.
+   void SetArchiveOnDailyClear(seed::MaTreeSP mountTree, std::string mountName);
 };
 //--------------------------------------------------------------------------//
 struct fon9_API MdRtSubr : public intrusive_ref_counter<MdRtSubr> {
@@ -76,11 +212,13 @@ struct fon9_API MdRtSubr : public intrusive_ref_counter<MdRtSubr> {
 struct MdRtSubrSP : public intrusive_ptr<MdRtSubr> {
    using base = intrusive_ptr<MdRtSubr>;
    using base::base;
-   /// 呼叫前必須: lock tree, 檢查 IsUnsubscribed();
+   /// 呼叫前必須: lock tree(或 lock e.KeyText_ 所在的分區), 檢查 IsUnsubscribed();
+   /// StreamRecoverEnd 必定通知: 即使沒有任何回補訊息(StreamDataKind_ == 0), 訂閱者仍需知道回補已結束.
    void operator()(const seed::SeedNotifyArgs& e) const {
-      assert(static_cast<SymbTree*>(&e.Tree_)->SymbMap_.IsLocked());
+      assert(static_cast<SymbTree*>(&e.Tree_)->IsSymbLocked());
       assert(!this->get()->IsUnsubscribed());
-      if (IsEnumContainsAny(this->get()->RtFilter_, static_cast<f9sv_MdRtsKind>(e.StreamDataKind_)))
+      if (e.NotifyKind_ == seed::SeedNotifyKind::StreamRecoverEnd
+          || IsEnumContainsAny(this->get()->RtFilter_, static_cast<f9sv_MdRtsKind>(e.StreamDataKind_)))
          this->get()->Callback_(e);
    }
 };
@@ -108,7 +246,7 @@ struct MdRtRecover : public TimerEntry {
    char              Padding___[3];
    bool              IsStarted_{false};
 
-   /// IsStarted_ == false 使用 StartInfoTime_;
+   /// IsStarted_ == false 使用 StartInfoTime_, 從 StartPos_ 開始尋找;
    /// IsStarted_ == true 使用 LastPos_;
    union {
       DayTime  StartInfoTime_;
@@ -124,6 +262,8 @@ struct MdRtRecover : public TimerEntry {
    /// 因為從該位置開始有即時通知,
    /// 訂閱者必須能處理「回補與即時」交錯回報的情況.
    PosT  EndPos_{};
+   /// IsStarted_ == false 時, 開始尋找 StartInfoTime_ 的位置, 由 MdRtTimeIndex::FindStartPos() 取得.
+   PosT  StartPos_{};
 
    using MdRtRecoverSP = intrusive_ptr<MdRtRecover>;
    inline static MdRtRecoverSP Make(MdRtStreamInnMgr& mgr, MdRtSubrSP subr, StreamSP reader) {
@@ -0,0 +1,728 @@
+﻿// \file fon9/fmkt/MdRtsArchive.cpp
+// \author fonwinz@gmail.com
+#include "fon9/fmkt/MdRtsArchive.hpp"
+#include "fon9/fmkt/MdRtsTypes.hpp"
+#include "fon9/fmkt/MdRtStreamInn.hpp"
+#include "fon9/seed/FieldMaker.hpp"
+#include "fon9/seed/TreeOp.hpp"
+#include "fon9/seed/PodOp.hpp"
+#include "fon9/BitvDecode.hpp"
+#include "fon9/Log.hpp"
+#include <algorithm>
+#ifdef fon9_POSIX
+#include <sys/mman.h>
+#endif
+
+namespace fon9 { namespace fmkt {
+
+static const char       kMdArcMagic[8] = {'f', '9', 'M', 'd', 'A', 'r', 'c', '\n'};
+static const uint32_t   kMdArcVersion = 1;
+static const uint32_t   kMdArcByteOrderChk = 0x01020304;
+
+/// 若資料不足, 則觸發 exception: Raise<BitvNeedsMore>("MdRtsArchive.Read");
+template <typename ValueT>
+static inline ValueT ReadOrRaise(DcQueue& rxbuf) {
+   ValueT res;
+   auto*  pres = rxbuf.Peek(&res, sizeof(res));
+   if (pres == nullptr)
+      Raise<BitvNeedsMore>("MdRtsArchive.Read");
+   res = GetBigEndian<ValueT>(pres);
+   rxbuf.PopConsumed(sizeof(ValueT));
+   return res;
+}
+
+//--------------------------------------------------------------------------//
+
+fon9_WARN_DISABLE_PADDING;
+/// 從 rti 的一個 stream 解碼出 MdArcRow;
+/// 委託簿只保留 OrderBuy, OrderSell, 用來判斷最佳一檔是否有異動.
+struct MdArcDecoder {
+   fon9_NON_COPY_NON_MOVE(MdArcDecoder);
+   enum {
+      kMaxLevel = 0x10,
+      kSideBuy = 0,
+      kSideSell = 1,
+   };
+   struct Book {
+      PriQty   Levels_[kMaxLevel];
+      unsigned Count_{0};
+   };
+   using ArcRows = std::vector<MdArcRow>[kMdArcSeriesCount];
+   const MdRtsArchive::BuildArgs&   Args_;
+   ArcRows&                         Dst_;
+   DayTime                          InfoTime_{DayTime::Null()};
+   Book                             Books_[2];
+
+   MdArcDecoder(const MdRtsArchive::BuildArgs& args, ArcRows& dst) : Args_(args), Dst_(dst) {
+   }
+
+   DayTime ArcTime(DayTime tm) const {
+      return MdRtsArchive::ToArcTime(tm.IsNull() ? DayTime{} : tm, this->Args_.DailyClearTime_);
+   }
+   void SkipMktSeq(DcQueue& pk) {
+      if (IsEnumContains(this->Args_.CtrlFlags_, MdSymbsCtrlFlag::HasMarketDataSeq)) {
+         MarketDataSeq mktseq{};
+         BitvTo(pk, mktseq);
+      }
+   }
+   /// pk = 儲存時的一個 MdRts 封包: f9sv_RtsPackType + 內容;
+   void DecodePacket(f9sv_MdRtsKind pkKind, DcQueue& pk) {
+      const f9sv_RtsPackType pkType = static_cast<f9sv_RtsPackType>(ReadOrRaise<uint8_t>(pk));
+      if (!IsEnumContains(pkKind, f9sv_MdRtsKind_NoInfoTime)) {
+         // InfoTime 為 Null 表示與前一個封包相同, 所以每個有 InfoTime 的封包都要取出.
+         DayTime infoTime{DayTime::Null()};
+         BitvTo(pk, infoTime);
+         if (!infoTime.IsNull())
+            this->InfoTime_ = infoTime;
+      }
+      fon9_WARN_DISABLE_SWITCH;
+      switch (pkType) {
+      case f9sv_RtsPackType_DealPack:
+         this->SkipMktSeq(pk);
+         this->DecodeDeal(pk);
+         break;
+      case f9sv_RtsPackType_DealBS:
+         this->SkipMktSeq(pk);
+         if (this->DecodeDeal(pk))
+            this->DecodeSnapshotBS(pk);
+         break;
+      case f9sv_RtsPackType_SnapshotBS:
+         this->SkipMktSeq(pk);
+         this->DecodeSnapshotBS(pk);
+         break;
+      case f9sv_RtsPackType_UpdateBS:
+         this->SkipMktSeq(pk);
+         this->DecodeUpdateBS(pk);
+         break;
+      }
+      fon9_WARN_POP;
+   }
+   /// 傳回 false 表示試撮.
+   bool DecodeDeal(DcQueue& pk) {
+      const f9sv_DealFlag flags = static_cast<f9sv_DealFlag>(ReadOrRaise<uint8_t>(pk));
+      DayTime dealTime = this->InfoTime_;
+      if (IsEnumContains(flags, f9sv_DealFlag_DealTimeChanged)) {
+         DayTime tm{DayTime::Null()};
+         BitvTo(pk, tm);
+         if (!tm.IsNull())
+            dealTime = tm;
+      }
+      Qty qty{};
+      if (IsEnumContains(flags, f9sv_DealFlag_TotalQtyLost))
+         BitvTo(pk, qty);
+      if (IsEnumContains(flags, f9sv_DealFlag_LmtFlagsChanged))
+         ReadOrRaise<uint8_t>(pk);
+      unsigned       count = ReadOrRaise<uint8_t>(pk) + 1u;
+      const bool     isCalc = IsEnumContains(flags, f9sv_DealFlag_Calculated);
+      auto&          deals = this->Dst_[cast_to_underlying(MdArcSeries::Deal)];
+      MdArcRow       row{};
+      row.Time_ = this->ArcTime(dealTime);
+      do {
+         BitvTo(pk, row.Pri_);
+         BitvTo(pk, row.Qty_);
+         if (!isCalc)
+            deals.push_back(row);
+      } while (--count > 0);
+      if (IsEnumContains(flags, f9sv_DealFlag_DealBuyCntChanged))
+         BitvTo(pk, qty);
+      if (IsEnumContains(flags, f9sv_DealFlag_DealSellCntChanged))
+         BitvTo(pk, qty);
+      return !isCalc;
+   }
+   void DecodeSnapshotBS(DcQueue& pk) {
+      const Book  bfBooks[2] = {this->Books_[kSideBuy], this->Books_[kSideSell]};
+      this->Books_[kSideBuy].Count_ = this->Books_[kSideSell].Count_ = 0;
+      PriQty      pqs[kMaxLevel];
+      while (!pk.empty()) {
+         const uint8_t bstype = ReadOrRaise<uint8_t>(pk);
+         if (bstype & 0x80) { // [BS快照] 的 特殊欄位更新.
+            if (static_cast<RtBSSnapshotSpc>(bstype) == RtBSSnapshotSpc::LmtFlags)
+               ReadOrRaise<uint8_t>(pk);
+            continue;
+         }
+         const unsigned count = static_cast<unsigned>(bstype & 0x0f) + 1;
+         // 打包時由深到淺, 所以最後取出的是第1檔.
+         for (unsigned L = count; L > 0;) {
+            --L;
+            BitvTo(pk, pqs[L].Pri_);
+            BitvTo(pk, pqs[L].Qty_);
+         }
+         Book* book;
+         switch (static_cast<RtBSType>(bstype & cast_to_underlying(RtBSType::Mask))) {
+         case RtBSType::OrderBuy:   book = &this->Books_[kSideBuy];  break;
+         case RtBSType::OrderSell:  book = &this->Books_[kSideSell]; break;
+         default:                   continue;
+         }
+         std::copy(pqs, pqs + count, book->Levels_);
+         book->Count_ = count;
+      }
+      this->CheckBestChanged(bfBooks);
+   }
+   void DecodeUpdateBS(DcQueue& pk) {
+      const uint8_t  first = ReadOrRaise<uint8_t>(pk);
+      if (first & 0x80) // 試撮.
+         return;
+      const Book  bfBooks[2] = {this->Books_[kSideBuy], this->Books_[kSideSell]};
+      unsigned    count = (first & 0x7fu) + 1u;
+      PriQty      pq;
+      do {
+         const uint8_t  bsType = ReadOrRaise<uint8_t>(pk);
+         const auto     act = static_cast<RtBSAction>(bsType & cast_to_underlying(RtBSAction::Mask));
+         if (act == RtBSAction::New || act == RtBSAction::ChangePQ)
+            BitvTo(pk, pq.Pri_);
+         if (act != RtBSAction::Delete)
+            BitvTo(pk, pq.Qty_);
+         Book* book;
+         switch (static_cast<RtBSType>(bsType & cast_to_underlying(RtBSType::Mask))) {
+         case RtBSType::OrderBuy:   book = &this->Books_[kSideBuy];  break;
+         case RtBSType::OrderSell:  book = &this->Books_[kSideSell]; break;
+         default:                   continue;
+         }
+         const unsigned lv = (bsType & 0x0fu);
+         switch (act) {
+         case RtBSAction::New:
+            if (book->Count_ < kMaxLevel)
+               ++book->Count_;
+            if (lv < book->Count_) {
+               std::copy_backward(book->Levels_ + lv, book->Levels_ + book->Count_ - 1, book->Levels_ + book->Count_);
+               book->Levels_[lv] = pq;
+            }
+            break;
+         case RtBSAction::ChangePQ:
+            if (lv < kMaxLevel) {
+               book->Levels_[lv] = pq;
+               if (book->Count_ <= lv)
+                  book->Count_ = lv + 1;
+            }
+            break;
+         case RtBSAction::ChangeQty:
+            if (lv < book->Count_)
+               book->Levels_[lv].Qty_ = pq.Qty_;
+            break;
+         case RtBSAction::Delete:
+            if (lv < book->Count_) {
+               std::copy(book->Levels_ + lv + 1, book->Levels_ + book->Count_, book->Levels_ + lv);
+               --book->Count_;
+            }
+            break;
+         }
+      } while (--count > 0);
+      this->CheckBestChanged(bfBooks);
+   }
+   static PriQty GetBest(const Book& book) {
+      if (book.Count_ > 0)
+         return book.Levels_[0];
+      PriQty res;
+      res.Pri_.AssignNull();
+      return res;
+   }
+   void CheckBestChanged(const Book (&bfBooks)[2]) {
+      const DayTime tm = this->ArcTime(this->InfoTime_);
+      for (unsigned side = kSideBuy; side <= kSideSell; ++side) {
+         const PriQty bf = GetBest(bfBooks[side]);
+         const PriQty af = GetBest(this->Books_[side]);
+         if (bf.Pri_ != af.Pri_ || bf.Qty_ != af.Qty_)
+            this->Dst_[cast_to_underlying(MdArcSeries::BestBuy) + side].push_back(MdArcRow{tm, af.Pri_, af.Qty_});
+      }
+   }
+};
+fon9_WARN_POP;
+
+size_t MdRtsArchive::DecodeRtStream(StrView rtStream, const BuildArgs& args,
+                                    std::vector<MdArcRow> (&dst)[kMdArcSeriesCount],
+                                    size_t* packetCount) {
+   // 儲存格式請參考 MdRtStream::Save(); MdRtRecover::OnTimer();
+   constexpr auto    kChkHeaderSize = sizeof(MdRtStreamInn_ChkValueType) + sizeof(f9sv_MdRtsKind);
+   MdArcDecoder      dec{args, dst};
+   DcQueueFixedMem   dcq{rtStream};
+   size_t            badCount = 0, pkCount = 0;
+   while (dcq.CalcSize() > kChkHeaderSize) {
+      const char* pchk = reinterpret_cast<const char*>(dcq.Peek1());
+      const auto  chkValue = GetBigEndian<MdRtStreamInn_ChkValueType>(pchk);
+      if (fon9_UNLIKELY(static_cast<uint32_t>(pchk - rtStream.begin()) != chkValue)) {
+         // 異常的資料, 往後找下一個正確的位置.
+         dcq.PopConsumed(1);
+         continue;
+      }
+      const f9sv_MdRtsKind pkKind = GetBigEndian<f9sv_MdRtsKind>(pchk + sizeof(chkValue));
+      dcq.PopConsumed(kChkHeaderSize);
+      size_t pksz = 0;
+      try {
+         if (!PopBitvByteArraySize(dcq, pksz))
+            break;
+      }
+      catch (std::exception&) {
+         ++badCount;
+         continue;
+      }
+      if (pksz <= 0)
+         continue;
+      if (pksz > dcq.CalcSize())
+         break;
+      ++pkCount;
+      DcQueueFixedMem pk{dcq.Peek1(), pksz};
+      try {
+         dec.DecodePacket(pkKind, pk);
+      }
+      catch (std::exception&) {
+         ++badCount;
+      }
+      dcq.PopConsumed(pksz);
+   }
+   if (packetCount)
+      *packetCount = pkCount;
+   return badCount;
+}
+
+//--------------------------------------------------------------------------//
+
+static void MakeSeriesColumns(const std::vector<MdArcRow>& rows, std::string& out, MdArcSeriesDir& dir, File::PosType pos) {
+   const size_t rowCount = rows.size();
+   dir.ColPos_ = pos;
+   dir.RowCount_ = static_cast<uint32_t>(rowCount);
+   out.resize(rowCount * sizeof(int64_t) * 3);
+   int64_t*  times = reinterpret_cast<int64_t*>(&*out.begin());
+   int64_t*  pris = times + rowCount;
+   uint64_t* qtys = reinterpret_cast<uint64_t*>(pris + rowCount);
+   std::vector<MdArcSecIdx> secIdx;
+   for (size_t L = 0; L < rowCount; ++L) {
+      const MdArcRow& row = rows[L];
+      times[L] = row.Time_.GetOrigValue();
+      pris[L] = row.Pri_.GetOrigValue();
+      qtys[L] = row.Qty_;
+      const int32_t sec = static_cast<int32_t>(row.Time_.GetIntPart());
+      if (secIdx.empty() || secIdx.back().Sec_ < sec)
+         secIdx.push_back(MdArcSecIdx{sec, static_cast<uint32_t>(L)});
+   }
+   dir.SecIdxPos_ = pos + out.size();
+   dir.SecIdxCount_ = static_cast<uint32_t>(secIdx.size());
+   if (!secIdx.empty())
+      out.append(reinterpret_cast<const char*>(secIdx.data()), secIdx.size() * sizeof(MdArcSecIdx));
+}
+
+File::Result MdRtsArchive::Build(InnApf& rti, std::string outFileName, const BuildArgs& args, BuildResult* result) {
+   File  fd;
+   auto  res = fd.Open(std::move(outFileName), FileMode::Write | FileMode::CreatePath | FileMode::Trunc);
+   if (!res)
+      return res;
+   BuildResult                   bres;
+   std::vector<InnApf::SKeyT>    keys = rti.GetStreamKeys();
+   std::sort(keys.begin(), keys.end());
+   std::vector<MdArcSymbDir>     dirs;
+   dirs.reserve(keys.size());
+   std::vector<MdArcRow>         rows[kMdArcSeriesCount];
+   std::string                   rtStream, outbuf;
+   File::PosType                 pos = sizeof(MdArcFileHeader);
+   for (const auto& key : keys) {
+      InnApf::StreamRW  rw;
+      if (!rw.Open(rti, ToStrView(key), FileMode::Read))
+         continue;
+      rtStream.resize(static_cast<size_t>(rw.Size()));
+      if (!rtStream.empty())
+         rtStream.resize(static_cast<size_t>(rw.Read(0, &*rtStream.begin(), rtStream.size())));
+      rw.Close();
+      for (auto& r : rows)
+         r.clear();
+      size_t pkCount = 0;
+      bres.BadPacketCount_ += DecodeRtStream(ToStrView(rtStream), args, rows, &pkCount);
+      bres.PacketCount_ += pkCount;
+      dirs.emplace_back();
+      MdArcSymbDir& dir = dirs.back();
+      memset(&dir, 0, sizeof(dir));
+      for (size_t L = 0; L < kMdArcSeriesCount; ++L) {
+         bres.RowCount_[L] += rows[L].size();
+         MakeSeriesColumns(rows[L], outbuf, dir.Series_[L], pos);
+         if (!(res = fd.Write(pos, ToStrView(outbuf))))
+            return res;
+         pos += outbuf.size();
+      }
+   }
+   // 商品代號字串.
+   outbuf.clear();
+   for (size_t L = 0; L < dirs.size(); ++L) {
+      dirs[L].KeyPos_ = pos + outbuf.size();
+      dirs[L].KeyLen_ = static_cast<uint32_t>(keys[L].size());
+      outbuf.append(keys[L].begin(), keys[L].end());
+   }
+   outbuf.append((8 - (outbuf.size() % 8)) % 8, '\0');
+   if (!(res = fd.Write(pos, ToStrView(outbuf))))
+      return res;
+   pos += outbuf.size();
+   // 商品目錄.
+   MdArcFileHeader hdr;
+   memset(&hdr, 0, sizeof(hdr));
+   memcpy(hdr.Magic_, kMdArcMagic, sizeof(hdr.Magic_));
+   hdr.Version_ = kMdArcVersion;
+   hdr.ByteOrderChk_ = kMdArcByteOrderChk;
+   hdr.SymbCount_ = static_cast<uint32_t>(dirs.size());
+   hdr.SymbDirPos_ = pos;
+   hdr.DailyClearTime_ = args.DailyClearTime_.GetOrigValue();
+   hdr.PriScale_ = Pri::Scale;
+   if (!dirs.empty()) {
+      if (!(res = fd.Write(pos, dirs.data(), dirs.size() * sizeof(MdArcSymbDir))))
+         return res;
+      pos += dirs.size() * sizeof(MdArcSymbDir);
+   }
+   if (!(res = fd.Write(0, &hdr, sizeof(hdr))))
+      return res;
+   bres.SymbCount_ = dirs.size();
+   if (result)
+      *result = bres;
+   return File::Result{pos};
+}
+
+//--------------------------------------------------------------------------//
+
+/// 整個歸檔檔案的內容: POSIX 使用 mmap(PROT_READ, MAP_SHARED); 其他系統則載入記憶體.
+struct MdRtsArchive::MapImpl {
+   fon9_NON_COPY_NON_MOVE(MapImpl);
+   MapImpl() = default;
+   const char* Ptr_{nullptr};
+   size_t      Size_{0};
+#ifdef fon9_POSIX
+   ~MapImpl() {
+      if (this->Ptr_)
+         munmap(const_cast<char*>(this->Ptr_), this->Size_);
+   }
+   File::Result Load(File& fd, size_t fsize) {
+      void* ptr = mmap(nullptr, fsize, PROT_READ, MAP_SHARED, fd.GetFD(), 0);
+      if (ptr == MAP_FAILED)
+         return File::Result{GetSysErrC()};
+      this->Ptr_ = static_cast<const char*>(ptr);
+      this->Size_ = fsize;
+      return File::Result{fsize};
+   }
+#else
+   std::string Buffer_;
+   File::Result Load(File& fd, size_t fsize) {
+      this->Buffer_.resize(fsize);
+      auto res = fd.Read(0, &*this->Buffer_.begin(), fsize);
+      if (res) {
+         this->Ptr_ = this->Buffer_.data();
+         this->Size_ = res.GetResult();
+      }
+      return res;
+   }
+#endif
+};
+
+MdRtsArchive::MdRtsArchive() {
+}
+MdRtsArchive::~MdRtsArchive() {
+}
+void MdRtsArchive::Close() {
+   this->Header_ = nullptr;
+   this->SymbDir_ = nullptr;
+   this->Map_.reset();
+}
+File::Result MdRtsArchive::Open(std::string fileName) {
+   this->Close();
+   File  fd;
+   auto  res = fd.Open(std::move(fileName), FileMode::Read);
+   if (!res)
+      return res;
+   if (!(res = fd.GetFileSize()))
+      return res;
+   const size_t fsize = static_cast<size_t>(res.GetResult());
+   if (fsize < sizeof(MdArcFileHeader))
+      return File::Result{std::errc::bad_message};
+   std::unique_ptr<MapImpl> map{new MapImpl};
+   if (!(res = map->Load(fd, fsize)))
+      return res;
+   const MdArcFileHeader* hdr = reinterpret_cast<const MdArcFileHeader*>(map->Ptr_);
+   if (memcmp(hdr->Magic_, kMdArcMagic, sizeof(kMdArcMagic)) != 0
+       || hdr->Version_ != kMdArcVersion
+       || hdr->ByteOrderChk_ != kMdArcByteOrderChk
+       || hdr->PriScale_ != Pri::Scale
+       || hdr->SymbDirPos_ > map->Size_
+       || (map->Size_ - hdr->SymbDirPos_) / sizeof(MdArcSymbDir) < hdr->SymbCount_)
+      return File::Result{std::errc::bad_message};
+   // 檢查每個商品的資料範圍, 之後存取時就不用再檢查.
+   const MdArcSymbDir* dirs = reinterpret_cast<const MdArcSymbDir*>(map->Ptr_ + hdr->SymbDirPos_);
+   for (uint32_t L = 0; L < hdr->SymbCount_; ++L) {
+      const MdArcSymbDir& dir = dirs[L];
+      if (dir.KeyPos_ > map->Size_ || map->Size_ - dir.KeyPos_ < dir.KeyLen_)
+         return File::Result{std::errc::bad_message};
+      for (const MdArcSeriesDir& ser : dir.Series_) {
+         if (ser.ColPos_ > map->Size_ || (map->Size_ - ser.ColPos_) / (sizeof(int64_t) * 3) < ser.RowCount_
+             || ser.SecIdxPos_ > map->Size_ || (map->Size_ - ser.SecIdxPos_) / sizeof(MdArcSecIdx) < ser.SecIdxCount_
+             || ser.ColPos_ % sizeof(int64_t) != 0 || ser.SecIdxPos_ % sizeof(uint32_t) != 0)
+            return File::Result{std::errc::bad_message};
+      }
+   }
+   this->Map_ = std::move(map);
+   this->Header_ = hdr;
+   this->SymbDir_ = dirs;
+   return File::Result{fsize};
+}
+StrView MdRtsArchive::GetSymbId(const MdArcSymbDir& symb) const {
+   assert(this->Map_);
+   return StrView{this->Map_->Ptr_ + symb.KeyPos_, symb.KeyLen_};
+}
+const MdArcSymbDir* MdRtsArchive::FindSymb(StrView symbid) const {
+   const MdArcSymbDir* const iend = this->SymbDir_ + this->SymbCount();
+   const MdArcSymbDir* ifind = std::lower_bound(this->SymbDir_, iend, symbid,
+      [this](const MdArcSymbDir& dir, StrView key) {
+         return this->GetSymbId(dir) < key;
+      });
+   if (ifind != iend && this->GetSymbId(*ifind) == symbid)
+      return ifind;
+   return nullptr;
+}
+MdArcSeriesView MdRtsArchive::GetSeries(const MdArcSymbDir& symb, MdArcSeries series) const {
+   assert(this->Map_ && static_cast<size_t>(series) < kMdArcSeriesCount);
+   const MdArcSeriesDir&   dir = symb.Series_[static_cast<size_t>(series)];
+   MdArcSeriesView         view;
+   view.RowCount_ = dir.RowCount_;
+   view.SecIdxCount_ = dir.SecIdxCount_;
+   view.Times_ = reinterpret_cast<const int64_t*>(this->Map_->Ptr_ + dir.ColPos_);
+   view.Pris_ = view.Times_ + dir.RowCount_;
+   view.Qtys_ = reinterpret_cast<const uint64_t*>(view.Pris_ + dir.RowCount_);
+   view.SecIdx_ = reinterpret_cast<const MdArcSecIdx*>(this->Map_->Ptr_ + dir.SecIdxPos_);
+   return view;
+}
+
+size_t MdArcSeriesView::LowerBound(DayTime arcTime) const {
+   const int32_t sec = static_cast<int32_t>(arcTime.GetIntPart());
+   const MdArcSecIdx* const iend = this->SecIdx_ + this->SecIdxCount_;
+   const MdArcSecIdx* ifind = std::lower_bound(this->SecIdx_, iend, sec,
+      [](const MdArcSecIdx& idx, int32_t key) {
+         return idx.Sec_ < key;
+      });
+   if (ifind == iend)
+      return this->RowCount_;
+   size_t idx = ifind->Row_;
+   const auto origTime = arcTime.GetOrigValue();
+   while (idx < this->RowCount_ && this->Times_[idx] < origTime)
+      ++idx;
+   return idx;
+}
+
+//--------------------------------------------------------------------------//
+
+fon9_WARN_DISABLE_PADDING;
+struct MdArcSymbSummary {
+   uint32_t DealCount_;
+   uint32_t BestBuyCount_;
+   uint32_t BestSellCount_;
+   DayTime  DealBegTime_;
+   DayTime  DealEndTime_;
+};
+fon9_WARN_POP;
+
+static seed::Fields MdArcRow_MakeFields() {
+   seed::Fields flds;
+   flds.Add(fon9_MakeField(MdArcRow, Pri_, "Pri"));
+   flds.Add(fon9_MakeField(MdArcRow, Qty_, "Qty"));
+   return flds;
+}
+static seed::LayoutSP MdArcSymbTree_MakeLayout() {
+   return new seed::LayoutN(seed::MakeField(Named{"Time"}, 0, *static_cast<const DayTime*>(nullptr)),
+                            seed::TabSP{new seed::Tab{Named{"Deal"}, MdArcRow_MakeFields()}},
+                            seed::TabSP{new seed::Tab{Named{"BestBuy"}, MdArcRow_MakeFields()}},
+                            seed::TabSP{new seed::Tab{Named{"BestSell"}, MdArcRow_MakeFields()}});
+}
+static seed::LayoutSP MdArcTree_MakeLayout() {
+   seed::Fields flds;
+   flds.Add(fon9_MakeField2(MdArcSymbSummary, DealCount));
+   flds.Add(fon9_MakeField2(MdArcSymbSummary, DealBegTime));
+   flds.Add(fon9_MakeField2(MdArcSymbSummary, DealEndTime));
+   flds.Add(fon9_MakeField2(MdArcSymbSummary, BestBuyCount));
+   flds.Add(fon9_MakeField2(MdArcSymbSummary, BestSellCount));
+   static seed::LayoutSP saplingLayout = MdArcSymbTree_MakeLayout();
+   return new seed::Layout1(seed::MakeField(Named{"SymbId"}, 0, *static_cast<const CharVector*>(nullptr)),
+                            seed::TabSP{new seed::Tab{Named{"Summary"}, std::move(flds), saplingLayout}});
+}
+
+/// 單一商品的歸檔資料, 每個 MdArcSeries 一個 Tab.
+class MdArcSymbTree : public seed::Tree {
+   fon9_NON_COPY_NON_MOVE(MdArcSymbTree);
+   using base = seed::Tree;
+public:
+   const MdRtsArchiveSP       Archive_;
+   const MdArcSymbDir* const  Symb_;
+
+   MdArcSymbTree(MdRtsArchiveSP archive, const MdArcSymbDir& symb, seed::LayoutSP layout)
+      : base{std::move(layout)}
+      , Archive_{std::move(archive)}
+      , Symb_{&symb} {
+   }
+   MdArcSeriesView GetSeries(const seed::Tab* tab) const {
+      const size_t tabidx = tab ? static_cast<size_t>(tab->GetIndex()) : 0u;
+      return this->Archive_->GetSeries(*this->Symb_, static_cast<MdArcSeries>(tabidx < kMdArcSeriesCount ? tabidx : 0u));
+   }
+   /// TextBegin() => 0; TextEnd() => RowCount_; 其餘為時間字串, 使用秒索引定位.
+   size_t GetRowIndex(const MdArcSeriesView& view, StrView strKeyText) const {
+      if (strKeyText.begin() == seed::kStrKeyText_Begin_)
+         return 0;
+      if (seed::IsTextEnd(strKeyText.begin()))
+         return view.RowCount_;
+      return view.LowerBound(this->Archive_->ToArcTime(StrTo(strKeyText, DayTime{})));
+   }
+   static void MakeRowView(const MdArcSeriesView& view, size_t idx, seed::Tab* tab, RevBuffer& rbuf) {
+      const MdArcRow row = view.GetRow(idx);
+      if (tab)
+         FieldsCellRevPrint(tab->Fields_, seed::SimpleRawRd{row}, rbuf, seed::GridViewResult::kCellSplitter);
+      RevPrint(rbuf, row.Time_);
+   }
+
+   struct PodOp : public seed::PodOpDefault {
+      fon9_NON_COPY_NON_MOVE(PodOp);
+      using base = seed::PodOpDefault;
+      const DayTime  KeyTime_;
+      PodOp(MdArcSymbTree& sender, StrView key, DayTime keyTime)
+         : base{sender, seed::OpResult::no_error, key}
+         , KeyTime_{keyTime} {
+      }
+      void BeginRead(seed::Tab& tab, seed::FnReadOp fnCallback) override {
+         const auto& tree = *static_cast<MdArcSymbTree*>(this->Sender_);
+         const auto  view = tree.GetSeries(&tab);
+         const auto  arcTime = tree.Archive_->ToArcTime(this->KeyTime_);
+         const auto  idx = view.LowerBound(arcTime);
+         if (idx >= view.RowCount_ || view.Times_[idx] != arcTime.GetOrigValue()) {
+            this->Tab_ = &tab;
+            this->OpResult_ = seed::OpResult::not_found_key;
+            fnCallback(*this, nullptr);
+            return;
+         }
+         MdArcRow row = view.GetRow(idx);
+         this->BeginRW(tab, std::move(fnCallback), seed::SimpleRawRd{row});
+      }
+   };
+   struct TreeOp : public seed::TreeOp {
+      fon9_NON_COPY_NON_MOVE(TreeOp);
+      using base = seed::TreeOp;
+      TreeOp(MdArcSymbTree& tree) : base(tree) {
+      }
+      void GridView(const seed::GridViewRequest& req, seed::FnGridViewOp fnCallback) override {
+         const auto&          tree = *static_cast<MdArcSymbTree*>(&this->Tree_);
+         const auto           view = tree.GetSeries(req.Tab_);
+         seed::GridViewResult res{this->Tree_, req.Tab_};
+         res.ContainerSize_ = view.RowCount_;
+         seed::MakeGridViewRange(tree.GetRowIndex(view, req.OrigKey_), size_t{0}, view.RowCount_, req, res,
+                                 [&view](size_t idx, seed::Tab* tab, RevBuffer& rbuf) {
+            MakeRowView(view, idx, tab, rbuf);
+         });
+         fnCallback(res);
+      }
+      void Get(StrView strKeyText, seed::FnPodOp fnCallback) override {
+         const DayTime keyTime = StrTo(strKeyText, DayTime::Null());
+         if (keyTime.IsNull()) {
+            fnCallback(seed::PodOpResult{this->Tree_, seed::OpResult::key_format_error, strKeyText}, nullptr);
+            return;
+         }
+         PodOp op{*static_cast<MdArcSymbTree*>(&this->Tree_), strKeyText, keyTime};
+         fnCallback(op, &op);
+      }
+   };
+   void OnTreeOp(seed::FnTreeOp fnCallback) override {
+      TreeOp op{*this};
+      fnCallback(seed::TreeOpResult{this, seed::OpResult::no_error}, &op);
+   }
+};
+
+/// 歸檔檔案的全部商品, Key = SymbId;
+class MdArcTree : public seed::Tree {
+   fon9_NON_COPY_NON_MOVE(MdArcTree);
+   using base = seed::Tree;
+public:
+   const MdRtsArchiveSP Archive_;
+
+   MdArcTree(MdRtsArchiveSP archive)
+      : base{MdArcTree_MakeLayout()}
+      , Archive_{std::move(archive)} {
+   }
+   MdArcSymbSummary MakeSummary(const MdArcSymbDir& symb) const {
+      MdArcSymbSummary res;
+      const auto deals = this->Archive_->GetSeries(symb, MdArcSeries::Deal);
+      res.DealCount_ = static_cast<uint32_t>(deals.RowCount_);
+      res.BestBuyCount_ = symb.Series_[cast_to_underlying(MdArcSeries::BestBuy)].RowCount_;
+      res.BestSellCount_ = symb.Series_[cast_to_underlying(MdArcSeries::BestSell)].RowCount_;
+      if (deals.RowCount_ > 0) {
+         res.DealBegTime_ = deals.GetTime(0);
+         res.DealEndTime_ = deals.GetTime(deals.RowCount_ - 1);
+      }
+      else {
+         res.DealBegTime_.AssignNull();
+         res.DealEndTime_.AssignNull();
+      }
+      return res;
+   }
+   size_t GetSymbIndex(StrView strKeyText) const {
+      const MdRtsArchive& arc = *this->Archive_;
+      if (strKeyText.begin() == seed::kStrKeyText_Begin_)
+         return 0;
+      if (seed::IsTextEnd(strKeyText.begin()))
+         return arc.SymbCount();
+      size_t lo = 0, hi = arc.SymbCount();
+      while (lo < hi) {
+         const size_t mid = (lo + hi) / 2;
+         if (arc.GetSymbId(*arc.GetSymb(mid)) < strKeyText)
+            lo = mid + 1;
+         else
+            hi = mid;
+      }
+      return lo;
+   }
+
+   struct PodOp : public seed::PodOpDefault {
+      fon9_NON_COPY_NON_MOVE(PodOp);
+      using base = seed::PodOpDefault;
+      const MdArcSymbDir&  Symb_;
+      PodOp(MdArcTree& sender, StrView key, const MdArcSymbDir& symb)
+         : base{sender, seed::OpResult::no_error, key}
+         , Symb_(symb) {
+      }
+      void BeginRead(seed::Tab& tab, seed::FnReadOp fnCallback) override {
+         MdArcSymbSummary summary = static_cast<MdArcTree*>(this->Sender_)->MakeSummary(this->Symb_);
+         this->BeginRW(tab, std::move(fnCallback), seed::SimpleRawRd{summary});
+      }
+      seed::TreeSP GetSapling(seed::Tab& tab) override {
+         return seed::TreeSP{new MdArcSymbTree{static_cast<MdArcTree*>(this->Sender_)->Archive_,
+                                               this->Symb_, tab.SaplingLayout_}};
+      }
+   };
+   struct TreeOp : public seed::TreeOp {
+      fon9_NON_COPY_NON_MOVE(TreeOp);
+      using base = seed::TreeOp;
+      TreeOp(MdArcTree& tree) : base(tree) {
+      }
+      void GridView(const seed::GridViewRequest& req, seed::FnGridViewOp fnCallback) override {
+         const auto&          tree = *static_cast<MdArcTree*>(&this->Tree_);
+         const MdRtsArchive&  arc = *tree.Archive_;
+         seed::GridViewResult res{this->Tree_, req.Tab_};
+         res.ContainerSize_ = arc.SymbCount();
+         seed::MakeGridViewRange(tree.GetSymbIndex(req.OrigKey_), size_t{0}, arc.SymbCount(), req, res,
+                                 [&tree, &arc](size_t idx, seed::Tab* tab, RevBuffer& rbuf) {
+            const MdArcSymbDir& symb = *arc.GetSymb(idx);
+            if (tab) {
+               MdArcSymbSummary summary = tree.MakeSummary(symb);
+               FieldsCellRevPrint(tab->Fields_, seed::SimpleRawRd{summary}, rbuf, seed::GridViewResult::kCellSplitter);
+            }
+            RevPrint(rbuf, arc.GetSymbId(symb));
+         });
+         fnCallback(res);
+      }
+      void Get(StrView strKeyText, seed::FnPodOp fnCallback) override {
+         auto& tree = *static_cast<MdArcTree*>(&this->Tree_);
+         if (const MdArcSymbDir* symb = (strKeyText.begin() == seed::kStrKeyText_Begin_
+                                         ? tree.Archive_->GetSymb(0)
+                                         : tree.Archive_->FindSymb(strKeyText))) {
+            PodOp op{tree, strKeyText, *symb};
+            fnCallback(op, &op);
+            return;
+         }
+         fnCallback(seed::PodOpResult{this->Tree_, seed::OpResult::not_found_key, strKeyText}, nullptr);
+      }
+   };
+   void OnTreeOp(seed::FnTreeOp fnCallback) override {
+      TreeOp op{*this};
+      fnCallback(seed::TreeOpResult{this, seed::OpResult::no_error}, &op);
+   }
+};
+
+fon9_API seed::TreeSP MakeMdRtsArchiveTree(MdRtsArchiveSP archive) {
+   return seed::TreeSP{new MdArcTree{std::move(archive)}};
+}
+
+} } // namespaces
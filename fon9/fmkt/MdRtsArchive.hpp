@@ -0,0 +1,187 @@
+﻿// \file fon9/fmkt/MdRtsArchive.hpp
+// \author fonwinz@gmail.com
+#ifndef __fon9_fmkt_MdRtsArchive_hpp__
+#define __fon9_fmkt_MdRtsArchive_hpp__
+#include "fon9/fmkt/FmdTypes.hpp"
+#include "fon9/fmkt/FmktTypes.hpp"
+#include "fon9/seed/Tree.hpp"
+#include "fon9/InnApf.hpp"
+
+namespace fon9 { namespace fmkt {
+
+/// \ingroup fmkt
+/// 歸檔的資料序列.
+enum class MdArcSeries : uint8_t {
+   /// f9sv_MdRtsKind_Deal: 成交明細(不含試撮).
+   Deal,
+   /// f9sv_MdRtsKind_BS: 最佳一檔買進價量, 有異動才記錄一筆.
+   BestBuy,
+   /// f9sv_MdRtsKind_BS: 最佳一檔賣出價量, 有異動才記錄一筆.
+   BestSell,
+   Count
+};
+constexpr size_t kMdArcSeriesCount = static_cast<size_t>(MdArcSeries::Count);
+
+struct MdArcRow {
+   DayTime  Time_;
+   Pri      Pri_;
+   Qty      Qty_;
+};
+
+//--------------------------------------------------------------------------//
+// 歸檔檔案格式, 全部使用 host byte order, 透過 MdArcFileHeader::ByteOrderChk_ 檢查.
+// - MdArcFileHeader
+// - 每個商品、每個序列: int64_t Time[RowCount], int64_t Pri[RowCount], uint64_t Qty[RowCount], MdArcSecIdx[SecIdxCount];
+// - 商品代號字串.
+// - MdArcSymbDir[SymbCount]: 依照 SymbId 排序.
+
+/// 秒索引: 每個不同的秒數一筆, Row_ 為該秒第一筆資料的位置.
+struct MdArcSecIdx {
+   int32_t  Sec_;
+   uint32_t Row_;
+};
+struct MdArcSeriesDir {
+   /// 三個欄位陣列的開始位置, 依序為: Time[RowCount_], Pri[RowCount_], Qty[RowCount_];
+   uint64_t ColPos_;
+   uint64_t SecIdxPos_;
+   uint32_t RowCount_;
+   uint32_t SecIdxCount_;
+};
+struct MdArcSymbDir {
+   uint64_t       KeyPos_;
+   uint32_t       KeyLen_;
+   uint32_t       Reserved_;
+   MdArcSeriesDir Series_[kMdArcSeriesCount];
+};
+struct MdArcFileHeader {
+   char     Magic_[8];
+   uint32_t Version_;
+   uint32_t ByteOrderChk_;
+   uint32_t SymbCount_;
+   uint32_t Reserved_;
+   uint64_t SymbDirPos_;
+   /// Time[] 存放的是 MdRtsArchive::ToArcTime() 之後的時間.
+   int64_t  DailyClearTime_;
+   /// Pri[] 的小數位數.
+   uint32_t PriScale_;
+   uint32_t Reserved2_;
+};
+
+//--------------------------------------------------------------------------//
+/// \ingroup fmkt
+/// 直接使用歸檔檔案(mmap)內容的序列, 不用解碼, 也不用複製.
+struct MdArcSeriesView {
+   const int64_t*       Times_{nullptr};
+   const int64_t*       Pris_{nullptr};
+   const uint64_t*      Qtys_{nullptr};
+   const MdArcSecIdx*   SecIdx_{nullptr};
+   size_t               RowCount_{0};
+   size_t               SecIdxCount_{0};
+
+   DayTime GetTime(size_t idx) const {
+      assert(idx < this->RowCount_);
+      return DayTime{TimeInterval::Make<TimeInterval::Scale>(this->Times_[idx])};
+   }
+   Pri GetPri(size_t idx) const {
+      assert(idx < this->RowCount_);
+      return Pri::Make<Pri::Scale>(this->Pris_[idx]);
+   }
+   Qty GetQty(size_t idx) const {
+      assert(idx < this->RowCount_);
+      return this->Qtys_[idx];
+   }
+   MdArcRow GetRow(size_t idx) const {
+      return MdArcRow{this->GetTime(idx), this->GetPri(idx), this->GetQty(idx)};
+   }
+   /// 傳回第一筆 Time >= arcTime 的位置, 若都比 arcTime 小, 則傳回 RowCount_;
+   /// - 先用秒索引找到該秒的第一筆, 再往後找, 不用掃描全部資料.
+   /// - arcTime 必須是 MdRtsArchive::ToArcTime() 之後的時間.
+   fon9_API size_t LowerBound(DayTime arcTime) const;
+};
+
+fon9_WARN_DISABLE_PADDING;
+/// \ingroup fmkt
+/// 盤後(或需要時)將 rti(MdRtStreamInnMgr 使用 InnApf 儲存的 MdRts 封包),
+/// 轉成「欄式(columnar)」的歸檔檔案, 之後可用 mmap 直接查詢, 不用再逐筆解碼 MdRts 封包.
+/// - 目前處理 f9sv_RtsPackType_DealPack, DealBS, SnapshotBS, UpdateBS;
+///   試撮(Calculated)的資料不列入歸檔.
+/// - 跨日(夜盤)時間: 小於 DailyClearTime 的時間 + 1 天, 讓每個序列的時間保持遞增.
+class fon9_API MdRtsArchive : public intrusive_ref_counter<MdRtsArchive> {
+   fon9_NON_COPY_NON_MOVE(MdRtsArchive);
+   struct MapImpl;
+   std::unique_ptr<MapImpl>   Map_;
+   const MdArcFileHeader*     Header_{nullptr};
+   const MdArcSymbDir*        SymbDir_{nullptr};
+
+public:
+   MdRtsArchive();
+   ~MdRtsArchive();
+
+   /// 開啟歸檔檔案, 若已開啟, 則先關閉.
+   /// - 若檔案格式不正確, 則傳回 std::errc::bad_message;
+   /// - 成功傳回檔案大小.
+   File::Result Open(std::string fileName);
+   void Close();
+
+   size_t SymbCount() const {
+      return this->Header_ ? this->Header_->SymbCount_ : 0u;
+   }
+   const MdArcSymbDir* GetSymb(size_t idx) const {
+      return idx < this->SymbCount() ? (this->SymbDir_ + idx) : nullptr;
+   }
+   /// 使用二元搜尋尋找商品, 找不到則傳回 nullptr;
+   const MdArcSymbDir* FindSymb(StrView symbid) const;
+   StrView GetSymbId(const MdArcSymbDir& symb) const;
+   MdArcSeriesView GetSeries(const MdArcSymbDir& symb, MdArcSeries series) const;
+
+   DayTime DailyClearTime() const {
+      return this->Header_ ? DayTime{TimeInterval::Make<TimeInterval::Scale>(this->Header_->DailyClearTime_)} : DayTime{};
+   }
+   /// 將 MdRts 的 InfoTime 轉成歸檔使用的時間: 若 tm < dailyClearTime 則 +1 天.
+   static DayTime ToArcTime(DayTime tm, DayTime dailyClearTime) {
+      return (tm < dailyClearTime) ? DayTime{tm + TimeInterval_Day(1)} : tm;
+   }
+   DayTime ToArcTime(DayTime tm) const {
+      return ToArcTime(tm, this->DailyClearTime());
+   }
+
+   struct BuildArgs {
+      /// 與建立 rti 時的 MdSymbsBase::CtrlFlags_ 相同, 用來判斷封包是否有 MarketSeq;
+      MdSymbsCtrlFlag   CtrlFlags_{};
+      DayTime           DailyClearTime_{};
+   };
+   struct BuildResult {
+      size_t   SymbCount_{0};
+      size_t   PacketCount_{0};
+      /// 無法解析的封包數量.
+      size_t   BadPacketCount_{0};
+      size_t   RowCount_[kMdArcSeriesCount];
+      BuildResult() {
+         memset(this->RowCount_, 0, sizeof(this->RowCount_));
+      }
+   };
+   /// 將 rti 的全部 streams 轉成歸檔檔案 outFileName;
+   /// - 若 outFileName 已存在, 則會覆蓋.
+   /// - rti 可以是正在寫入的檔案, 此時只會處理呼叫當下已寫入的資料.
+   /// - 失敗傳回錯誤碼, 成功傳回檔案大小.
+   static File::Result Build(InnApf& rti, std::string outFileName, const BuildArgs& args, BuildResult* result = nullptr);
+
+   /// 將一個 stream 儲存的內容(MdRtStream::Save() 的格式)解碼到 dst[];
+   /// - 傳回無法解析的封包數量.
+   /// - 提供給 Build() 及測試使用.
+   static size_t DecodeRtStream(StrView rtStream, const BuildArgs& args,
+                                std::vector<MdArcRow> (&dst)[kMdArcSeriesCount],
+                                size_t* packetCount = nullptr);
+};
+using MdRtsArchiveSP = intrusive_ptr<MdRtsArchive>;
+fon9_WARN_POP;
+
+/// \ingroup fmkt
+/// 提供歸檔檔案查詢的 seed tree.
+/// - Key = SymbId; 欄位: 各序列的筆數、開始時間、結束時間.
+/// - 每個商品的 sapling: 每個序列一個 Tab(Deal, BestBuy, BestSell), Key = Time;
+///   GridView 的 OrigKey_ 為開始時間(e.g. "10:00:00"), 透過秒索引定位, 用於區間查詢.
+fon9_API seed::TreeSP MakeMdRtsArchiveTree(MdRtsArchiveSP archive);
+
+} } // namespaces
+#endif//__fon9_fmkt_MdRtsArchive_hpp__
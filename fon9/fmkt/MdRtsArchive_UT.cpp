@@ -0,0 +1,797 @@
+﻿// \file fon9/fmkt/MdRtsArchive_UT.cpp
+//
+// 測試 MdRtsArchive:
+// - 模擬盤中 MdRtStream 儲存的 rti: DealPack, UpdateBS, 每秒一次 SnapshotBS, 其他種類的封包.
+// - 轉成歸檔檔案後, 檢查每個商品的 Deal, BestBuy, BestSell 序列是否正確.
+// - 比較「逐筆解碼 rti」與「直接使用歸檔檔案」的查詢效率.
+// - 測試 MdRtTimeIndex: 由 MdRtStream 儲存即時訊息, 訂閱時指定回補的開始時間,
+//   MdRtRecover 從索引點開始尋找, 回補的內容必須與「從頭尋找」相同.
+//   重新開啟 rti 之後, 從索引檔(.rti.idx)載入的索引點必須與儲存時相同.
+// - 測試回補沒有任何符合的訊息時, 訂閱者仍會收到 StreamRecoverEnd.
+//
+// >MdRtsArchive_UT [symbCount eventCountPerSymb]
+//
+// \author fonwinz@gmail.com
+#include "fon9/fmkt/MdRtsArchive.hpp"
+#include "fon9/fmkt/MdSymbs.hpp"
+#include "fon9/fmkt/MdSystem.hpp"
+#include "fon9/fmkt/SymbBSData.hpp"
+#include "fon9/seed/TreeOp.hpp"
+#include "fon9/seed/PodOp.hpp"
+#include "fon9/seed/FieldMaker.hpp"
+#include "fon9/buffer/RevBufferList.hpp"
+#include "fon9/BitvDecode.hpp"
+#include "fon9/TestTools.hpp"
+#include "fon9/CountDownLatch.hpp"
+#include "fon9/StrTo.hpp"
+#include <random>
+#include <thread>
+
+namespace f9fmkt = fon9::fmkt;
+static const char kRtiFileName[] = "MdRtsArchive_UT.rti";
+static const char kArcFileName[] = "MdRtsArchive_UT.mda";
+static const auto kCtrlFlags = f9fmkt::MdSymbsCtrlFlag::HasMarketDataSeq;
+
+using ArcRows = std::vector<f9fmkt::MdArcRow>[f9fmkt::kMdArcSeriesCount];
+
+//--------------------------------------------------------------------------//
+// 依照 MdRtStream::Publish(); MdRtStream::Save(); 的方式打包.
+struct SymbGen {
+   fon9_NON_COPY_NON_MOVE(SymbGen);
+   fon9::InnApf::StreamRW  Rw_;
+   fon9::InnApf::SizeT     StorageSize_{0};
+   fon9::DayTime           InfoTime_{fon9::DayTime::Null()};
+   f9sv_MdRtsKind          InfoTimeKind_{};
+   uint32_t                LastTimeSnapshotBS_{};
+   f9fmkt::SymbTwsBSData   BS_;
+   /// 歸檔時, 最後記錄的最佳一檔買賣價量, 初始為 Null, 所以第一次儲存 BS 時一定會記錄.
+   f9fmkt::PriQty          LastBest_[2];
+   std::mt19937            Rand_;
+   ArcRows                 Expected_;
+
+   SymbGen(unsigned seed) : Rand_{seed} {
+      LastBest_[0].Pri_.AssignNull();
+      LastBest_[1].Pri_.AssignNull();
+      BS_.Clear();
+      for (unsigned L = 0; L < f9fmkt::SymbBSData::kBSCount; ++L) {
+         BS_.Buys_[L].Pri_ = f9fmkt::Pri{100 - L, 0};
+         BS_.Buys_[L].Qty_ = 10 + L;
+         BS_.Sells_[L].Pri_ = f9fmkt::Pri{101 + L, 0};
+         BS_.Sells_[L].Qty_ = 20 + L;
+      }
+   }
+   unsigned Rand(unsigned n) {
+      return static_cast<unsigned>(this->Rand_() % n);
+   }
+   void Save(fon9::RevBufferList&& rts, f9sv_MdRtsKind pkKind) {
+      fon9::ByteArraySizeToBitvT(rts, fon9::CalcDataSize(rts.cfront()));
+      fon9::PutBigEndian(rts.AllocPacket<f9sv_MdRtsKind>(), pkKind);
+      fon9::PutBigEndian(rts.AllocPacket<f9fmkt::MdRtStreamInn_ChkValueType>(),
+                         static_cast<f9fmkt::MdRtStreamInn_ChkValueType>(this->StorageSize_));
+      this->StorageSize_ += fon9::CalcDataSize(rts.cfront());
+      this->Rw_.AppendBuffered(rts.MoveOut());
+   }
+   void PackInfoTime(fon9::RevBufferList& rts, f9sv_RtsPackType pkType, f9sv_MdRtsKind pkKind, fon9::DayTime infoTime) {
+      if (this->InfoTimeKind_ == pkKind && this->InfoTime_ == infoTime)
+         fon9::RevPutBitv(rts, fon9_BitvV_NumberNull);
+      else {
+         this->InfoTimeKind_ = pkKind;
+         this->InfoTime_ = infoTime;
+         fon9::ToBitv(rts, infoTime);
+      }
+      *rts.AllocPacket<uint8_t>() = fon9::cast_to_underlying(pkType);
+   }
+   void Publish(f9sv_RtsPackType pkType, f9sv_MdRtsKind pkKind, fon9::DayTime infoTime, fon9::RevBufferList&& rts) {
+      this->PackInfoTime(rts, pkType, pkKind, infoTime);
+      this->Save(std::move(rts), pkKind);
+   }
+   // -----
+   void GenDeal(fon9::DayTime tm) {
+      fon9::RevBufferList rts{128};
+      f9sv_DealFlag  flags = (this->Rand(20) == 0 ? f9sv_DealFlag_Calculated : f9sv_DealFlag{});
+      if (this->Rand(5) == 0) {
+         flags |= f9sv_DealFlag_DealSellCntChanged;
+         fon9::ToBitv(rts, this->Rand(1000));
+      }
+      if (this->Rand(5) == 0) {
+         flags |= f9sv_DealFlag_DealBuyCntChanged;
+         fon9::ToBitv(rts, this->Rand(1000));
+      }
+      fon9::DayTime dealTime = tm;
+      if (this->Rand(4) == 0) {
+         flags |= f9sv_DealFlag_DealTimeChanged;
+         dealTime = tm - fon9::TimeInterval_Millisecond(1);
+      }
+      const unsigned count = this->Rand(3) + 1;
+      f9fmkt::PriQty pqs[3];
+      for (unsigned L = 0; L < count; ++L) {
+         pqs[L].Pri_ = this->BS_.Buys_[0].Pri_ + f9fmkt::Pri{this->Rand(3), 1};
+         pqs[L].Qty_ = this->Rand(10) + 1;
+      }
+      for (unsigned L = count; L > 0;) {
+         --L;
+         fon9::ToBitv(rts, pqs[L].Qty_);
+         fon9::ToBitv(rts, pqs[L].Pri_);
+      }
+      *rts.AllocPacket<uint8_t>() = static_cast<uint8_t>(count - 1);
+      if (this->Rand(10) == 0) {
+         flags |= f9sv_DealFlag_LmtFlagsChanged;
+         *rts.AllocPacket<uint8_t>() = 0;
+      }
+      if (this->Rand(10) == 0) {
+         flags |= f9sv_DealFlag_TotalQtyLost;
+         fon9::ToBitv(rts, this->Rand(100000));
+      }
+      if (IsEnumContains(flags, f9sv_DealFlag_DealTimeChanged))
+         fon9::ToBitv(rts, dealTime);
+      *rts.AllocPacket<uint8_t>() = fon9::cast_to_underlying(flags);
+      f9fmkt::PackMktSeq(rts, kCtrlFlags, ++this->BS_.MarketSeq_);
+      this->Publish(f9sv_RtsPackType_DealPack, f9sv_MdRtsKind_Deal, tm, std::move(rts));
+      if (!IsEnumContains(flags, f9sv_DealFlag_Calculated)) {
+         for (unsigned L = 0; L < count; ++L)
+            this->Expected_[0].push_back(f9fmkt::MdArcRow{dealTime, pqs[L].Pri_, pqs[L].Qty_});
+      }
+   }
+   // -----
+   struct BSUpd {
+      uint8_t        BSType_;
+      f9fmkt::PriQty PQ_;
+   };
+   void ApplyUpd(const BSUpd& upd) {
+      f9fmkt::PriQty* pqs = ((upd.BSType_ & fon9::cast_to_underlying(f9fmkt::RtBSType::Mask))
+                             == fon9::cast_to_underlying(f9fmkt::RtBSType::OrderBuy) ? this->BS_.Buys_ : this->BS_.Sells_);
+      const unsigned lv = (upd.BSType_ & 0x0fu);
+      const unsigned last = f9fmkt::SymbBSData::kBSCount - 1;
+      switch (static_cast<f9fmkt::RtBSAction>(upd.BSType_ & fon9::cast_to_underlying(f9fmkt::RtBSAction::Mask))) {
+      case f9fmkt::RtBSAction::New:
+         std::copy_backward(pqs + lv, pqs + last, pqs + last + 1);
+         pqs[lv] = upd.PQ_;
+         break;
+      case f9fmkt::RtBSAction::ChangePQ:
+         pqs[lv] = upd.PQ_;
+         break;
+      case f9fmkt::RtBSAction::ChangeQty:
+         pqs[lv].Qty_ = upd.PQ_.Qty_;
+         break;
+      case f9fmkt::RtBSAction::Delete:
+         std::copy(pqs + lv + 1, pqs + last + 1, pqs + lv);
+         pqs[last] = f9fmkt::PriQty{};
+         break;
+      }
+   }
+   void GenUpdateBS(fon9::DayTime tm) {
+      const bool     isBuy = (this->Rand(2) == 0);
+      const uint8_t  side = fon9::cast_to_underlying(isBuy ? f9fmkt::RtBSType::OrderBuy : f9fmkt::RtBSType::OrderSell);
+      f9fmkt::PriQty* pqs = (isBuy ? this->BS_.Buys_ : this->BS_.Sells_);
+      BSUpd          upds[2];
+      unsigned       count = 1;
+      switch (this->Rand(4)) {
+      case 0: // ChangeQty: 任意一檔.
+         upds[0].BSType_ = static_cast<uint8_t>(side | fon9::cast_to_underlying(f9fmkt::RtBSAction::ChangeQty) | this->Rand(5));
+         upds[0].PQ_.Qty_ = this->Rand(50) + 1;
+         break;
+      case 1: // ChangePQ: 第1檔.
+         upds[0].BSType_ = static_cast<uint8_t>(side | fon9::cast_to_underlying(f9fmkt::RtBSAction::ChangePQ));
+         upds[0].PQ_.Pri_ = pqs[0].Pri_;
+         upds[0].PQ_.Qty_ = this->Rand(50) + 1;
+         break;
+      case 2: // New: 第1檔插入新價格, 最後一檔被擠掉.
+         upds[0].BSType_ = static_cast<uint8_t>(side | fon9::cast_to_underlying(f9fmkt::RtBSAction::New));
+         upds[0].PQ_.Pri_ = pqs[0].Pri_ + f9fmkt::Pri{isBuy ? 1 : -1, 2};
+         upds[0].PQ_.Qty_ = this->Rand(50) + 1;
+         break;
+      default: // Delete 第1檔, 並補上最後一檔.
+         upds[0].BSType_ = static_cast<uint8_t>(side | fon9::cast_to_underlying(f9fmkt::RtBSAction::Delete));
+         upds[1].BSType_ = static_cast<uint8_t>(side | fon9::cast_to_underlying(f9fmkt::RtBSAction::New) | 4);
+         upds[1].PQ_.Pri_ = pqs[4].Pri_ + f9fmkt::Pri{isBuy ? -1 : 1, 2};
+         upds[1].PQ_.Qty_ = this->Rand(50) + 1;
+         count = 2;
+         break;
+      }
+      for (unsigned L = 0; L < count; ++L)
+         this->ApplyUpd(upds[L]);
+      this->BS_.InfoTime_ = tm;
+      ++this->BS_.MarketSeq_;
+
+      fon9::RevBufferList rts{128};
+      for (unsigned L = count; L > 0;) {
+         const BSUpd& upd = upds[--L];
+         const auto   act = static_cast<f9fmkt::RtBSAction>(upd.BSType_ & fon9::cast_to_underlying(f9fmkt::RtBSAction::Mask));
+         if (act != f9fmkt::RtBSAction::Delete)
+            fon9::ToBitv(rts, upd.PQ_.Qty_);
+         if (act == f9fmkt::RtBSAction::New || act == f9fmkt::RtBSAction::ChangePQ)
+            fon9::ToBitv(rts, upd.PQ_.Pri_);
+         *rts.AllocPacket<uint8_t>() = upd.BSType_;
+      }
+      *rts.AllocPacket<uint8_t>() = static_cast<uint8_t>(count - 1);
+      // 與 MdRtStream::PublishUpdateBS() 相同: 每秒的第一個異動改存 SnapshotBS;
+      f9fmkt::PackMktSeq(rts, kCtrlFlags, this->BS_.MarketSeq_);
+      this->PackInfoTime(rts, f9sv_RtsPackType_UpdateBS, f9sv_MdRtsKind_BS, tm);
+      const auto bstm = static_cast<uint32_t>(tm.GetIntPart());
+      if (this->LastTimeSnapshotBS_ != bstm) {
+         this->LastTimeSnapshotBS_ = bstm;
+         rts.MoveOut();
+         this->BS_.Flags_ = f9sv_BSFlag_OrderBuy | f9sv_BSFlag_OrderSell;
+         f9fmkt::MdRtsPackSnapshotBS(rts, this->BS_);
+         f9fmkt::PackMktSeq(rts, kCtrlFlags, this->BS_.MarketSeq_);
+         fon9::ToBitv(rts, tm);
+         *rts.AllocPacket<uint8_t>() = fon9::cast_to_underlying(f9sv_RtsPackType_SnapshotBS);
+      }
+      this->Save(std::move(rts), f9sv_MdRtsKind_BS);
+
+      const f9fmkt::PriQty afBest[2] = {this->BS_.Buys_[0], this->BS_.Sells_[0]};
+      for (unsigned L = 0; L < 2; ++L) {
+         if (this->LastBest_[L].Pri_ != afBest[L].Pri_ || this->LastBest_[L].Qty_ != afBest[L].Qty_) {
+            this->LastBest_[L] = afBest[L];
+            this->Expected_[1 + L].push_back(f9fmkt::MdArcRow{tm, afBest[L].Pri_, afBest[L].Qty_});
+         }
+      }
+   }
+   void GenOther(fon9::DayTime tm) {
+      // 不會被歸檔的封包: 必須能正確跳過.
+      fon9::RevBufferList rts{128};
+      fon9::ToBitv(rts, f9fmkt::Pri{123, 1});
+      fon9::ToBitv(rts, f9fmkt::Pri{456, 1});
+      this->Publish(f9sv_RtsPackType_PriLmts, f9sv_MdRtsKind_Ref, tm, std::move(rts));
+   }
+};
+
+//--------------------------------------------------------------------------//
+static void CheckRows(const char* symbid, const char* name, const f9fmkt::MdArcSeriesView& view,
+                      const std::vector<f9fmkt::MdArcRow>& expected) {
+   if (view.RowCount_ != expected.size()) {
+      std::cout << "|symb=" << symbid << "|series=" << name
+         << "|rows=" << view.RowCount_ << "|expected=" << expected.size() << "\r[ERROR]" << std::endl;
+      abort();
+   }
+   for (size_t L = 0; L < view.RowCount_; ++L) {
+      const auto row = view.GetRow(L);
+      if (row.Time_ != expected[L].Time_ || row.Pri_ != expected[L].Pri_ || row.Qty_ != expected[L].Qty_) {
+         std::cout << "|symb=" << symbid << "|series=" << name << "|row=" << L << "\r[ERROR]" << std::endl;
+         abort();
+      }
+   }
+}
+
+// 依照 MdRtRecover::OnTimer() 的規則, 從 rtStream 的開頭尋找 InfoTime >= startTime 的封包,
+// 傳回從該封包開始到結尾, 應回補的內容(不含 ChkHeader).
+static std::string RecoverScan(const std::string& rtStream, fon9::DayTime startTime) {
+   constexpr auto kChkHeaderSize = sizeof(f9fmkt::MdRtStreamInn_ChkValueType) + sizeof(f9sv_MdRtsKind);
+   std::string    res;
+   fon9::DayTime  lastInfoTime = fon9::DayTime::Null();
+   bool           isStarted = false;
+   size_t         pos = 0;
+   while (pos + kChkHeaderSize < rtStream.size()) {
+      const char* pchk = rtStream.c_str() + pos;
+      if (fon9::GetBigEndian<f9fmkt::MdRtStreamInn_ChkValueType>(pchk) != pos) {
+         std::cout << "|pos=" << pos << "|err=Bad ChkValue\r[ERROR]" << std::endl;
+         abort();
+      }
+      const auto              pkKind = fon9::GetBigEndian<f9sv_MdRtsKind>(pchk + sizeof(f9fmkt::MdRtStreamInn_ChkValueType));
+      fon9::DcQueueFixedMem   dcq{pchk + kChkHeaderSize, rtStream.c_str() + rtStream.size()};
+      size_t                  pksz = 0;
+      fon9::PopBitvByteArraySize(dcq, pksz);
+      if (!IsEnumContains(pkKind, f9sv_MdRtsKind_NoInfoTime)) {
+         fon9::DcQueueFixedMem pk{dcq.Peek1() + sizeof(f9sv_RtsPackType), pksz - sizeof(f9sv_RtsPackType)};
+         fon9::BitvTo(pk, lastInfoTime);
+      }
+      if (!isStarted && !lastInfoTime.IsNull() && lastInfoTime >= startTime)
+         isStarted = true;
+      const char* pend = reinterpret_cast<const char*>(dcq.Peek1()) + pksz;
+      if (isStarted)
+         res.append(pchk + kChkHeaderSize, pend);
+      pos = static_cast<size_t>(pend - rtStream.c_str());
+   }
+   return res;
+}
+
+// 使用 MdSymbsT<> 及 MdRtStream 儲存即時訊息: 在 MdRtStream 儲存時建立 MdRtTimeIndex;
+// 然後透過 SubscribeStream() 指定回補的開始時間: MdRtRecover 從 MdRtTimeIndex 找到的 StartPos_ 開始尋找.
+// 重新開啟 rti 之後, 從索引檔(.rti.idx)載入的 MdRtTimeIndex 必須與儲存時相同.
+// 最後換日, 測試 DailyClear() 將前一日的 rti 轉成歸檔.
+static const char     kRecoverRtiPathFmt[] = "MdRtsArchive_UT_Recover_{0:f}";
+static const char     kRecoverRtiPath[] = "MdRtsArchive_UT_Recover_";
+static const unsigned kRecoverTDay = 20240102;
+
+class TestMdSymb : public f9fmkt::Symb {
+   fon9_NON_COPY_NON_MOVE(TestMdSymb);
+   using base = f9fmkt::Symb;
+public:
+   f9fmkt::SymbTwsBSData   BS_;
+   f9fmkt::MdRtStream      MdRtStream_;
+
+   TestMdSymb(const fon9::StrView& symbid, f9fmkt::MdRtStreamInnMgr& innMgr)
+      : base{symbid}
+      , MdRtStream_{innMgr} {
+      this->TDayYYYYMMDD_ = innMgr.TDayYYYYMMDD();
+      this->MdRtStream_.OpenRtStorage(*this);
+      this->BS_.Clear();
+   }
+   f9fmkt::SymbData* GetSymbData(int tabid) override {
+      if (tabid == 1)
+         return &this->MdRtStream_;
+      return base::GetSymbData(tabid);
+   }
+   f9fmkt::SymbData* FetchSymbData(int tabid) override {
+      return this->GetSymbData(tabid);
+   }
+   static fon9::seed::LayoutSP MakeLayout() {
+      using namespace fon9::seed;
+      constexpr auto kTabFlag = TabFlag::NoSapling_NoSeedCommand_Writable;
+      return LayoutSP{new LayoutN(
+         fon9_MakeField(f9fmkt::Symb, SymbId_, "Id"), TreeFlag::AddableRemovable | TreeFlag::Unordered,
+         TabSP{new Tab{fon9::Named{fon9_kCSTR_TabName_Base}, f9fmkt::Symb::MakeFields(),       kTabFlag}},
+         TabSP{new Tab{fon9::Named{fon9_kCSTR_TabName_Rt},   f9fmkt::MdRtStream::MakeFields(), kTabFlag}}
+      )};
+   }
+};
+class TestMdSymbs : public f9fmkt::MdSymbsT<TestMdSymb> {
+   fon9_NON_COPY_NON_MOVE(TestMdSymbs);
+   using base = f9fmkt::MdSymbsT<TestMdSymb>;
+public:
+   TestMdSymbs() : base(TestMdSymb::MakeLayout(), kRecoverRtiPathFmt, kCtrlFlags) {
+   }
+   f9fmkt::SymbSP MakeSymb(const fon9::StrView& symbid) override {
+      return new TestMdSymb(symbid, this->RtInnMgr_);
+   }
+};
+
+static void TestRecoverTimeIndex(const fon9::InnStream::OpenArgs& sargs) {
+   const unsigned kSymbCount = 10;
+   const unsigned kEventCount = 20000;
+   // 最後封包的時間約為 13:29:58.38;
+   static const char* const kStartTimes[] = {"09:00:00", "10:00:00", "11:30:00.5", "13:00:00", "13:29:58"};
+   constexpr size_t kStartTimeCount = fon9::numofele(kStartTimes);
+   const std::string rtiPath = kRecoverRtiPath + std::to_string(kRecoverTDay);
+   const std::string rtiFileName = rtiPath + ".rti";
+   const std::string arcFileName = rtiPath + ".mda";
+   const std::string rtiFileNameNext = kRecoverRtiPath + std::to_string(kRecoverTDay + 1) + ".rti";
+   const std::string idxFileName = rtiFileName + ".idx";
+   const std::string idxFileNameNext = rtiFileNameNext + ".idx";
+   remove(rtiFileName.c_str());
+   remove(arcFileName.c_str());
+   remove(rtiFileNameNext.c_str());
+   remove(idxFileName.c_str());
+   remove(idxFileNameNext.c_str());
+
+   std::vector<std::string> symbids;
+   std::vector<std::string> recovered[kStartTimeCount];
+   // 每個商品的: 索引點數量, 及每個 kStartTimes 從索引取得的開始位置.
+   using IndexResult = std::vector<size_t>;
+   std::vector<IndexResult> indexResults(kSymbCount);
+   const auto getIndexResult = [](const f9fmkt::MdRtStream& rts) {
+      IndexResult res{rts.RtTimeIndex().size()};
+      for (const char* tm : kStartTimes)
+         res.push_back(rts.RtTimeIndex().FindStartPos(fon9::StrTo(fon9::StrView_cstr(tm), fon9::DayTime::Null()),
+                                                      rts.InnMgr_.DailyClearTime()));
+      return res;
+   };
+   for (unsigned L = 0; L < kSymbCount; ++L)
+      symbids.push_back(fon9::RevPrintTo<std::string>("R", 10000 + L));
+   fon9::intrusive_ptr<TestMdSymbs> mdSymbs{new TestMdSymbs};
+   mdSymbs->DailyClear(kRecoverTDay);
+   {
+      std::cout << "[TEST ] MdRtStream save:";
+      fon9::StopWatch   stopWatch;
+      std::mt19937      rnd;
+      auto              symbsLk = mdSymbs->SymbMap_.Lock();
+      std::vector<TestMdSymb*> symbs;
+      for (const auto& symbid : symbids)
+         symbs.push_back(static_cast<TestMdSymb*>(mdSymbs->FetchSymb(symbsLk, &symbid).get()));
+      // 09:00:00 .. 13:30:00 平均分配, 每個時間有 2 個事件, 測試 InfoTime 為 Null 的情況.
+      const fon9::DayTime tmBeg = fon9::TimeInterval_HHMMSS(90000);
+      const int64_t       usSpan = (fon9::TimeInterval_HHMMSS(133000) - tmBeg).GetOrigValue();
+      for (unsigned LEv = 0; LEv < kEventCount; ++LEv) {
+         const fon9::DayTime tm = tmBeg + fon9::TimeInterval_Microsecond(usSpan * (LEv / 2) / (kEventCount / 2));
+         for (TestMdSymb* symb : symbs) {
+            fon9::RevBufferList rts{128};
+            if (rnd() % 4 == 0) {
+               fon9::ToBitv(rts, f9fmkt::Pri{123, 1});
+               fon9::ToBitv(rts, f9fmkt::Pri{456, 1});
+               symb->MdRtStream_.Publish(ToStrView(symb->SymbId_), f9sv_RtsPackType_PriLmts, f9sv_MdRtsKind_Ref, tm, std::move(rts));
+            }
+            else { // 異動第1檔買進數量.
+               symb->BS_.Buys_[0].Qty_ = rnd() % 50 + 1;
+               symb->BS_.InfoTime_ = tm;
+               ++symb->BS_.MarketSeq_;
+               fon9::ToBitv(rts, symb->BS_.Buys_[0].Qty_);
+               *rts.AllocPacket<uint8_t>() = static_cast<uint8_t>(fon9::cast_to_underlying(f9fmkt::RtBSType::OrderBuy)
+                                                                  | fon9::cast_to_underlying(f9fmkt::RtBSAction::ChangeQty));
+               *rts.AllocPacket<uint8_t>() = 0; // count - 1;
+               symb->MdRtStream_.PublishUpdateBS(ToStrView(symb->SymbId_), symb->BS_, std::move(rts), kCtrlFlags);
+            }
+         }
+      }
+      std::cout << fon9::AutoTimeUnit{stopWatch.StopTimer()} << "\r[OK   ]" << std::endl;
+   }
+   for (size_t LTm = 0; LTm < kStartTimeCount; ++LTm) {
+      std::cout << "[TEST ] Recover from " << kStartTimes[LTm] << ":";
+      fon9::StopWatch         stopWatch;
+      std::vector<std::string>& res = recovered[LTm];
+      std::vector<fon9::SubConn> subConns(kSymbCount);
+      fon9::CountDownLatch    waiter{kSymbCount};
+      const std::string       args = std::string{"MdRts::,"} + kStartTimes[LTm];
+      res.resize(kSymbCount);
+      for (unsigned L = 0; L < kSymbCount; ++L) {
+         std::string* pres = &res[L];
+         auto symbsLk = mdSymbs->SymbMap_.Lock();
+         TestMdSymbs::MdSymOp op(*mdSymbs, &symbids[L], mdSymbs->GetSymb(symbsLk, &symbids[L]), symbsLk);
+         op.SubscribeStream(&subConns[L], *mdSymbs->RtTab_, &args,
+                            [pres, &waiter](const fon9::seed::SeedNotifyArgs& e) {
+            switch (e.NotifyKind_) {
+            case fon9::seed::SeedNotifyKind::StreamRecover:
+               pres->append(e.GetGridView());
+               break;
+            case fon9::seed::SeedNotifyKind::StreamRecoverEnd:
+               pres->append(e.GetGridView());
+               waiter.CountDown();
+               break;
+            default:
+               break;
+            }
+         });
+      }
+      waiter.Wait();
+      const double span = stopWatch.StopTimer();
+      size_t       bytes = 0;
+      auto         symbsLk = mdSymbs->SymbMap_.Lock();
+      for (unsigned L = 0; L < kSymbCount; ++L) {
+         bytes += res[L].size();
+         auto symb = mdSymbs->GetSymb(symbsLk, &symbids[L]);
+         static_cast<TestMdSymb*>(symb.get())->MdRtStream_.UnsubscribeStream(symbsLk, &subConns[L]);
+      }
+      std::cout << fon9::AutoTimeUnit{span} << "|bytes=" << bytes << "\r[OK   ]" << std::endl;
+   }
+   {  // 沒有任何符合的回補訊息(開始時間在最後封包之後): 仍必須收到 StreamRecoverEnd,
+      // 訂閱者才能知道回補已結束; 此時 StreamDataKind_ == 0, 不可被 MdRtSubr::RtFilter_ 過濾掉.
+      std::cout << "[TEST ] Recover nothing:";
+      const std::string    args = "MdRts::,23:00:00";
+      fon9::SubConn        subConn{};
+      std::atomic<int>     endCount{0};
+      std::string          gv;
+      {
+         auto symbsLk = mdSymbs->SymbMap_.Lock();
+         TestMdSymbs::MdSymOp op(*mdSymbs, &symbids[0], mdSymbs->GetSymb(symbsLk, &symbids[0]), symbsLk);
+         op.SubscribeStream(&subConn, *mdSymbs->RtTab_, &args,
+                            [&endCount, &gv](const fon9::seed::SeedNotifyArgs& e) {
+            if (e.NotifyKind_ == fon9::seed::SeedNotifyKind::StreamRecoverEnd) {
+               gv = e.GetGridView();
+               ++endCount;
+            }
+         });
+      }
+      for (unsigned L = 0; L < 500 && endCount == 0; ++L)
+         std::this_thread::sleep_for(std::chrono::milliseconds{10});
+      auto symbsLk = mdSymbs->SymbMap_.Lock();
+      auto symb = mdSymbs->GetSymb(symbsLk, &symbids[0]);
+      static_cast<TestMdSymb*>(symb.get())->MdRtStream_.UnsubscribeStream(symbsLk, &subConn);
+      if (endCount != 1 || !gv.empty()) {
+         std::cout << "|endCount=" << endCount << "|bytes=" << gv.size() << "\r[ERROR]" << std::endl;
+         abort();
+      }
+      std::cout << "\r[OK   ]" << std::endl;
+   }
+   {
+      auto symbsLk = mdSymbs->SymbMap_.Lock();
+      for (unsigned L = 0; L < kSymbCount; ++L) {
+         auto symb = mdSymbs->GetSymb(symbsLk, &symbids[L]);
+         indexResults[L] = getIndexResult(static_cast<TestMdSymb*>(symb.get())->MdRtStream_);
+      }
+   }
+   mdSymbs.reset();
+   // 重新開啟 rti 之後換日: DailyClear() 之後, 在 DefaultThreadPool 將前一日的 rti 轉成歸檔, 並掛到 MdSystem.
+   // 不可在原本的 mdSymbs 換日: 商品換日時會在前一日的 rti 寫入 TradingSessionId, 使回補內容與 rti 不同.
+   std::cout << "[TEST ] DailyClear archive:";
+   f9fmkt::MdSystemSP mdsys{new f9fmkt::MdSystem{nullptr, "MdSys"}};
+   mdSymbs.reset(new TestMdSymbs);
+   mdsys->Sapling_->AddNamedSapling(mdSymbs, "Symbs");
+   std::string errmsg = mdsys->SetRtiConfig("Archive=Y|MapExtentMB=1");
+   if (!errmsg.empty() || mdSymbs->RtInnMgr_.GetRtiMapExtentSize() != 1024 * 1024) {
+      std::cout << "|SetRtiConfig=" << errmsg << "\r[ERROR]" << std::endl;
+      abort();
+   }
+   mdSymbs->DailyClear(kRecoverTDay);
+   mdSymbs->DailyClear(kRecoverTDay + 1);
+   for (unsigned L = 0; L < 1000 && !mdsys->Sapling_->Get("SymbsArc"); ++L)
+      std::this_thread::sleep_for(std::chrono::milliseconds{10});
+   const bool isMounted = (mdsys->Sapling_->Get("SymbsArc").get() != nullptr);
+   // 解除 MdSymbs 對 MdSystem 的參考.
+   mdsys->SetRtiConfig("Archive=N");
+   mdsys.reset();
+   mdSymbs.reset();
+   f9fmkt::MdRtsArchiveSP arc{new f9fmkt::MdRtsArchive};
+   if (!isMounted || !arc->Open(arcFileName) || arc->SymbCount() != kSymbCount) {
+      std::cout << "|mounted=" << isMounted << "|symbs=" << arc->SymbCount() << "\r[ERROR]" << std::endl;
+      abort();
+   }
+   std::cout << "\r[OK   ]" << std::endl;
+   // 關閉 rti 之後, 從頭尋找, 取得預期的回補內容.
+   std::cout << "[TEST ] Check recovered:";
+   fon9::InnApf::OpenArgs  oargs{rtiFileName, 64, fon9::FileMode::Read};
+   fon9::InnApf::OpenResult ores;
+   fon9::InnApfSP          apf = fon9::InnApf::Make(oargs, sargs, ores);
+   if (!apf) {
+      std::cout << "|err=" << fon9::RevPrintTo<std::string>(ores) << "\r[ERROR]" << std::endl;
+      abort();
+   }
+   f9fmkt::MdRtsArchive::BuildArgs bargs;
+   bargs.CtrlFlags_ = kCtrlFlags;
+   bargs.DailyClearTime_ = arc->DailyClearTime();
+   std::string rtStream;
+   size_t      rtiBytes = 0;
+   for (unsigned L = 0; L < kSymbCount; ++L) {
+      fon9::InnApf::StreamRW rw;
+      rw.Open(*apf, &symbids[L], fon9::FileMode::Read);
+      rtStream.resize(static_cast<size_t>(rw.Size()));
+      rw.Read(0, &*rtStream.begin(), rtStream.size());
+      rtiBytes += rtStream.size();
+      // DailyClear() 轉出的歸檔, 必須與直接解碼 rti 的結果相同.
+      ArcRows rows;
+      f9fmkt::MdRtsArchive::DecodeRtStream(fon9::ToStrView(rtStream), bargs, rows);
+      for (size_t LSer = 0; LSer < f9fmkt::kMdArcSeriesCount; ++LSer)
+         CheckRows(symbids[L].c_str(), "Archive", arc->GetSeries(*arc->FindSymb(&symbids[L]), static_cast<f9fmkt::MdArcSeries>(LSer)), rows[LSer]);
+      for (size_t LTm = 0; LTm < kStartTimeCount; ++LTm) {
+         const std::string expected = RecoverScan(rtStream, fon9::StrTo(fon9::StrView_cstr(kStartTimes[LTm]), fon9::DayTime::Null()));
+         if (recovered[LTm][L] != expected || expected.empty()) {
+            std::cout << "|symb=" << symbids[L] << "|from=" << kStartTimes[LTm]
+               << "|recovered=" << recovered[LTm][L].size() << "|expected=" << expected.size() << "\r[ERROR]" << std::endl;
+            abort();
+         }
+      }
+   }
+   std::cout << "|rtiBytes=" << rtiBytes << "\r[OK   ]" << std::endl;
+   apf.reset();
+   arc.reset();
+   // 重新開啟 rti 之後, 從 .rti.idx 載入索引點, 必須與儲存時相同.
+   // 因為建立商品時會在 rti 寫入 TradingSessionId, 所以在檢查回補內容之後才測試.
+   std::cout << "[TEST ] Reload .rti.idx:";
+   mdSymbs.reset(new TestMdSymbs);
+   mdSymbs->DailyClear(kRecoverTDay);
+   {
+      auto symbsLk = mdSymbs->SymbMap_.Lock();
+      for (unsigned L = 0; L < kSymbCount; ++L) {
+         auto symb = mdSymbs->FetchSymb(symbsLk, &symbids[L]);
+         const IndexResult res = getIndexResult(static_cast<TestMdSymb*>(symb.get())->MdRtStream_);
+         if (res != indexResults[L] || res[0] == 0 || res.back() == 0) {
+            std::cout << "|symb=" << symbids[L] << "|items=" << res[0] << "|expected=" << indexResults[L][0]
+                      << "\r[ERROR]" << std::endl;
+            abort();
+         }
+      }
+   }
+   mdSymbs.reset();
+   std::cout << "\r[OK   ]" << std::endl;
+   remove(rtiFileName.c_str());
+   remove(arcFileName.c_str());
+   remove(rtiFileNameNext.c_str());
+   remove(idxFileName.c_str());
+   remove(idxFileNameNext.c_str());
+}
+
+static void TestArchiveTree(f9fmkt::MdRtsArchiveSP arc, const std::string& symbid, const ArcRows& expected) {
+   std::cout << "[TEST ] SeedTree:";
+   fon9::seed::TreeSP root = f9fmkt::MakeMdRtsArchiveTree(arc);
+   fon9::seed::TreeSP sapling;
+   root->OnTreeOp([&](const fon9::seed::TreeOpResult&, fon9::seed::TreeOp* op) {
+      op->Get(&symbid, [&](const fon9::seed::PodOpResult& res, fon9::seed::PodOp* pod) {
+         if (pod)
+            sapling = pod->GetSapling(*res.Sender_->LayoutSP_->GetTab(0));
+      });
+   });
+   if (!sapling) {
+      std::cout << "|err=Not found sapling\r[ERROR]" << std::endl;
+      abort();
+   }
+   // 查詢 10:00:00 之後的 5 筆成交.
+   const fon9::DayTime  tmStart = fon9::TimeInterval_HHMMSS(100000);
+   const auto&          deals = expected[0];
+   const auto           iexp = std::find_if(deals.begin(), deals.end(),
+                                            [tmStart](const f9fmkt::MdArcRow& r) { return r.Time_ >= tmStart; });
+   std::string          gv;
+   uint16_t             rowCount = 0;
+   sapling->OnTreeOp([&](const fon9::seed::TreeOpResult&, fon9::seed::TreeOp* op) {
+      fon9::seed::GridViewRequest req{"10:00:00"};
+      req.Tab_ = sapling->LayoutSP_->GetTab(0);
+      req.MaxRowCount_ = 5;
+      op->GridView(req, [&](fon9::seed::GridViewResult& res) {
+         gv = res.GridView_;
+         rowCount = res.RowCount_;
+      });
+   });
+   const size_t expCount = std::min(static_cast<size_t>(deals.end() - iexp), size_t{5});
+   if (rowCount != expCount) {
+      std::cout << "|rows=" << rowCount << "|expected=" << expCount << "\r[ERROR]" << std::endl;
+      abort();
+   }
+   if (expCount > 0) {
+      const fon9::DayTime gvTime = fon9::StrTo(fon9::StrView{&gv}, fon9::DayTime::Null());
+      if (gvTime != iexp->Time_) {
+         std::cout << "|gv=" << gv << "\r[ERROR]" << std::endl;
+         abort();
+      }
+   }
+   std::cout << "|rows=" << rowCount << "\r[OK   ]" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+#if defined(_MSC_VER) && defined(_DEBUG)
+   _CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
+   //_CrtSetBreakAlloc(176);
+#endif
+   fon9::AutoPrintTestInfo utinfo("MdRtsArchive");
+   const unsigned kSymbCount = (argc > 1 ? fon9::StrTo(fon9::StrView_cstr(argv[1]), 300u) : 300u);
+   const unsigned kEventCount = (argc > 2 ? fon9::StrTo(fon9::StrView_cstr(argv[2]), 5000u) : 5000u);
+   std::cout << "|SymbCount=" << kSymbCount << "|EventCountPerSymb=" << kEventCount << std::endl;
+
+   fon9::InnStream::OpenArgs  sargs{fon9::InnRoomType{}};
+   sargs.ExpectedRoomSize_[0] = 1024 * 2;
+   sargs.ExpectedRoomSize_[1] = 1024 * 4;
+   sargs.ExpectedRoomSize_[2] = 1024 * 8;
+   sargs.ExpectedRoomSize_[3] = 1024 * 16;
+   fon9::InnApf::OpenResult   ores;
+   std::vector<std::unique_ptr<SymbGen>> symbs;
+   std::vector<std::string>   symbids;
+   remove(kRtiFileName);
+   {
+      std::cout << "[TEST ] Build rti:";
+      fon9::StopWatch         stopWatch;
+      fon9::InnApf::OpenArgs  oargs{kRtiFileName};
+      fon9::InnApfSP          apf = fon9::InnApf::Make(oargs, sargs, ores);
+      if (!apf) {
+         std::cout << "|err=" << fon9::RevPrintTo<std::string>(ores) << "\r[ERROR]" << std::endl;
+         abort();
+      }
+      for (unsigned L = 0; L < kSymbCount; ++L) {
+         symbs.emplace_back(new SymbGen{L});
+         symbids.push_back(fon9::RevPrintTo<std::string>("S", 10000 + L));
+         symbs.back()->Rw_.Open(*apf, &symbids.back(), fon9::FileMode::Append | fon9::FileMode::Read | fon9::FileMode::OpenAlways);
+      }
+      // 09:00:00 .. 13:30:00 平均分配每個事件的時間, 商品之間交錯儲存.
+      const fon9::DayTime tmBeg = fon9::TimeInterval_HHMMSS(90000);
+      const int64_t       usSpan = (fon9::TimeInterval_HHMMSS(133000) - tmBeg).GetOrigValue();
+      for (unsigned LEv = 0; LEv < kEventCount; ++LEv) {
+         // 讓同一時間有多個事件, 測試 InfoTime 為 Null 的情況.
+         const fon9::DayTime tm = tmBeg + fon9::TimeInterval_Microsecond(usSpan * (LEv / 2) / kEventCount);
+         for (auto& symb : symbs) {
+            switch (symb->Rand(10)) {
+            case 0: case 1: case 2:
+               symb->GenDeal(tm);
+               break;
+            case 9:
+               symb->GenOther(tm);
+               break;
+            default:
+               symb->GenUpdateBS(tm);
+               break;
+            }
+         }
+      }
+      for (auto& symb : symbs)
+         symb->Rw_.Close();
+      while (apf->use_count() != 1)
+         std::this_thread::yield();
+      apf.reset();
+      std::cout << fon9::AutoTimeUnit{stopWatch.StopTimer()} << "\r[OK   ]" << std::endl;
+   }
+   fon9::InnApf::OpenArgs  oargs{kRtiFileName, 64, fon9::FileMode::Read};
+   fon9::InnApfSP          apf = fon9::InnApf::Make(oargs, sargs, ores);
+   if (!apf) {
+      std::cout << "|err=" << fon9::RevPrintTo<std::string>(ores) << "\r[ERROR]" << std::endl;
+      abort();
+   }
+   f9fmkt::MdRtsArchive::BuildArgs bargs;
+   bargs.CtrlFlags_ = kCtrlFlags;
+   {
+      std::cout << "[TEST ] Build archive:";
+      fon9::StopWatch                  stopWatch;
+      f9fmkt::MdRtsArchive::BuildResult bres;
+      auto res = f9fmkt::MdRtsArchive::Build(*apf, kArcFileName, bargs, &bres);
+      const double span = stopWatch.StopTimer();
+      if (!res || bres.SymbCount_ != kSymbCount || bres.BadPacketCount_ != 0) {
+         std::cout << "|res=" << fon9::RevPrintTo<std::string>(res)
+            << "|symbs=" << bres.SymbCount_ << "|bad=" << bres.BadPacketCount_ << "\r[ERROR]" << std::endl;
+         abort();
+      }
+      std::cout << fon9::AutoTimeUnit{span}
+         << "|packets=" << bres.PacketCount_
+         << "|deals=" << bres.RowCount_[0]
+         << "|bestBuy=" << bres.RowCount_[1]
+         << "|bestSell=" << bres.RowCount_[2]
+         << "|fileSize=" << res.GetResult()
+         << "\r[OK   ]" << std::endl;
+   }
+   f9fmkt::MdRtsArchiveSP arc{new f9fmkt::MdRtsArchive};
+   {
+      std::cout << "[TEST ] Open & Check:";
+      auto res = arc->Open(kArcFileName);
+      if (!res || arc->SymbCount() != kSymbCount) {
+         std::cout << "|res=" << fon9::RevPrintTo<std::string>(res) << "\r[ERROR]" << std::endl;
+         abort();
+      }
+      static const char* kSeriesNames[] = {"Deal", "BestBuy", "BestSell"};
+      for (unsigned L = 0; L < kSymbCount; ++L) {
+         const f9fmkt::MdArcSymbDir* symb = arc->FindSymb(&symbids[L]);
+         if (symb == nullptr) {
+            std::cout << "|symb=" << symbids[L] << "|err=Not found\r[ERROR]" << std::endl;
+            abort();
+         }
+         for (size_t LSer = 0; LSer < f9fmkt::kMdArcSeriesCount; ++LSer)
+            CheckRows(symbids[L].c_str(), kSeriesNames[LSer],
+                      arc->GetSeries(*symb, static_cast<f9fmkt::MdArcSeries>(LSer)), symbs[L]->Expected_[LSer]);
+      }
+      std::cout << "\r[OK   ]" << std::endl;
+   }
+   TestArchiveTree(arc, symbids[0], symbs[0]->Expected_);
+   utinfo.PrintSplitter();
+   TestRecoverTimeIndex(sargs);
+   // -----
+   utinfo.PrintSplitter();
+   std::cout << "Query benchmark: deals of every symbol, 10:00:00 <= DealTime < 10:05:00" << std::endl;
+   const fon9::DayTime tmQryBeg = fon9::TimeInterval_HHMMSS(100000);
+   const fon9::DayTime tmQryEnd = fon9::TimeInterval_HHMMSS(100500);
+   uint64_t qtyDecode = 0, qtyArc = 0, rtiBytes = 0, arcRows = 0;
+   {  // 目前的方式: 讀出 rti stream, 逐筆解碼全部封包, 再過濾時間.
+      std::cout << "[TEST ] Decode rti:";
+      fon9::StopWatch   stopWatch;
+      std::string       rtStream;
+      ArcRows           rows;
+      for (const auto& symbid : symbids) {
+         fon9::InnApf::StreamRW rw;
+         rw.Open(*apf, &symbid, fon9::FileMode::Read);
+         rtStream.resize(static_cast<size_t>(rw.Size()));
+         rw.Read(0, &*rtStream.begin(), rtStream.size());
+         rtiBytes += rtStream.size();
+         for (auto& r : rows)
+            r.clear();
+         f9fmkt::MdRtsArchive::DecodeRtStream(fon9::ToStrView(rtStream), bargs, rows);
+         for (const auto& row : rows[0]) {
+            if (tmQryBeg <= row.Time_ && row.Time_ < tmQryEnd)
+               qtyDecode += row.Qty_;
+         }
+      }
+      const double span = stopWatch.StopTimer();
+      std::cout << fon9::AutoTimeUnit{span}
+         << "|" << (static_cast<double>(rtiBytes) / span / 1024 / 1024) << " MB/s"
+         << "|sumQty=" << qtyDecode << "\r[OK   ]" << std::endl;
+   }
+   {  // 歸檔: 使用秒索引定位, 直接讀取欄位陣列.
+      std::cout << "[TEST ] Archive:";
+      fon9::StopWatch stopWatch;
+      for (size_t L = 0; L < arc->SymbCount(); ++L) {
+         const auto   view = arc->GetSeries(*arc->GetSymb(L), f9fmkt::MdArcSeries::Deal);
+         const size_t iend = view.LowerBound(arc->ToArcTime(tmQryEnd));
+         for (size_t idx = view.LowerBound(arc->ToArcTime(tmQryBeg)); idx < iend; ++idx) {
+            qtyArc += view.Qtys_[idx];
+            ++arcRows;
+         }
+      }
+      const double span = stopWatch.StopTimer();
+      if (qtyArc != qtyDecode) {
+         std::cout << "|sumQty=" << qtyArc << "|expected=" << qtyDecode << "\r[ERROR]" << std::endl;
+         abort();
+      }
+      std::cout << fon9::AutoTimeUnit{span} << "|rows=" << arcRows << "|sumQty=" << qtyArc << "\r[OK   ]" << std::endl;
+   }
+   {  // 全日掃描: 全部商品的全部成交.
+      std::cout << "[TEST ] Full scan archive:";
+      fon9::StopWatch stopWatch;
+      uint64_t        sumQty = 0, rowCount = 0;
+      for (size_t L = 0; L < arc->SymbCount(); ++L) {
+         const auto view = arc->GetSeries(*arc->GetSymb(L), f9fmkt::MdArcSeries::Deal);
+         for (size_t idx = 0; idx < view.RowCount_; ++idx)
+            sumQty += view.Qtys_[idx];
+         rowCount += view.RowCount_;
+      }
+      const double span = stopWatch.StopTimer();
+      std::cout << fon9::AutoTimeUnit{span} << "|rows=" << rowCount << "|sumQty=" << sumQty
+         << "|" << (static_cast<double>(rowCount) / span) << " rows/s"
+         << "\r[OK   ]" << std::endl;
+   }
+   arc.reset();
+   symbs.clear();
+   while (apf->use_count() != 1)
+      std::this_thread::yield();
+   apf.reset();
+   remove(kRtiFileName);
+   remove(kArcFileName);
+}
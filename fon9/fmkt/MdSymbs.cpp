@@ -130,7 +130,7 @@ void MdSymbsBase::DailyClear(unsigned tdayYYYYMMDD) {
    this->UnsafeSubj_.Publish(e);
 }
 void MdSymbsBase::UnsafePublish(f9sv_RtsPackType pkType, seed::SeedNotifyArgs& e) {
-   assert(this->SymbMap_.IsLocked());
+   assert(this->IsSymbLocked());
    // IsDailyClearing_ 時, 有可能 f9sv_RtsPackType_TradingSessionId 或 PodRemoved(商品過期被移除)
    // 所以這裡要讓 PodRemoved 送給 tree 的訂閱者,
    // 但 TradingSessionId 由 MdSymbsBase::DailyClear() 送出一次, 不要每個商品都送一次.
@@ -145,7 +145,13 @@ void MdSymbsBase::UnsafePublish(f9sv_RtsPackType pkType, seed::SeedNotifyArgs& e
    //   - f9sv_RtsPackType_DealBS, f9sv_RtsPackType_DealPack 一般情況不包含 TotalQty;
    //   - 在沒有 TotalQtyLost 的情況下, TotalQty 由 Client 自行計算.
    // - f9sv_RtsPackType_UpdateBS
-   this->UnsafeSubj_.Publish(e);
+   if (this->GetShardCount() <= 1)
+      this->UnsafeSubj_.Publish(e);
+   else {
+      // 可能僅鎖定 e.KeyText_ 所在的分區, 此時其他分區可能同時在發行.
+      std::lock_guard<std::mutex> lk{this->UnsafeSubjPublishMutex_};
+      this->UnsafeSubj_.Publish(e);
+   }
 }
 seed::OpResult MdSymbsBase::SubscribeStream(SubConn* pSubConn, seed::Tab& tab, StrView args, seed::FnSeedSubr&& fnSubr) {
    if (!IsEnumContains(this->CtrlFlags_, MdSymbsCtrlFlag::AllowSubrTree) || &tab != this->RtTab_)
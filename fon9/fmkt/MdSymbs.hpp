@@ -24,9 +24,9 @@ class fon9_API MdSymbsBase : public SymbTree {
    struct SymbsSubrSP : public intrusive_ptr<SymbsSubr> {
       using base = intrusive_ptr<SymbsSubr>;
       using base::base;
-      /// 呼叫前必須: lock tree, 檢查 IsUnsubscribed();
+      /// 呼叫前必須: lock tree(或 lock e.KeyText_ 所在的分區), 檢查 IsUnsubscribed();
       void operator()(const seed::SeedNotifyArgs& e) const {
-         assert(static_cast<SymbTree*>(&e.Tree_)->SymbMap_.IsLocked());
+         assert(static_cast<SymbTree*>(&e.Tree_)->IsSymbLocked());
          assert(!this->get()->IsUnsubscribed());
          auto& symbs = this->get()->SymbsRecovering_;
          if (symbs.empty() || symbs.find(e.KeyText_) == symbs.end())
@@ -35,6 +35,9 @@ class fon9_API MdSymbsBase : public SymbTree {
    };
    using UnsafeSubj = seed::UnsafeSeedSubjT<SymbsSubrSP>;
    UnsafeSubj  UnsafeSubj_;
+   /// 當有多個分區時, 不同分區的商品可能同時發行訊息給「整棵樹」的訂閱者,
+   /// 此時需要額外的保護, 讓整棵樹的訂閱者一次只收到一個訊息.
+   std::mutex  UnsafeSubjPublishMutex_;
 
    /// 在 LoadFrom() 成功開啟, 且檔案載入完畢後的通知.
    /// 預設 do nothing.
@@ -68,7 +71,8 @@ public:
    /// 訂閱整棵樹, 建構時必須提供 MdSymbsCtrlFlag::AllowSubrTree 旗標.
    seed::OpResult SubscribeStream(SubConn* pSubConn, seed::Tab&, StrView args, seed::FnSeedSubr&&);
    seed::OpResult UnsubscribeStream(SubConn* pSubConn, seed::Tab&);
-   /// - 此處會檢查 assert(this->SymbMap_.IsLocked()); 未鎖定的呼叫, 必定為設計上的問題.
+   /// - 此處會檢查 assert(this->IsSymbLocked()); 未鎖定的呼叫, 必定為設計上的問題.
+   /// - 可以在僅鎖定 e.KeyText_ 所在分區的情況下呼叫.
    /// - 若 pkType == f9sv_RtsPackType_Count; 則必須從 e.NotifyKind_ 取得通知種類.
    void UnsafePublish(f9sv_RtsPackType pkType, seed::SeedNotifyArgs& e);
 
@@ -1,6 +1,7 @@
 ﻿// \file fon9/fmkt/MdSystem.cpp
 // \author fonwinz@gmail.com
 #include "fon9/fmkt/MdSystem.hpp"
+#include "fon9/fmkt/MdSymbs.hpp"
 #include "fon9/seed/SysEnv.hpp"
 #include "fon9/TimedFileName.hpp"
 #include "fon9/Log.hpp"
@@ -14,10 +15,34 @@ MdSystem::MdSystem(seed::MaTreeSP root, std::string name)
 MdSystem::~MdSystem() {
    this->ClearTimer_.DisposeAndWait();
 }
+/// args == nullptr: 解除 MdSymbs 對 this->Sapling_ 的參考(歸檔掛載位置).
+static void ApplyRtiArgs(const seed::MaTreeSP& sapling, const MdRtiArgs* args) {
+   auto seeds = sapling->GetList(nullptr);
+   for (seed::NamedSeedSP& seed : seeds) {
+      auto* symbs = dynamic_cast<MdSymbsBase*>(seed->GetSapling().get());
+      if (symbs == nullptr)
+         continue;
+      if (args)
+         symbs->RtInnMgr_.SetRtiMapExtentSize(args->RtiMapExtentSize_);
+      if (args && args->IsArchiveOnDailyClear_)
+         symbs->RtInnMgr_.SetArchiveOnDailyClear(sapling, seed->Name_ + "Arc");
+      else
+         symbs->RtInnMgr_.SetArchiveOnDailyClear(nullptr, std::string{});
+   }
+}
 void MdSystem::OnParentTreeClear(seed::Tree& parent) {
+   ApplyRtiArgs(this->Sapling_, nullptr);
    base::OnParentTreeClear(parent);
    this->ClearTimer_.DisposeAndWait();
 }
+std::string MdSystem::SetRtiConfig(StrView cfg) {
+   MdRtiArgs     args;
+   RevBufferList rbuf{128};
+   if (!ParseConfig(args, cfg, rbuf))
+      return BufferTo<std::string>(rbuf.MoveOut());
+   ApplyRtiArgs(this->Sapling_, &args);
+   return std::string{};
+}
 void MdSystem::EmitOnClearTimer(TimerEntry* timer, TimeStamp now) {
    (void)now;
    MdSystem& rthis = ContainerOf(*static_cast<ClearTimer*>(timer), &MdSystem::ClearTimer_);
@@ -54,6 +54,13 @@ public:
    /// - 然後使用「現在時間」檢查 TDay 是否改變, 若有則會觸發 OnMdSystemStartup();
    void SetClearHHMMSS(unsigned clearHHMMSS);
 
+   /// 設定 this->Sapling_ 裡面每個 MdSymbs 的 rti 處理方式, 格式請參考 MdRtiArgs, 例: "Archive=Y";
+   /// - 通常在建立 MdSystem 之後, 由 plugin 的設定取得, 在 StartupMdSystem() 之前呼叫.
+   /// - Archive=Y: 換日時轉出的歸檔, 掛在 this->Sapling_ 的 "MdSymbs名稱 + Arc" 底下, 例: "SymbsArc";
+   /// - MapExtentMB=n: 在下次開啟 rti(換日)時生效, 回補時直接從 memory map 取得資料.
+   /// - 傳回錯誤訊息, retval.empty() 表示成功.
+   std::string SetRtiConfig(StrView cfg);
+
    /// 啟動(or 換日清檔).
    /// 已根據設定建立好相關物件後, 呼叫此處啟動.
    /// - 若 tday 有變動, 則會觸發 OnMdSystemStartup();
@@ -0,0 +1,165 @@
+﻿// \file fon9/fmkt/SymbShard_UT.cpp
+//
+// 測試 SymbTree 分區鎖定(SymbShardMutex)的效率:
+// - N 個 parser thread: 模擬解析行情, 每次異動一個商品.
+//   - TreeLock: 使用 SymbMap_.Lock() 鎖定整棵樹.
+//   - ShardLock: 使用 LockShard(symbid) 僅鎖定商品所在的分區.
+// - 1 個 reader thread: 定時使用 SymbMap_.Lock() 鎖定整棵樹, 檢查全部商品的一致性,
+//   模擬 GridView、SaveTo()... 之類的「整棵樹」操作.
+//
+// >SymbShard_UT [parserThreadCount symbCount updCountPerThread]
+//
+// \author fonwinz@gmail.com
+#include "fon9/fmkt/SymbTree.hpp"
+#include "fon9/seed/FieldMaker.hpp"
+#include "fon9/TestTools.hpp"
+#include "fon9/StrTo.hpp"
+#include <thread>
+#include <vector>
+#include <atomic>
+
+//--------------------------------------------------------------------------//
+
+class ShardTestSymb : public fon9::fmkt::Symb {
+   fon9_NON_COPY_NON_MOVE(ShardTestSymb);
+   using base = fon9::fmkt::Symb;
+public:
+   using base::base;
+   // 每次異動同時更新 2 個欄位, reader 檢查這 2 個欄位是否一致.
+   uint64_t UpdCount_{0};
+   uint64_t UpdSum_{0};
+};
+
+class ShardTestTree : public fon9::fmkt::SymbTree {
+   fon9_NON_COPY_NON_MOVE(ShardTestTree);
+   using base = fon9::fmkt::SymbTree;
+public:
+   ShardTestTree() : base{MakeLayout()} {
+   }
+   static fon9::seed::LayoutSP MakeLayout() {
+      using namespace fon9::seed;
+      using fon9::fmkt::Symb;
+      return LayoutSP{new Layout1(fon9_MakeField(Symb, SymbId_, "Id"), TreeFlag::Unordered,
+                                  TabSP{new Tab{fon9::Named{"Base"}, Symb::MakeFields()}})};
+   }
+   fon9::fmkt::SymbSP MakeSymb(const fon9::StrView& symbid) override {
+      return new ShardTestSymb{symbid};
+   }
+};
+
+//--------------------------------------------------------------------------//
+
+enum class LockMode {
+   TreeLock,
+   ShardLock,
+};
+struct ShardArgs {
+   unsigned                   ParserThreadCount_;
+   unsigned                   UpdCountPerThread_;
+   std::vector<std::string>   SymbIds_;
+};
+
+/// 模擬解析行情的工作量.
+inline void UpdateSymb(ShardTestSymb& symb, unsigned val) {
+   uint64_t sum = val;
+   for (unsigned L = 0; L < 32; ++L)
+      sum = sum * 131 + L;
+   symb.UpdSum_ += (sum & 0xff) + 1;
+   symb.UpdCount_ += 1;
+   symb.UpdSum_ -= (sum & 0xff);
+}
+
+void RunParser(ShardTestTree& tree, const ShardArgs& args, LockMode mode, unsigned threadNo) {
+   const size_t symbCount = args.SymbIds_.size();
+   size_t       idx = (symbCount / args.ParserThreadCount_) * threadNo;
+   for (unsigned L = 0; L < args.UpdCountPerThread_; ++L) {
+      const fon9::StrView symbid = fon9::ToStrView(args.SymbIds_[idx]);
+      if (++idx >= symbCount)
+         idx = 0;
+      if (mode == LockMode::TreeLock) {
+         auto lk = tree.SymbMap_.Lock();
+         auto ifind = lk->find(symbid);
+         if (ifind != lk->end())
+            UpdateSymb(*static_cast<ShardTestSymb*>(&fon9::fmkt::GetSymbValue(*ifind)), L);
+      }
+      else {
+         auto lk = tree.LockShard(symbid);
+         if (auto* symb = tree.FindSymb(lk, symbid))
+            UpdateSymb(*static_cast<ShardTestSymb*>(symb), L);
+      }
+   }
+}
+
+void TestShard(const ShardArgs& args, LockMode mode, unsigned shardCount) {
+   ShardTestTree tree;
+   tree.SetShardCount(shardCount);
+   for (const auto& id : args.SymbIds_)
+      tree.FetchSymb(fon9::ToStrView(id));
+
+   std::atomic<bool> isRunning{true};
+   uint64_t          readCount = 0;
+   uint64_t          errCount = 0;
+   std::thread       reader{[&]() {
+      while (isRunning.load(std::memory_order_relaxed)) {
+         {
+            auto lk = tree.SymbMap_.Lock();
+            for (auto& v : *lk) {
+               auto& symb = *static_cast<ShardTestSymb*>(&fon9::fmkt::GetSymbValue(v));
+               if (symb.UpdCount_ != symb.UpdSum_)
+                  ++errCount;
+            }
+         }
+         ++readCount;
+         std::this_thread::sleep_for(std::chrono::milliseconds{1});
+      }
+   }};
+
+   char msg[128];
+   sprintf(msg, "%s|shards=%-3u|threads=%u", mode == LockMode::TreeLock ? "TreeLock " : "ShardLock",
+           tree.GetShardCount(), args.ParserThreadCount_);
+   std::vector<std::thread> parsers;
+   fon9::StopWatch          stopWatch;
+   for (unsigned L = 0; L < args.ParserThreadCount_; ++L)
+      parsers.emplace_back(&RunParser, std::ref(tree), std::cref(args), mode, L);
+   for (auto& th : parsers)
+      th.join();
+   const uint64_t totalCount = static_cast<uint64_t>(args.UpdCountPerThread_) * args.ParserThreadCount_;
+   stopWatch.PrintResultNoEOL(msg, totalCount);
+   isRunning = false;
+   reader.join();
+
+   uint64_t updCount = 0;
+   {
+      auto lk = tree.SymbMap_.Lock();
+      for (auto& v : *lk)
+         updCount += static_cast<ShardTestSymb*>(&fon9::fmkt::GetSymbValue(v))->UpdCount_;
+   }
+   std::cout << "|reads=" << readCount << "|inconsistent=" << errCount << std::endl;
+   if (updCount != totalCount || errCount != 0) {
+      std::cout << "[ERROR] updCount=" << updCount << "|expected=" << totalCount << std::endl;
+      abort();
+   }
+}
+
+int main(int argc, char** argv) {
+   fon9::AutoPrintTestInfo utinfo{"SymbShard"};
+
+   ShardArgs args;
+   args.ParserThreadCount_ = (argc > 1 ? fon9::StrTo(fon9::StrView_cstr(argv[1]), 0u) : 0u);
+   if (args.ParserThreadCount_ == 0)
+      args.ParserThreadCount_ = std::max(2u, std::thread::hardware_concurrency());
+   const unsigned symbCount = (argc > 2 ? fon9::StrTo(fon9::StrView_cstr(argv[2]), 0u) : 20000u);
+   args.UpdCountPerThread_ = (argc > 3 ? fon9::StrTo(fon9::StrView_cstr(argv[3]), 0u) : 1000000u);
+   args.SymbIds_.reserve(symbCount);
+   for (unsigned L = 0; L < symbCount; ++L)
+      args.SymbIds_.push_back(fon9::RevPrintTo<std::string>("TX", L));
+
+   TestShard(args, LockMode::TreeLock, 1);
+   TestShard(args, LockMode::ShardLock, 1);
+   utinfo.PrintSplitter();
+   static const unsigned shardList[] = {4, 16, 64};
+   for (unsigned shardCount : shardList) {
+      TestShard(args, LockMode::TreeLock, shardCount);
+      TestShard(args, LockMode::ShardLock, shardCount);
+   }
+}
@@ -28,6 +28,26 @@ void SymbPodOp::BeginWrite(seed::Tab& tab, seed::FnWriteOp fnCallback) {
    }
 }
 //--------------------------------------------------------------------------//
+void SymbShardMutex::SetShardCount(unsigned count) {
+   unsigned mask = 0;
+   while (mask + 1 < count && mask + 1 < kMaxShardCount)
+      mask = (mask << 1) | 1;
+   if (mask == this->ShardMask_)
+      return;
+   this->Shards_.reset(new Shard[mask + 1]);
+   this->ShardMask_ = mask;
+}
+#ifndef NDEBUG
+bool SymbShardMutex::IsShardLocked() const {
+   const auto curid = std::this_thread::get_id();
+   for (unsigned idx = 0; idx <= this->ShardMask_; ++idx) {
+      if (this->Shards_[idx].Owner_ == curid)
+         return true;
+   }
+   return false;
+}
+#endif
+//--------------------------------------------------------------------------//
 SymbTree::~SymbTree() {
 }
 void SymbTree::LockedDailyClear(Locker& symbs, unsigned tdayYYYYMMDD) {
@@ -6,6 +6,8 @@
 #include "fon9/seed/Tree.hpp"
 #include "fon9/seed/PodOp.hpp"
 #include "fon9/RevPrint.hpp"
+#include <thread>
+#include <memory>
 
 namespace fon9 { namespace fmkt {
 
@@ -103,6 +105,12 @@ public:
    virtual void OnAfterPodOpWrite(Symb& symb, seed::Tab& tab, const Locker& symbs) {
       (void)symb; (void)tab; (void)symbs;
    }
+   /// TreeOp 移除商品前通知.
+   /// - 讓 SymbTreeT 的衍生者(實際應用者), 可以解除商品的關聯(例: 額外的商品索引).
+   /// - 預設: do nothing.
+   virtual void OnBeforePodOpRemove(Symb& symb, const Locker& symbs) {
+      (void)symb; (void)symbs;
+   }
 
    SymbSP FetchSymb(const Locker& symbs, const StrView& symbid) {
       auto ifind = symbs->find(symbid);
@@ -185,6 +193,7 @@ protected:
             Locker lockedMap{static_cast<SymbTreeT*>(&this->Tree_)->SymbMap_};
             auto   ifind = lockedMap->find(strKeyText);
             if (ifind != lockedMap->end()) {
+               static_cast<SymbTreeT*>(&this->Tree_)->OnBeforePodOpRemove(GetSymbValue(*ifind), lockedMap);
                lockedMap->erase(ifind);
                res.OpResult_ = seed::OpResult::removed_pod;
             }
@@ -195,18 +204,177 @@ protected:
 };
 //--------------------------------------------------------------------------//
 
+fon9_WARN_DISABLE_PADDING;
+/// \ingroup fmkt
+/// 商品表的分區鎖.
+/// - lock(): 依序鎖定全部的分區, 用於「整棵樹」的操作, 例如:
+///   新增/移除商品、DailyClear、SaveTo/LoadFrom、GridView、訂閱整棵樹...
+///   一般透過 SymbTree::SymbMap_.Lock() 使用, 此時可取得整棵樹的一致狀態.
+/// - LockShard(idx): 僅鎖定一個分區, 一般透過 SymbTree::LockShard(symbid) 使用.
+///   - 因為新增/移除商品必須鎖定全部的分區, 所以此時可以安全的在 SymbMap「尋找」商品.
+///   - 可以存取同分區商品的資料.
+/// - 預設只有 1 個分區, 此時與使用一個 std::mutex 相同.
+class fon9_API SymbShardMutex {
+   fon9_NON_COPY_NON_MOVE(SymbShardMutex);
+   struct Shard {
+      std::mutex  Mutex_;
+      // 避免相鄰的 mutex 在同一條 cache line.
+      char        Padding_[64 - sizeof(std::mutex) % 64];
+   #ifndef NDEBUG
+      std::thread::id   Owner_;
+   #endif
+      void lock() {
+         this->Mutex_.lock();
+      #ifndef NDEBUG
+         this->Owner_ = std::this_thread::get_id();
+      #endif
+      }
+      void unlock() {
+      #ifndef NDEBUG
+         this->Owner_ = std::thread::id{};
+      #endif
+         this->Mutex_.unlock();
+      }
+   };
+   std::unique_ptr<Shard[]>   Shards_;
+   unsigned                   ShardMask_{0};
+
+public:
+   enum : unsigned {
+      kMaxShardCount = 256,
+   };
+   SymbShardMutex() : Shards_{new Shard[1]} {
+   }
+
+   /// 必須在尚未使用前設定(例: SymbTree 建構時), count 會調整為 2 的冪次, 最多 kMaxShardCount.
+   void SetShardCount(unsigned count);
+   unsigned GetShardCount() const {
+      return this->ShardMask_ + 1;
+   }
+   unsigned GetShardIndex(const StrView& symbid) const {
+      if (this->ShardMask_ == 0)
+         return 0;
+      const size_t h = std::hash<StrView>()(symbid);
+      return static_cast<unsigned>((h ^ (h >> 16)) & this->ShardMask_);
+   }
+
+   /// 鎖定全部的分區.
+   void lock() {
+      for (unsigned idx = 0; idx <= this->ShardMask_; ++idx)
+         this->Shards_[idx].lock();
+   }
+   void unlock() {
+      for (unsigned idx = this->ShardMask_ + 1; idx > 0;)
+         this->Shards_[--idx].unlock();
+   }
+   void LockShard(unsigned idx) {
+      assert(idx <= this->ShardMask_);
+      this->Shards_[idx].lock();
+   }
+   void UnlockShard(unsigned idx) {
+      assert(idx <= this->ShardMask_);
+      this->Shards_[idx].unlock();
+   }
+
+#ifndef NDEBUG
+   /// 目前的 thread 是否有鎖定任一分區.
+   bool IsShardLocked() const;
+#endif
+
+   /// 僅鎖定一個分區.
+   class ShardLocker {
+      fon9_NON_COPYABLE(ShardLocker);
+      SymbShardMutex*   Mutex_;
+      unsigned          Index_;
+   public:
+      ShardLocker() : Mutex_{nullptr}, Index_{0} {
+      }
+      ShardLocker(SymbShardMutex& mx, unsigned idx) : Mutex_{&mx}, Index_{idx} {
+         mx.LockShard(idx);
+      }
+      ShardLocker(ShardLocker&& rhs) : Mutex_{rhs.Mutex_}, Index_{rhs.Index_} {
+         rhs.Mutex_ = nullptr;
+      }
+      ShardLocker& operator=(ShardLocker&& rhs) {
+         this->unlock();
+         this->Mutex_ = rhs.Mutex_;
+         this->Index_ = rhs.Index_;
+         rhs.Mutex_ = nullptr;
+         return *this;
+      }
+      ~ShardLocker() {
+         this->unlock();
+      }
+      void unlock() {
+         if (this->Mutex_) {
+            this->Mutex_->UnlockShard(this->Index_);
+            this->Mutex_ = nullptr;
+         }
+      }
+      bool owns_lock() const {
+         return this->Mutex_ != nullptr;
+      }
+      unsigned GetShardIndex() const {
+         return this->Index_;
+      }
+   };
+};
+fon9_WARN_POP;
+
 /// \ingroup fmkt
 /// 商品資料表, 一般行情系統使用: multi thread(mutex) + unordered
-class fon9_API SymbTree : public SymbTreeT<SymbMap, std::mutex> {
+/// - 預設使用一個 mutex 保護整棵樹.
+/// - 可使用 SetShardCount() 設定分區數量, 之後只異動單一商品的作業(例: 解析成交、報價),
+///   可以使用 LockShard() 僅鎖定商品所在的分區, 讓不同分區的商品可以同時處理.
+class fon9_API SymbTree : public SymbTreeT<SymbMap, SymbShardMutex> {
    fon9_NON_COPY_NON_MOVE(SymbTree);
 public:
    using SymbTreeT::SymbTreeT;
    ~SymbTree();
 
    void LockedDailyClear(Locker& symbs, unsigned tdayYYYYMMDD);
+
+   using ShardLocker = SymbShardMutex::ShardLocker;
+   /// 設定分區數量, 必須在尚未使用前設定(例: 建構時).
+   void SetShardCount(unsigned count) {
+      this->SymbMap_.UnsafeGetMutex().SetShardCount(count);
+   }
+   unsigned GetShardCount() const {
+      return this->SymbMap_.UnsafeGetMutex().GetShardCount();
+   }
+   /// 僅鎖定 symbid 所在的分區, 在返回的 ShardLocker 解鎖前:
+   /// - 可以使用 FindSymb(shardLocker, symbid) 尋找商品, 但不可新增/移除商品.
+   /// - 可以異動 symbid 的資料, 並發行 symbid 的即時訊息.
+   ShardLocker LockShard(const StrView& symbid) {
+      SymbShardMutex& mx = this->SymbMap_.UnsafeGetMutex();
+      return ShardLocker{mx, mx.GetShardIndex(symbid)};
+   }
+   /// 若已事先取得(保存) symbid 所在的分區, 可直接鎖定該分區, 不用再計算 symbid 的 hash.
+   ShardLocker LockShardIndex(unsigned shardIndex) {
+      return ShardLocker{this->SymbMap_.UnsafeGetMutex(), shardIndex};
+   }
+   unsigned GetShardIndex(const StrView& symbid) const {
+      return this->SymbMap_.UnsafeGetMutex().GetShardIndex(symbid);
+   }
+   /// 必須先透過 LockShard(symbid) 鎖定 symbid 所在的分區.
+   /// \retval nullptr 商品不存在.
+   Symb* FindSymb(const ShardLocker& lk, const StrView& symbid) const {
+      (void)lk;
+      assert(lk.owns_lock() && lk.GetShardIndex() == this->SymbMap_.UnsafeGetMutex().GetShardIndex(symbid));
+      const SymbMapImpl& symbs = this->SymbMap_.UnsafeGetBase();
+      auto ifind = symbs.find(symbid);
+      return ifind == symbs.end() ? nullptr : &GetSymbValue(*ifind);
+   }
+
+#ifndef NDEBUG
+   /// 整棵樹已鎖定, 或目前的 thread 有鎖定任一分區.
+   bool IsSymbLocked() const {
+      return this->SymbMap_.IsLocked() || this->SymbMap_.UnsafeGetMutex().IsShardLocked();
+   }
+#endif
 };
 // 使用 fon9_API_TEMPLATE_CLASS 造成 VS 2015 Debug build 失敗?!
-// fon9_API_TEMPLATE_CLASS(SymbTree, SymbTreeT, SymbMap, std::mutex);
+// fon9_API_TEMPLATE_CLASS(SymbTree, SymbTreeT, SymbMap, SymbShardMutex);
 
 } } // namespaces
 #endif//__fon9_fmkt_SymbTree_hpp__
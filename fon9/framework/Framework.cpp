@@ -89,6 +89,26 @@ int Framework::Initialize(int argc, char** argv) {
       }
    }
 
+   // $LogDeferred=Y 或 n(每個 thread 的 ring 大小, 單位 KB): 啟用延遲格式化 log.
+#define fon9_kCSTR_LogDeferred   "LogDeferred"
+   if (auto varLogDeferred = cfgld.GetVariable(fon9_kCSTR_LogDeferred)) {
+      cfgstr = &varLogDeferred->Value_.Str_;
+      StrTrim(&cfgstr);
+      LogDeferredArgs args;
+      bool isEnabled = (toupper(static_cast<unsigned char>(cfgstr.Get1st())) == 'Y');
+      if (!isEnabled) {
+         if (const size_t ringSizeKB = StrTo(cfgstr, 0u)) {
+            args.RingSize_ = ringSizeKB * 1024;
+            isEnabled = true;
+         }
+      }
+      if (isEnabled) {
+         StartLogDeferred(args);
+         sysEnv->Add(new seed::SysEnvItem(fon9_kCSTR_LogDeferred, RevPrintTo<std::string>("RingSize=", args.RingSize_),
+                                          "Deferred format log"));
+      }
+   }
+
 #define fon9_kCSTR_HostId   "HostId"
    if (auto hostId = cfgld.GetVariable(fon9_kCSTR_HostId)) {
       LocalHostId_ = StrTo(&hostId->Value_.Str_, 0u);
@@ -29,6 +29,13 @@ namespace fon9 { namespace io {
 //       Loopback=Y or N
 //       TTL=hops    必須有提供 Loopback 選項.
 //
+// 接收(udp or multicast)額外選項:
+//    RecvBatch=n    一次 system call 最多取回 n 個 datagram(Linux: recvmmsg), 預設為 0(不使用).
+//                   每個 datagram 仍會個別觸發 OnDevice_Recv().
+// 傳送(udp or multicast)額外選項:
+//    SendBatch=n    每個 BufferNode 為一個 datagram, 一次 system call 最多送出 n 個 datagram(Linux: sendmmsg),
+//                   預設為 0(不使用): 每次 flush 將 queue 裡面的資料合併成一個 datagram 送出.
+//
 
 bool DgramBase::CreateSocket(Socket& so, const SocketAddress& addr, SocketResult& soRes) {
    this->Config_.Options_.TCP_NODELAY_ = 0;
@@ -82,6 +89,8 @@ void DgramBase::OpImpl_Open(std::string cfgstr) {
    this->Interface_.Addr_.sa_family = AF_UNSPEC;
    this->TTL_ = 0;
    this->Loopback_ = -1;
+   this->RecvBatchCount_ = 0;
+   this->SendBatchCount_ = 0;
    base::OpImpl_Open(std::move(cfgstr));
 }
 ConfigParser::Result DgramBase::OpImpl_SetProperty(StrView tag, StrView& value) {
@@ -103,6 +112,14 @@ ConfigParser::Result DgramBase::OpImpl_SetProperty(StrView tag, StrView& value)
       this->Loopback_ = (toupper(value.Get1st()) == 'Y');
       return ConfigParser::Result::Success;
    }
+   if (iequals(tag, "RecvBatch")) {
+      this->RecvBatchCount_ = StrTo(value, this->RecvBatchCount_);
+      return ConfigParser::Result::Success;
+   }
+   if (iequals(tag, "SendBatch")) {
+      this->SendBatchCount_ = StrTo(value, this->SendBatchCount_);
+      return ConfigParser::Result::Success;
+   }
    return base::OpImpl_SetProperty(tag, value);
 }
 
@@ -19,6 +19,8 @@ class fon9_API DgramBase : public SocketClientDevice {
    SocketAddress  Interface_;
    int            Loopback_;
    uint8_t        TTL_;
+   uint16_t       RecvBatchCount_;
+   uint16_t       SendBatchCount_;
 
 protected:
    void OpImpl_Open(std::string cfgstr) override;
@@ -31,6 +33,19 @@ public:
    DgramBase(SessionSP ses, ManagerSP mgr)
       : base(std::move(ses), std::move(mgr), Style::Client) {
    }
+
+   /// 設定 "RecvBatch=n": 一次 system call 最多取回 n 個 datagram.
+   /// - n <= 1 表示不使用批次接收, 每次 read 一個 datagram.
+   /// - 目前僅 Linux(recvmmsg) 支援, 其餘平台忽略此設定.
+   uint16_t GetRecvBatchCount() const {
+      return this->RecvBatchCount_;
+   }
+   /// 設定 "SendBatch=n": 傳送時每個 BufferNode 為一個 datagram, 一次 system call 最多送出 n 個 datagram.
+   /// - n <= 1 表示不使用批次傳送, 每次 flush 將 queue 裡面的資料(多個 node)合併成一個 datagram 送出.
+   /// - 目前僅 Linux(sendmmsg) 支援, 其餘平台忽略此設定.
+   uint16_t GetSendBatchCount() const {
+      return this->SendBatchCount_;
+   }
 };
 fon9_WARN_POP;
 
@@ -0,0 +1,273 @@
+﻿/// \file fon9/io/DgramBurst_UT.cpp
+///
+/// 在 loopback 測試 Dgram 突發(burst)封包的效率:
+/// - 接收: 比較 RecvBatch=0(每個 datagram 一次 read) 與 RecvBatch=n(recvmmsg) 的差異.
+/// - 傳送: 比較 SendASAP()(每個 datagram 一次 write) 與 SendBatch=n(sendmmsg) 的差異.
+/// - 每個 datagram 前 8 bytes 為序號, 之後的內容由序號產生;
+///   接收端檢查每個 datagram 的大小及內容, 且序號必須依送出的順序連續收到(loopback 不會亂序), 否則測試失敗.
+/// - 傳送測試由另一個 Dgram 接收, 所以 SendASAP() 及 sendmmsg() 都會驗證端對端的順序及內容.
+/// - RecvBatch=n 時, 超過接收 slot 的 datagram 會被截斷, 必須拋棄, 不可交給 Session.
+///
+/// \author fonwinz@gmail.com
+#include "fon9/io/SimpleManager.hpp"
+#include "fon9/io/FdrDgram.hpp"
+#include "fon9/io/FdrServiceEpoll.hpp"
+#include "fon9/TestTools.hpp"
+#include "fon9/StrTo.hpp"
+#include "fon9/Endian.hpp"
+
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+//--------------------------------------------------------------------------//
+
+static const size_t kPkSeqSize = sizeof(uint64_t);
+
+static char PkContentChar(uint64_t seq, size_t idx) {
+   return static_cast<char>('A' + (seq + idx) % 26);
+}
+static void MakeBurstPk(std::string& pk, uint64_t seq) {
+   fon9::PutBigEndian(&*pk.begin(), seq);
+   for (size_t L = kPkSeqSize; L < pk.size(); ++L)
+      pk[L] = PkContentChar(seq, L);
+}
+
+fon9_WARN_DISABLE_PADDING;
+class BurstSession : public fon9::io::Session {
+   fon9_NON_COPY_NON_MOVE(BurstSession);
+   virtual fon9::io::RecvBufferSize OnDevice_LinkReady(fon9::io::Device&) override {
+      return fon9::io::RecvBufferSize::Default;
+   }
+   virtual fon9::io::RecvBufferSize OnDevice_Recv(fon9::io::Device&, fon9::DcQueueList& rxbuf) override {
+      // 每個 datagram 必須個別觸發 OnDevice_Recv().
+      if (fon9::CalcDataSize(rxbuf.cfront()) != this->ExpectedSize_ || !this->CheckPk(rxbuf))
+         this->ErrCount_.fetch_add(1, std::memory_order_relaxed);
+      rxbuf.MoveOut();
+      this->RecvCount_.fetch_add(1, std::memory_order_relaxed);
+      return fon9::io::RecvBufferSize::Default;
+   }
+   /// 檢查內容是否正確, 且序號必須是下一個期望的序號: 不可重複、遺漏、亂序.
+   bool CheckPk(fon9::DcQueueList& rxbuf) {
+      const char* pk = static_cast<const char*>(rxbuf.Peek(&*this->PkBuf_.begin(), this->ExpectedSize_));
+      if (pk == nullptr)
+         return false;
+      const uint64_t seq = fon9::GetBigEndian<uint64_t>(pk);
+      if (seq != this->NextSeq_ || seq >= this->ExpectedCount_)
+         return false;
+      ++this->NextSeq_;
+      for (size_t L = kPkSeqSize; L < this->ExpectedSize_; ++L) {
+         if (pk[L] != PkContentChar(seq, L))
+            return false;
+      }
+      return true;
+   }
+   std::string PkBuf_;
+   uint64_t    NextSeq_{0};
+public:
+   BurstSession(size_t expectedSize, uint64_t expectedCount)
+      : ExpectedSize_{expectedSize}
+      , ExpectedCount_{expectedCount} {
+      this->PkBuf_.resize(expectedSize);
+   }
+   const size_t          ExpectedSize_;
+   const uint64_t        ExpectedCount_;
+   std::atomic<uint64_t> RecvCount_{0};
+   std::atomic<uint64_t> ErrCount_{0};
+};
+using BurstSessionSP = fon9::intrusive_ptr<BurstSession>;
+fon9_WARN_POP;
+
+//--------------------------------------------------------------------------//
+
+struct BurstArgs {
+   fon9::io::FdrServiceSP  IoService_;
+   uint16_t                Port_;
+   unsigned                BurstCount_;
+   unsigned                PkCountPerBurst_;
+   size_t                  PkSize_;
+};
+
+fon9::io::DeviceSP OpenDgram(const BurstArgs& args, fon9::io::SessionSP ses, std::string cfgstr) {
+   static fon9::io::ManagerCSP mgr{new fon9::io::SimpleManager{}};
+   fon9::io::DeviceSP dev{new fon9::io::FdrDgram(args.IoService_, std::move(ses), mgr)};
+   dev->Initialize();
+   dev->AsyncOpen(std::move(cfgstr));
+   dev->WaitGetDeviceId();
+   return dev;
+}
+void CloseDgram(fon9::io::DeviceSP&& dev) {
+   dev->AsyncDispose("TestBurst.End");
+   dev->WaitGetDeviceId();
+   // 等候 dev 釋放 socket, 避免下一個測試 bind 失敗.
+   while (dev->use_count() > 1)
+      std::this_thread::yield();
+}
+fon9::io::DeviceSP OpenReceiver(const BurstArgs& args, BurstSessionSP ses, unsigned recvBatch) {
+   return OpenDgram(args, std::move(ses), fon9::RevPrintTo<std::string>("Bind=127.0.0.1:", args.Port_,
+                                                                        "|RCVBUF=", 1024 * 1024 * 8,
+                                                                        "|RecvBatch=", recvBatch));
+}
+void WaitBurstReceived(BurstSession& ses, uint64_t sentCount) {
+   // 等候這批 burst 接收完畢, 若超過 1 秒則視為有遺失.
+   fon9::StopWatch waitWatch;
+   while (ses.RecvCount_.load(std::memory_order_relaxed) < sentCount && waitWatch.CurrSpan() < 1)
+      std::this_thread::yield();
+}
+/// 全部送出, 且全部正確收到, 才算通過.
+void CheckBurstResult(fon9::StopWatch& stopWatch, const char* msg, BurstSession& ses, uint64_t sentCount, uint64_t expectedCount) {
+   const uint64_t recvCount = ses.RecvCount_.load(std::memory_order_relaxed);
+   const uint64_t errCount = ses.ErrCount_.load(std::memory_order_relaxed);
+   std::cout << "[TEST ] ";
+   stopWatch.PrintResultNoEOL(msg, recvCount)
+      << "|sent=" << sentCount
+      << "|lost=" << (sentCount - recvCount)
+      << "|err=" << errCount;
+   if (sentCount != expectedCount || recvCount != sentCount || errCount != 0) {
+      std::cout << "\r[ERROR]" << std::endl;
+      abort();
+   }
+   std::cout << "\r[OK   ]" << std::endl;
+}
+
+//--------------------------------------------------------------------------//
+
+void TestRecvBurst(const BurstArgs& args, unsigned recvBatch) {
+   const size_t         pkSize = args.PkSize_;
+   const unsigned       burstCount = args.BurstCount_;
+   const unsigned       pkCountPerBurst = args.PkCountPerBurst_;
+   const uint64_t       expectedCount = static_cast<uint64_t>(burstCount) * pkCountPerBurst;
+   BurstSessionSP       ses{new BurstSession{pkSize, expectedCount}};
+   fon9::io::DeviceSP   dev = OpenReceiver(args, ses, recvBatch);
+   std::this_thread::sleep_for(std::chrono::milliseconds{100});
+   const uint16_t       port = args.Port_;
+
+   int fdSender = socket(AF_INET, SOCK_DGRAM, 0);
+   struct sockaddr_in addr;
+   fon9::ZeroStruct(addr);
+   addr.sin_family = AF_INET;
+   addr.sin_port = htons(port);
+   addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+   std::string pk(pkSize, 'x');
+
+   char msg[128];
+   sprintf(msg, "Recv|RecvBatch=%-3u|burst=%u*%u|pkSize=%u", recvBatch, burstCount, pkCountPerBurst, static_cast<unsigned>(pkSize));
+
+   uint64_t         sentCount = 0;
+   fon9::StopWatch  stopWatch;
+   for (unsigned b = 0; b < burstCount; ++b) {
+      for (unsigned L = 0; L < pkCountPerBurst; ++L) {
+         MakeBurstPk(pk, sentCount);
+         if (sendto(fdSender, pk.data(), pk.size(), 0, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) > 0)
+            ++sentCount;
+      }
+      WaitBurstReceived(*ses, sentCount);
+   }
+   CheckBurstResult(stopWatch, msg, *ses, sentCount, expectedCount);
+   close(fdSender);
+   CloseDgram(std::move(dev));
+}
+
+/// 在 2 個正常的 datagram 之間, 送出 1 個超過接收 slot(RecvBufferSize::Default => 4K) 的 datagram,
+/// 被截斷的 datagram 必須拋棄, 所以只會收到 2 個正常的 datagram.
+void TestRecvTruncated(const BurstArgs& args, unsigned recvBatch) {
+   const size_t         pkSize = args.PkSize_;
+   BurstSessionSP       ses{new BurstSession{pkSize, 2}};
+   fon9::io::DeviceSP   dev = OpenReceiver(args, ses, recvBatch);
+   std::this_thread::sleep_for(std::chrono::milliseconds{100});
+
+   int fdSender = socket(AF_INET, SOCK_DGRAM, 0);
+   struct sockaddr_in addr;
+   fon9::ZeroStruct(addr);
+   addr.sin_family = AF_INET;
+   addr.sin_port = htons(args.Port_);
+   addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+   std::string pk(pkSize, 'x');
+   std::string pkHuge(1024 * 8, 'x');
+
+   char msg[128];
+   sprintf(msg, "Recv|RecvBatch=%-3u|truncated=%u", recvBatch, static_cast<unsigned>(pkHuge.size()));
+
+   uint64_t         sentCount = 0;
+   fon9::StopWatch  stopWatch;
+   MakeBurstPk(pk, 0);
+   if (sendto(fdSender, pk.data(), pk.size(), 0, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) > 0)
+      ++sentCount;
+   MakeBurstPk(pkHuge, 1);
+   sendto(fdSender, pkHuge.data(), pkHuge.size(), 0, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr));
+   MakeBurstPk(pk, 1);
+   if (sendto(fdSender, pk.data(), pk.size(), 0, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) > 0)
+      ++sentCount;
+   WaitBurstReceived(*ses, sentCount + 1);
+   CheckBurstResult(stopWatch, msg, *ses, sentCount, 2);
+   close(fdSender);
+   CloseDgram(std::move(dev));
+}
+
+/// sendBatch == 0: 使用 SendASAP(): 每個 datagram 一次 write();
+/// sendBatch > 0:  使用 SendBuffered(): 在 fdr thread 透過 sendmmsg() 送出.
+void TestSendBurst(const BurstArgs& args, unsigned sendBatch) {
+   const size_t         pkSize = args.PkSize_;
+   const unsigned       burstCount = args.BurstCount_;
+   const unsigned       pkCountPerBurst = args.PkCountPerBurst_;
+   const uint64_t       expectedCount = static_cast<uint64_t>(burstCount) * pkCountPerBurst;
+   BurstSessionSP       sesRecv{new BurstSession{pkSize, expectedCount}};
+   fon9::io::DeviceSP   devRecv = OpenReceiver(args, sesRecv, 32);
+   BurstSessionSP       sesSend{new BurstSession{pkSize, 0}};
+   fon9::io::DeviceSP   devSend = OpenDgram(args, sesSend, fon9::RevPrintTo<std::string>("127.0.0.1:", args.Port_,
+                                                                                       "|SNDBUF=", 1024 * 1024 * 8,
+                                                                                       "|SendBatch=", sendBatch));
+   std::this_thread::sleep_for(std::chrono::milliseconds{100});
+   std::string          pk(pkSize, 'x');
+
+   char msg[128];
+   sprintf(msg, "Send|SendBatch=%-3u|burst=%u*%u|pkSize=%u", sendBatch, burstCount, pkCountPerBurst, static_cast<unsigned>(pkSize));
+
+   uint64_t         sentCount = 0;
+   fon9::StopWatch  stopWatch;
+   for (unsigned b = 0; b < burstCount; ++b) {
+      for (unsigned L = 0; L < pkCountPerBurst; ++L) {
+         MakeBurstPk(pk, sentCount);
+         if (sendBatch == 0)
+            devSend->SendASAP(pk.data(), pk.size());
+         else
+            devSend->SendBuffered(pk.data(), pk.size());
+         ++sentCount;
+      }
+      WaitBurstReceived(*sesRecv, sentCount);
+   }
+   CheckBurstResult(stopWatch, msg, *sesRecv, sentCount, expectedCount);
+   CloseDgram(std::move(devSend));
+   CloseDgram(std::move(devRecv));
+}
+
+int main(int argc, char** argv) {
+   fon9::AutoPrintTestInfo utinfo{"DgramBurst"};
+   std::this_thread::sleep_for(std::chrono::milliseconds{10}); // 等候其他 thread 啟動.
+   fon9::LogLevel_ = fon9::LogLevel::Warn;
+
+   const uint16_t port = static_cast<uint16_t>(argc > 1 ? fon9::StrTo(fon9::StrView_cstr(argv[1]), 0u) : 0u);
+   if (port == 0) {
+      std::cout << "Usage: DgramBurst_UT port [burstCount pkCountPerBurst pkSize]\n"
+                   "default: port=19998 burstCount=200 pkCountPerBurst=500 pkSize=100\n";
+   }
+   const unsigned burstCount      = (argc > 2 ? fon9::StrTo(fon9::StrView_cstr(argv[2]), 0u) : 200u);
+   const unsigned pkCountPerBurst = (argc > 3 ? fon9::StrTo(fon9::StrView_cstr(argv[3]), 0u) : 500u);
+   const size_t   pkSize          = std::max(kPkSeqSize, static_cast<size_t>(argc > 4 ? fon9::StrTo(fon9::StrView_cstr(argv[4]), 0u) : 100u));
+
+   fon9::io::IoServiceArgs iosvArgs;
+   iosvArgs.ThreadCount_ = 1;
+   fon9::io::FdrServiceEpoll::MakeResult err;
+   fon9::io::FdrServiceSP iosv = fon9::io::FdrServiceEpoll::MakeService(iosvArgs, "DgramBurst", err);
+   if (!iosv) {
+      std::cout << "IoService.MakeService|" << fon9::RevPrintTo<std::string>(err) << std::endl;
+      return 3;
+   }
+   const BurstArgs args{iosv, port ? port : static_cast<uint16_t>(19998), burstCount, pkCountPerBurst, pkSize};
+   static const unsigned batchList[] = {0, 8, 32, 64};
+   for (unsigned recvBatch : batchList)
+      TestRecvBurst(args, recvBatch);
+   TestRecvTruncated(args, 32);
+   utinfo.PrintSplitter();
+   for (unsigned sendBatch : batchList)
+      TestSendBurst(args, sendBatch);
+}
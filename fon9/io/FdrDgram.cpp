@@ -3,6 +3,7 @@
 #include "fon9/sys/Config.h"
 #ifdef fon9_POSIX
 #include "fon9/io/FdrDgram.hpp"
+#include "fon9/Log.hpp"
 
 namespace fon9 { namespace io {
 
@@ -38,5 +39,217 @@ void FdrDgramImpl::SocketError(StrView fnName, int eno) {
    base::SocketError(fnName, eno);
 }
 
+//--------------------------------------------------------------------------//
+
+#ifdef fon9_HAVE_SOCKET_MMSG
+bool DgramRecvSlots::Reserve(unsigned batchCount, size_t slotSize) {
+   if (fon9_LIKELY(this->Msgs_.size() == batchCount && this->SlotSize_ == slotSize))
+      return true;
+   assert(this->IsEmpty());
+   byte* mem = this->Mem_.Alloc(static_cast<MemBlockSize>(batchCount * slotSize));
+   if (mem == nullptr) {
+      this->Msgs_.clear();
+      this->SlotSize_ = 0;
+      return false;
+   }
+   this->SlotSize_ = slotSize;
+   this->Msgs_.resize(batchCount);
+   this->Iovs_.resize(batchCount);
+   for (unsigned L = 0; L < batchCount; ++L) {
+      struct iovec&   iov = this->Iovs_[L];
+      iov.iov_base = mem;
+      iov.iov_len = slotSize;
+      mem += slotSize;
+      struct mmsghdr& msg = this->Msgs_[L];
+      ZeroStruct(msg);
+      msg.msg_hdr.msg_iov = &iov;
+      msg.msg_hdr.msg_iovlen = 1;
+   }
+   return true;
+}
+int DgramRecvSlots::RecvFrom(Fdr::fdr_t fd) {
+   assert(this->IsEmpty());
+   this->Head_ = this->Count_ = 0;
+   int res = recvmmsg(fd, this->Msgs_.data(), static_cast<unsigned>(this->Msgs_.size()), 0, nullptr);
+   if (res > 0)
+      this->Count_ = static_cast<unsigned>(res);
+   return res;
+}
+DcQueueList* DgramRecvSlots::PopToRecvBuffer(RecvBuffer& rbuf, size_t& rxsz) {
+   assert(!this->IsEmpty());
+   const struct mmsghdr& msg = this->Msgs_[this->Head_++];
+   if (fon9_UNLIKELY(msg.msg_hdr.msg_flags & MSG_TRUNC)) {
+      // 只記錄第 1, 2, 4, 8... 次, 避免大量 log.
+      const uint64_t count = ++this->TruncatedCount_;
+      if ((count & (count - 1)) == 0)
+         fon9_LOG_WARN("DgramRecvSlots.Truncated|slotSize=", this->SlotSize_, "|rxsz=", msg.msg_len,
+                       "|truncatedCount=", count);
+      rxsz = 0;
+      return nullptr;
+   }
+   if ((rxsz = msg.msg_len) == 0)
+      return nullptr;
+   const byte*    src = static_cast<const byte*>(msg.msg_hdr.msg_iov->iov_base);
+   struct iovec   bufv[2];
+   size_t         bufCount = rbuf.GetRecvBlockVector(bufv, rxsz);
+   size_t         sz0 = (bufv[0].iov_len < rxsz ? bufv[0].iov_len : rxsz);
+   memcpy(bufv[0].iov_base, src, sz0);
+   if (sz0 < rxsz) {
+      assert(bufCount == 2);
+      memcpy(bufv[1].iov_base, src + sz0, rxsz - sz0);
+   }
+   (void)bufCount;
+   return &rbuf.SetDataReceived(rxsz);
+}
+
+//--------------------------------------------------------------------------//
+
+fon9_WARN_DISABLE_PADDING;
+struct FdrDgramImpl::BatchRecvAux : public FdrRecvAux {
+   FdrDgramImpl*  Impl_;
+   Device*        Device_;
+   bool (*FnIsRecvBufferAlive_)(Device& dev, RecvBuffer& rbuf);
+
+   bool IsRecvBufferAlive(Device& dev, RecvBuffer& rbuf) const {
+      return this->FnIsRecvBufferAlive_ == nullptr || this->FnIsRecvBufferAlive_(dev, rbuf);
+   }
+   /// - isEnableReadable == false: 在 fdr thread 的 CheckReadBatch() 觸發事件之後,
+   ///   剩餘的 datagrams 返回後由 CheckReadBatch() 繼續處理.
+   /// - isEnableReadable == true: 在 op thread 觸發事件之後(此時 readable 偵測已關閉),
+   ///   必須在此處理剩餘的 datagrams, 然後才能重新啟用 readable 偵測,
+   ///   否則若 socket 已無新資料, 則剩餘的 datagrams 將不會有機會處理.
+   void ContinueRecv(RecvBuffer& rbuf, RecvBufferSize expectSize, bool isEnableReadable) const {
+      if (isEnableReadable) {
+         DgramRecvSlots& slots = this->Impl_->RecvSlots_;
+         Device&         dev = *this->Device_;
+         while (expectSize >= RecvBufferSize::Default && !slots.IsEmpty()) {
+            if (dev.OpImpl_GetState() != io::State::LinkReady || !this->IsRecvBufferAlive(dev, rbuf)) {
+               slots.Clear();
+               return;
+            }
+            size_t rxsz;
+            if (DcQueueList* rxbuf = slots.PopToRecvBuffer(rbuf, rxsz)) {
+               expectSize = dev.Session_->OnDevice_Recv(dev, *rxbuf);
+               rbuf.SetContinueRecv();
+            }
+         }
+         if (expectSize < RecvBufferSize::Default)
+            slots.Clear();
+      }
+      FdrRecvAux::ContinueRecv(rbuf, expectSize, isEnableReadable);
+   }
+};
+fon9_WARN_POP;
+
+bool FdrDgramImpl::CheckReadBatch(Device& dev, bool (*fnIsRecvBufferAlive)(Device& dev, RecvBuffer& rbuf)) {
+   if (fon9_UNLIKELY(this->RecvSize_ < RecvBufferSize::Default)) {
+   __DROP_RECV:
+      // Session 決定不要再處理 OnDevice_Recv() 事件, 所以拋棄全部已收到的資料.
+      this->RecvSlots_.Clear();
+      return base::CheckRead(dev, fnIsRecvBufferAlive);
+   }
+   BatchRecvAux aux;
+   aux.Impl_ = this;
+   aux.Device_ = &dev;
+   aux.FnIsRecvBufferAlive_ = fnIsRecvBufferAlive;
+   size_t totrd = 0;
+   for (;;) {
+      bool isSocketEmpty = false;
+      if (this->RecvSlots_.IsEmpty()) {
+         size_t expectSize = (this->RecvSize_ == RecvBufferSize::Default
+                              ? 1024 * 4
+                              : static_cast<size_t>(this->RecvSize_));
+         if (expectSize < 64)
+            expectSize = 64;
+         if (fon9_UNLIKELY(!this->RecvSlots_.Reserve(this->RecvBatchCount_, expectSize)))
+            return base::CheckRead(dev, fnIsRecvBufferAlive);
+         int rdn = this->RecvSlots_.RecvFrom(this->GetFD());
+         if (fon9_UNLIKELY(rdn <= 0)) {
+            if (rdn < 0)
+               goto __READ_ERROR;
+            return true;
+         }
+         // 取出的數量, 比要求的少 => 資料已全部取出, 處理完這批之後就結束 Recv.
+         isSocketEmpty = (static_cast<unsigned>(rdn) < this->RecvSlots_.GetBatchCount());
+      }
+      do {
+         size_t rxsz;
+         DcQueueList* rxbuf = this->RecvSlots_.PopToRecvBuffer(this->RecvBuffer_, rxsz);
+         if (fon9_UNLIKELY(rxbuf == nullptr))
+            continue;
+         totrd += rxsz;
+         DeviceRecvBufferReady(dev, *rxbuf, aux);
+         // 到 op thread 處理 Recv 事件, 剩餘的 datagrams 會在 aux.ContinueRecv() 處理.
+         if (fon9_UNLIKELY(aux.IsNeedsUpdateFdrEvent_))
+            return true;
+         // 沒有呼叫 aux.ContinueRecv() => 已斷線.
+         if (fon9_UNLIKELY(this->RecvBuffer_.IsInvokingEvent())) {
+            this->RecvSlots_.Clear();
+            return true;
+         }
+         if (fon9_UNLIKELY(this->RecvSize_ < RecvBufferSize::Default))
+            goto __DROP_RECV;
+      } while (!this->RecvSlots_.IsEmpty());
+
+      if (isSocketEmpty)
+         return true;
+      // 避免一次占用太久, 所以先結束.
+      if (totrd > 1024 * 256)
+         return true;
+   }
+
+__READ_ERROR:
+   if (int eno = ErrorCannotRetry(errno)) {
+      this->SocketError("Recv", eno);
+      return false;
+   }
+   return true;
+}
+
+//--------------------------------------------------------------------------//
+
+int FdrDgramImpl::SendvBatch(DeviceOpLocker& sc, DcQueueList& toSend) {
+   struct iovec   bufv[kMaxSendBatchCount];
+   struct mmsghdr msgs[kMaxSendBatchCount];
+   size_t         msgCount = toSend.PeekBlockVector(bufv);
+   if (msgCount > this->SendBatchCount_)
+      msgCount = this->SendBatchCount_;
+   for (size_t L = 0; L < msgCount; ++L) {
+      ZeroStruct(msgs[L]);
+      msgs[L].msg_hdr.msg_iov = bufv + L;
+      msgs[L].msg_hdr.msg_iovlen = 1;
+   }
+__RETRY_SENDMMSG:
+   int msgSent = (msgCount ? sendmmsg(this->GetFD(), msgs, static_cast<unsigned>(msgCount), 0) : 0);
+   if (fon9_LIKELY(msgSent >= 0)) {
+      size_t wrsz = 0;
+      for (int L = 0; L < msgSent; ++L)
+         wrsz += msgs[L].msg_len;
+      toSend.PopConsumed(wrsz);
+      // 若僅送出部分 datagrams, 則剩餘的在 writable 時繼續送出;
+      // 此時若是因為下一個 datagram 的錯誤(e.g. EMSGSIZE), 則會在下次 sendmmsg() 時取得 errno.
+      if (fon9_LIKELY(toSend.empty()))
+         this->CheckSendQueueEmpty(sc);
+      else
+         this->EnableEventBit(FdrEventFlag::Writable);
+      return 0;
+   }
+   if (int eno = ErrorCannotRetry(errno)) {
+      if (eno == EMSGSIZE) { // Message too long.
+         // 第一個 datagram 太大, 與 FdrSocket::Sendv() 相同: 拆成 512 bytes 送出.
+         if (bufv[0].iov_len > 512) {
+            bufv[0].iov_len = 512;
+            msgCount = 1;
+            goto __RETRY_SENDMMSG;
+         }
+      }
+      this->SocketError("Sendv", eno);
+      return eno;
+   }
+   this->EnableEventBit(FdrEventFlag::Writable);
+   return 0;
+}
+#endif
+
 } } // namespaces
 #endif
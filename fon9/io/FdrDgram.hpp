@@ -4,9 +4,70 @@
 #define __fon9_io_FdrDgram_hpp__
 #include "fon9/io/DgramBase.hpp"
 #include "fon9/io/FdrSocketClient.hpp"
+#include "fon9/buffer/MemBlock.hpp"
+
+#ifdef __linux__
+/// 支援 recvmmsg(), sendmmsg();
+#define fon9_HAVE_SOCKET_MMSG
+#endif
 
 namespace fon9 { namespace io {
 
+#ifdef fon9_HAVE_SOCKET_MMSG
+fon9_WARN_DISABLE_PADDING;
+/// \ingroup io
+/// 使用 recvmmsg() 一次取回多個 datagram 時, 存放 datagram 的暫存區.
+/// - 預先分配 BatchCount 個 SlotSize 的 slot, 每個 slot 存放一個 datagram.
+/// - 取回的 datagram 在 [Head_..Count_) 之間, 依序取出後交給 RecvBuffer.
+/// - 超過 SlotSize 的 datagram 會被截斷(MSG_TRUNC), 內容不完整, 所以直接拋棄, 並計入 TruncatedCount.
+class DgramRecvSlots {
+   fon9_NON_COPY_NON_MOVE(DgramRecvSlots);
+   using MsgHdrs = std::vector<struct mmsghdr>;
+   using IoVecs = std::vector<struct iovec>;
+   MemBlock Mem_;
+   MsgHdrs  Msgs_;
+   IoVecs   Iovs_;
+   size_t   SlotSize_{0};
+   unsigned Head_{0};
+   unsigned Count_{0};
+   uint64_t TruncatedCount_{0};
+
+public:
+   DgramRecvSlots() = default;
+
+   /// 確定 slots 的數量 & 大小, 若有改變則重新分配.
+   /// 必須在 IsEmpty() 時才能呼叫.
+   bool Reserve(unsigned batchCount, size_t slotSize);
+
+   /// 透過 recvmmsg() 取回 datagram(s), 必須在 IsEmpty() 時才能呼叫.
+   /// \retval >=0 取回的 datagram 數量.
+   /// \retval <0  失敗, 此時可透過 errno 取得錯誤原因.
+   int RecvFrom(Fdr::fdr_t fd);
+
+   bool IsEmpty() const {
+      return this->Head_ >= this->Count_;
+   }
+   unsigned GetBatchCount() const {
+      return static_cast<unsigned>(this->Msgs_.size());
+   }
+   /// 因超過 SlotSize 被截斷而拋棄的 datagram 數量.
+   uint64_t GetTruncatedCount() const {
+      return this->TruncatedCount_;
+   }
+   /// 取出一個 datagram 並複製到 rbuf, 若為空的 datagram 則不複製.
+   /// - rxsz 填入 datagram 的大小.
+   /// - 被截斷的 datagram: 計入 TruncatedCount, rxsz = 0, 傳回 nullptr.
+   /// \retval nullptr 空的 datagram, 或被截斷的 datagram.
+   /// \retval else    rbuf.SetDataReceived(rxsz) 的傳回值.
+   DcQueueList* PopToRecvBuffer(RecvBuffer& rbuf, size_t& rxsz);
+   /// 拋棄尚未取出的 datagram(s).
+   void Clear() {
+      this->Head_ = this->Count_ = 0;
+   }
+};
+fon9_WARN_POP;
+#endif
+
 struct FdrDgramImpl : public FdrSocketClientImpl {
    fon9_NON_COPY_NON_MOVE(FdrDgramImpl);
    using base = FdrSocketClientImpl;
@@ -15,6 +76,24 @@ struct FdrDgramImpl : public FdrSocketClientImpl {
    virtual void OnFdrSocket_Error(std::string errmsg) override;
    virtual void SocketError(StrView fnName, int eno) override;
 
+#ifdef fon9_HAVE_SOCKET_MMSG
+   const unsigned RecvBatchCount_;
+   DgramRecvSlots RecvSlots_;
+   struct BatchRecvAux;
+   bool CheckReadBatch(Device& dev, bool (*fnIsRecvBufferAlive)(Device& dev, RecvBuffer& rbuf));
+
+   enum : unsigned {
+      kMaxSendBatchCount = 64,
+   };
+   const unsigned SendBatchCount_;
+   /// 使用 sendmmsg() 送出 toSend: 每個 node 為一個 datagram.
+   int SendvBatch(DeviceOpLocker& sc, DcQueueList& toSend);
+#endif
+
+   static FdrDgramImpl& StaticCast(SendBuffer& sbuf) {
+      return static_cast<FdrDgramImpl&>(ContainerOf(sbuf, &FdrDgramImpl::SendBuffer_));
+   }
+
 public:
    using OwnerDevice = DgramT<FdrServiceSP, FdrDgramImpl>;
    using OwnerDeviceSP = intrusive_ptr<OwnerDevice>;
@@ -22,16 +101,78 @@ public:
 
    FdrDgramImpl(OwnerDevice* owner, Socket&& so, SocketResult&)
       : base{*owner->IoService_, std::move(so)}
+   #ifdef fon9_HAVE_SOCKET_MMSG
+      , RecvBatchCount_{owner->GetRecvBatchCount()}
+      , SendBatchCount_{owner->GetSendBatchCount() < kMaxSendBatchCount
+                        ? owner->GetSendBatchCount() : static_cast<unsigned>(kMaxSendBatchCount)}
+   #endif
       , Owner_{owner} {
    }
    bool OpImpl_ConnectTo(const SocketAddress& addr, SocketResult& soRes);
+
+   /// 若有設定 RecvBatch, 則使用 recvmmsg() 一次取回多個 datagram,
+   /// 然後每個 datagram 個別觸發一次 OnDevice_Recv() 事件.
+   /// 否則使用 FdrSocket::CheckRead();
+   bool CheckRead(Device& dev, bool (*fnIsRecvBufferAlive)(Device& dev, RecvBuffer& rbuf)) {
+   #ifdef fon9_HAVE_SOCKET_MMSG
+      if (this->RecvBatchCount_ > 1)
+         return this->CheckReadBatch(dev, fnIsRecvBufferAlive);
+   #endif
+      return base::CheckRead(dev, fnIsRecvBufferAlive);
+   }
+
+   /// 若有設定 SendBatch, 則使用 sendmmsg() 一次送出多個 datagram: 每個 node 為一個 datagram.
+   /// 否則使用 FdrSocket::Sendv(); 將 toSend 合併成一個 datagram 送出.
+   int SendvDgram(DeviceOpLocker& sc, DcQueueList& toSend) {
+   #ifdef fon9_HAVE_SOCKET_MMSG
+      if (this->SendBatchCount_ > 1)
+         return this->SendvBatch(sc, toSend);
+   #endif
+      return this->Sendv(sc, toSend);
+   }
+
+   //--------------------------------------------------------------------------//
+
+   struct ContinueSendAux : public base::ContinueSendAux {
+      void ContinueToSend(ContinueSendChecker& sc, DcQueueList& toSend) const {
+         sc.GetALocker().UnlockForInplace();
+         StaticCast(SendBuffer::StaticCast(toSend)).SendvDgram(sc, toSend);
+      }
+   };
+
+   /// 每個 datagram 必須使用獨立的 node,
+   /// 避免放入 queue 時, 透過 AppendToBuffer() 併入前一個 datagram 的 node.
+   template <class AuxMemBase>
+   struct DgramAuxMem : public AuxMemBase {
+      using AuxMemBase::AuxMemBase;
+      void PushTo(BufferList& buf) {
+         FwdBufferNode* node = FwdBufferNode::Alloc(this->Size_);
+         byte*          ptrdst = node->GetDataEnd();
+         memcpy(ptrdst, this->Src_, this->Size_);
+         node->SetDataEnd(ptrdst + this->Size_);
+         buf.push_back(node);
+      }
+   };
+   using SendASAP_AuxMem = DgramAuxMem<base::SendASAP_AuxMem>;
+   using SendBuffered_AuxMem = DgramAuxMem<base::SendBuffered_AuxMem>;
+
+   struct SendASAP_AuxBuf : public SendAuxBuf {
+      using SendAuxBuf::SendAuxBuf;
+
+      Device::SendResult StartToSend(DeviceOpLocker& sc, DcQueueList& toSend) {
+         toSend.push_back(std::move(*this->Src_));
+         if (int eno = StaticCast(SendBuffer::StaticCast(toSend)).SendvDgram(sc, toSend))
+            return GetSysErrC(eno);
+         return Device::SendResult{0};
+      }
+   };
 };
 
 //--------------------------------------------------------------------------//
 
 /// \ingroup io
 /// 使用 fd 的實作的 Dgram.
-using FdrDgram = DeviceImpl_DeviceStartSend<FdrDgramImpl::OwnerDevice, FdrSocket>;
+using FdrDgram = DeviceImpl_DeviceStartSend<FdrDgramImpl::OwnerDevice, FdrDgramImpl>;
 
 } } // namespaces
 #endif//__fon9_io_FdrDgram_hpp__
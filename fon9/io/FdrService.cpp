@@ -60,10 +60,7 @@ void FdrThread::ProcessPendingSends() {
       sender->OnFdrEvent_StartSend();
 }
 void FdrThread::PushToPendingReqs(PendingReqs& reqs, FdrEventHandlerSP&& handler) {
-   {
-      PendingReqs::Locker lk{reqs};
-      lk->emplace_back(std::move(handler));
-   }
+   reqs.Emplace(std::move(handler));
    this->WakeupThread();
 }
 void FdrThread::WakeupThread() {
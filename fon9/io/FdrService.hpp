@@ -5,7 +5,7 @@
 #include "fon9/io/IoBase.hpp"
 #include "fon9/io/IoServiceArgs.hpp"
 #include "fon9/FdrNotify.hpp"
-#include "fon9/MustLock.hpp"
+#include "fon9/MpscQueue.hpp"
 #include "fon9/ThreadId.hpp"
 
 #include <thread>
@@ -44,7 +44,8 @@ fon9_ENABLE_ENUM_BITWISE_OP(FdrEventFlag);
 class FdrThread : public intrusive_ref_counter<FdrThread> {
 protected:
    using PendingReqsImpl = std::vector<FdrEventHandlerSP>;
-   using PendingReqs = MustLock<PendingReqsImpl>;
+   /// 任意 thread 都可加入要求(不用 lock), 只有 FdrThread 會取出.
+   using PendingReqs = MpscQueue<FdrEventHandlerSP>;
    PendingReqs       PendingUpdates_;
    PendingReqs       PendingSends_;
    PendingReqs       PendingRemoves_;
@@ -61,9 +62,13 @@ protected:
    static void OnFdrEvent_Emit(FdrEventFlag evs, FdrEventHandler* handler);
    static void SetFdrEventHandlerBookmark(FdrEventHandler* handler, uint64_t bookmark);
 
-   static PendingReqsImpl MoveOutPendingImpl(PendingReqs& impl) {
-      PendingReqs::Locker lk{impl};
-      return std::move(*lk);
+   /// 只能在 FdrThread 呼叫: 取出目前已加入的要求.
+   /// 處理這些要求時, 若有再加入的要求, 則留在 reqs, 等下次處理.
+   static PendingReqsImpl MoveOutPendingImpl(PendingReqs& reqs) {
+      PendingReqsImpl res;
+      while (reqs.PopFront([&res](FdrEventHandlerSP& sp) { res.emplace_back(std::move(sp)); })) {
+      }
+      return res;
    }
 
    void ProcessPendingSends();
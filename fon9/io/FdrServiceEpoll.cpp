@@ -59,12 +59,17 @@ void FdrThreadEpoll::ThrRunImpl(const ServiceThreadArgs& args) {
    EvHandlers  evHandlers{args.Capacity_};
    Fdr::fdr_t  epFdr = this->FdrEpoll_.GetFD();
    const int   kEpollWaitMS = (IsBlockWait(args.HowWait_) ? -1 : 0);
+   const bool  isAdaptiveWait = (args.HowWait_ == HowWait::Adaptive);
+   AdaptiveWaitCounter idleCounter;
    while (this->use_count() > 0) {
       // 再次進入 epoll_wait() 之前, 必須先將 Pending Removes, Updates 處理完,
       // 因為: 在 OnFdrEvent_Emit() 裡面關閉 readable, writable 偵測, 必須確實執行.
       // 避免: 當 Device 必須回到 op thread 觸發 OnDevice_Recv() 或 執行 send,
       //       如果沒有確實禁止 readable, writable, 則可能會發生非預期的結果.
       int msWait = kEpollWaitMS;
+      // Adaptive: 連續閒置已用完 spin, yield 的次數, 才進入 block 等候.
+      if (isAdaptiveWait && idleCounter.IsBlockStage(args.AdaptiveWait_))
+         msWait = -1;
       if (fon9_UNLIKELY(this->WakeupRequests_.load(std::memory_order_relaxed) != 0)) {
          this->ClearWakeup();
          this->ProcessPendings(epFdr, evHandlers);
@@ -76,6 +81,7 @@ void FdrThreadEpoll::ThrRunImpl(const ServiceThreadArgs& args) {
       struct epoll_event* pEvBeg = &*epEvents.begin();
       int epRes = epoll_wait(epFdr, pEvBeg, static_cast<int>(epEvents.size()), msWait);
       if (fon9_LIKELY(epRes > 0)) {
+         idleCounter.Reset();
          for (int L = 0; L < epRes; ++L, ++pEvBeg) {
             if (FdrEventHandler* hdr = static_cast<FdrEventHandler*>(pEvBeg->data.ptr)) {
                if (fon9_LIKELY(hdr->GetFdrEventHandlerBookmark() > 0)) {
@@ -104,6 +110,8 @@ void FdrThreadEpoll::ThrRunImpl(const ServiceThreadArgs& args) {
       else if (fon9_LIKELY(epRes == 0)) { // 如果 !Block, 則 epRes==0 是常態!
          if (args.HowWait_ == HowWait::Yield)
             std::this_thread::yield();
+         else if (isAdaptiveWait)
+            idleCounter.OnIdle(args.AdaptiveWait_);
       }
       else if (epRes < 0) {
          if (int eno = ErrorCannotRetry(errno))
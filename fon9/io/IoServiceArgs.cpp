@@ -24,6 +24,10 @@ ConfigParser::Result IoServiceArgs::OnTagValue(StrView tag, StrView& value) {
          return ConfigParser::Result::EInvalidValue;
       }
    }
+   else if (tag == "SpinCount")
+      this->AdaptiveWait_.SpinCount_ = StrTo(value, this->AdaptiveWait_.SpinCount_);
+   else if (tag == "YieldCount")
+      this->AdaptiveWait_.YieldCount_ = StrTo(value, this->AdaptiveWait_.YieldCount_);
    else if (tag == "Cpus") {
       while (!value.empty()) {
          StrView v1 = StrFetchTrim(value, ',');
@@ -14,7 +14,7 @@ namespace fon9 { namespace io {
 
 /// \ingroup io
 /// args: "ThreadCount=n|Wait=Policy|Cpus=List|Capacity=0"
-/// Policy: Block(default)
+/// Policy: Block(default), Yield, Busy, Adaptive(可再設定 SpinCount=n|YieldCount=n)
 struct fon9_API IoServiceArgs {
    /// 若有設定 CpuAffinity, 則每個 io service thread 會綁定一個固定的 cpu, 而不是所有的 thread 共用這裡設定的 cpu.
    /// 例如: ThreadCount_=3; CpuAffinity=0,1;
@@ -25,6 +25,8 @@ struct fon9_API IoServiceArgs {
 
    uint32_t ThreadCount_{2};
    HowWait  HowWait_{HowWait::Block};
+   /// HowWait_ == HowWait::Adaptive 時使用.
+   AdaptiveWaitArgs  AdaptiveWait_;
 
    /// 每個 io service thread 可服務的容量, 例如: MaxConnections.
    /// 0 = 由 io service 自行決定最佳值.
@@ -43,7 +45,9 @@ struct fon9_API IoServiceArgs {
    /// ------------|------------------------------
    /// ThreadCount | > 0
    /// Capacity    | >= 0
-   /// Wait        | "Block" or "Busy" or "Yield"
+   /// Wait        | "Block" or "Busy" or "Yield" or "Adaptive"
+   /// SpinCount   | Wait=Adaptive 時, 沒有事件時先 spin 的次數.
+   /// YieldCount  | Wait=Adaptive 時, spin 之後再 yield 的次數, 之後才進入 block 等候.
    /// Cpus        | c0, c1, c2 ... 根據 thread pool index 依序選擇 c0 或 c1 或 c2...
    ConfigParser::Result OnTagValue(StrView tag, StrView& value);
 };
@@ -55,6 +59,7 @@ struct fon9_API ServiceThreadArgs {
    size_t      ThreadPoolIndex_;
    int         CpuAffinity_;
    HowWait     HowWait_;
+   AdaptiveWaitArgs  AdaptiveWait_;
    size_t      Capacity_;
 
    ServiceThreadArgs() = default;
@@ -63,6 +68,7 @@ struct fon9_API ServiceThreadArgs {
       , ThreadPoolIndex_{index}
       , CpuAffinity_{ioArgs.GetCpuAffinity(index)}
       , HowWait_{ioArgs.HowWait_}
+      , AdaptiveWait_{ioArgs.AdaptiveWait_}
       , Capacity_{ioArgs.Capacity_} {
    }
 
@@ -7,6 +7,10 @@
 #include "fon9/Worker.hpp"
 #include "fon9/ThreadId.hpp"
 
+fon9_BEFORE_INCLUDE_STD;
+#include <deque>
+fon9_AFTER_INCLUDE_STD;
+
 namespace fon9 { namespace io {
 
 void DomainNameParser::Reset(std::string dn, port_t defaultPortNo) {
@@ -173,5 +173,15 @@ __ERROR_cstrErrFieldName:
       cstrErrFieldName = "AcceptedClientOptions_";
       goto __ERROR_cstrErrFieldName;
    }
+
+   fon9::io::IoServiceArgs iosvArgs;
+   fon9::RevBufferList     rbuf{128};
+   if (!fon9::ParseConfig(iosvArgs, "Wait=Adaptive|SpinCount=1000|YieldCount=10", rbuf)) {
+      cstrErrFieldName = "Wait=Adaptive";
+      goto __ERROR_cstrErrFieldName;
+   }
+   CHECK_VALUE(iosvArgs, HowWait_,                 fon9::HowWait::Adaptive);
+   CHECK_VALUE(iosvArgs, AdaptiveWait_.SpinCount_,  1000u);
+   CHECK_VALUE(iosvArgs, AdaptiveWait_.YieldCount_, 10u);
    std::cout << "\r[OK   ]" << std::endl;
 }
@@ -38,10 +38,15 @@ void IocpService::ThrRun(CompletionPortHandleSP cpHandleSP, ServiceThreadArgs ar
    OVERLAPPED* lpOverlapped;
    DWORD       bytesTransfered;
    const DWORD dwMilliseconds = (IsBlockWait(args.HowWait_) ? INFINITE : 0);
+   const bool  isAdaptiveWait = (args.HowWait_ == HowWait::Adaptive);
+   AdaptiveWaitCounter idleCounter;
    HANDLE      cpHandle = cpHandleSP->GetFD();
    for (;;) {
       ULONG_PTR   iocpHandler = kIocpKey_StopThrRun;
-      if (::GetQueuedCompletionStatus(cpHandle, &bytesTransfered, &iocpHandler, &lpOverlapped, dwMilliseconds)) {
+      // Adaptive: 連續閒置已用完 spin, yield 的次數, 才進入 block 等候.
+      const DWORD msWait = ((isAdaptiveWait && idleCounter.IsBlockStage(args.AdaptiveWait_)) ? INFINITE : dwMilliseconds);
+      if (::GetQueuedCompletionStatus(cpHandle, &bytesTransfered, &iocpHandler, &lpOverlapped, msWait)) {
+         idleCounter.Reset();
          if (iocpHandler == kIocpKey_StopThrRun)
             break;
          reinterpret_cast<IocpHandler*>(iocpHandler)->OnIocp_Done(lpOverlapped, bytesTransfered);
@@ -50,6 +55,8 @@ void IocpService::ThrRun(CompletionPortHandleSP cpHandleSP, ServiceThreadArgs ar
          if (lpOverlapped == nullptr) { // timeout.
             if (args.HowWait_ == HowWait::Yield)
                std::this_thread::yield();
+            else if (isAdaptiveWait)
+               idleCounter.OnIdle(args.AdaptiveWait_);
             continue;
          }
          DWORD eno = GetLastError();
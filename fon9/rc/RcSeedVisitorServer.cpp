@@ -509,9 +509,26 @@ static size_t PutGridViewBuffer(RevBufferList& rbuf, SeedNotifyArgsT& e) {
    return sz + ByteArrayToBitv_NoEmpty(rbuf, gvStr->c_str(), sz);
 }
 
+// 同一次通知的多個 rc 訂閱者, 共用打包好的 gv.
+struct RcSvFanoutCache : public seed::SeedNotifyArgs::SubrCache, public RcFanoutPayload {
+   fon9_NON_COPY_NON_MOVE(RcSvFanoutCache);
+   RcSvFanoutCache() = default;
+};
+static RcFanoutPayload& GetFanoutGridView(const seed::SeedNotifyArgs& e) {
+   if (auto* cache = dynamic_cast<RcSvFanoutCache*>(e.SubrCache_.get()))
+      return *cache;
+   RcSvFanoutCache* cache = new RcSvFanoutCache;
+   e.SubrCache_.reset(cache);
+   RevBufferList rbuf{64};
+   ToBitv(rbuf, e.GetGridView());
+   cache->Assign(std::move(rbuf));
+   return *cache;
+}
+
 void RcSeedVisitorServerNote::OnSubscribeNotify(SubrRegSP preg, const seed::SeedNotifyArgs& e) {
-   RevBufferList ackbuf{128};
-   RcSession&    ses = *static_cast<RcSession*>(preg->Device_->Session_.get());
+   RevBufferList     ackbuf{128};
+   RcSession&        ses = *static_cast<RcSession*>(preg->Device_->Session_.get());
+   RcFanoutPayload*  fanout = nullptr;
    switch (e.NotifyKind_) {
    default: // Unknown NotifyKind;
       return;
@@ -546,7 +563,8 @@ void RcSeedVisitorServerNote::OnSubscribeNotify(SubrRegSP preg, const seed::Seed
       }
       return;
    case seed::SeedNotifyKind::TableChanged:
-      ToBitv(ackbuf, e.GetGridView());
+      fanout = &GetFanoutGridView(e);
+      fanout->PutTo(ackbuf);
       break;
    case seed::SeedNotifyKind::StreamRecover:
    case seed::SeedNotifyKind::StreamRecoverEnd:
@@ -569,7 +587,8 @@ void RcSeedVisitorServerNote::OnSubscribeNotify(SubrRegSP preg, const seed::Seed
       /* fall through */ // 繼續處理 gv 及 key 填入 ackbuf;
    case seed::SeedNotifyKind::SeedChanged:
    case seed::SeedNotifyKind::StreamData:
-      ToBitv(ackbuf, e.GetGridView());
+      fanout = &GetFanoutGridView(e);
+      fanout->PutTo(ackbuf);
       goto __CHECK_PUT_KEY_FOR_SUBR_TREE;
    case seed::SeedNotifyKind::PodRemoved:
    case seed::SeedNotifyKind::SeedRemoved:
@@ -588,7 +607,10 @@ void RcSeedVisitorServerNote::OnSubscribeNotify(SubrRegSP preg, const seed::Seed
    }
    ToBitv(ackbuf, preg->SubrIndex_);
    PutBigEndian(ackbuf.AllocBuffer(sizeof(SvFunc)), SvFuncSubscribeData(e.NotifyKind_));
-   ses.Send(f9rc_FunctionCode_SeedVisitor, std::move(ackbuf));
+   if (fanout)
+      ses.Send(f9rc_FunctionCode_SeedVisitor, std::move(ackbuf), *fanout);
+   else
+      ses.Send(f9rc_FunctionCode_SeedVisitor, std::move(ackbuf));
 }
 
 } } // namespaces
@@ -22,17 +22,32 @@ namespace fon9 { namespace rc {
 #define cstrProtocolHeadErr            cstrProtocolHead cstrProtocolHeadVer ":err="
 //--------------------------------------------------------------------------//
 using ChecksumT = RcSession::ChecksumT;
-static inline ChecksumT FeedCalcCheckSum(ChecksumT cksum, const byte* ptr, size_t sz) {
-   do {
-      cksum = static_cast<ChecksumT>((((cksum & 1) << 15) | (cksum >> 1)) + *ptr++);
-   } while (--sz > 0);
+static inline ChecksumT RcChecksumStep(ChecksumT cksum, byte b) {
+   return static_cast<ChecksumT>(static_cast<ChecksumT>((cksum >> 1) | (cksum << 15)) + b);
+}
+fon9_API ChecksumT RcChecksumFeed(ChecksumT cksum, const void* mem, size_t sz) {
+   // rotate-and-add: 每個 byte 都相依於前一個結果, 無法平行計算.
+   // 所以這裡僅展開迴圈, 減少迴圈控制的負擔, 讓 compiler 產生連續的 ror + add.
+   const byte* ptr = reinterpret_cast<const byte*>(mem);
+   for (; sz >= 8; sz -= 8, ptr += 8) {
+      cksum = RcChecksumStep(cksum, ptr[0]);
+      cksum = RcChecksumStep(cksum, ptr[1]);
+      cksum = RcChecksumStep(cksum, ptr[2]);
+      cksum = RcChecksumStep(cksum, ptr[3]);
+      cksum = RcChecksumStep(cksum, ptr[4]);
+      cksum = RcChecksumStep(cksum, ptr[5]);
+      cksum = RcChecksumStep(cksum, ptr[6]);
+      cksum = RcChecksumStep(cksum, ptr[7]);
+   }
+   for (; sz > 0; --sz)
+      cksum = RcChecksumStep(cksum, *ptr++);
    return cksum;
 }
 static ChecksumT BufferList_CalcRcChecksum(const BufferNode* node) {
    ChecksumT cksum = 0;
    while (node) {
       if (auto sz = node->GetDataSize())
-         cksum = FeedCalcCheckSum(cksum, node->GetDataBegin(), sz);
+         cksum = RcChecksumFeed(cksum, node->GetDataBegin(), sz);
       node = node->GetNext();
    }
    return cksum;
@@ -44,7 +59,7 @@ static ChecksumT FuncParam_CalcRcChecksum(DcQueueList& buf, f9rc_FunctionCode fu
    if (size_t blksz = buf.GetCurrBlockSize()) {
       if (blksz > paramSize)
          blksz = paramSize;
-      cksum = FeedCalcCheckSum(cksum, buf.Peek1(), blksz);
+      cksum = RcChecksumFeed(cksum, buf.Peek1(), blksz);
       if ((paramSize -= blksz) <= 0)
          return cksum;
    }
@@ -53,7 +68,7 @@ static ChecksumT FuncParam_CalcRcChecksum(DcQueueList& buf, f9rc_FunctionCode fu
          if (size_t nodesz = node->GetDataSize()) {
             if (nodesz > paramSize)
                nodesz = paramSize;
-            cksum = FeedCalcCheckSum(cksum, node->GetDataBegin(), nodesz);
+            cksum = RcChecksumFeed(cksum, node->GetDataBegin(), nodesz);
             if ((paramSize -= nodesz) <= 0)
                return cksum;
          }
@@ -61,6 +76,59 @@ static ChecksumT FuncParam_CalcRcChecksum(DcQueueList& buf, f9rc_FunctionCode fu
    }
    return cksum;
 }
+// 計算 rbuf 前方 sz bytes 的 checksum.
+static ChecksumT BufferList_CalcRcChecksum(const BufferNode* node, size_t sz) {
+   ChecksumT cksum = 0;
+   while (node && sz > 0) {
+      if (size_t nodesz = node->GetDataSize()) {
+         if (nodesz > sz)
+            nodesz = sz;
+         cksum = RcChecksumFeed(cksum, node->GetDataBegin(), nodesz);
+         sz -= nodesz;
+      }
+      node = node->GetNext();
+   }
+   return cksum;
+}
+static void RcFramePacketHeader(f9rc_FunctionCode fnCode, RevBufferList& rbuf) {
+   ByteArraySizeToBitvT(rbuf, CalcDataSize(rbuf.cfront()));
+   char* pout = rbuf.AllocPrefix(sizeof(fnCode));
+   PutBigEndian(pout -= sizeof(fnCode), fnCode);
+   rbuf.SetPrefixUsed(pout);
+}
+static void RcFramePacketChecksum(RevBufferList& rbuf, ChecksumT cksum) {
+   char* pout = rbuf.AllocPrefix(sizeof(ChecksumT));
+   PutBigEndian(pout -= sizeof(ChecksumT), cksum);
+   rbuf.SetPrefixUsed(pout);
+}
+fon9_API void RcFramePacket(f9rc_FunctionCode fnCode, RevBufferList& rbuf, bool isNoChecksum) {
+   RcFramePacketHeader(fnCode, rbuf);
+   if (!isNoChecksum)
+      RcFramePacketChecksum(rbuf, BufferList_CalcRcChecksum(rbuf.cfront()));
+}
+fon9_API void RcFramePacket(f9rc_FunctionCode fnCode, RevBufferList& rbuf, bool isNoChecksum, RcFanoutPayload& payload) {
+   RcFramePacketHeader(fnCode, rbuf);
+   if (!isNoChecksum) {
+      const size_t datsz = CalcDataSize(rbuf.cfront());
+      assert(datsz >= payload.size());
+      RcFramePacketChecksum(rbuf, payload.CalcChecksum(
+         BufferList_CalcRcChecksum(rbuf.cfront(), datsz - payload.size())));
+   }
+}
+//--------------------------------------------------------------------------//
+void RcFanoutPayload::Assign(RevBufferList&& rbuf) {
+   this->Assign(BufferTo<std::string>(rbuf.MoveOut()));
+}
+RcFanoutPayload::ChecksumT RcFanoutPayload::CalcChecksum(ChecksumT prevState) {
+   // prevState 的低位元變化不大(header 只差 SubrIndex), 所以先混合高低位元再取位置.
+   const uint32_t key = static_cast<uint32_t>(prevState) | kMemoKeyUsed;
+   ChecksumMemo&  memo = this->Memo_[((prevState * 40503u) & 0xffffu) >> 10];
+   if (memo.Key_ == key)
+      return memo.Result_;
+   memo.Key_ = key;
+   memo.Result_ = RcChecksumFeed(prevState, this->Payload_.data(), this->Payload_.size());
+   return memo.Result_;
+}
 //--------------------------------------------------------------------------//
 RcSession::RcSession(RcFunctionMgrSP mgr, RcSessionRole role, f9rc_RcFlag flags)
    : FunctionMgr_(std::move(mgr))
@@ -114,15 +182,12 @@ io::RecvBufferSize RcSession::OnDevice_LinkReady(io::Device& dev) {
    return kRcSession_RecvBufferSize;
 }
 void RcSession::Send(f9rc_FunctionCode fnCode, RevBufferList&& rbuf) {
-   ByteArraySizeToBitvT(rbuf, CalcDataSize(rbuf.cfront()));
-   char* pout = rbuf.AllocPrefix(sizeof(fnCode));
-   PutBigEndian(pout -= sizeof(fnCode), fnCode);
-   rbuf.SetPrefixUsed(pout);
-   if (!this->LocalParam_.IsNoChecksum()) {
-      pout = rbuf.AllocPrefix(sizeof(ChecksumT));
-      PutBigEndian(pout -= sizeof(ChecksumT), BufferList_CalcRcChecksum(rbuf.cfront()));
-      rbuf.SetPrefixUsed(pout);
-   }
+   RcFramePacket(fnCode, rbuf, this->LocalParam_.IsNoChecksum());
+   this->Dev_->Send(rbuf.MoveOut());
+   this->LastSentTime_ = UtcNow();
+}
+void RcSession::Send(f9rc_FunctionCode fnCode, RevBufferList&& rbuf, RcFanoutPayload& payload) {
+   RcFramePacket(fnCode, rbuf, this->LocalParam_.IsNoChecksum(), payload);
    this->Dev_->Send(rbuf.MoveOut());
    this->LastSentTime_ = UtcNow();
 }
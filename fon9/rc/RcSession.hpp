@@ -24,6 +24,8 @@ enum class RcSessionRole : int8_t {
 };
 fon9_ENABLE_ENUM_BITWISE_OP(RcSessionRole);
 
+class RcFanoutPayload;
+
 /// \ingroup rc
 /// 使用 f9rc 協定的處理程序.
 class fon9_API RcSession : public io::Session {
@@ -43,6 +45,10 @@ public:
    /// - checksum(如果需要) + fnCode + ByteArraySizeToBitvT(rbuf的資料量)
    /// - 若 if (!this->LocalParam_.IsNoChecksum()) 則加上 checksum.
    void Send(f9rc_FunctionCode fnCode, RevBufferList&& rbuf);
+   /// 同一份資料送給多個 session 時(fan-out) 使用.
+   /// - rbuf 的尾端必須是 payload: 先呼叫 payload.PutTo(rbuf); 然後才填入此 session 自己的 header.
+   /// - 若需要 checksum, 則 payload 部分的 checksum 由 payload 記憶, 不一定需要重算.
+   void Send(f9rc_FunctionCode fnCode, RevBufferList&& rbuf, RcFanoutPayload& payload);
 
    /// 發生嚴重錯誤, 強制結束 Session.
    void ForceLogout(std::string reason);
@@ -177,5 +183,77 @@ private:
    Notes Notes_;
 };
 
+/// \ingroup rc
+/// f9rc 的 checksum 計算: 從 cksum 狀態開始, 將 [mem, mem+sz) 加入計算.
+/// - 可分段計算: RcChecksumFeed(RcChecksumFeed(0, A), B) == RcChecksumFeed(0, A+B);
+/// - 但不能任意組合: 必須知道前一段的結果, 才能計算下一段.
+///   若同一段資料需要重複計算(例: fan-out), 可參考 RcFanoutPayload 的做法.
+fon9_API RcSession::ChecksumT RcChecksumFeed(RcSession::ChecksumT cksum, const void* mem, size_t sz);
+
+/// \ingroup rc
+/// 在 rbuf 前方加上 f9rc 的封包框架:
+/// checksum(若 isNoChecksum==false) + fnCode + ByteArraySizeToBitvT(rbuf的資料量).
+fon9_API void RcFramePacket(f9rc_FunctionCode fnCode, RevBufferList& rbuf, bool isNoChecksum);
+/// rbuf 的尾端必須是 payload, 請參考 RcSession::Send(fnCode, rbuf, payload);
+fon9_API void RcFramePacket(f9rc_FunctionCode fnCode, RevBufferList& rbuf, bool isNoChecksum, RcFanoutPayload& payload);
+
+fon9_WARN_DISABLE_PADDING;
+/// \ingroup rc
+/// 同一份資料需要送給多個 RcSession 時(例: 訂閱通知的 fan-out), 共用的尾端資料.
+/// - 資料只打包一次, 每個 session 只需複製打包好的 bytes, 然後在前方加上自己的 header.
+/// - f9rc 的 checksum 為 rotate-and-add, 無法由「header 的 checksum」與「payload 的 checksum」直接組合;
+///   所以記錄「計算到 payload 之前的 checksum 狀態 => 最終 checksum」,
+///   header 相同(例: 相同的 SubrIndex) 的 session, 不必重算 payload 的 checksum.
+/// - 記憶表使用 prevState 直接對應(kMemoCount 個位置), 碰撞時覆蓋;
+///   不同 header 的數量 > kMemoCount 時, 命中率約為 kMemoCount / 不同header數量.
+/// - 非 thread safe: 應在同一次通知(同一個 thread) 裡面使用.
+class fon9_API RcFanoutPayload {
+   fon9_NON_COPY_NON_MOVE(RcFanoutPayload);
+   using ChecksumT = RcSession::ChecksumT;
+   enum {
+      /// 必須與 CalcChecksum() 取位置的方式配合: 16 bits 乘法雜湊的高 6 bits.
+      kMemoCount = 64,
+      /// ChecksumMemo::Key_ 的有效旗標, 低 16 bits 為 prevState.
+      kMemoKeyUsed = 0x10000,
+   };
+   struct ChecksumMemo {
+      uint32_t    Key_;
+      ChecksumT   Result_;
+   };
+   std::string    Payload_;
+   ChecksumMemo   Memo_[kMemoCount];
+   void ClearMemo() {
+      for (ChecksumMemo& memo : this->Memo_)
+         memo.Key_ = 0;
+   }
+
+public:
+   RcFanoutPayload() {
+      this->ClearMemo();
+   }
+
+   /// 設定已打包好的 payload, 並清除 checksum 的記憶.
+   void Assign(RevBufferList&& rbuf);
+   void Assign(std::string&& payload) {
+      this->Payload_ = std::move(payload);
+      this->ClearMemo();
+   }
+
+   const std::string& GetPayload() const {
+      return this->Payload_;
+   }
+   size_t size() const {
+      return this->Payload_.size();
+   }
+   /// 將 payload 複製到 rbuf 的前方.
+   void PutTo(RevBufferList& rbuf) const {
+      if (!this->Payload_.empty())
+         RevPutMem(rbuf, this->Payload_.data(), this->Payload_.size());
+   }
+   /// 從 prevState 開始, 計算 payload 之後的 checksum.
+   ChecksumT CalcChecksum(ChecksumT prevState);
+};
+fon9_WARN_POP;
+
 } } // namespaces
 #endif//__fon9_rc_RcSession_hpp__
@@ -187,6 +187,160 @@ struct ClientTester {
    }
 };
 //--------------------------------------------------------------------------//
+// 原本(逐 byte)的 checksum 計算, 用來驗證 RcChecksumFeed() 的結果, 及比較效率.
+static fon9::rc::RcSession::ChecksumT RefChecksum(fon9::rc::RcSession::ChecksumT cksum, const void* mem, size_t sz) {
+   const fon9::byte* ptr = reinterpret_cast<const fon9::byte*>(mem);
+   for (; sz > 0; --sz)
+      cksum = static_cast<fon9::rc::RcSession::ChecksumT>((((cksum & 1) << 15) | (cksum >> 1)) + *ptr++);
+   return cksum;
+}
+static std::string MakeChecksumTestMem() {
+   std::string mem(64 * 1024, '\0');
+   for (size_t L = 0; L < mem.size(); ++L)
+      mem[L] = static_cast<char>((L * 131) + (L >> 7));
+   return mem;
+}
+/// 檢查 RcChecksumFeed() 及 RcFanoutPayload::CalcChecksum() 的結果, 必須與 RefChecksum() 相同.
+static void TestChecksum() {
+   std::cout << "[TEST ] RcChecksumFeed: compare with RefChecksum().";
+   const std::string mem = MakeChecksumTestMem();
+   // 結果相同, 且可分段計算.
+   for (size_t sz = 0; sz < 300; ++sz) {
+      const auto res = RefChecksum(0, mem.data(), sz);
+      if (fon9::rc::RcChecksumFeed(0, mem.data(), sz) != res) {
+         std::cout << "|sz=" << sz << "\r[ERROR]" << std::endl;
+         abort();
+      }
+      for (size_t split = 0; split <= sz; split += 7) {
+         if (fon9::rc::RcChecksumFeed(fon9::rc::RcChecksumFeed(0, mem.data(), split), mem.data() + split, sz - split) != res) {
+            std::cout << "|sz=" << sz << "|split=" << split << "\r[ERROR]" << std::endl;
+            abort();
+         }
+      }
+   }
+   std::cout << "\r[OK   ]" << std::endl;
+
+   std::cout << "[TEST ] RcFanoutPayload: CalcChecksum().";
+   fon9::rc::RcFanoutPayload fanout;
+   fanout.Assign(std::string(mem.data(), 1000));
+   // 不同的 prevState 數量超過記憶的數量, 且重複計算, 測試記憶的取用及淘汰.
+   for (unsigned round = 0; round < 3; ++round) {
+      for (unsigned L = 0; L < 200; ++L) {
+         const auto prevState = fon9::rc::RcChecksumFeed(0, mem.data() + L, 8);
+         if (fanout.CalcChecksum(prevState) != RefChecksum(prevState, mem.data(), 1000)) {
+            std::cout << "|round=" << round << "|L=" << L << "\r[ERROR]" << std::endl;
+            abort();
+         }
+      }
+   }
+   std::cout << "\r[OK   ]" << std::endl;
+}
+static void BenchChecksum() {
+   std::cout << "[BenchChecksum]" << std::endl;
+   const std::string mem = MakeChecksumTestMem();
+   fon9::StopWatch   stopWatch;
+   char              msg[128];
+   volatile unsigned sink = 0;
+   for (size_t blksz : {64u, 1024u, 64u * 1024u}) {
+      const size_t kTimes = (64u * 1024u * 1024u) / blksz;
+      stopWatch.ResetTimer();
+      for (size_t L = 0; L < kTimes; ++L)
+         sink = sink + RefChecksum(static_cast<fon9::rc::RcSession::ChecksumT>(L), mem.data(), blksz);
+      sprintf(msg, "RefChecksum   |blksz=%6u", static_cast<unsigned>(blksz));
+      stopWatch.PrintResult(msg, kTimes);
+
+      stopWatch.ResetTimer();
+      for (size_t L = 0; L < kTimes; ++L)
+         sink = sink + fon9::rc::RcChecksumFeed(static_cast<fon9::rc::RcSession::ChecksumT>(L), mem.data(), blksz);
+      sprintf(msg, "RcChecksumFeed|blksz=%6u", static_cast<unsigned>(blksz));
+      stopWatch.PrintResult(msg, kTimes);
+
+      // 已打包的 payload, 只需計算新的 header(8 bytes), payload 的部分使用記憶的結果.
+      // 模擬 4 種不同的 header(例: 不同的 SubrIndex).
+      fon9::rc::RcFanoutPayload fanout;
+      fanout.Assign(std::string(mem.data(), blksz));
+      stopWatch.ResetTimer();
+      for (size_t L = 0; L < kTimes; ++L)
+         sink = sink + fanout.CalcChecksum(fon9::rc::RcChecksumFeed(0, mem.data() + (L % 4), 8));
+      sprintf(msg, "CachedPayload |blksz=%6u", static_cast<unsigned>(blksz));
+      stopWatch.PrintResult(msg, kTimes);
+   }
+}
+//--------------------------------------------------------------------------//
+// 同一份資料送給 subrCount 個訂閱者: 比較「每個訂閱者各自打包」與「共用 RcFanoutPayload」的成本.
+static void BuildSubrHeader(fon9::RevBufferList& rbuf, unsigned subrIndex) {
+   fon9::ToBitv(rbuf, subrIndex);
+   *rbuf.AllocBuffer(1) = 0x12; // SvFunc;
+}
+static void BenchFanout(bool isNoChecksum) {
+   std::cout << "[BenchFanout] " << (isNoChecksum ? "NoChecksum" : "Checksum") << std::endl;
+   std::string gv(200, 'x');
+   for (size_t L = 0; L < gv.size(); ++L)
+      gv[L] = static_cast<char>(L * 7);
+   const unsigned kTimes = 2000;
+   // 檢查結果是否相同: 不同的 SubrIndex 數量超過 checksum 記憶的數量.
+   const unsigned kSubrIndexVariants = 200;
+   {
+      fon9::rc::RcFanoutPayload  fanout;
+      fon9::RevBufferList        rbuf{64};
+      fon9::ToBitv(rbuf, fon9::StrView{&gv});
+      fanout.Assign(std::move(rbuf));
+      for (unsigned subrIndex = 0; subrIndex < kSubrIndexVariants * 2; ++subrIndex) {
+         fon9::RevBufferList rbufOld{128};
+         fon9::ToBitv(rbufOld, fon9::StrView{&gv});
+         BuildSubrHeader(rbufOld, subrIndex % kSubrIndexVariants);
+         fon9::rc::RcFramePacket(RcFuncCode_Test, rbufOld, isNoChecksum);
+         fon9::RevBufferList rbufNew{128};
+         fanout.PutTo(rbufNew);
+         BuildSubrHeader(rbufNew, subrIndex % kSubrIndexVariants);
+         fon9::rc::RcFramePacket(RcFuncCode_Test, rbufNew, isNoChecksum, fanout);
+         if (fon9::BufferTo<std::string>(rbufOld.MoveOut()) != fon9::BufferTo<std::string>(rbufNew.MoveOut())) {
+            std::cout << "[ERROR] RcFanoutPayload: packet mismatch." << std::endl;
+            abort();
+         }
+      }
+   }
+   fon9::StopWatch stopWatch;
+   char            msg[128];
+   // 同一個商品的訂閱者, SubrIndex 取決於各 client 的訂閱順序, 所以不同的 SubrIndex 數量,
+   // 可能接近訂閱者數量(distinct=0 表示每個訂閱者的 SubrIndex 都不同).
+   for (unsigned subrCount : {1u, 10u, 100u, 500u}) {
+      stopWatch.ResetTimer();
+      for (unsigned L = 0; L < kTimes; ++L) {
+         for (unsigned subrIndex = 0; subrIndex < subrCount; ++subrIndex) {
+            fon9::RevBufferList rbuf{128};
+            fon9::ToBitv(rbuf, fon9::StrView{&gv});
+            BuildSubrHeader(rbuf, subrIndex);
+            fon9::rc::RcFramePacket(RcFuncCode_Test, rbuf, isNoChecksum);
+            rbuf.MoveOut();
+         }
+      }
+      sprintf(msg, "PerSubr|subrCount=%4u", subrCount);
+      stopWatch.PrintResult(msg, kTimes);
+
+      for (unsigned distinct : {4u, 64u, 0u}) {
+         if (distinct >= subrCount)
+            continue;
+         stopWatch.ResetTimer();
+         for (unsigned L = 0; L < kTimes; ++L) {
+            fon9::rc::RcFanoutPayload  fanout;
+            fon9::RevBufferList        rbufPayload{64};
+            fon9::ToBitv(rbufPayload, fon9::StrView{&gv});
+            fanout.Assign(std::move(rbufPayload));
+            for (unsigned subrIndex = 0; subrIndex < subrCount; ++subrIndex) {
+               fon9::RevBufferList rbuf{128};
+               fanout.PutTo(rbuf);
+               BuildSubrHeader(rbuf, distinct ? (subrIndex % distinct) : subrIndex);
+               fon9::rc::RcFramePacket(RcFuncCode_Test, rbuf, isNoChecksum, fanout);
+               rbuf.MoveOut();
+            }
+         }
+         sprintf(msg, "Fanout |subrCount=%4u|distinct=%3u", subrCount, distinct ? distinct : subrCount);
+         stopWatch.PrintResult(msg, kTimes);
+      }
+   }
+}
+//--------------------------------------------------------------------------//
 int main(int argc, const char** argv) {
    // 測試方法:
    // - 建立 RcServer: TcpServer + RcServerFactory
@@ -198,12 +352,23 @@ int main(int argc, const char** argv) {
    #endif
 
    f9rc_RcFlag  rcflag{};
+   bool         isBench = false;
    for (int L = 1; L < argc; ++L) {
       if (strcmp(argv[L], "NoChecksum") == 0)
          rcflag |= f9rc_RcFlag_NoChecksum;
+      else if (strcmp(argv[L], "Bench") == 0)
+         isBench = true;
    }
 
    fon9::AutoPrintTestInfo utinfo("Rc_UT");
+   TestChecksum();
+   if (isBench) {
+      // 僅執行效能測試, 不建立連線.
+      BenchChecksum();
+      BenchFanout(false);
+      BenchFanout(true);
+      return 0;
+   }
    fon9::GetDefaultThreadPool();
    fon9::GetDefaultTimerThread();
 
@@ -3,6 +3,7 @@
 #include "fon9/seed/FileImpTree.hpp"
 #include "fon9/seed/FieldMaker.hpp"
 #include "fon9/DefaultThreadPool.hpp"
+#include "fon9/Log.hpp"
 #include <sys/stat.h>
 
 namespace fon9 { namespace seed {
@@ -7,6 +7,8 @@ namespace fon9 { namespace seed {
 
 SeedNotifyArgs::~SeedNotifyArgs() {
 }
+SeedNotifyArgs::SubrCache::~SubrCache() {
+}
 void SeedNotifyArgs::MakeGridView() const {
    if (this->NotifyKind_ == SeedNotifyKind::TableChanged) {
       CountDownLatch waiter{1};
@@ -86,6 +86,15 @@ public:
 
    virtual ~SeedNotifyArgs();
 
+   /// 提供給訂閱者: 在「同一次通知」的多個訂閱者之間, 共用由 GetGridView() 衍生的資料.
+   /// - 例: fon9/rc/RcSeedVisitorServer.cpp 將 gv 打包一次, 讓全部的 rc 訂閱者共用.
+   /// - 由訂閱者自行建立及解釋, 發行者不應使用.
+   /// - 通知訂閱者時是依序呼叫, 所以不用考慮 thread safe.
+   struct fon9_API SubrCache {
+      virtual ~SubrCache();
+   };
+   mutable std::unique_ptr<SubrCache>  SubrCache_;
+
    /// - NotifyKind = SeedChanged:
    ///   - 預設: 不含 this->KeyText_, 僅包含 Tab_.Fields_, 頭尾不含分隔字元,
    ///     也就是使用: FieldsCellRevPrint0NoSpl();